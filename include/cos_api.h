@@ -1,15 +1,26 @@
 #ifndef COS_API_H
 #define COS_API_H
 
+#include <pthread.h>
+
+#include "op/async_result.h"
 #include "op/bucket_op.h"
 #include "op/cos_result.h"
 #include "op/object_op.h"
 #include "op/service_op.h"
+#include "util/hedged_request.h"
 #include "util/simple_mutex.h"
+#include "util/task_executor.h"
 #include "Poco/SharedPtr.h"
 
 namespace qcloud_cos {
 
+typedef Poco::SharedPtr<AsyncResult<HeadObjectResp> > HeadObjectAsyncResultPtr;
+typedef Poco::SharedPtr<AsyncResult<GetObjectByFileResp> > GetObjectByFileAsyncResultPtr;
+typedef Poco::SharedPtr<AsyncResult<MultiGetObjectResp> > MultiGetObjectAsyncResultPtr;
+typedef Poco::SharedPtr<AsyncResult<PutObjectByFileResp> > PutObjectByFileAsyncResultPtr;
+typedef Poco::SharedPtr<AsyncResult<MultiUploadObjectResp> > MultiUploadObjectAsyncResultPtr;
+
 class CosAPI {
 public:
     /// \brief CosAPI构造函数
@@ -22,6 +33,15 @@ public:
     /// \brief 设置密钥
     void SetCredentail(const std::string& ak, const std::string& sk, const std::string& token);
 
+    /// \brief 设置密钥提供者, 同步获取一次密钥后由后台线程在临时密钥过期前自动刷新
+    ///
+    /// \param provider            密钥提供者, 如向业务的STS服务申请临时密钥
+    /// \param refresh_ahead_in_s  提前多少秒刷新
+    ///
+    /// \return 首次获取密钥失败时返回false
+    bool SetCredentialProvider(const Poco::SharedPtr<CredentialProvider>& provider,
+                               uint64_t refresh_ahead_in_s = 300);
+
     /// \brief 获取 Bucket 所在的地域信息
     std::string GetBucketLocation(const std::string& bucket_name);
 
@@ -41,12 +61,41 @@ public:
                                      uint64_t start_time_in_s,
                                      uint64_t end_time_in_s);
 
+    /// \brief 批量生成预签名链接, 同一批次只派生一次签名密钥并共享host前缀,
+    ///        适合一次为大量对象生成链接
+    ///
+    /// \param object_names  对象名列表
+    /// \param urls          按object_names的顺序写入链接, 会被调整为与object_names相同的大小
+    /// \param thread_num    大于1时把批次分段并行签名, 最多使用thread_num个执行器线程
+    ///
+    /// \return 密钥为空无法签名时返回false
+    bool GeneratePresignedUrls(const std::string& bucket_name,
+                               const std::vector<std::string>& object_names,
+                               HTTP_METHOD http_method,
+                               uint64_t start_time_in_s,
+                               uint64_t end_time_in_s,
+                               std::vector<std::string>* urls,
+                               unsigned thread_num = 1);
+
     /// \brief 判断Bucket是否存在
     bool IsBucketExist(const std::string& bucket_name);
 
     /// \brief 判断Object是否存在
     bool IsObjectExist(const std::string& bucket_name, const std::string& object_name);
 
+    /// \brief 获取进程内HTTPS连接的TLS握手统计
+    ///
+    /// \param full_handshake_num     完整握手次数
+    /// \param resumed_handshake_num  通过session恢复的握手次数
+    void GetTlsHandshakeNum(uint64_t* full_handshake_num, uint64_t* resumed_handshake_num);
+
+    /// \brief 获取多线程上传/下载/复制共享的任务执行器的运行统计
+    void GetExecutorStats(TaskExecutorStats* stats);
+
+    /// \brief 获取GET/HEAD请求对冲的运行统计, 对冲率为m_hedge_num / m_request_num,
+    ///        对冲胜出率为m_hedge_win_num / m_hedge_num
+    void GetHedgeStats(HedgeStats* stats);
+
     /// \brief 创建一个Bucket
     ///        详见: https://cloud.tencent.com/document/api/436/8291
     ///
@@ -333,6 +382,38 @@ public:
     CosResult MultiUploadObject(const MultiUploadObjectReq& request,
                                 MultiUploadObjectResp* response);
 
+    /// \brief 以下为异步接口, 请求在AsynThreadPoolSize大小的线程池中执行, 调用立即返回
+    ///        可通过返回的句柄等待结果, 或传入callback在请求完成后回调
+    ///        请求参数会被拷贝, CosAPI析构时会等待其发起的异步请求全部完成
+    ///        注意: 异步接口只是把同步接口放到线程池中执行, 每个进行中的请求在整个
+    ///        请求期间(含重试等待)独占一个线程池线程, 同时进行的异步请求数不超过
+    ///        AsynThreadPoolSize, 超出的请求在线程池中排队, 排队时间计入请求耗时;
+    ///        线程池由进程内所有CosAPI对象共享. 大量并发的小请求需相应调大线程池
+    ///
+    /// \param request   同对应的同步接口
+    /// \param callback  完成回调, 在线程池线程中执行, 可为空
+    ///
+    /// \return 异步结果句柄
+    HeadObjectAsyncResultPtr AsyncHeadObject(const HeadObjectReq& request,
+            const AsyncResult<HeadObjectResp>::Callback& callback
+                = AsyncResult<HeadObjectResp>::Callback());
+
+    GetObjectByFileAsyncResultPtr AsyncGetObject(const GetObjectByFileReq& request,
+            const AsyncResult<GetObjectByFileResp>::Callback& callback
+                = AsyncResult<GetObjectByFileResp>::Callback());
+
+    MultiGetObjectAsyncResultPtr AsyncGetObject(const MultiGetObjectReq& request,
+            const AsyncResult<MultiGetObjectResp>::Callback& callback
+                = AsyncResult<MultiGetObjectResp>::Callback());
+
+    PutObjectByFileAsyncResultPtr AsyncPutObject(const PutObjectByFileReq& request,
+            const AsyncResult<PutObjectByFileResp>::Callback& callback
+                = AsyncResult<PutObjectByFileResp>::Callback());
+
+    MultiUploadObjectAsyncResultPtr AsyncMultiUploadObject(const MultiUploadObjectReq& request,
+            const AsyncResult<MultiUploadObjectResp>::Callback& callback
+                = AsyncResult<MultiUploadObjectResp>::Callback());
+
     /// \brief 舍弃一个分块上传并删除已上传的块
     ///        详见: https://www.qcloud.com/document/product/436/7740
     ///
@@ -556,6 +637,21 @@ private:
     int CosInit();
     void CosUInit();
 
+    // 将ObjectOp的同步接口投递到异步线程池执行
+    template <class ReqType, class RespType>
+    Poco::SharedPtr<AsyncResult<RespType> > ScheduleAsyncTask(
+            CosResult (ObjectOp::*func)(const ReqType&, RespType*),
+            const ReqType& request,
+            const typename AsyncResult<RespType>::Callback& callback);
+
+    template <class ReqType, class RespType>
+    void RunAsyncTask(CosResult (ObjectOp::*func)(const ReqType&, RespType*),
+                      const ReqType& request,
+                      Poco::SharedPtr<AsyncResult<RespType> > async_result);
+
+    // 等待本对象发起的异步请求全部完成
+    void WaitAsyncTasks();
+
 private:
     // Be careful with the m_config order
     Poco::SharedPtr<CosConfig> m_config;
@@ -563,6 +659,10 @@ private:
     BucketOp m_bucket_op; // 内部封装bucket相关的操作
     ServiceOp m_service_op; // 内部封装service相关的操作
 
+    pthread_mutex_t m_async_mutex;
+    pthread_cond_t m_async_cond;
+    unsigned m_async_task_num; // 本对象尚未完成的异步请求数
+
     static SimpleMutex s_init_mutex;
     static bool s_init;
     static bool s_poco_init;
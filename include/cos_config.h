@@ -4,6 +4,10 @@
 #include <stdint.h>
 
 #include <string>
+
+#include "Poco/SharedPtr.h"
+
+#include "util/credential.h"
 #include "util/simple_mutex.h"
 
 namespace qcloud_cos{
@@ -15,7 +19,7 @@ public:
     explicit CosConfig(const std::string& config_file);
 
     /// \brief CosConfig构造函数
-    CosConfig() : m_app_id(0), m_access_key(""), m_secret_key(""), m_region(""), m_tmp_token(""), m_config_parsed(false) {}
+    CosConfig() : m_app_id(0), m_region(""), m_config_parsed(false) {}
 
     /// \brief CosConfig构造函数
     ///
@@ -26,8 +30,9 @@ public:
               const std::string& access_key,
               const std::string& secret_key,
               const std::string& region)
-        : m_app_id(appid), m_access_key(access_key),
-        m_secret_key(secret_key), m_region(region), m_tmp_token(""), m_config_parsed(false) {}
+        : m_app_id(appid), m_region(region), m_config_parsed(false) {
+        m_credential.Set(Credential(access_key, secret_key, ""));
+    }
 
     /// \brief CosConfig构造函数
     ///
@@ -39,30 +44,30 @@ public:
               const std::string& secret_key,
               const std::string& region,
               const std::string& tmp_token)
-        : m_app_id(appid), m_access_key(access_key),
-        m_secret_key(secret_key), m_region(region), m_tmp_token(tmp_token), m_config_parsed(false) {}
+        : m_app_id(appid), m_region(region), m_config_parsed(false) {
+        m_credential.Set(Credential(access_key, secret_key, tmp_token));
+    }
 
-    /// \brief CosConfig复制构造函数
+    /// \brief CosConfig复制构造函数, 只复制当前的密钥, 不复制密钥的后台刷新
     ///
     /// \param config
     CosConfig(const CosConfig& config) {
         m_app_id = config.m_app_id;
-        m_access_key = config.m_access_key;
-        m_secret_key = config.m_secret_key;
+        m_credential.Set(*config.GetCredential());
         m_region = config.m_region;
-        m_tmp_token = config.m_tmp_token;
         m_config_parsed = config.m_config_parsed;
     }
 
-    /// \brief CosConfig赋值构造函数
+    /// \brief CosConfig赋值构造函数, 只复制当前的密钥, 不复制密钥的后台刷新
     ///
     /// \param config
     CosConfig& operator=(const CosConfig& config) {
+        if (this == &config) {
+            return *this;
+        }
         m_app_id = config.m_app_id;
-        m_access_key = config.m_access_key;
-        m_secret_key = config.m_secret_key;
+        m_credential.Set(*config.GetCredential());
         m_region = config.m_region;
-        m_tmp_token = config.m_tmp_token;
         m_config_parsed = config.m_config_parsed;
         return *this;
     }
@@ -98,25 +103,38 @@ public:
     /// \brief 获取临时密钥
     std::string GetTmpToken() const;
 
+    /// \brief 获取当前密钥的快照, 不加锁, 同一快照中的AccessKey/SecretKey/TmpToken相互匹配
+    ///        密钥被替换后快照仍会保留一段时间, 只应在一次请求的组包和签名过程中使用
+    const Credential* GetCredential() const { return m_credential.Get(); }
+
     /// \brief 设置AppID
     void SetAppId(uint64_t app_id) { m_app_id = app_id; }
 
     /// \brief 设置AccessKey
-    void SetAccessKey(const std::string& access_key) { m_access_key = access_key; }
+    void SetAccessKey(const std::string& access_key);
 
     /// \brief 设置SecreteKey
-    void SetSecretKey(const std::string& secret_key) { m_secret_key = secret_key; }
+    void SetSecretKey(const std::string& secret_key);
 
     /// \brief 设置操作的Region
     ///        region的有效值参见https://cloud.tencent.com/document/product/436/6224
     void SetRegion(const std::string& region) { m_region = region; }
 
     /// \brief 设置临时密钥
-    void SetTmpToken(const std::string& tmp_token) { m_tmp_token = tmp_token; }
+    void SetTmpToken(const std::string& tmp_token);
 
     /// \brief 更新临时密钥
     void SetConfigCredentail(const std::string& access_key, const std::string& secret_key, const std::string& tmp_token);
 
+    /// \brief 设置密钥提供者, 同步获取一次密钥后由后台线程在密钥过期前自动刷新
+    ///
+    /// \param provider            密钥提供者
+    /// \param refresh_ahead_in_s  提前多少秒刷新, 有效期短于两倍提前量时在剩余有效期过半时刷新
+    ///
+    /// \return 首次获取密钥失败时返回false, 不启动后台刷新
+    bool SetCredentialProvider(const Poco::SharedPtr<CredentialProvider>& provider,
+                               uint64_t refresh_ahead_in_s = 300);
+
     /// \brief 设置是否使用自定义ip和端口号
     void SetIsUseIntranetAddr(bool is_use_intranet);
 
@@ -124,13 +142,14 @@ public:
     void SetIntranetAddr(const std::string& intranet_addr);
    
 private:
-    mutable SimpleRWLock m_lock;
+    // 只修改部分密钥的Set接口需读取当前快照再替换, 互斥以免相互覆盖
+    SimpleMutex m_credential_mutex;
     uint64_t m_app_id;
-    std::string m_access_key;
-    std::string m_secret_key;
+    AtomicCredential m_credential;
     std::string m_region;
-    std::string m_tmp_token;
     bool m_config_parsed;
+    // 需先于m_credential析构
+    Poco::SharedPtr<CredentialRefresher> m_credential_refresher;
 };
 
 } // namespace qcloud_cos
@@ -67,6 +67,11 @@ typedef enum compress_type {
     COMPRESS_BZIP2
 } SELECT_COMPRESS_TYPE;
 
+typedef enum dns_rotate_policy {
+    DNS_ROTATE_ROUND_ROBIN = 0,     // 在域名的多个地址间轮询
+    DNS_ROTATE_LEAST_LOADED         // 优先选择已建立连接最少的地址
+} DNS_ROTATE_POLICY;
+
 #define LOG_LEVEL_STRING(level) \
         ( (level == COS_LOG_DBG) ? "[DBG] " :    \
           (level == COS_LOG_INFO) ? "[INFO] " :  \
@@ -51,6 +51,67 @@ public:
     /// \brief 设置长连接的参数
     static void SetKeepIntvl(int64_t keepintvl);
 
+    /// \brief 设置连接池中每个host最多保留的空闲连接数,默认: 32
+    static void SetMaxIdleSessionsPerHost(unsigned num);
+
+    /// \brief 设置空闲连接的最长保留时间,超时后关闭,单位:毫秒,默认: 15000
+    static void SetIdleSessionTimeoutInms(uint64_t time);
+
+    /// \brief 设置共享任务执行器的线程数,0表示按CPU核数自动确定,默认: 0
+    ///        需在首次发起多线程上传/下载/复制之前设置
+    static void SetExecutorThreadNum(unsigned num);
+
+    /// \brief 设置请求失败后的最大重试次数,0表示不重试,默认: 3
+    static void SetMaxRetryTimes(unsigned times);
+
+    /// \brief 设置重试退避的初始等待时间,每次重试翻倍并随机抖动,单位:毫秒,默认: 100
+    ///        服务端限流(503 SlowDown)时以其10倍为初始等待时间
+    static void SetRetryBaseDelayInms(uint64_t time);
+
+    /// \brief 设置重试退避的最大等待时间,单位:毫秒,默认: 5000
+    static void SetRetryMaxDelayInms(uint64_t time);
+
+    /// \brief 设置是否开启GET/HEAD请求的对冲,默认: false
+    ///        原请求超过对冲等待时间仍未收到响应时, 再发出一个相同的请求, 先收到响应的一方胜出
+    static void SetHedgeEnable(bool enable);
+
+    /// \brief 设置对冲等待时间取近期首字节耗时的百分位数,取值[1, 100],默认: 95
+    static void SetHedgeDelayPercentile(unsigned percentile);
+
+    /// \brief 设置对冲等待时间的下限,单位:毫秒,默认: 10
+    static void SetHedgeMinDelayInms(uint64_t time);
+
+    /// \brief 设置使用Expect: 100-continue的请求体大小阈值,单位:字节,默认: 0(不使用)
+    ///        请求体大于等于该值(或长度未知)时, 先发送请求头, 收到服务端的100 Continue后再发送请求体,
+    ///        服务端因签名错误或限流等直接拒绝时不再发送请求体
+    static void SetExpectContinueThreshold(uint64_t threshold);
+
+    /// \brief 设置等待100 Continue的超时时间,单位:毫秒,默认: 1000
+    ///        超时未收到时视为服务端不支持, 直接发送请求体
+    static void SetExpectContinueTimeoutInms(uint64_t time);
+
+    /// \brief 设置列举类请求是否接受gzip压缩的响应,默认: false
+    ///        开启后GetBucket/ListParts等列举请求携带Accept-Encoding: gzip,
+    ///        响应在解析xml前边接收边解压, 仅在服务端支持gzip时开启
+    static void SetListGzipEnable(bool enable);
+
+    /// \brief 设置HTTP传输层,默认: "poco"
+    ///        "curl"为基于libcurl multi事件循环的实现, 需在编译时开启ENABLE_CURL_TRANSPORT
+    static void SetHttpTransport(const std::string& name);
+
+    /// \brief 是否开启SDK内的DNS缓存, 开启后新建连接时使用缓存的解析结果,
+    ///        并在域名解析出的多个地址间轮转, 连接失败时切换到下一个地址
+    static void SetDnsCacheEnable(bool enable);
+
+    /// \brief 设置DNS缓存中解析结果的有效期, 单位ms
+    static void SetDnsCacheTtlInms(uint64_t time);
+
+    /// \brief 设置解析失败结果的缓存时间, 以及连接失败的地址被降低优先级的时间, 单位ms
+    static void SetDnsNegativeTtlInms(uint64_t time);
+
+    /// \brief 设置在域名的多个地址间选择的策略
+    static void SetDnsRotatePolicy(DNS_ROTATE_POLICY policy);
+
     static void SetDestDomain(const std::string& dest_domain);
 
     /// \brief 获取签名超时时间,单位秒
@@ -94,6 +155,57 @@ public:
     static int64_t GetKeepIdle();
     static int64_t GetKeepIntvl();
 
+    /// \brief 获取连接池中每个host最多保留的空闲连接数
+    static unsigned GetMaxIdleSessionsPerHost();
+
+    /// \brief 获取空闲连接的最长保留时间,单位:毫秒
+    static uint64_t GetIdleSessionTimeoutInms();
+
+    /// \brief 获取共享任务执行器的线程数,0表示自动确定
+    static unsigned GetExecutorThreadNum();
+
+    /// \brief 获取请求失败后的最大重试次数
+    static unsigned GetMaxRetryTimes();
+
+    /// \brief 获取重试退避的初始等待时间,单位:毫秒
+    static uint64_t GetRetryBaseDelayInms();
+
+    /// \brief 获取重试退避的最大等待时间,单位:毫秒
+    static uint64_t GetRetryMaxDelayInms();
+
+    /// \brief 获取是否开启GET/HEAD请求的对冲
+    static bool IsHedgeEnable();
+
+    /// \brief 获取对冲等待时间取近期首字节耗时的百分位数
+    static unsigned GetHedgeDelayPercentile();
+
+    /// \brief 获取对冲等待时间的下限,单位:毫秒
+    static uint64_t GetHedgeMinDelayInms();
+
+    /// \brief 获取使用Expect: 100-continue的请求体大小阈值,单位:字节
+    static uint64_t GetExpectContinueThreshold();
+
+    /// \brief 获取等待100 Continue的超时时间,单位:毫秒
+    static uint64_t GetExpectContinueTimeoutInms();
+
+    /// \brief 获取列举类请求是否接受gzip压缩的响应
+    static bool IsListGzipEnable();
+
+    /// \brief 获取HTTP传输层的名称
+    static std::string GetHttpTransport();
+
+    /// \brief 是否开启DNS缓存
+    static bool IsDnsCacheEnable();
+
+    /// \brief 获取DNS缓存中解析结果的有效期, 单位ms
+    static uint64_t GetDnsCacheTtlInms();
+
+    /// \brief 获取解析失败结果的缓存时间, 单位ms
+    static uint64_t GetDnsNegativeTtlInms();
+
+    /// \brief 获取在域名的多个地址间选择的策略
+    static DNS_ROTATE_POLICY GetDnsRotatePolicy();
+
     /// \brief 下载过程中是否检查MD5
     static bool IsCheckMd5();
 
@@ -137,7 +249,7 @@ private:
     static uint64_t m_recv_timeout_in_ms;
     // 单文件分片并发上传线程池大小(每个文件一个)
     static unsigned m_threadpool_size;
-    // 异步上传下载线程池大小(全局就一个)(暂时没有使用)
+    // 异步上传下载线程池大小(全局就一个)
     static unsigned m_asyn_threadpool_size;
     // 下载文件到本地线程池大小
     static unsigned m_down_thread_pool_size;
@@ -149,6 +261,40 @@ private:
     static int64_t m_keep_idle;
     // 每个keepalive探针时间间隔，单位s
     static int64_t m_keep_intvl;
+    // 连接池中每个host最多保留的空闲连接数
+    static unsigned m_max_idle_sessions_per_host;
+    // 空闲连接最长保留时间(毫秒)
+    static uint64_t m_idle_session_timeout_in_ms;
+    // 共享任务执行器线程数, 0表示按CPU核数自动确定
+    static unsigned m_executor_thread_num;
+    // 请求失败后的最大重试次数
+    static unsigned m_max_retry_times;
+    // 重试退避的初始等待时间(毫秒)
+    static uint64_t m_retry_base_delay_in_ms;
+    // 重试退避的最大等待时间(毫秒)
+    static uint64_t m_retry_max_delay_in_ms;
+    // 是否开启GET/HEAD请求的对冲
+    static bool m_hedge_enable;
+    // 对冲等待时间取近期首字节耗时的百分位数
+    static unsigned m_hedge_delay_percentile;
+    // 对冲等待时间的下限
+    static uint64_t m_hedge_min_delay_in_ms;
+    // 请求体不小于该值时使用Expect: 100-continue, 0表示不使用
+    static uint64_t m_expect_continue_threshold;
+    // 等待100 Continue的超时时间
+    static uint64_t m_expect_continue_timeout_in_ms;
+    // 列举类请求是否接受gzip压缩的响应
+    static bool m_list_gzip_enable;
+    // HTTP传输层的名称
+    static std::string m_http_transport;
+    // 是否开启DNS缓存
+    static bool m_dns_cache_enable;
+    // DNS缓存中解析结果的有效期, 单位ms
+    static uint64_t m_dns_cache_ttl_in_ms;
+    // 解析失败结果的缓存时间, 单位ms
+    static uint64_t m_dns_negative_ttl_in_ms;
+    // 在域名的多个地址间选择的策略
+    static DNS_ROTATE_POLICY m_dns_rotate_policy;
     // 下载时是否检查md5
     static bool m_is_check_md5;
     
@@ -0,0 +1,112 @@
+#ifndef ASYNC_RESULT_H
+#define ASYNC_RESULT_H
+#pragma once
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include <boost/function.hpp>
+
+#include "op/cos_result.h"
+#include "util/noncopyable.h"
+
+namespace qcloud_cos {
+
+/// \brief 异步请求的结果句柄, 请求在异步线程池中执行, 调用方可等待结果或注册完成回调
+///
+/// \tparam RespType 对应同步接口的Response类型
+template <class RespType>
+class AsyncResult : private NonCopyable {
+public:
+    /// \brief 完成回调, 在异步线程池的线程中执行, 不应长时间阻塞
+    typedef boost::function<void (const CosResult&, const RespType&)> Callback;
+
+    AsyncResult() : m_done(false) {
+        pthread_mutex_init(&m_mutex, NULL);
+        pthread_cond_init(&m_cond, NULL);
+    }
+
+    ~AsyncResult() {
+        pthread_cond_destroy(&m_cond);
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    /// \brief 请求是否已完成
+    bool IsDone() {
+        pthread_mutex_lock(&m_mutex);
+        bool done = m_done;
+        pthread_mutex_unlock(&m_mutex);
+        return done;
+    }
+
+    /// \brief 阻塞等待请求完成
+    void Wait() {
+        pthread_mutex_lock(&m_mutex);
+        while (!m_done) {
+            pthread_cond_wait(&m_cond, &m_mutex);
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    /// \brief 最多等待timeout_in_ms毫秒, 返回请求是否已完成
+    bool WaitFor(uint64_t timeout_in_ms) {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        uint64_t deadline_in_us = now.tv_sec * 1000000 + now.tv_usec + timeout_in_ms * 1000;
+        struct timespec deadline;
+        deadline.tv_sec = deadline_in_us / 1000000;
+        deadline.tv_nsec = (deadline_in_us % 1000000) * 1000;
+
+        pthread_mutex_lock(&m_mutex);
+        while (!m_done) {
+            if (pthread_cond_timedwait(&m_cond, &m_mutex, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        bool done = m_done;
+        pthread_mutex_unlock(&m_mutex);
+        return done;
+    }
+
+    /// \brief 等待请求完成并返回请求的调用情况
+    const CosResult& GetResult() {
+        Wait();
+        return m_result;
+    }
+
+    /// \brief 等待请求完成并返回Response
+    const RespType& GetResp() {
+        Wait();
+        return m_resp;
+    }
+
+    /// \brief 以下接口由SDK内部在执行请求时调用
+    void SetCallback(const Callback& callback) { m_callback = callback; }
+
+    RespType* MutableResp() { return &m_resp; }
+
+    void Done(const CosResult& result) {
+        pthread_mutex_lock(&m_mutex);
+        m_result = result;
+        m_done = true;
+        pthread_cond_broadcast(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+
+        if (m_callback) {
+            m_callback(m_result, m_resp);
+        }
+    }
+
+private:
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    bool m_done;
+    CosResult m_result;
+    RespType m_resp;
+    Callback m_callback;
+};
+
+} // namespace qcloud_cos
+#endif // ASYNC_RESULT_H
@@ -14,6 +14,9 @@ namespace qcloud_cos{
 
 class BaseReq;
 class BaseResp;
+class BodySource;
+class CanonicalRequest;
+class Credential;
 
 class BaseOp {
 public:
@@ -68,6 +71,7 @@ public:
     /// \param additional_params  http请求需要所需的额外params
     /// \param req_body http request的body
     /// \param resp     http返回
+    /// \param is_decode_gzip 是否解压gzip压缩的响应体, 只应在请求主动声明接受gzip时开启
     ///
     /// \return http调用情况(状态码等)
     CosResult NormalAction(const std::string& host,
@@ -77,7 +81,22 @@ public:
                            const std::map<std::string, std::string>& additional_params,
                            const std::string& req_body,
                            bool check_body,
-                           BaseResp* resp);
+                           BaseResp* resp,
+                           bool is_decode_gzip = false);
+
+    /// \brief 列举类请求(GetBucket/ListParts等)的通用操作, 无请求体
+    ///        开启CosSysConfig::SetListGzipEnable时接受gzip压缩的响应, 解压后再解析
+    ///
+    /// \param host     目标主机, 以http://开头
+    /// \param path     http path
+    /// \param req      http请求
+    /// \param resp     http返回
+    ///
+    /// \return http调用情况(状态码等)
+    CosResult ListAction(const std::string& host,
+                         const std::string& path,
+                         const BaseReq& req,
+                         BaseResp* resp);
 
     /// \brief 下载文件并输出到流中
     ///
@@ -113,10 +132,39 @@ public:
                            std::istream& is,
                            BaseResp* resp);
 
+    /// \brief 从BodySource读入数据并上传, 参数同上
+    CosResult UploadAction(const std::string& host,
+                           const std::string& path,
+                           const BaseReq& req,
+                           const std::map<std::string, std::string>& additional_headers,
+                           const std::map<std::string, std::string>& additional_params,
+                           BodySource& body,
+                           BaseResp* resp);
+
     std::string GetRealUrl(const std::string& host,
                            const std::string& path,
                            bool is_https);
 
+    /// \brief 用一份密钥快照为请求签名: 临时密钥时设置x-cos-security-token,
+    ///        再由params和headers生成canonical_req并计算Authorization
+    ///        每次发送(包括重试)前都应读取新的快照并调用, 使后台刷新的密钥在重试时生效,
+    ///        快照也不会跨越重试前的退避等待被持有
+    ///
+    /// \param credential    本次发送使用的密钥快照
+    /// \param method        http方法
+    /// \param path          http path
+    /// \param params        http params
+    /// \param headers       http headers, 返回时已填充签名相关的header
+    /// \param canonical_req 返回签名所用的规范化请求, 发送时复用其中的query串
+    ///
+    /// \return 签名失败(如密钥为空)时返回false
+    static bool SignRequest(const Credential& credential,
+                            const std::string& method,
+                            const std::string& path,
+                            const std::map<std::string, std::string>& params,
+                            std::map<std::string, std::string>* headers,
+                            CanonicalRequest* canonical_req);
+
 
 protected:
     Poco::SharedPtr<CosConfig> m_config;
@@ -13,6 +13,8 @@
 #include <string>
 #include <stdint.h>
 
+#include "util/request_timing.h"
+
 
 namespace qcloud_cos {
 
@@ -22,7 +24,8 @@ class CosResult {
 public:
     CosResult()
         : m_is_succ(false), m_http_status(-1), m_error_info(""), m_err_code(""),
-          m_err_msg(""), m_resource_addr(""), m_x_cos_request_id(""), m_x_cos_trace_id("") {}
+          m_err_msg(""), m_resource_addr(""), m_x_cos_request_id(""), m_x_cos_trace_id(""),
+          m_real_byte(0), m_attempt_num(0) {}
 
     ~CosResult() {}
 
@@ -36,6 +39,8 @@ public:
         m_x_cos_request_id = other.m_x_cos_request_id;
         m_x_cos_trace_id = other.m_x_cos_trace_id;
         m_real_byte = other.m_real_byte;
+        m_attempt_num = other.m_attempt_num;
+        m_timing = other.m_timing;
     }
 
     CosResult& operator=(const CosResult& other) {
@@ -49,6 +54,8 @@ public:
             m_x_cos_request_id = other.m_x_cos_request_id;
             m_x_cos_trace_id = other.m_x_cos_trace_id;
             m_real_byte = other.m_real_byte;
+            m_attempt_num = other.m_attempt_num;
+            m_timing = other.m_timing;
         }
         return *this;
     }
@@ -80,6 +87,11 @@ public:
     std::string GetXCosRequestId() const { return m_x_cos_request_id; }
     std::string GetXCosTraceId() const { return m_x_cos_trace_id; }
     uint64_t GetRealByte() const { return m_real_byte; }
+    /// \brief 发送请求的次数, 包括失败后的重试
+    unsigned GetAttemptNum() const { return m_attempt_num; }
+    /// \brief 各阶段耗时及收发字节数, 为所有尝试(包括重试)之和;
+    ///        分块上传/下载/复制时为所有分块请求之和
+    const RequestTiming& GetTiming() const { return m_timing; }
 
     // Setter
     void SetErrorInfo(const std::string& result) { m_error_info = result; }
@@ -99,6 +111,15 @@ public:
     void SetRealByte(uint64_t real_byte) {
         m_real_byte = real_byte;
     }
+    void SetAttemptNum(unsigned attempt_num) {
+        m_attempt_num = attempt_num;
+    }
+    void SetTiming(const RequestTiming& timing) {
+        m_timing = timing;
+    }
+    void AddTiming(const RequestTiming& timing) {
+        m_timing.Add(timing);
+    }
     /// \brief 输出Result的具体信息
     std::string DebugString() const;
 
@@ -115,6 +136,8 @@ private:
     std::string m_x_cos_request_id;
     std::string m_x_cos_trace_id;
     uint64_t m_real_byte;
+    unsigned m_attempt_num; // 发送请求的次数
+    RequestTiming m_timing; // 各阶段耗时
 };
 
 } // namespace qcloud_cos
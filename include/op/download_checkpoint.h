@@ -0,0 +1,60 @@
+#ifndef DOWNLOAD_CHECKPOINT_H
+#define DOWNLOAD_CHECKPOINT_H
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "util/noncopyable.h"
+
+namespace qcloud_cos {
+
+/// \brief 多线程下载的断点记录文件
+///        首部记录object的etag、大小和分片大小, 之后每下载完成一个分片追加一行
+///        格式:
+///          etag=<etag>
+///          file_size=<file_size>
+///          slice_size=<slice_size>
+///          slice=<slice_index>
+class DownloadCheckpoint : private NonCopyable {
+public:
+    explicit DownloadCheckpoint(const std::string& checkpoint_file);
+
+    ~DownloadCheckpoint();
+
+    /// \brief 加载断点文件, 文件不存在或格式错误时返回false
+    bool Load();
+
+    /// \brief 新建断点文件, 覆盖已有内容
+    bool Create(const std::string& etag, uint64_t file_size, uint64_t slice_size);
+
+    /// \brief 记录一个已下载完成的分片, 线程安全
+    bool AppendSlice(uint64_t slice_index);
+
+    /// \brief 断点记录的object信息与当前object是否一致
+    bool IsMatch(const std::string& etag, uint64_t file_size, uint64_t slice_size) const;
+
+    /// \brief 删除断点文件
+    void Remove();
+
+    /// \brief 已完成分片的位图, 下标为分片序号
+    const std::vector<bool>& GetSliceBitmap() const { return m_slice_bitmap; }
+
+    /// \brief 已完成的分片数
+    uint64_t GetFinishedSliceNum() const;
+
+private:
+    std::string m_checkpoint_file;
+    pthread_mutex_t m_mutex;
+
+    std::string m_etag;
+    uint64_t m_file_size;
+    uint64_t m_slice_size;
+    std::vector<bool> m_slice_bitmap;
+};
+
+} // namespace qcloud_cos
+#endif // DOWNLOAD_CHECKPOINT_H
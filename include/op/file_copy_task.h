@@ -42,16 +42,29 @@ public:
 
     void SetHeaders(const std::map<std::string, std::string>& headers);
 
+    /// \brief 设置签名所需的配置与path, 每次发送(包括重试)前读取最新的密钥快照重新签名
+    void SetSignInfo(const Poco::SharedPtr<CosConfig>& config, const std::string& path);
+
     std::string GetErrMsg() const { return m_err_msg; }
 
     std::string GetEtag() const { return m_etag; }
 
     std::string GetLastModified() const { return m_last_modified; }
 
+    unsigned GetAttemptNum() const { return m_attempt_num; }
+
+    /// \brief 最近一个分块的耗时, 包括其重试
+    const RequestTiming& GetTiming() const { return m_timing; }
+
+    /// \brief 本任务执行过的所有分块的耗时之和
+    const RequestTiming& GetTotalTiming() const { return m_total_timing; }
+
 private:
     std::string m_full_url;
     std::map<std::string, std::string> m_headers;
     std::map<std::string, std::string> m_params;
+    Poco::SharedPtr<CosConfig> m_config;
+    std::string m_path;
     uint64_t m_conn_timeout_in_ms;
     uint64_t m_recv_timeout_in_ms;
     std::string m_resp;
@@ -61,6 +74,9 @@ private:
     std::string m_err_msg;
     std::string m_etag;
     std::string m_last_modified;
+    unsigned m_attempt_num;
+    RequestTiming m_timing;
+    RequestTiming m_total_timing;
 };
 
 }
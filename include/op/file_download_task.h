@@ -12,6 +12,7 @@
 #include <pthread.h>
 
 #include <string>
+#include <vector>
 
 #include "cos_config.h"
 #include "cos_defines.h"
@@ -32,8 +33,8 @@ public:
                  const std::map<std::string, std::string>& params,
                  uint64_t conn_timeout_in_ms,
                  uint64_t recv_timeout_in_ms,
+                 int fd = -1,
                  uint64_t offset = 0,
-                 unsigned char* pbuf = NULL,
                  const size_t data_len = 0);
 
     ~FileDownTask() {}
@@ -42,7 +43,11 @@ public:
 
     void DownTask();
 
-    void SetDownParams(unsigned char* pdatabuf, size_t datalen, uint64_t offset);
+    /// \brief 设置下载区间, 数据通过pwrite直接写入fd的offset处
+    void SetDownParams(int fd, size_t datalen, uint64_t offset);
+
+    /// \brief 设置签名所需的配置与path, 每次发送(包括重试)前读取最新的密钥快照重新签名
+    void SetSignInfo(const Poco::SharedPtr<CosConfig>& config, const std::string& path);
 
     std::string GetTaskResp();
 
@@ -56,14 +61,24 @@ public:
 
     std::string GetErrMsg() const { return m_err_msg; }
 
+    unsigned GetAttemptNum() const { return m_attempt_num; }
+
+    /// \brief 最近一个分块的耗时, 包括其重试
+    const RequestTiming& GetTiming() const { return m_timing; }
+
+    /// \brief 本任务执行过的所有分块的耗时之和
+    const RequestTiming& GetTotalTiming() const { return m_total_timing; }
+
 private:
     std::string m_full_url;
     std::map<std::string, std::string> m_headers;
     std::map<std::string, std::string> m_params;
+    Poco::SharedPtr<CosConfig> m_config;
+    std::string m_path;
     uint64_t m_conn_timeout_in_ms;
     uint64_t m_recv_timeout_in_ms;
+    int m_fd;
     uint64_t m_offset;
-    unsigned char* m_data_buf_ptr;
     size_t m_data_len;
     std::string m_resp;
     bool m_is_task_success;
@@ -71,6 +86,37 @@ private:
     int m_http_status;
     std::map<std::string, std::string> m_resp_headers;
     std::string m_err_msg;
+    unsigned m_attempt_num;
+    RequestTiming m_timing;
+    RequestTiming m_total_timing;
+};
+
+/// \brief 多线程下载的分片调度器, 下载线程空闲后立即领取下一个分片,
+///        任一分片失败后停止分发
+class FileDownPipeline {
+public:
+    /// \param finished_slices  已下载完成的分片位图, 其中的分片不再分发
+    FileDownPipeline(uint64_t file_size, uint64_t slice_size,
+                     const std::vector<bool>& finished_slices = std::vector<bool>());
+
+    ~FileDownPipeline();
+
+    /// \brief 领取下一个待下载的分片, 已无分片或已中止时返回false
+    bool NextSlice(uint64_t* offset, size_t* len);
+
+    /// \brief 分片下载失败, 中止后续分发, 仅记录第一个失败的任务
+    void Abort(FileDownTask* failed_task);
+
+    /// \brief 获取失败的下载任务, 未失败时返回NULL
+    FileDownTask* GetFailedTask();
+
+private:
+    pthread_mutex_t m_mutex;
+    uint64_t m_file_size;
+    uint64_t m_slice_size;
+    uint64_t m_next_offset;
+    std::vector<bool> m_finished_slices;
+    FileDownTask* m_failed_task;
 };
 
 } // namespace qcloud_cos
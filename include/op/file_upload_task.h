@@ -4,7 +4,10 @@
 
 #include <pthread.h>
 
+#include <deque>
+#include <map>
 #include <string>
+#include <vector>
 
 #include "cos_config.h"
 #include "cos_defines.h"
@@ -54,14 +57,27 @@ public:
     
     void SetHeaders(const std::map<std::string, std::string>& headers);
 
+    /// \brief 设置签名所需的配置与path, 每次发送(包括重试)前读取最新的密钥快照重新签名
+    void SetSignInfo(const Poco::SharedPtr<CosConfig>& config, const std::string& path);
+
     std::string GetErrMsg() const { return m_err_msg; }
 
+    unsigned GetAttemptNum() const { return m_attempt_num; }
+
+    /// \brief 最近一个分块的耗时, 包括其重试
+    const RequestTiming& GetTiming() const { return m_timing; }
+
+    /// \brief 本任务执行过的所有分块的耗时之和
+    const RequestTiming& GetTotalTiming() const { return m_total_timing; }
+
 private:
     std::string m_full_url;
     const std::map<std::string, std::string> m_base_headers;
     const std::map<std::string, std::string> m_base_params;
     std::map<std::string, std::string> m_final_headers;
     std::map<std::string, std::string> m_final_params;
+    Poco::SharedPtr<CosConfig> m_config;
+    std::string m_path;
     uint64_t m_conn_timeout_in_ms;
     uint64_t m_recv_timeout_in_ms;
     unsigned char*  m_data_buf_ptr;
@@ -71,6 +87,68 @@ private:
     int m_http_status;
     std::map<std::string, std::string> m_resp_headers;
     std::string m_err_msg;
+    unsigned m_attempt_num;
+    RequestTiming m_timing;
+    RequestTiming m_total_timing;
+};
+
+/// \brief 分块上传流水线, 读取线程填充分块缓冲区, 上传线程取出后立即上传,
+///        缓冲区数量固定, 上传完成后归还给读取线程复用
+class FileUploadPipeline {
+public:
+    /// \param buf_num    缓冲区个数, 即流水线窗口大小
+    /// \param part_size  每个缓冲区的大小
+    FileUploadPipeline(size_t buf_num, uint64_t part_size);
+
+    ~FileUploadPipeline();
+
+    /// \brief 读取线程获取一个空闲缓冲区, 无空闲时阻塞, 流水线已中止时返回NULL
+    unsigned char* AcquireFreeBuf();
+
+    /// \brief 读取线程提交一个已填充的分块
+    void PushPart(uint64_t part_number, unsigned char* buf, uint64_t len);
+
+    /// \brief 读取线程通知所有分块已提交
+    void FinishPush();
+
+    /// \brief 归还未提交的缓冲区
+    void ReleaseBuf(unsigned char* buf);
+
+    /// \brief 上传线程取出一个待上传的分块, 无分块时阻塞,
+    ///        所有分块已取完或流水线已中止时返回false
+    bool PopPart(uint64_t* part_number, unsigned char** buf, uint64_t* len);
+
+    /// \brief 上传线程上传成功后记录etag并归还缓冲区
+    void CompletePart(uint64_t part_number, const std::string& etag, unsigned char* buf);
+
+    /// \brief 上传线程上传失败后中止流水线, 仅记录第一个失败的分块
+    void AbortPart(uint64_t part_number, FileUploadTask* failed_task, unsigned char* buf);
+
+    /// \brief 获取失败的上传任务, 未失败时返回NULL
+    FileUploadTask* GetFailedTask() const { return m_failed_task; }
+
+    /// \brief 获取按分块号排序的上传结果
+    const std::map<uint64_t, std::string>& GetPartEtags() const { return m_part_etags; }
+
+private:
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_free_cond;
+    pthread_cond_t m_ready_cond;
+
+    std::vector<unsigned char*> m_bufs;
+    std::deque<unsigned char*> m_free_bufs;
+
+    struct ReadyPart {
+        uint64_t m_part_number;
+        unsigned char* m_buf;
+        uint64_t m_len;
+    };
+    std::deque<ReadyPart> m_ready_parts;
+
+    bool m_push_finished;
+    bool m_aborted;
+    FileUploadTask* m_failed_task;
+    std::map<uint64_t, std::string> m_part_etags;
 };
 
 }
@@ -9,6 +9,8 @@
 #define OBJECT_OP_H
 #pragma once
 
+#include <vector>
+
 #include "op/base_op.h"
 
 #include "op/cos_result.h"
@@ -17,8 +19,13 @@
 
 namespace qcloud_cos {
 
+class DownloadCheckpoint;
+class FileDownPipeline;
+class FileDownTask;
 class FileUploadTask;
+class FileUploadPipeline;
 class FileCopyTask;
+class UploadCheckpoint;
 
 /// \brief 封装了Object相关的操作
 class ObjectOp : public BaseOp {
@@ -205,6 +212,21 @@ public:
 
     std::string GeneratePresignedUrl(const GeneratePresignedUrlReq& req);
 
+    /// \brief 批量生成预签名链接, 同一批次共享签名密钥、签名串前缀和host前缀
+    ///
+    /// \param object_names  对象名列表
+    /// \param urls          按object_names的顺序写入链接, 会被调整为与object_names相同的大小
+    /// \param thread_num    大于1时把批次分段提交到TaskExecutor并行签名
+    ///
+    /// \return 密钥为空无法签名时返回false, urls中均为空串
+    bool GeneratePresignedUrls(const std::string& bucket_name,
+                               const std::vector<std::string>& object_names,
+                               HTTP_METHOD http_method,
+                               uint64_t start_time_in_s,
+                               uint64_t end_time_in_s,
+                               std::vector<std::string>* urls,
+                               unsigned thread_num = 1);
+
     CosResult OptionsObject(const OptionsObjectReq& req, OptionsObjectResp* resp);
 
     CosResult SelectObjectContent(const SelectObjectContentReq& req, SelectObjectContentResp* resp);
@@ -216,23 +238,44 @@ private:
     // 下载文件, 内部使用多线程
     CosResult MultiThreadDownload(const MultiGetObjectReq& req, MultiGetObjectResp* resp);
 
-    // 上传文件, 内部使用多线程
+    // 上传文件, 内部使用多线程, uploaded_parts中的分块不再上传
+    // checkpoint不为NULL时, 每个分块上传成功后追加到断点文件
     CosResult MultiThreadUpload(const MultiUploadObjectReq& req,
                                 const std::string& upload_id,
+                                const std::map<uint64_t, std::string>& uploaded_parts,
+                                UploadCheckpoint* checkpoint,
                                 std::vector<std::string>* etags_ptr,
                                 std::vector<uint64_t>* part_numbers_ptr);
 
+    // 通过ListParts核对断点文件中记录的分块, 返回服务端确实存在的分块
+    // ListParts失败时返回其结果, upload_id已不存在时错误码为NoSuchUpload
+    CosResult ReconcileUploadedParts(const MultiUploadObjectReq& req,
+                                     const UploadCheckpoint& checkpoint,
+                                     std::map<uint64_t, std::string>* uploaded_parts);
+
+    // upload_id是否已不存在(已完成或已被Abort)
+    static bool IsNoSuchUpload(const CosResult& result);
+
+    // 下载线程, 循环领取分片下载并写入fd, 直至分片领完或下载失败
+    // checkpoint不为NULL时, 每个分片下载完成后记录到断点文件
+    void DownloadSliceWorker(int fd, FileDownPipeline* pipeline,
+                             DownloadCheckpoint* checkpoint, uint64_t slice_size,
+                             FileDownTask* task);
+
+    // 上传线程, 循环从流水线中取出分块上传, 直至分块取完或流水线中止
+    void UploadPartWorker(const std::string& upload_id, const std::string& host,
+                          FileUploadPipeline* pipeline, UploadCheckpoint* checkpoint,
+                          FileUploadTask* task);
+
     // 读取文件内容, 并返回读取的长度
     uint64_t GetContent(const std::string& src, std::string* file_content) const;
 
     void FillUploadTask(const std::string& upload_id, const std::string& host,
-                        const std::string& path, unsigned char* file_content_buf,
-                        uint64_t len, uint64_t part_number,
-                        FileUploadTask* task_ptr);
+                        unsigned char* file_content_buf, uint64_t len,
+                        uint64_t part_number, FileUploadTask* task_ptr);
 
     void FillCopyTask(const std::string& upload_id, const std::string& host,
-                      const std::string& path, uint64_t part_number,
-                      const std::string& range,
+                      uint64_t part_number, const std::string& range,
                       const std::map<std::string, std::string>& headers,
                       const std::map<std::string, std::string>& params,
                       FileCopyTask* task);
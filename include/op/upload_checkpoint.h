@@ -0,0 +1,68 @@
+#ifndef UPLOAD_CHECKPOINT_H
+#define UPLOAD_CHECKPOINT_H
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cos_defines.h"
+#include "util/noncopyable.h"
+
+namespace qcloud_cos {
+
+/// \brief 分块上传的断点记录文件
+///        首部记录upload_id、文件大小、修改时间、分块大小, 之后每上传成功一个分块追加一行
+///        格式:
+///          upload_id=<upload_id>
+///          file_size=<file_size>
+///          file_mtime=<file_mtime>
+///          part_size=<part_size>
+///          part=<part_number> <etag>
+class UploadCheckpoint : private NonCopyable {
+public:
+    explicit UploadCheckpoint(const std::string& checkpoint_file);
+
+    ~UploadCheckpoint();
+
+    /// \brief 加载断点文件, 文件不存在或格式错误时返回false
+    bool Load();
+
+    /// \brief 新建断点文件, 覆盖已有内容
+    bool Create(const std::string& upload_id, uint64_t file_size,
+                uint64_t file_mtime, uint64_t part_size);
+
+    /// \brief 追加一个已上传成功的分块, 线程安全
+    bool AppendPart(uint64_t part_number, const std::string& etag);
+
+    /// \brief 断点记录的文件信息与当前文件是否一致
+    bool IsMatch(uint64_t file_size, uint64_t file_mtime, uint64_t part_size) const;
+
+    /// \brief 从服务端已上传的分块(ListParts的结果)中, 选出断点记录中ETag一致的分块
+    ///        断点中没有记录或ETag不一致的分块需要重新上传
+    void MatchUploadedParts(const std::vector<Part>& server_parts,
+                            std::map<uint64_t, std::string>* uploaded_parts) const;
+
+    /// \brief 删除断点文件
+    void Remove();
+
+    const std::string& GetUploadId() const { return m_upload_id; }
+
+    const std::map<uint64_t, std::string>& GetParts() const { return m_parts; }
+
+private:
+    std::string m_checkpoint_file;
+    pthread_mutex_t m_mutex;
+
+    std::string m_upload_id;
+    uint64_t m_file_size;
+    uint64_t m_file_mtime;
+    uint64_t m_part_size;
+    std::map<uint64_t, std::string> m_parts;
+};
+
+} // namespace qcloud_cos
+#endif // UPLOAD_CHECKPOINT_H
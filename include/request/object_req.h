@@ -186,10 +186,20 @@ public:
     /// \brief 获取线程池大小
     int GetThreadPoolSize() const { return m_thread_pool_size; }
 
+    /// \brief 设置断点文件路径, 设置后开启断点续传:
+    ///        数据先写入local_file_path.download临时文件, 中断后再次调用只下载缺失的分片,
+    ///        下载完成后重命名为local_file_path
+    void SetCheckpointFile(const std::string& checkpoint_file) {
+        m_checkpoint_file = checkpoint_file;
+    }
+
+    std::string GetCheckpointFile() const { return m_checkpoint_file; }
+
 private:
     std::string m_local_file_path;
     uint64_t m_slice_size;
     int m_thread_pool_size;
+    std::string m_checkpoint_file;
 };
 
 class PutObjectReq : public ObjectReq {
@@ -298,6 +308,7 @@ public:
                          std::istream& in_stream)
         : PutObjectReq(bucket_name, object_name), m_in_stream(in_stream) {
         m_need_compute_contentmd5 = true;
+        m_is_chunked_transfer = false;
     }
 
     virtual ~PutObjectByStreamReq() {}
@@ -316,9 +327,25 @@ public:
         return m_need_compute_contentmd5;
     }
 
+    /// \brief 以Transfer-Encoding: chunked边读边上传, 用于管道等长度未知、不可定位的流, 默认关闭
+    ///        开启后不再预先读取流计算Content-MD5, 改为边发送边计算MD5并与返回的ETag比对;
+    ///        流不可定位时失败后不会重试
+    void TurnOnChunkedTransfer() {
+        m_is_chunked_transfer = true;
+    }
+
+    void TurnOffChunkedTransfer() {
+        m_is_chunked_transfer = false;
+    }
+
+    bool IsChunkedTransfer() const {
+        return m_is_chunked_transfer;
+    }
+
 private:
     std::istream& m_in_stream;
     bool m_need_compute_contentmd5;
+    bool m_is_chunked_transfer;
 };
 
 class PutObjectByFileReq : public PutObjectReq {
@@ -543,6 +570,7 @@ public:
           m_in_stream(in_stream), m_upload_id(upload_id), m_part_number(1)  {
         m_method = "PUT";
         m_need_compute_contentmd5 = true;
+        m_is_chunked_transfer = false;
     }
 
     /// \brief 设置本次分块上传的ID
@@ -570,6 +598,21 @@ public:
         return m_need_compute_contentmd5;
     }
 
+    /// \brief 以Transfer-Encoding: chunked边读边上传, 用于管道等长度未知、不可定位的流, 默认关闭
+    ///        开启后不再预先读取流计算Content-MD5, 改为边发送边计算MD5并与返回的ETag比对;
+    ///        流不可定位时失败后不会重试
+    void TurnOnChunkedTransfer() {
+        m_is_chunked_transfer = true;
+    }
+
+    void TurnOffChunkedTransfer() {
+        m_is_chunked_transfer = false;
+    }
+
+    bool IsChunkedTransfer() const {
+        return m_is_chunked_transfer;
+    }
+
     /// \brief 请求参数中设置单链接限速,参考https://cloud.tencent.com/document/product/436/40140
     void SetTrafficLimitByParam(const std::string& str) {
         if (GetHeader("x-cos-traffic-limit") == "") {
@@ -588,6 +631,7 @@ private:
     std::string m_upload_id;
     uint64_t m_part_number;
     bool m_need_compute_contentmd5;
+    bool m_is_chunked_transfer;
 };
 
 class UploadPartCopyDataReq : public ObjectReq {
@@ -779,12 +823,21 @@ public:
         }
     }
 
+    /// \brief 设置断点文件路径, 设置后开启断点续传:
+    ///        上传失败时不再Abort, 重新调用时根据断点文件和ListParts只上传缺失的分块
+    void SetCheckpointFile(const std::string& checkpoint_file) {
+        m_checkpoint_file = checkpoint_file;
+    }
+
+    std::string GetCheckpointFile() const { return m_checkpoint_file; }
+
 private:
     std::string m_local_file_path;
     uint64_t m_part_size;
     int m_thread_pool_size;
     std::map<std::string, std::string> m_xcos_meta;
     bool mb_set_meta;
+    std::string m_checkpoint_file;
 };
 
 class AbortMultiUploadReq : public ObjectReq {
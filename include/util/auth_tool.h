@@ -7,8 +7,12 @@
 #include <string>
 #include <vector>
 
+#include "Poco/SharedPtr.h"
+
 #include "request/base_req.h"
+#include "util/canonical_request.h"
 #include "util/noncopyable.h"
+#include "util/sha1.h"
 
 namespace qcloud_cos {
 
@@ -50,28 +54,60 @@ public:
                             uint64_t start_time_in_s,
                             uint64_t end_time_in_s);
 
+    /// \brief ʹѹ淶ǩָЧ(ͨCosSysConfig)ʹ
+    ///        ÷ɽͬһCanonicalRequestƴ
+    static std::string Sign(const std::string& secret_id,
+                            const std::string& secret_key,
+                            const std::string& http_method,
+                            const std::string& in_uri,
+                            const CanonicalRequest& canonical_req);
+
+    /// \brief ʹѹ淶ǩ, ÷ɽͬһCanonicalRequestƴ
+    ///
+    /// \param secret_id      ӵеĿʶ ID֤
+    /// \param secret_key     ӵеĿԿ
+    /// \param http_method    http,POST/GET/HEAD/PUT, Сд
+    /// \param in_uri         http uri
+    /// \param canonical_req  paramsheadersĹ淶
+    ///
+    /// \return ַʽǩؿմʧ
+    static std::string Sign(const std::string& secret_id,
+                            const std::string& secret_key,
+                            const std::string& http_method,
+                            const std::string& in_uri,
+                            const CanonicalRequest& canonical_req,
+                            uint64_t start_time_in_s,
+                            uint64_t end_time_in_s);
+};
+
+/// \brief ǩ, һֻuriͬҲheader/param(Ԥǩ)
+///        ʱһkey-timeӦǩԿƴǩǰ׺, ֮ÿuriֻһժҪ
+///        ֻ, ڶ߳в
+class BatchSigner : private NonCopyable {
+public:
+    /// \param start_time_in_s/end_time_in_s ǩЧ, ʼʱΪ0ʱ䲻ڿʼʱʱ,
+    ///        ʹõǰʱ估CosSysConfigõЧ
+    BatchSigner(const std::string& secret_id,
+                const std::string& secret_key,
+                const std::string& http_method,
+                uint64_t start_time_in_s,
+                uint64_t end_time_in_s);
+
+    /// \brief secret_id/secret_keyΪʱ޷ǩ
+    bool IsValid() const { return m_is_valid; }
+
+    /// \brief ǩq-signatureֵ֮ǰĹ̶, uriͬ
+    const std::string& GetSignPrefix() const { return m_sign_prefix; }
+
+    /// \brief uriӦq-signatureֵ, ǩΪGetSignPrefix() + GetSignature(uri)
+    std::string GetSignature(const std::string& uri) const;
+
 private:
-    /// \brief paramsеݣתСд,keyparam_list key=valueparam_value_list
-    /// \param params 
-    /// \param key_encode keyǷuri
-    /// \param value_encode valueǷuri
-    /// \param value_lower valueǷСд
-    /// \param param_list б;ָ
-    /// \param param_value_list ֵб,&ָ
-    /// \retval     
-    static void FillMap(const std::map<std::string,std::string> &params,
-                        bool key_encode,
-                        bool value_encode,
-                        bool value_lower,
-                        std::string* param_list,
-                        std::string* param_value_list);
-
-    /// \brief ҳҪȨͷ,Ŀǰhost conent-type xͷĶҪȨ
-    /// \param hedaers ͷkv
-    /// \param filted_req_headers ҪȨͷ
-    /// \retval 
-    static void FilterAndSetSignHeader(const std::map<std::string,std::string>& headers,
-                                       std::map<std::string, std::string>* filted_req_headers);
+    bool m_is_valid;
+    std::string m_lower_method;
+    std::string m_key_time;
+    std::string m_sign_prefix;
+    Poco::SharedPtr<const HmacSha1Ctx> m_sign_key_hmac;
 };
 
 } // namespace qcloud_cos
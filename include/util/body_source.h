@@ -0,0 +1,158 @@
+#ifndef BODY_SOURCE_H
+#define BODY_SOURCE_H
+#pragma once
+
+#include <stdint.h>
+
+#include <iostream>
+#include <string>
+
+#include "Poco/MD5Engine.h"
+
+#include "util/noncopyable.h"
+
+namespace qcloud_cos {
+
+/// \brief HTTP请求体的数据源, 发送时由数据源直接写入socket流,
+///        避免先拷贝到std::string/istringstream再发送
+///        基于事件循环的传输层无法阻塞地写入流, 改为通过Read分段拉取数据
+class BodySource : private NonCopyable {
+public:
+    virtual ~BodySource() {}
+
+    /// \brief 请求体长度, 用于填充Content-Length, IsChunked为true时不会被调用
+    virtual uint64_t GetLength() = 0;
+
+    /// \brief 请求体长度未知(如管道), 以Transfer-Encoding: chunked边读边发送
+    virtual bool IsChunked() { return false; }
+
+    /// \brief 将请求体写入os
+    ///
+    /// \return 实际写入的字节数
+    virtual uint64_t WriteTo(std::ostream& os) = 0;
+
+    /// \brief 从当前读取位置读取至多len字节, 与WriteTo二选一使用, 读取失败时抛出异常
+    ///
+    /// \return 实际读取的字节数, 0表示已读完
+    virtual size_t Read(char* buf, size_t len) = 0;
+
+    /// \brief 回到起始位置以便失败后重新发送
+    ///
+    /// \return 无法回到起始位置时返回false, 此时不能重试
+    virtual bool Rewind() = 0;
+};
+
+/// \brief 连续内存数据源, 不持有内存, 调用方需保证发送期间内存有效
+class BufferBodySource : public BodySource {
+public:
+    BufferBodySource(const char* data, size_t len)
+        : m_data(data), m_len(len), m_read_offset(0) {}
+
+    explicit BufferBodySource(const std::string& body)
+        : m_data(body.data()), m_len(body.size()), m_read_offset(0) {}
+
+    virtual ~BufferBodySource() {}
+
+    virtual uint64_t GetLength() { return m_len; }
+
+    virtual uint64_t WriteTo(std::ostream& os);
+
+    virtual size_t Read(char* buf, size_t len);
+
+    virtual bool Rewind() {
+        m_read_offset = 0;
+        return true;
+    }
+
+private:
+    const char* m_data;
+    size_t m_len;
+    size_t m_read_offset;
+};
+
+/// \brief 文件区间数据源, 发送时按块pread读取, 不将整个区间读入内存
+class FileBodySource : public BodySource {
+public:
+    FileBodySource(const std::string& file_path, uint64_t offset, uint64_t len)
+        : m_file_path(file_path), m_offset(offset), m_len(len), m_read_fd(-1),
+          m_read_offset(0) {}
+
+    virtual ~FileBodySource();
+
+    virtual uint64_t GetLength() { return m_len; }
+
+    virtual uint64_t WriteTo(std::ostream& os);
+
+    /// \brief 首次读取时打开文件, 直到析构时才关闭
+    virtual size_t Read(char* buf, size_t len);
+
+    virtual bool Rewind() {
+        m_read_offset = 0;
+        return true;
+    }
+
+private:
+    std::string m_file_path;
+    uint64_t m_offset;
+    uint64_t m_len;
+    int m_read_fd;
+    uint64_t m_read_offset;
+};
+
+/// \brief 流数据源, 发送从流当前位置到结尾的数据
+///        is_chunked为true时不定位到流尾计算长度, 可用于管道、socket等不可定位的流
+class StreamBodySource : public BodySource {
+public:
+    explicit StreamBodySource(std::istream& is, bool is_chunked = false)
+        : m_is(is), m_start_pos(is.tellg()), m_is_chunked(is_chunked) {}
+
+    virtual ~StreamBodySource() {}
+
+    virtual uint64_t GetLength();
+
+    virtual bool IsChunked() { return m_is_chunked; }
+
+    virtual uint64_t WriteTo(std::ostream& os);
+
+    virtual size_t Read(char* buf, size_t len);
+
+    /// \brief 只有可定位的流(如文件流、字符串流)才能回到起始位置
+    virtual bool Rewind();
+
+private:
+    std::istream& m_is;
+    std::streampos m_start_pos;
+    bool m_is_chunked;
+};
+
+/// \brief 在发送内部数据源的同时计算MD5, 发送结束后即可取得摘要,
+///        用于上传后校验返回的ETag, 无需预先额外读取一遍数据
+class Md5BodySource : public BodySource {
+public:
+    explicit Md5BodySource(BodySource& source) : m_source(source), m_is_read_done(false) {}
+
+    virtual ~Md5BodySource() {}
+
+    virtual uint64_t GetLength() { return m_source.GetLength(); }
+
+    virtual bool IsChunked() { return m_source.IsChunked(); }
+
+    virtual uint64_t WriteTo(std::ostream& os);
+
+    /// \brief 读完(返回0)时生成摘要
+    virtual size_t Read(char* buf, size_t len);
+
+    virtual bool Rewind();
+
+    /// \brief 获取已发送数据的MD5(十六进制), 需在WriteTo或Read读完之后调用
+    const std::string& GetMd5Hex() const { return m_md5_hex; }
+
+private:
+    BodySource& m_source;
+    Poco::MD5Engine m_md5;
+    std::string m_md5_hex;
+    bool m_is_read_done;
+};
+
+} // namespace qcloud_cos
+#endif // BODY_SOURCE_H
@@ -0,0 +1,58 @@
+#ifndef CANONICAL_REQUEST_H
+#define CANONICAL_REQUEST_H
+#pragma once
+
+#include <map>
+#include <string>
+
+namespace qcloud_cos {
+
+/// \brief 请求的规范化形式, 一次遍历params/headers, 同时生成签名所需的param/header列表
+///        以及请求行中的query串, 每个key/value只做一次URL编码, 结果直接写入预留好的字符串
+///
+///        签名列表按小写key排序, key小写后相同的只保留按原key排序的最后一个;
+///        header只保留参与签名的部分(host/content-*/range/x-cos*等)
+class CanonicalRequest {
+public:
+    /// \brief 空请求, 用于先声明后赋值, 如每次重试前重新签名
+    CanonicalRequest() {}
+
+    /// \brief 只包含params, 用于HttpSender拼接query串, 允许由params隐式构造
+    CanonicalRequest(const std::map<std::string, std::string>& params);
+
+    CanonicalRequest(const std::map<std::string, std::string>& params,
+                     const std::map<std::string, std::string>& headers);
+
+    /// \brief 参与签名的param key列表, 以;分隔, 如q-url-param-list
+    const std::string& GetParamList() const { return m_param_list; }
+
+    /// \brief 签名串中的param部分, key=value以&分隔
+    const std::string& GetParamValueList() const { return m_param_value_list; }
+
+    /// \brief 参与签名的header key列表, 以;分隔, 如q-header-list
+    const std::string& GetHeaderList() const { return m_header_list; }
+
+    /// \brief 签名串中的header部分, key=value以&分隔
+    const std::string& GetHeaderValueList() const { return m_header_value_list; }
+
+    /// \brief 请求行中的query串, 按原始key排序, 非空时以?开头
+    const std::string& GetQueryString() const { return m_query_str; }
+
+    /// \brief header是否参与签名
+    static bool IsSignHeader(const std::string& key);
+
+private:
+    void BuildParams(const std::map<std::string, std::string>& params, bool with_sign_list);
+
+    void BuildHeaders(const std::map<std::string, std::string>& headers);
+
+private:
+    std::string m_param_list;
+    std::string m_param_value_list;
+    std::string m_header_list;
+    std::string m_header_value_list;
+    std::string m_query_str;
+};
+
+} // namespace qcloud_cos
+#endif // CANONICAL_REQUEST_H
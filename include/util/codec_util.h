@@ -45,6 +45,14 @@ public:
      */
     static std::string UrlEncode(const std::string& str);
 
+    /**
+     * @brief 对字符串进行URL编码, 结果追加到out之后, 避免产生临时字符串
+     *
+     * @param str   带编码的字符串
+     * @param out   存放结果的字符串
+     */
+    static void UrlEncode(const std::string& str, std::string* out);
+
     /**
      * @brief 对字符串进行base64编码
      *
@@ -54,6 +62,15 @@ public:
      */
     static std::string Base64Encode(const std::string& plainText);
 
+    /**
+     * @brief 对base64编码的字符串进行解码, 要求带=填充且长度为4的倍数
+     *
+     * @param encodedText  待解码的字符串
+     *
+     * @return 解码后的字符串, 输入为空或不合法时返回空串
+     */
+    static std::string Base64Decode(const std::string& encodedText);
+
     /**
      * @brief 获取hmacSha1值
      *
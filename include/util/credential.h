@@ -0,0 +1,118 @@
+#ifndef CREDENTIAL_H
+#define CREDENTIAL_H
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+
+#include "Poco/SharedPtr.h"
+
+#include "util/noncopyable.h"
+#include "util/simple_mutex.h"
+
+namespace qcloud_cos {
+
+/// \brief 一组访问密钥, 构造后不再修改
+class Credential {
+public:
+    Credential() : m_expired_time_in_s(0) {}
+
+    /// \param expired_time_in_s 临时密钥的过期时间(unix时间戳, 秒), 0表示不会过期
+    Credential(const std::string& access_key,
+               const std::string& secret_key,
+               const std::string& tmp_token,
+               uint64_t expired_time_in_s = 0)
+        : m_access_key(access_key), m_secret_key(secret_key),
+          m_tmp_token(tmp_token), m_expired_time_in_s(expired_time_in_s) {}
+
+    const std::string& GetAccessKey() const { return m_access_key; }
+    const std::string& GetSecretKey() const { return m_secret_key; }
+    const std::string& GetTmpToken() const { return m_tmp_token; }
+    uint64_t GetExpiredTimeInSec() const { return m_expired_time_in_s; }
+
+private:
+    std::string m_access_key;
+    std::string m_secret_key;
+    std::string m_tmp_token;
+    uint64_t m_expired_time_in_s;
+};
+
+/// \brief 密钥提供者, 如向业务自己的STS服务申请临时密钥
+///        由CredentialRefresher在后台线程中调用
+class CredentialProvider {
+public:
+    virtual ~CredentialProvider() {}
+
+    /// \brief 获取一组新的密钥
+    ///
+    /// \return 获取成功返回true
+    virtual bool FetchCredential(Credential* credential) = 0;
+};
+
+/// \brief 可原子替换的密钥快照, 读取时只做一次原子load, 不加锁也不复制字符串
+///        被替换下来的快照至少再保留kRetiredKeepTimeInS秒后才释放,
+///        Get返回的指针只应在一次请求的组包和签名过程中使用, 不要长期持有
+class AtomicCredential : private NonCopyable {
+public:
+    AtomicCredential();
+    ~AtomicCredential();
+
+    const Credential* Get() const {
+        return __atomic_load_n(&m_current, __ATOMIC_ACQUIRE);
+    }
+
+    void Set(const Credential& credential);
+
+private:
+    struct RetiredCredential {
+        const Credential* m_credential;
+        uint64_t m_retired_time_in_s;   // 单调时钟, 单位:秒
+    };
+
+    const Credential* m_current;
+    SimpleMutex m_mutex;    // 写者之间互斥, 并保护m_retired
+    std::deque<RetiredCredential> m_retired;
+};
+
+/// \brief 后台刷新密钥, 在当前密钥过期前refresh_ahead_in_s秒通过CredentialProvider
+///        获取新密钥并替换到AtomicCredential中, 获取失败时每隔几秒重试
+class CredentialRefresher : private NonCopyable {
+public:
+    CredentialRefresher(const Poco::SharedPtr<CredentialProvider>& provider,
+                        AtomicCredential* credential,
+                        uint64_t refresh_ahead_in_s);
+
+    /// \brief 停止并等待后台线程退出
+    ~CredentialRefresher();
+
+    /// \brief 同步获取一次密钥, 成功后启动后台刷新线程
+    ///
+    /// \return 首次获取失败返回false, 此时不启动后台线程
+    bool Start();
+
+private:
+    static void* ThreadEntry(void* arg);
+
+    void Run();
+
+    bool Refresh();
+
+    // 距下一次刷新的秒数, 密钥不会过期时返回0
+    uint64_t GetRefreshDelayInSec() const;
+
+private:
+    Poco::SharedPtr<CredentialProvider> m_provider;
+    AtomicCredential* m_credential;
+    uint64_t m_refresh_ahead_in_s;
+    pthread_t m_tid;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    bool m_started;
+    bool m_stopping;
+};
+
+} // namespace qcloud_cos
+#endif // CREDENTIAL_H
@@ -0,0 +1,125 @@
+#ifndef CURL_HTTP_TRANSPORT_H
+#define CURL_HTTP_TRANSPORT_H
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+
+#include <curl/curl.h>
+
+#include "util/http_transport.h"
+
+namespace qcloud_cos {
+
+/// \brief 基于libcurl multi的传输层, 需在编译时开启ENABLE_CURL_TRANSPORT, 要求libcurl >= 7.68
+///        所有请求由一个事件循环线程驱动, 调用线程只负责提交请求并等待其结束,
+///        大量并发传输共用一个线程的poll, 连接由multi句柄的连接缓存复用
+///        请求体与响应体经由每个传输各自的缓冲区中转, BodySource的读取和resp_stream的写入
+///        都在调用线程中进行; 事件循环线程只拷贝缓冲区, 缓冲区为空或已满时暂停该传输
+///        取消请求时由事件循环定期检查RequestContext::IsCancelled, 最长延迟kPollIntervalInms
+class CurlHttpTransport : public HttpTransport {
+public:
+    CurlHttpTransport();
+
+    /// \brief 结束事件循环, 尚未完成的请求以失败返回
+    virtual ~CurlHttpTransport();
+
+    virtual std::string GetName() const { return "curl"; }
+
+    virtual int SendRequest(const std::string& http_method,
+                            const std::string& url_str,
+                            const CanonicalRequest& req_params,
+                            const std::map<std::string, std::string>& req_headers,
+                            BodySource& req_body,
+                            uint64_t conn_timeout_in_ms,
+                            uint64_t recv_timeout_in_ms,
+                            std::map<std::string, std::string>* resp_headers,
+                            std::ostream& resp_stream,
+                            std::string* err_msg,
+                            bool is_check_md5,
+                            RequestContext* ctx);
+
+    virtual int SendRequest(const std::string& http_method,
+                            const std::string& url_str,
+                            const CanonicalRequest& req_params,
+                            const std::map<std::string, std::string>& req_headers,
+                            const std::string& req_body,
+                            uint64_t conn_timeout_in_ms,
+                            uint64_t recv_timeout_in_ms,
+                            std::map<std::string, std::string>* resp_headers,
+                            std::string* xml_err_str,
+                            std::ostream& resp_stream,
+                            std::string* err_msg,
+                            uint64_t* real_byte,
+                            bool is_check_md5,
+                            RequestContext* ctx);
+
+private:
+    struct Transfer;
+
+    // 构造easy句柄并设置请求选项, 失败时填充err_msg并返回false
+    bool SetupTransfer(Transfer* transfer,
+                       const std::string& http_method,
+                       const std::string& url_str,
+                       const CanonicalRequest& req_params,
+                       const std::map<std::string, std::string>& req_headers,
+                       uint64_t conn_timeout_in_ms,
+                       uint64_t recv_timeout_in_ms,
+                       bool is_decode_gzip,
+                       std::string* err_msg);
+
+    // 提交到事件循环, 在调用线程中读取请求体、写入响应体, 直至传输结束
+    void Perform(Transfer* transfer);
+
+    // 从BodySource补充请求体缓冲区, 调用前后均持有transfer->m_mutex, 读取期间释放
+    void FillRequestBody(Transfer* transfer, std::string* buf);
+
+    // 将取出的响应体写入resp_stream或xml_err_str, 写入失败时返回false
+    static bool WriteResponseBody(Transfer* transfer, const std::string& data);
+
+    // 根据传输结果填充耗时/错误信息, 返回http状态码或-1
+    int FinishTransfer(Transfer* transfer, std::string* err_msg);
+
+    static void* LoopEntry(void* arg);
+
+    void RunLoop();
+
+    // 以下只在事件循环线程中调用
+    // 把新提交的传输加入multi句柄, 已开始停止时返回false
+    bool AddPendingTransfers();
+
+    void RemoveCancelledTransfers();
+
+    // 恢复缓冲区已由调用线程补充或取走的暂停传输
+    void ResumePausedTransfers();
+
+    void CompleteTransfer(Transfer* transfer, CURLcode result);
+
+    // 停止时结束所有尚未完成的传输
+    void AbortAllTransfers();
+
+    static void LockShare(CURL* handle, curl_lock_data data, curl_lock_access access,
+                          void* userptr);
+
+    static void UnlockShare(CURL* handle, curl_lock_data data, void* userptr);
+
+private:
+    CURLM* m_multi;
+    CURLSH* m_share;                // 在所有传输间共享TLS session, 新建连接时可恢复握手
+    pthread_mutex_t m_share_mutex;
+    pthread_t m_loop_tid;
+    bool m_loop_started;
+    pthread_mutex_t m_mutex;        // 保护m_pending_transfers和m_stopping
+    std::deque<Transfer*> m_pending_transfers;
+    bool m_stopping;
+    std::set<Transfer*> m_running_transfers;    // 只由事件循环线程访问
+};
+
+} // namespace qcloud_cos
+#endif // CURL_HTTP_TRANSPORT_H
@@ -0,0 +1,106 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Poco/SharedPtr.h"
+
+#include "util/noncopyable.h"
+#include "util/simple_mutex.h"
+
+namespace qcloud_cos {
+
+/// \brief 域名解析器接口, DnsCache缓存未命中时调用
+///        默认使用系统解析器, 测试时可通过DnsCache::SetResolver注入桩实现, 无需访问网络
+class DnsResolver : private NonCopyable {
+public:
+    virtual ~DnsResolver() {}
+
+    /// \brief 解析host对应的全部IP地址
+    ///
+    /// \param host     待解析的域名
+    /// \param addrs    返回解析出的IP地址, 如"10.0.0.1"
+    /// \param err_msg  解析失败时返回错误信息
+    ///
+    /// \return 成功且至少解析出一个地址时返回true
+    virtual bool Resolve(const std::string& host, std::vector<std::string>* addrs,
+                         std::string* err_msg) = 0;
+};
+
+/// \brief 通过Poco::Net::DNS(getaddrinfo)解析
+class SystemDnsResolver : public DnsResolver {
+public:
+    virtual bool Resolve(const std::string& host, std::vector<std::string>* addrs,
+                         std::string* err_msg);
+};
+
+/// \brief 进程内共享的DNS缓存, 由HttpSessionPool在新建连接时使用, 需开启DnsCacheEnable
+///        - 解析结果缓存DnsCacheTtlInms, 解析失败的结果缓存DnsNegativeTtlInms,
+///          期间同一域名的连接直接失败, 不再反复等待解析超时
+///        - 缓存过期后重新解析失败时, 继续使用过期的地址
+///        - 每次取地址时按DnsRotatePolicy在多个地址间轮询, 或优先选择已建立连接最少的地址,
+///          使分块上传下载的连接分散到不同的接入IP
+///        - 连接失败的地址在DnsNegativeTtlInms内排在其他地址之后, 连接时依次尝试下一个地址
+class DnsCache : private NonCopyable {
+public:
+    static DnsCache& Instance();
+
+    /// \brief 设置解析器, 传入空指针则恢复使用系统解析器, 同时清空缓存
+    void SetResolver(const Poco::SharedPtr<DnsResolver>& resolver);
+
+    /// \brief 获取host的候选地址, 依次尝试连接即可
+    ///        缓存未命中或已过期时在调用线程上同步解析
+    ///
+    /// \return 解析失败(包括命中解析失败的缓存)时返回false并填充err_msg
+    bool GetAddresses(const std::string& host, std::vector<std::string>* addrs,
+                      std::string* err_msg);
+
+    /// \brief 记录连接addr失败
+    void MarkFailed(const std::string& addr);
+
+    /// \brief 记录与addr建立/关闭了一个连接, 用于按已建立连接数选择地址
+    void AddConnection(const std::string& addr);
+    void RemoveConnection(const std::string& addr);
+
+    /// \brief 清空缓存的解析结果与各地址的状态
+    void Clear();
+
+    /// \brief 获取缓存命中与实际解析的次数
+    void GetStats(uint64_t* hit_num, uint64_t* resolve_num);
+
+private:
+    struct Entry {
+        std::vector<std::string> m_addrs;   // 为空表示解析失败
+        std::string m_err_msg;
+        uint64_t m_expire_in_ms;
+        size_t m_next_index;                // 下次轮询的起始位置
+    };
+
+    struct AddrState {
+        unsigned m_conn_num;
+        uint64_t m_fail_until_in_ms;
+    };
+
+    DnsCache() : m_resolver(new SystemDnsResolver()), m_hit_num(0), m_resolve_num(0) {}
+
+    static uint64_t GetNowInMs();
+
+    // 调用方需持有m_mutex, 按轮转策略和地址状态排序候选地址
+    void SelectAddresses(Entry* entry, uint64_t now_in_ms, std::vector<std::string>* addrs);
+
+private:
+    SimpleMutex m_mutex;
+    Poco::SharedPtr<DnsResolver> m_resolver;
+    std::map<std::string, Entry> m_entries;
+    std::map<std::string, AddrState> m_addr_states;
+    uint64_t m_hit_num;
+    uint64_t m_resolve_num;
+};
+
+} // namespace qcloud_cos
+#endif // DNS_CACHE_H
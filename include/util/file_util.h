@@ -16,6 +16,9 @@ class FileUtil
 
     //返回文件大小
     static uint64_t GetFileLen(const std::string& path);
+
+    //返回文件最后修改时间(秒), 文件不存在时返回0
+    static uint64_t GetFileMtime(const std::string& path);
 };
 
 }
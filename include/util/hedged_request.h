@@ -0,0 +1,77 @@
+#ifndef HEDGED_REQUEST_H
+#define HEDGED_REQUEST_H
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <ostream>
+#include <string>
+
+#include "util/canonical_request.h"
+#include "util/request_timing.h"
+
+namespace qcloud_cos {
+
+/// \brief 对冲请求的运行统计
+struct HedgeStats {
+    uint64_t m_request_num;         // 开启对冲后发出的GET/HEAD请求数
+    uint64_t m_hedge_num;           // 其中发出了对冲请求的次数
+    uint64_t m_hedge_win_num;       // 对冲请求先于原请求收到响应的次数
+    uint64_t m_get_delay_in_us;     // 当前GET请求的对冲等待时间, 0表示样本不足暂不对冲
+    uint64_t m_head_delay_in_us;    // 当前HEAD请求的对冲等待时间, 0表示样本不足暂不对冲
+
+    HedgeStats()
+        : m_request_num(0), m_hedge_num(0), m_hedge_win_num(0),
+          m_get_delay_in_us(0), m_head_delay_in_us(0) {}
+};
+
+/// \brief 对冲请求: 原请求超过对冲等待时间仍未收到响应首字节时, 再发出一个相同的请求,
+///        先收到响应头的一方胜出并继续读取响应体, 另一方的连接被立即关闭
+///        对冲等待时间为近期首字节耗时的HedgeDelayPercentile分位数, 且不小于HedgeMinDelayInms,
+///        样本不足时只收集耗时而不对冲
+///        对冲请求由数量有限的常驻工作线程发出, 线程均忙碌时放弃对冲, 只发原请求
+///        只用于无请求体的GET/HEAD请求, 由CosSysConfig::SetHedgeEnable开启
+class HedgedRequest {
+public:
+    /// \brief 参数同HttpSender::SendRequest, 未开启对冲、方法不适用或带有请求体时直接调用HttpSender
+    ///        timing非NULL时返回作为结果的请求的耗时
+    ///        is_decode_gzip为true时解压gzip压缩的响应体, 见RequestContext::SetDecodeGzip
+    static int SendRequest(const std::string& http_method,
+                           const std::string& url_str,
+                           const CanonicalRequest& req_params,
+                           const std::map<std::string, std::string>& req_headers,
+                           const std::string& req_body,
+                           uint64_t conn_timeout_in_ms,
+                           uint64_t recv_timeout_in_ms,
+                           std::map<std::string, std::string>* resp_headers,
+                           std::string* resp_body,
+                           std::string* err_msg,
+                           RequestTiming* timing = NULL,
+                           bool is_decode_gzip = false);
+
+    /// \brief 下载到流的版本, 只有胜出的请求会向resp_stream写入数据
+    static int SendRequest(const std::string& http_method,
+                           const std::string& url_str,
+                           const CanonicalRequest& req_params,
+                           const std::map<std::string, std::string>& req_headers,
+                           const std::string& req_body,
+                           uint64_t conn_timeout_in_ms,
+                           uint64_t recv_timeout_in_ms,
+                           std::map<std::string, std::string>* resp_headers,
+                           std::string* xml_err_str,
+                           std::ostream& resp_stream,
+                           std::string* err_msg,
+                           uint64_t* real_byte,
+                           bool is_check_md5 = false,
+                           RequestTiming* timing = NULL);
+
+    /// \brief 是否已开启对冲且http_method的请求可以对冲
+    static bool IsHedgeable(const std::string& http_method);
+
+    /// \brief 获取进程内的对冲统计
+    static void GetStats(HedgeStats* stats);
+};
+
+} // namespace qcloud_cos
+#endif // HEDGED_REQUEST_H
@@ -16,14 +16,66 @@
 
 #include "request/base_req.h"
 #include "response/base_resp.h"
+#include "util/canonical_request.h"
+#include "util/noncopyable.h"
+#include "util/request_timing.h"
+#include "util/simple_mutex.h"
 
 namespace qcloud_cos {
 
+class BodySource;
+
+/// \brief 请求的上下文, HttpSender在其中记录本次请求各阶段的耗时
+///        请求可从其他线程取消, 用于对冲请求时取消落后的一方
+///        poco传输层在请求发出后登记连接的socket, Cancel时关闭socket的读写,
+///        使阻塞在等待响应或读取响应体的HttpSender立即返回, 被取消的连接不会归还连接池;
+///        curl传输层则由事件循环定期检查IsCancelled
+class RequestContext : private NonCopyable {
+public:
+    RequestContext() : m_fd(-1), m_cancelled(false), m_is_decode_gzip(false) {}
+
+    virtual ~RequestContext() {}
+
+    void Cancel();
+
+    bool IsCancelled();
+
+    /// \brief 收到响应头(首字节)时由HttpSender回调, 返回false则放弃本次请求, 不再读取响应体
+    virtual bool OnResponseHeader() { return !IsCancelled(); }
+
+    /// \brief 供HttpSender登记正在使用的socket, 已被取消时返回false
+    bool AttachSocket(int fd);
+
+    /// \brief 供HttpSender在连接归还连接池之前注销socket
+    void DetachSocket();
+
+    /// \brief 设置是否解压gzip压缩的响应体, 须在发送前由调用方设置
+    ///        默认不解压, 以免改变以Content-Encoding: gzip上传的对象的下载内容
+    void SetDecodeGzip(bool is_decode_gzip) { m_is_decode_gzip = is_decode_gzip; }
+
+    bool IsDecodeGzip() const { return m_is_decode_gzip; }
+
+    /// \brief 本次请求的耗时, 只应由发送请求的线程在请求结束后读取
+    const RequestTiming& GetTiming() const { return m_timing; }
+
+    /// \brief 供HttpSender记录耗时, 每次发送前重置
+    RequestTiming* MutableTiming() { return &m_timing; }
+
+private:
+    SimpleMutex m_mutex;
+    int m_fd;
+    bool m_cancelled;
+    bool m_is_decode_gzip;
+    RequestTiming m_timing;
+};
+
+/// \brief req_params可直接传入params(现场编码), 也可传入签名时已构造的CanonicalRequest复用其query串
+///        请求经由HttpTransport::GetTransport()返回的传输层发出
 class HttpSender {
 public:
     static int SendRequest(const std::string& http_method,
                            const std::string& url_str,
-                           const std::map<std::string, std::string>& req_params,
+                           const CanonicalRequest& req_params,
                            const std::map<std::string, std::string>& req_headers,
                            const std::string& req_body,
                            uint64_t conn_timeout_in_ms,
@@ -31,11 +83,12 @@ public:
                            std::map<std::string, std::string>* resp_headers,
                            std::string* resp_body,
                            std::string* err_msg,
-                           bool is_check_md5 = false);
+                           bool is_check_md5 = false,
+                           RequestContext* ctx = NULL);
 
     static int SendRequest(const std::string& http_method,
                            const std::string& url_str,
-                           const std::map<std::string, std::string>& req_params,
+                           const CanonicalRequest& req_params,
                            const std::map<std::string, std::string>& req_headers,
                            const std::string& req_body,
                            uint64_t conn_timeout_in_ms,
@@ -47,7 +100,7 @@ public:
 
     static int SendRequest(const std::string& http_method,
                            const std::string& url_str,
-                           const std::map<std::string, std::string>& req_params,
+                           const CanonicalRequest& req_params,
                            const std::map<std::string, std::string>& req_headers,
                            std::istream& is,
                            uint64_t conn_timeout_in_ms,
@@ -59,7 +112,7 @@ public:
 
     static int SendRequest(const std::string& http_method,
                            const std::string& url_str,
-                           const std::map<std::string, std::string>& req_params,
+                           const CanonicalRequest& req_params,
                            const std::map<std::string, std::string>& req_headers,
                            std::istream& is,
                            uint64_t conn_timeout_in_ms,
@@ -69,9 +122,36 @@ public:
                            std::string* err_msg,
                            bool is_check_md5 = false);
 
+    /// \brief 请求体由BodySource直接写入socket流, 不经过中间拷贝
+    static int SendRequest(const std::string& http_method,
+                           const std::string& url_str,
+                           const CanonicalRequest& req_params,
+                           const std::map<std::string, std::string>& req_headers,
+                           BodySource& req_body,
+                           uint64_t conn_timeout_in_ms,
+                           uint64_t recv_timeout_in_ms,
+                           std::map<std::string, std::string>* resp_headers,
+                           std::string* resp_body,
+                           std::string* err_msg,
+                           bool is_check_md5 = false,
+                           RequestContext* ctx = NULL);
+
+    static int SendRequest(const std::string& http_method,
+                           const std::string& url_str,
+                           const CanonicalRequest& req_params,
+                           const std::map<std::string, std::string>& req_headers,
+                           BodySource& req_body,
+                           uint64_t conn_timeout_in_ms,
+                           uint64_t recv_timeout_in_ms,
+                           std::map<std::string, std::string>* resp_headers,
+                           std::ostream& resp_stream,
+                           std::string* err_msg,
+                           bool is_check_md5 = false,
+                           RequestContext* ctx = NULL);
+
     static int SendRequest(const std::string& http_method,
                            const std::string& url_str,
-                           const std::map<std::string, std::string>& req_params,
+                           const CanonicalRequest& req_params,
                            const std::map<std::string, std::string>& req_headers,
                            const std::string& req_body,
                            uint64_t conn_timeout_in_ms,
@@ -81,10 +161,14 @@ public:
                            std::ostream& resp_stream,
                            std::string* err_msg,
                            uint64_t* real_byte,
-                           bool is_check_md5 = false);
+                           bool is_check_md5 = false,
+                           RequestContext* ctx = NULL);
 
     // TODO(sevenyou) 挪走
     static uint64_t GetTimeStampInUs();
+
+    /// \brief 单调时钟, 不受系统时间调整影响, 用于计算耗时
+    static uint64_t GetMonotonicTimeInUs();
 };
 
 } // namespace qcloud_cos
@@ -0,0 +1,151 @@
+#ifndef HTTP_SESSION_POOL_H
+#define HTTP_SESSION_POOL_H
+#pragma once
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Poco/Net/Context.h"
+#include "Poco/Net/Session.h"
+
+#include "util/noncopyable.h"
+#include "util/request_timing.h"
+#include "util/simple_mutex.h"
+
+namespace Poco {
+class Timespan;
+class URI;
+namespace Net {
+class HTTPClientSession;
+class StreamSocket;
+}
+}
+
+namespace qcloud_cos {
+
+/// \brief 进程内共享的HTTP(S)长连接池, 按scheme://host:port归类空闲连接
+///        只有开启KeepAlive时才复用连接, 否则每次借出新连接、归还时直接关闭
+///        HTTPS连接共享同一个SSL Context, 并按host缓存TLS session用于握手恢复
+class HttpSessionPool : private NonCopyable {
+public:
+    static HttpSessionPool& Instance();
+
+    /// \brief 创建进程共享的SSL Context, 由CosAPI::CosInit调用
+    void InitSslContext();
+
+    /// \brief 释放SSL Context及缓存的TLS session, 由CosAPI::CosUInit调用
+    void ResetSslContext();
+
+    /// \brief 借出一个到url所在主机的连接, 优先复用空闲连接
+    ///
+    /// \param url             请求的url
+    /// \param is_new_session  返回是否为新建的连接, 可为NULL
+    Poco::Net::HTTPClientSession* Acquire(const Poco::URI& url, bool* is_new_session = NULL);
+
+    /// \brief 为未建立连接的session分步完成DNS解析、TCP建连和TLS握手, 并记录各步耗时
+    ///        已建立连接(复用)时直接返回, 失败时抛出Poco异常
+    ///        连接超时使用session->getTimeout()
+    ///        开启DNS缓存时从DnsCache取候选地址, 建连失败时依次尝试下一个地址
+    void Connect(Poco::Net::HTTPClientSession* session, RequestTiming* timing);
+
+    /// \brief 归还连接, reusable为false或连接已断开时直接关闭
+    ///        is_new_session为true时统计本次TLS握手是否为session恢复
+    void Release(Poco::Net::HTTPClientSession* session, bool reusable,
+                 bool is_new_session = false);
+
+    /// \brief 关闭所有空闲连接
+    void Clear();
+
+    /// \brief 获取当前空闲连接总数
+    size_t GetIdleSessionNum();
+
+    /// \brief 获取TLS握手统计
+    ///
+    /// \param full_handshake_num     完整握手次数
+    /// \param resumed_handshake_num  通过session恢复的握手次数
+    void GetTlsHandshakeNum(uint64_t* full_handshake_num, uint64_t* resumed_handshake_num);
+
+private:
+    struct IdleSession {
+        Poco::Net::HTTPClientSession* m_session;
+        uint64_t m_idle_since_in_ms;
+    };
+    typedef std::map<std::string, std::deque<IdleSession> > SessionMap;
+    typedef std::map<std::string, Poco::Net::Session::Ptr> TlsSessionMap;
+
+    HttpSessionPool()
+        : m_idle_num(0), m_full_handshake_num(0), m_resumed_handshake_num(0) {}
+    ~HttpSessionPool();
+
+    static std::string GetSessionKey(bool is_https, const std::string& host, uint16_t port);
+
+    static Poco::Net::Context::Ptr CreateSslContext();
+
+    Poco::Net::HTTPClientSession* CreateSession(const Poco::URI& url, bool is_https);
+
+    // 记录新建HTTPS连接的握手类型, 并缓存其TLS session供后续连接恢复
+    void RecordTlsSession(Poco::Net::HTTPClientSession* session, bool is_new_session);
+
+    // 设置socket的TCP keepalive探针参数
+    void ApplyKeepAliveOption(Poco::Net::HTTPClientSession* session);
+
+    // 获取host的候选地址, 未开启DNS缓存时返回host本身, 解析失败时抛出HostNotFoundException
+    static void ResolveAddresses(const std::string& host, std::vector<std::string>* addrs);
+
+    // 依次尝试连接候选地址, 开启DNS缓存时记录失败的地址及连接所用的地址
+    void ConnectSocket(Poco::Net::HTTPClientSession* session, Poco::Net::StreamSocket& ss,
+                       const std::vector<std::string>& addrs, const Poco::Timespan& timeout);
+
+    // 关闭并释放session, 同时更新其地址在DnsCache中的连接数
+    void DestroySession(Poco::Net::HTTPClientSession* session);
+
+    // 调用方需持有m_mutex, 过期连接放入stale_sessions由调用方在锁外关闭
+    void ReapStaleSessions(uint64_t now_in_ms,
+                           std::deque<Poco::Net::HTTPClientSession*>* stale_sessions);
+
+private:
+    SimpleMutex m_mutex;
+    SessionMap m_idle_sessions;
+    size_t m_idle_num;
+
+    Poco::Net::Context::Ptr m_ssl_context;
+    TlsSessionMap m_tls_sessions;
+    // 开启DNS缓存时, 已建立连接的session所连接的地址
+    std::map<Poco::Net::HTTPClientSession*, std::string> m_session_addrs;
+    uint64_t m_full_handshake_num;
+    uint64_t m_resumed_handshake_num;
+};
+
+/// \brief 借出连接的持有者, 析构时自动归还连接池
+///        只有完整读取响应且服务端允许keep-alive时, 才应调用SetReusable(true)
+class PooledSession : private NonCopyable {
+public:
+    explicit PooledSession(const Poco::URI& url)
+        : m_session(NULL), m_reusable(false), m_is_new_session(false) {
+        m_session = HttpSessionPool::Instance().Acquire(url, &m_is_new_session);
+    }
+
+    ~PooledSession() {
+        HttpSessionPool::Instance().Release(m_session, m_reusable, m_is_new_session);
+    }
+
+    Poco::Net::HTTPClientSession* operator->() const { return m_session; }
+
+    Poco::Net::HTTPClientSession* Get() const { return m_session; }
+
+    void Connect(RequestTiming* timing) { HttpSessionPool::Instance().Connect(m_session, timing); }
+
+    void SetReusable(bool reusable) { m_reusable = reusable; }
+
+private:
+    Poco::Net::HTTPClientSession* m_session;
+    bool m_reusable;
+    bool m_is_new_session;
+};
+
+} // namespace qcloud_cos
+#endif // HTTP_SESSION_POOL_H
@@ -0,0 +1,93 @@
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <ostream>
+#include <string>
+
+#include "Poco/SharedPtr.h"
+
+#include "util/canonical_request.h"
+#include "util/noncopyable.h"
+
+namespace qcloud_cos {
+
+class BodySource;
+class RequestContext;
+
+/// \brief HTTP传输层接口, HttpSender的请求最终都经由当前传输层发出,
+///        BaseOp、HedgedRequest及File*Task无需关心底层使用的网络库
+///        内置两种实现:
+///        - poco: 默认实现, 每个请求在调用线程上阻塞收发, 连接由HttpSessionPool复用
+///        - curl: 编译时开启ENABLE_CURL_TRANSPORT后可用, 所有请求由一个libcurl multi
+///                事件循环线程驱动, 大量并发传输不再各占一个阻塞的socket读写
+///        实现须是线程安全的; 网络错误与超时的err_msg须分别以"Net Exception:"、
+///        "TimeoutException:"开头, RetryPolicy据此判断能否重试
+class HttpTransport : private NonCopyable {
+public:
+    virtual ~HttpTransport() {}
+
+    /// \brief 传输层名称, 与CosSysConfig::SetHttpTransport的取值对应
+    virtual std::string GetName() const = 0;
+
+    /// \brief 发送请求, 无论状态码如何, 响应体均写入resp_stream
+    ///        is_check_md5为true时校验响应体MD5与ETag, 不一致时返回-1
+    ///        ctx->IsDecodeGzip()且响应经过gzip压缩时, 写入resp_stream的是解压后的数据
+    ///        ctx非NULL时在其中记录耗时, 且请求可从其他线程取消
+    ///
+    /// \return http状态码, 失败时返回-1并填充err_msg
+    virtual int SendRequest(const std::string& http_method,
+                            const std::string& url_str,
+                            const CanonicalRequest& req_params,
+                            const std::map<std::string, std::string>& req_headers,
+                            BodySource& req_body,
+                            uint64_t conn_timeout_in_ms,
+                            uint64_t recv_timeout_in_ms,
+                            std::map<std::string, std::string>* resp_headers,
+                            std::ostream& resp_stream,
+                            std::string* err_msg,
+                            bool is_check_md5,
+                            RequestContext* ctx) = 0;
+
+    /// \brief 下载请求, 状态码为200/206时响应体写入resp_stream, 否则写入xml_err_str
+    ///        real_byte返回写入的字节数, 其余同上
+    virtual int SendRequest(const std::string& http_method,
+                            const std::string& url_str,
+                            const CanonicalRequest& req_params,
+                            const std::map<std::string, std::string>& req_headers,
+                            const std::string& req_body,
+                            uint64_t conn_timeout_in_ms,
+                            uint64_t recv_timeout_in_ms,
+                            std::map<std::string, std::string>* resp_headers,
+                            std::string* xml_err_str,
+                            std::ostream& resp_stream,
+                            std::string* err_msg,
+                            uint64_t* real_byte,
+                            bool is_check_md5,
+                            RequestContext* ctx) = 0;
+
+    /// \brief 获取当前使用的传输层
+    ///        已通过SetTransport注入时返回注入的实现, 否则按CosSysConfig::GetHttpTransport创建,
+    ///        名称未知或该实现未编译时退回poco
+    static Poco::SharedPtr<HttpTransport> GetTransport();
+
+    /// \brief 注入自定义的传输层(如测试桩), 传入空指针则恢复按配置创建
+    ///        正在进行的请求仍使用原传输层完成
+    static void SetTransport(const Poco::SharedPtr<HttpTransport>& transport);
+
+    /// \brief 按名称创建内置的传输层, 名称未知或该实现未编译时返回NULL
+    static HttpTransport* Create(const std::string& name);
+
+protected:
+    /// \brief 请求被取消时的错误信息
+    static const char kCancelledErrMsg[];
+
+    /// \brief 请求体较大或长度未知时使用Expect: 100-continue
+    static bool ShouldExpectContinue(BodySource& req_body);
+};
+
+} // namespace qcloud_cos
+#endif // HTTP_TRANSPORT_H
@@ -0,0 +1,61 @@
+#ifndef POCO_HTTP_TRANSPORT_H
+#define POCO_HTTP_TRANSPORT_H
+#pragma once
+
+#include <stdint.h>
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+
+#include "util/http_transport.h"
+
+namespace qcloud_cos {
+
+/// \brief 基于Poco的默认传输层, 每个请求在调用线程上阻塞收发
+///        连接从HttpSessionPool借出, 开启KeepAlive时复用已建立的TCP/TLS连接
+///        ctx非NULL时请求发出后登记连接的socket, 取消时关闭socket的读写使阻塞的收发立即返回
+class PocoHttpTransport : public HttpTransport {
+public:
+    PocoHttpTransport() {}
+
+    virtual ~PocoHttpTransport() {}
+
+    virtual std::string GetName() const { return "poco"; }
+
+    virtual int SendRequest(const std::string& http_method,
+                            const std::string& url_str,
+                            const CanonicalRequest& req_params,
+                            const std::map<std::string, std::string>& req_headers,
+                            BodySource& req_body,
+                            uint64_t conn_timeout_in_ms,
+                            uint64_t recv_timeout_in_ms,
+                            std::map<std::string, std::string>* resp_headers,
+                            std::ostream& resp_stream,
+                            std::string* err_msg,
+                            bool is_check_md5,
+                            RequestContext* ctx);
+
+    virtual int SendRequest(const std::string& http_method,
+                            const std::string& url_str,
+                            const CanonicalRequest& req_params,
+                            const std::map<std::string, std::string>& req_headers,
+                            const std::string& req_body,
+                            uint64_t conn_timeout_in_ms,
+                            uint64_t recv_timeout_in_ms,
+                            std::map<std::string, std::string>* resp_headers,
+                            std::string* xml_err_str,
+                            std::ostream& resp_stream,
+                            std::string* err_msg,
+                            uint64_t* real_byte,
+                            bool is_check_md5,
+                            RequestContext* ctx);
+
+private:
+    // 将is拷贝至os, 同时增量计算MD5, 返回拷贝的字节数
+    static uint64_t CopyStreamWithMd5(std::istream& is, std::ostream& os, std::string* md5_str);
+};
+
+} // namespace qcloud_cos
+#endif // POCO_HTTP_TRANSPORT_H
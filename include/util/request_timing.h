@@ -0,0 +1,52 @@
+#ifndef REQUEST_TIMING_H
+#define REQUEST_TIMING_H
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+namespace qcloud_cos {
+
+/// \brief 一次HTTP请求各阶段的耗时(微秒, 基于单调时钟)及收发的字节数
+///        复用连接池中的连接时, DNS/建连/TLS握手耗时为0
+///        多个请求(如分块上传/下载的各个分块)可通过Add累加, 此时各阶段耗时为所有请求之和
+struct RequestTiming {
+    uint64_t m_dns_time_in_us;          // DNS解析耗时
+    uint64_t m_connect_time_in_us;      // TCP建连耗时
+    uint64_t m_tls_time_in_us;          // TLS握手耗时
+    uint64_t m_send_time_in_us;         // 发送请求头和请求体的耗时
+    uint64_t m_first_byte_time_in_us;   // 请求发送完毕至收到响应头的耗时
+    uint64_t m_recv_time_in_us;         // 读取响应体的耗时
+    uint64_t m_total_time_in_us;        // 请求的总耗时
+    uint64_t m_bytes_sent;              // 已发送的请求体字节数
+    uint64_t m_bytes_received;          // 已接收的响应体字节数
+    unsigned m_request_num;             // 累计的请求数
+    unsigned m_new_session_num;         // 其中新建连接的请求数
+
+    RequestTiming()
+        : m_dns_time_in_us(0), m_connect_time_in_us(0), m_tls_time_in_us(0),
+          m_send_time_in_us(0), m_first_byte_time_in_us(0), m_recv_time_in_us(0),
+          m_total_time_in_us(0), m_bytes_sent(0), m_bytes_received(0),
+          m_request_num(0), m_new_session_num(0) {}
+
+    void Add(const RequestTiming& other) {
+        m_dns_time_in_us += other.m_dns_time_in_us;
+        m_connect_time_in_us += other.m_connect_time_in_us;
+        m_tls_time_in_us += other.m_tls_time_in_us;
+        m_send_time_in_us += other.m_send_time_in_us;
+        m_first_byte_time_in_us += other.m_first_byte_time_in_us;
+        m_recv_time_in_us += other.m_recv_time_in_us;
+        m_total_time_in_us += other.m_total_time_in_us;
+        m_bytes_sent += other.m_bytes_sent;
+        m_bytes_received += other.m_bytes_received;
+        m_request_num += other.m_request_num;
+        m_new_session_num += other.m_new_session_num;
+    }
+
+    /// \brief 输出各阶段耗时, 用于日志
+    std::string DebugString() const;
+};
+
+} // namespace qcloud_cos
+#endif // REQUEST_TIMING_H
@@ -0,0 +1,68 @@
+#ifndef RETRY_POLICY_H
+#define RETRY_POLICY_H
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+namespace qcloud_cos {
+
+/// \brief 请求失败的分类, 决定是否重试及退避的初始等待时间
+enum RetryableError {
+    kNotRetryable = 0,
+    kRetryNetworkError,         // 连接失败、超时、连接被重置等网络错误
+    kRetryServerError,          // 服务端5xx错误
+    kRetrySlowDown,             // 服务端限流(503 SlowDown)
+    kRetryChecksumMismatch,     // 下载内容的MD5或上传后返回的ETag与本地不一致
+};
+
+/// \brief 失败重试策略: 按失败类型和HTTP方法的幂等性判断是否重试,
+///        重试前按指数退避等待, 并在[0, 退避时间]内随机抖动(full jitter),
+///        避免大量客户端在服务端抖动或限流时同时重试
+///        次数和等待时间由CosSysConfig的MaxRetryTimes/RetryBaseDelayInms/RetryMaxDelayInms配置
+class RetryPolicy {
+public:
+    /// \brief 使用CosSysConfig中的配置
+    RetryPolicy();
+
+    RetryPolicy(unsigned max_retry_times, uint64_t base_delay_in_ms, uint64_t max_delay_in_ms);
+
+    /// \brief 对一次请求的结果分类
+    ///
+    /// \param http_code  HttpSender::SendRequest的返回值, -1表示未收到有效响应
+    /// \param err_code   COS返回的错误码, 如SlowDown
+    /// \param err_msg    HttpSender返回的错误信息
+    static RetryableError Classify(int http_code, const std::string& err_code,
+                                   const std::string& err_msg);
+
+    /// \brief 同Classify, 错误码从COS返回的xml响应体中提取, 供未解析响应体的分块任务使用
+    static RetryableError ClassifyResponse(int http_code, const std::string& resp_body,
+                                           const std::string& err_msg);
+
+    /// \brief 重复执行与执行一次效果相同的HTTP方法
+    static bool IsIdempotent(const std::string& http_method);
+
+    /// \brief 第attempt次(从1开始)尝试以error失败后是否应重试
+    ///        非幂等方法只在服务端明确拒绝(限流)时重试
+    bool ShouldRetry(const std::string& http_method, RetryableError error,
+                     unsigned attempt) const;
+
+    /// \brief 第attempt次尝试失败后重试前的等待时间, 单位毫秒
+    uint64_t GetDelayInms(RetryableError error, unsigned attempt) const;
+
+    /// \brief 按GetDelayInms等待
+    void Backoff(RetryableError error, unsigned attempt) const;
+
+    /// \brief ShouldRetry为true时等待退避时间后返回true
+    bool WaitForRetry(const std::string& http_method, RetryableError error,
+                      unsigned attempt) const;
+
+private:
+    unsigned m_max_retry_times;
+    uint64_t m_base_delay_in_ms;
+    uint64_t m_max_delay_in_ms;
+};
+
+} // namespace qcloud_cos
+#endif // RETRY_POLICY_H
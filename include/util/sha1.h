@@ -5,6 +5,8 @@
 
 #include <string>
 
+#include "util/noncopyable.h"
+
 namespace qcloud_cos {
 
 /* Useful defines & typedefs */
@@ -33,16 +35,47 @@ void ShaFinal(unsigned char [20], SHA_INFO *);
 void ShaOutput(unsigned char [20],unsigned char [40]);
 const char* ShaVersion(void);
 
-class Sha1 {
+/// \brief SHA-1摘要, 使用OpenSSL的EVP接口; OpenSSL在运行时按CPU特性选择
+///        SHA-NI/AVX2/SSSE3等指令集实现, 比上面的可移植实现(ShaInit/ShaUpdate/ShaFinal)快数倍
+///        头文件中不引入openssl头文件, 以免其SHA_LONG宏与上面的typedef冲突
+class Sha1 : private NonCopyable {
 public:
     Sha1();
     ~Sha1();
 
     void Append(const char* data, unsigned int size);
+
+    /// \brief 返回小写的16进制摘要
     std::string Final();
 
 private:
-    SHA_INFO    m_sha;
+    void*       m_ctx;      // EVP_MD_CTX*
+};
+
+/// \brief HMAC-SHA1, 构造时预先计算密钥内外填充块的哈希状态,
+///        之后每次计算只需对消息和内层摘要做哈希; 计算不修改预计算状态, 可并发调用
+class HmacSha1Ctx {
+public:
+    HmacSha1Ctx();
+    explicit HmacSha1Ctx(const std::string& key);
+    HmacSha1Ctx(const HmacSha1Ctx& other);
+    HmacSha1Ctx& operator=(const HmacSha1Ctx& other);
+    ~HmacSha1Ctx();
+
+    /// \brief 返回20字节的二进制摘要
+    std::string Digest(const std::string& plain_text) const;
+
+    /// \brief 返回小写的16进制摘要
+    std::string HexDigest(const std::string& plain_text) const;
+
+private:
+    void Init(const std::string& key);
+
+    void Compute(const std::string& plain_text, unsigned char digest[SHA_DIGESTSIZE]) const;
+
+private:
+    void*       m_inner;    // EVP_MD_CTX*, 已处理(key ^ ipad)的状态
+    void*       m_outer;    // EVP_MD_CTX*, 已处理(key ^ opad)的状态
 };
 
 }
@@ -0,0 +1,99 @@
+#ifndef TASK_EXECUTOR_H
+#define TASK_EXECUTOR_H
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include "util/noncopyable.h"
+
+namespace qcloud_cos {
+
+typedef boost::function<void ()> ExecutorTask;
+
+/// \brief 执行器的运行统计
+struct TaskExecutorStats {
+    unsigned m_thread_num;          // 工作线程数
+    unsigned m_busy_thread_num;     // 正在执行任务的线程数
+    uint64_t m_queued_task_num;     // 排队等待执行的任务数
+    uint64_t m_completed_task_num;  // 启动以来执行完成的任务数
+    double m_utilization;           // 启动以来工作线程的忙碌时间占比, 取值[0, 1]
+
+    TaskExecutorStats()
+        : m_thread_num(0), m_busy_thread_num(0), m_queued_task_num(0),
+          m_completed_task_num(0), m_utilization(0) {}
+};
+
+/// \brief 进程内共享的任务执行器, SDK的多线程上传、下载、复制均提交到这里执行
+///        所有工作线程共享一个先进先出的任务队列, 任务以网络IO为主, 队列操作不是瓶颈
+///        线程数由ExecutorThreadNum配置, 为0时按CPU核数自动确定, 首次提交任务时启动
+class TaskExecutor : private NonCopyable {
+public:
+    static TaskExecutor& Instance();
+
+    /// \brief 提交一个任务, 任务中抛出的异常会被忽略
+    void Submit(const ExecutorTask& task);
+
+    /// \brief 获取运行统计
+    void GetStats(TaskExecutorStats* stats);
+
+private:
+    TaskExecutor();
+    ~TaskExecutor();
+
+    static unsigned GetDefaultThreadNum();
+
+    static void* WorkerEntry(void* arg);
+
+    // 调用方需持有m_mutex
+    void Start();
+
+    void WorkerLoop();
+
+private:
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    std::vector<pthread_t> m_threads;
+    std::deque<ExecutorTask> m_tasks;
+    bool m_started;
+    bool m_stopping;
+    unsigned m_busy_thread_num;
+    uint64_t m_completed_task_num;
+    uint64_t m_busy_time_in_us;
+    uint64_t m_start_time_in_us;
+};
+
+/// \brief 一次操作提交到TaskExecutor的一组任务, 限制该组同时执行的任务数
+///        超出配额的任务在组内排队, 组内任务完成后再提交到执行器,
+///        避免单次大文件操作占满所有工作线程
+class TaskGroup : private NonCopyable {
+public:
+    /// \param max_concurrency 该组最多同时执行的任务数, 0视为1
+    explicit TaskGroup(unsigned max_concurrency);
+
+    /// \brief 析构时等待组内任务全部完成
+    ~TaskGroup();
+
+    void Schedule(const ExecutorTask& task);
+
+    /// \brief 等待已提交的任务全部完成
+    void Wait();
+
+private:
+    void RunTask(const ExecutorTask& task);
+
+private:
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    unsigned m_max_concurrency;
+    unsigned m_running_num;
+    std::deque<ExecutorTask> m_pending_tasks;
+};
+
+} // namespace qcloud_cos
+#endif // TASK_EXECUTOR_H
@@ -3,11 +3,13 @@
 #include <pthread.h>
 
 #include "threadpool/boost/threadpool.hpp"
+#include <boost/bind.hpp>
 #include "Poco/Net/HTTPStreamFactory.h"
 #include "Poco/Net/HTTPSStreamFactory.h"
 #include "Poco/Net/SSLManager.h"
 
 #include "cos_sys_config.h"
+#include "util/http_session_pool.h"
 #include "util/string_util.h"
 
 namespace qcloud_cos {
@@ -16,15 +18,22 @@ bool CosAPI::s_init = false;
 bool CosAPI::s_poco_init = false;
 int CosAPI::s_cos_obj_num = 0;
 SimpleMutex CosAPI::s_init_mutex = SimpleMutex();
-//boost::threadpool::pool* g_threadpool = NULL;
+// 异步接口的请求会阻塞等待其在TaskExecutor中的分块任务, 因此使用独立的线程池执行
+boost::threadpool::pool* g_threadpool = NULL;
 
 CosAPI::CosAPI(CosConfig& config)
-    : m_config(new CosConfig(config)), m_object_op(m_config), m_bucket_op(m_config), m_service_op(m_config) {
+    : m_config(new CosConfig(config)), m_object_op(m_config), m_bucket_op(m_config), m_service_op(m_config),
+      m_async_task_num(0) {
+    pthread_mutex_init(&m_async_mutex, NULL);
+    pthread_cond_init(&m_async_cond, NULL);
     CosInit();
 }
 
 CosAPI::~CosAPI() {
+    WaitAsyncTasks();
     CosUInit();
+    pthread_cond_destroy(&m_async_cond);
+    pthread_mutex_destroy(&m_async_mutex);
 }
 
 int CosAPI::CosInit() {
@@ -38,7 +47,10 @@ int CosAPI::CosInit() {
             s_poco_init = true;
         }
 
-        //g_threadpool = new boost::threadpool::pool(CosSysConfig::GetAsynThreadPoolSize());
+        // 所有HTTPS连接共享同一个SSL Context, 避免每次请求重复构建并支持TLS session恢复
+        HttpSessionPool::Instance().InitSslContext();
+
+        g_threadpool = new boost::threadpool::pool(CosSysConfig::GetAsynThreadPoolSize());
         s_init = true;
     }
 
@@ -49,20 +61,88 @@ void CosAPI::CosUInit() {
     SimpleMutexLocker locker(&s_init_mutex);
     --s_cos_obj_num;
     if (s_init && s_cos_obj_num == 0) {
-        //if (g_threadpool){
-        //    g_threadpool->wait();
-        //    delete g_threadpool;
-        //    g_threadpool = NULL;
-        //}
+        if (g_threadpool){
+            g_threadpool->wait();
+            delete g_threadpool;
+            g_threadpool = NULL;
+        }
 
+        // 最后一个CosAPI对象析构时关闭所有空闲长连接
+        HttpSessionPool::Instance().Clear();
+        HttpSessionPool::Instance().ResetSslContext();
         s_init = false;
     }
 }
 
+template <class ReqType, class RespType>
+Poco::SharedPtr<AsyncResult<RespType> > CosAPI::ScheduleAsyncTask(
+        CosResult (ObjectOp::*func)(const ReqType&, RespType*),
+        const ReqType& request,
+        const typename AsyncResult<RespType>::Callback& callback) {
+    Poco::SharedPtr<AsyncResult<RespType> > async_result(new AsyncResult<RespType>());
+    async_result->SetCallback(callback);
+
+    pthread_mutex_lock(&m_async_mutex);
+    ++m_async_task_num;
+    pthread_mutex_unlock(&m_async_mutex);
+
+    // 请求参数随任务一起拷贝, 调用方无需保证request的生命周期
+    // 同步接口在线程池线程中阻塞执行, 线程全忙时任务排队等待
+    g_threadpool->schedule(boost::bind(&CosAPI::RunAsyncTask<ReqType, RespType>, this,
+                                       func, request, async_result));
+    return async_result;
+}
+
+template <class ReqType, class RespType>
+void CosAPI::RunAsyncTask(CosResult (ObjectOp::*func)(const ReqType&, RespType*),
+                          const ReqType& request,
+                          Poco::SharedPtr<AsyncResult<RespType> > async_result) {
+    // 任务在线程池中执行, 异常不能抛出到线程池; 无论成功与否都需Done, 否则调用方会一直等待
+    CosResult result;
+    try {
+        result = (m_object_op.*func)(request, async_result->MutableResp());
+    } catch (const std::exception& ex) {
+        SDK_LOG_ERR("Async task throw exception, %s", ex.what());
+        result.SetFail();
+        result.SetErrorInfo(std::string("Async task throw exception, ") + ex.what());
+    } catch (...) {
+        SDK_LOG_ERR("Async task throw unknown exception");
+        result.SetFail();
+        result.SetErrorInfo("Async task throw unknown exception");
+    }
+
+    try {
+        async_result->Done(result);
+    } catch (const std::exception& ex) {
+        SDK_LOG_ERR("Async callback throw exception, %s", ex.what());
+    } catch (...) {
+        SDK_LOG_ERR("Async callback throw unknown exception");
+    }
+
+    pthread_mutex_lock(&m_async_mutex);
+    if (--m_async_task_num == 0) {
+        pthread_cond_broadcast(&m_async_cond);
+    }
+    pthread_mutex_unlock(&m_async_mutex);
+}
+
+void CosAPI::WaitAsyncTasks() {
+    pthread_mutex_lock(&m_async_mutex);
+    while (m_async_task_num > 0) {
+        pthread_cond_wait(&m_async_cond, &m_async_mutex);
+    }
+    pthread_mutex_unlock(&m_async_mutex);
+}
+
 void CosAPI::SetCredentail(const std::string& ak, const std::string& sk, const std::string& token){
     m_config->SetConfigCredentail(ak,sk,token);
 }
 
+bool CosAPI::SetCredentialProvider(const Poco::SharedPtr<CredentialProvider>& provider,
+                                   uint64_t refresh_ahead_in_s) {
+    return m_config->SetCredentialProvider(provider, refresh_ahead_in_s);
+}
+
 bool CosAPI::IsBucketExist(const std::string& bucket_name) {
     return m_bucket_op.IsBucketExist(bucket_name);
 }
@@ -71,6 +151,18 @@ bool CosAPI::IsObjectExist(const std::string& bucket_name, const std::string& ob
     return m_object_op.IsObjectExist(bucket_name, object_name);
 }
 
+void CosAPI::GetTlsHandshakeNum(uint64_t* full_handshake_num, uint64_t* resumed_handshake_num) {
+    HttpSessionPool::Instance().GetTlsHandshakeNum(full_handshake_num, resumed_handshake_num);
+}
+
+void CosAPI::GetExecutorStats(TaskExecutorStats* stats) {
+    TaskExecutor::Instance().GetStats(stats);
+}
+
+void CosAPI::GetHedgeStats(HedgeStats* stats) {
+    HedgedRequest::GetStats(stats);
+}
+
 std::string CosAPI::GeneratePresignedUrl(const GeneratePresignedUrlReq& request) {
     return m_object_op.GeneratePresignedUrl(request);
 }
@@ -94,6 +186,17 @@ std::string CosAPI::GeneratePresignedUrl(const std::string& bucket_name,
     return GeneratePresignedUrl(bucket_name, key, start_time_in_s, end_time_in_s, HTTP_GET);
 }
 
+bool CosAPI::GeneratePresignedUrls(const std::string& bucket_name,
+                                   const std::vector<std::string>& object_names,
+                                   HTTP_METHOD http_method,
+                                   uint64_t start_time_in_s,
+                                   uint64_t end_time_in_s,
+                                   std::vector<std::string>* urls,
+                                   unsigned thread_num) {
+    return m_object_op.GeneratePresignedUrls(bucket_name, object_names, http_method,
+                                             start_time_in_s, end_time_in_s, urls, thread_num);
+}
+
 std::string CosAPI::GetBucketLocation(const std::string& bucket_name) {
     return m_bucket_op.GetBucketLocation(bucket_name);
 }
@@ -257,6 +360,37 @@ CosResult CosAPI::MultiUploadObject(const MultiUploadObjectReq& request,
     return m_object_op.MultiUploadObject(request, response);
 }
 
+HeadObjectAsyncResultPtr CosAPI::AsyncHeadObject(const HeadObjectReq& request,
+        const AsyncResult<HeadObjectResp>::Callback& callback) {
+    return ScheduleAsyncTask(&ObjectOp::HeadObject, request, callback);
+}
+
+GetObjectByFileAsyncResultPtr CosAPI::AsyncGetObject(const GetObjectByFileReq& request,
+        const AsyncResult<GetObjectByFileResp>::Callback& callback) {
+    CosResult (ObjectOp::*func)(const GetObjectByFileReq&, GetObjectByFileResp*)
+        = &ObjectOp::GetObject;
+    return ScheduleAsyncTask(func, request, callback);
+}
+
+MultiGetObjectAsyncResultPtr CosAPI::AsyncGetObject(const MultiGetObjectReq& request,
+        const AsyncResult<MultiGetObjectResp>::Callback& callback) {
+    CosResult (ObjectOp::*func)(const MultiGetObjectReq&, MultiGetObjectResp*)
+        = &ObjectOp::GetObject;
+    return ScheduleAsyncTask(func, request, callback);
+}
+
+PutObjectByFileAsyncResultPtr CosAPI::AsyncPutObject(const PutObjectByFileReq& request,
+        const AsyncResult<PutObjectByFileResp>::Callback& callback) {
+    CosResult (ObjectOp::*func)(const PutObjectByFileReq&, PutObjectByFileResp*)
+        = &ObjectOp::PutObject;
+    return ScheduleAsyncTask(func, request, callback);
+}
+
+MultiUploadObjectAsyncResultPtr CosAPI::AsyncMultiUploadObject(const MultiUploadObjectReq& request,
+        const AsyncResult<MultiUploadObjectResp>::Callback& callback) {
+    return ScheduleAsyncTask(&ObjectOp::MultiUploadObject, request, callback);
+}
+
 CosResult CosAPI::AbortMultiUpload(const AbortMultiUploadReq& request,
                                    AbortMultiUploadResp* response) {
     return m_object_op.AbortMultiUpload(request, response);
@@ -10,7 +10,7 @@
 
 namespace qcloud_cos {
 CosConfig::CosConfig(const std::string& config_file) :
-    m_app_id(0), m_access_key(""), m_secret_key(""), m_region(""), m_tmp_token(""), m_config_parsed(false) {
+    m_app_id(0), m_region(""), m_config_parsed(false) {
     if (InitConf(config_file)) {
         m_config_parsed = true;
      }
@@ -87,12 +87,15 @@ bool CosConfig::InitConf(const std::string& config_file) {
     Poco::JSON::Object::Ptr object = result.extract<Poco::JSON::Object::Ptr>();
 
     JsonObjectGetIntegerValue(object, "AppID", &m_app_id);
-    JsonObjectGetStringValue(object, "AccessKey", &m_access_key);
-    JsonObjectGetStringValue(object, "SecretId", &m_access_key);
-    JsonObjectGetStringValue(object, "SecretKey", &m_secret_key);
-    if (m_access_key.empty() || m_secret_key.empty()) {
+    std::string access_key;
+    std::string secret_key;
+    JsonObjectGetStringValue(object, "AccessKey", &access_key);
+    JsonObjectGetStringValue(object, "SecretId", &access_key);
+    JsonObjectGetStringValue(object, "SecretKey", &secret_key);
+    if (access_key.empty() || secret_key.empty()) {
         std::cerr << "warnning, access_key or serete_key not exists" << std::endl;
      }
+    SetConfigCredentail(access_key, secret_key, GetCredential()->GetTmpToken());
     
     //设置cos区域和下载域名:cos,cdn,innercos,自定义,默认:cos
     JsonObjectGetStringValue(object, "Region", &m_region);
@@ -149,17 +152,63 @@ bool CosConfig::InitConf(const std::string& config_file) {
 
     bool bool_value;
     // 长连接相关
-    #if 0
-    if (JsonObjectGetBoolValue(object, "keepalive_mode", &bool_value)) {
+    if (JsonObjectGetBoolValue(object, "KeepAlive", &bool_value)) {
         CosSysConfig::SetKeepAlive(bool_value);
     }
-    if (JsonObjectGetIntegerValue(object, "keepalive_idle_time", &integer_value)) {
+    if (JsonObjectGetIntegerValue(object, "KeepIdle", &integer_value)) {
         CosSysConfig::SetKeepIdle(integer_value);
     }
-    if (JsonObjectGetIntegerValue(object, "keepalive_interval_time", &integer_value)) {
+    if (JsonObjectGetIntegerValue(object, "KeepIntvl", &integer_value)) {
         CosSysConfig::SetKeepIntvl(integer_value);
     }
-    #endif
+    if (JsonObjectGetIntegerValue(object, "MaxIdleSessionsPerHost", &integer_value)) {
+        CosSysConfig::SetMaxIdleSessionsPerHost(integer_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "IdleSessionTimeoutInms", &integer_value)) {
+        CosSysConfig::SetIdleSessionTimeoutInms(integer_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "ExecutorThreadNum", &integer_value)) {
+        CosSysConfig::SetExecutorThreadNum(integer_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "MaxRetryTimes", &integer_value)) {
+        CosSysConfig::SetMaxRetryTimes(integer_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "RetryBaseDelayInms", &integer_value)) {
+        CosSysConfig::SetRetryBaseDelayInms(integer_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "RetryMaxDelayInms", &integer_value)) {
+        CosSysConfig::SetRetryMaxDelayInms(integer_value);
+    }
+    if (JsonObjectGetBoolValue(object, "HedgeEnable", &bool_value)) {
+        CosSysConfig::SetHedgeEnable(bool_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "HedgeDelayPercentile", &integer_value)) {
+        CosSysConfig::SetHedgeDelayPercentile(integer_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "HedgeMinDelayInms", &integer_value)) {
+        CosSysConfig::SetHedgeMinDelayInms(integer_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "ExpectContinueThreshold", &integer_value)) {
+        CosSysConfig::SetExpectContinueThreshold(integer_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "ExpectContinueTimeoutInms", &integer_value)) {
+        CosSysConfig::SetExpectContinueTimeoutInms(integer_value);
+    }
+    if (JsonObjectGetBoolValue(object, "ListGzipEnable", &bool_value)) {
+        CosSysConfig::SetListGzipEnable(bool_value);
+    }
+    if (JsonObjectGetBoolValue(object, "DnsCacheEnable", &bool_value)) {
+        CosSysConfig::SetDnsCacheEnable(bool_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "DnsCacheTtlInms", &integer_value)) {
+        CosSysConfig::SetDnsCacheTtlInms(integer_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "DnsNegativeTtlInms", &integer_value)) {
+        CosSysConfig::SetDnsNegativeTtlInms(integer_value);
+    }
+    if (JsonObjectGetIntegerValue(object, "DnsRotatePolicy", &integer_value)) {
+        CosSysConfig::SetDnsRotatePolicy((DNS_ROTATE_POLICY)integer_value);
+    }
     if (JsonObjectGetBoolValue(object, "IsCheckMd5", &bool_value)) {
         CosSysConfig::SetCheckMd5(bool_value);
     }
@@ -181,6 +230,10 @@ bool CosConfig::InitConf(const std::string& config_file) {
         CosSysConfig::SetIntranetAddr(str_value);
     }
 
+    if (JsonObjectGetStringValue(object, "HttpTransport", &str_value)) {
+        CosSysConfig::SetHttpTransport(str_value);
+    }
+
     CosSysConfig::PrintValue();
     return true;
 }
@@ -190,15 +243,11 @@ uint64_t CosConfig::GetAppId() const {
 }
 
 std::string CosConfig::GetAccessKey() const {
-    SimpleRLocker lock(m_lock);
-    std::string ak = m_access_key;
-    return ak;
+    return GetCredential()->GetAccessKey();
 }
 
 std::string CosConfig::GetSecretKey() const {
-    SimpleRLocker lock(m_lock);
-    std::string sk = m_secret_key;
-    return sk;
+    return GetCredential()->GetSecretKey();
 }
 
 std::string CosConfig::GetRegion() const {
@@ -206,16 +255,46 @@ std::string CosConfig::GetRegion() const {
 }
 
 std::string CosConfig::GetTmpToken() const {
-    SimpleRLocker lock(m_lock);
-    std::string token = m_tmp_token;
-    return token;
+    return GetCredential()->GetTmpToken();
+}
+
+void CosConfig::SetAccessKey(const std::string& access_key) {
+    SimpleMutexLocker locker(&m_credential_mutex);
+    const Credential* credential = GetCredential();
+    m_credential.Set(Credential(access_key, credential->GetSecretKey(),
+                                credential->GetTmpToken()));
+}
+
+void CosConfig::SetSecretKey(const std::string& secret_key) {
+    SimpleMutexLocker locker(&m_credential_mutex);
+    const Credential* credential = GetCredential();
+    m_credential.Set(Credential(credential->GetAccessKey(), secret_key,
+                                credential->GetTmpToken()));
+}
+
+void CosConfig::SetTmpToken(const std::string& tmp_token) {
+    SimpleMutexLocker locker(&m_credential_mutex);
+    const Credential* credential = GetCredential();
+    m_credential.Set(Credential(credential->GetAccessKey(), credential->GetSecretKey(),
+                                tmp_token));
 }
 
 void CosConfig::SetConfigCredentail(const std::string& access_key, const std::string& secret_key, const std::string& tmp_token) {
-    SimpleWLocker lock(m_lock);
-    m_access_key = access_key;
-    m_secret_key = secret_key;
-    m_tmp_token  = tmp_token;
+    SimpleMutexLocker locker(&m_credential_mutex);
+    m_credential.Set(Credential(access_key, secret_key, tmp_token));
+}
+
+bool CosConfig::SetCredentialProvider(const Poco::SharedPtr<CredentialProvider>& provider,
+                                      uint64_t refresh_ahead_in_s) {
+    // 先停止已有的刷新线程, 避免新旧provider交替覆盖密钥
+    m_credential_refresher = NULL;
+    Poco::SharedPtr<CredentialRefresher> refresher(
+        new CredentialRefresher(provider, &m_credential, refresh_ahead_in_s));
+    if (!refresher->Start()) {
+        return false;
+    }
+    m_credential_refresher = refresher;
+    return true;
 }
 
 
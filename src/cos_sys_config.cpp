@@ -19,7 +19,7 @@ uint64_t CosSysConfig::m_conn_timeout_in_ms = 5 * 1000;
 uint64_t CosSysConfig::m_recv_timeout_in_ms = 5 * 1000;
 
 unsigned CosSysConfig::m_threadpool_size = kDefaultThreadPoolSizeUploadPart;
-unsigned CosSysConfig::m_asyn_threadpool_size = kDefaultPoolSize; //暂时没有使用
+unsigned CosSysConfig::m_asyn_threadpool_size = kDefaultPoolSize;
 
 //日志输出
 LOG_OUT_TYPE CosSysConfig::m_log_outtype = COS_LOG_STDOUT;
@@ -34,6 +34,41 @@ unsigned CosSysConfig::m_down_slice_size = 4*1024*1024;
 bool CosSysConfig::m_keep_alive = false;
 int64_t CosSysConfig::m_keep_idle = 20;
 int64_t CosSysConfig::m_keep_intvl = 5;
+unsigned CosSysConfig::m_max_idle_sessions_per_host = 32;
+uint64_t CosSysConfig::m_idle_session_timeout_in_ms = 15 * 1000;
+
+// 共享任务执行器线程数
+unsigned CosSysConfig::m_executor_thread_num = 0;
+
+// 失败重试: 最大次数及指数退避的初始/最大等待时间(毫秒)
+unsigned CosSysConfig::m_max_retry_times = kMaxRetryTimes;
+uint64_t CosSysConfig::m_retry_base_delay_in_ms = 100;
+uint64_t CosSysConfig::m_retry_max_delay_in_ms = 5 * 1000;
+
+// GET/HEAD请求对冲: 等待时间取首字节耗时的百分位数, 且不小于下限(毫秒)
+bool CosSysConfig::m_hedge_enable = false;
+unsigned CosSysConfig::m_hedge_delay_percentile = 95;
+uint64_t CosSysConfig::m_hedge_min_delay_in_ms = 10;
+
+// Expect: 100-continue: 请求体大小阈值(字节), 0表示不使用; 等待100 Continue的超时时间(毫秒)
+uint64_t CosSysConfig::m_expect_continue_threshold = 0;
+uint64_t CosSysConfig::m_expect_continue_timeout_in_ms = 1000;
+
+// 列举类请求(GetBucket/ListParts等)是否接受gzip压缩的响应
+bool CosSysConfig::m_list_gzip_enable = false;
+
+// HTTP传输层: poco或curl
+std::string CosSysConfig::m_http_transport = "poco";
+
+// 是否开启DNS缓存
+bool CosSysConfig::m_dns_cache_enable = false;
+// DNS缓存中解析结果的有效期, 单位ms
+uint64_t CosSysConfig::m_dns_cache_ttl_in_ms = 60000;
+// 解析失败结果的缓存时间, 单位ms
+uint64_t CosSysConfig::m_dns_negative_ttl_in_ms = 5000;
+// 在域名的多个地址间选择的策略
+DNS_ROTATE_POLICY CosSysConfig::m_dns_rotate_policy = DNS_ROTATE_ROUND_ROBIN;
+
 bool CosSysConfig::m_is_check_md5 = false;
 
 // 设置私有云host
@@ -63,6 +98,23 @@ void CosSysConfig::PrintValue() {
     std::cout << "keepalive:" << m_keep_alive << std::endl;
     std::cout << "keepidle:" << m_keep_idle << std::endl;
     std::cout << "keepintvl:" << m_keep_intvl << std::endl;
+    std::cout << "max_idle_sessions_per_host:" << m_max_idle_sessions_per_host << std::endl;
+    std::cout << "idle_session_timeout_in_ms:" << m_idle_session_timeout_in_ms << std::endl;
+    std::cout << "executor_thread_num:" << m_executor_thread_num << std::endl;
+    std::cout << "max_retry_times:" << m_max_retry_times << std::endl;
+    std::cout << "retry_base_delay_in_ms:" << m_retry_base_delay_in_ms << std::endl;
+    std::cout << "retry_max_delay_in_ms:" << m_retry_max_delay_in_ms << std::endl;
+    std::cout << "hedge_enable:" << m_hedge_enable << std::endl;
+    std::cout << "hedge_delay_percentile:" << m_hedge_delay_percentile << std::endl;
+    std::cout << "hedge_min_delay_in_ms:" << m_hedge_min_delay_in_ms << std::endl;
+    std::cout << "expect_continue_threshold:" << m_expect_continue_threshold << std::endl;
+    std::cout << "expect_continue_timeout_in_ms:" << m_expect_continue_timeout_in_ms << std::endl;
+    std::cout << "list_gzip_enable:" << m_list_gzip_enable << std::endl;
+    std::cout << "http_transport:" << m_http_transport << std::endl;
+    std::cout << "dns_cache_enable:" << m_dns_cache_enable << std::endl;
+    std::cout << "dns_cache_ttl_in_ms:" << m_dns_cache_ttl_in_ms << std::endl;
+    std::cout << "dns_negative_ttl_in_ms:" << m_dns_negative_ttl_in_ms << std::endl;
+    std::cout << "dns_rotate_policy:" << m_dns_rotate_policy << std::endl;
 }
 
 void CosSysConfig::SetKeepAlive(bool keep_alive) {
@@ -77,6 +129,74 @@ void CosSysConfig::SetKeepIntvl(int64_t keep_intvl) {
     m_keep_intvl = keep_intvl;
 }
 
+void CosSysConfig::SetMaxIdleSessionsPerHost(unsigned num) {
+    m_max_idle_sessions_per_host = num;
+}
+
+void CosSysConfig::SetIdleSessionTimeoutInms(uint64_t time) {
+    m_idle_session_timeout_in_ms = time;
+}
+
+void CosSysConfig::SetExecutorThreadNum(unsigned num) {
+    m_executor_thread_num = num;
+}
+
+void CosSysConfig::SetMaxRetryTimes(unsigned times) {
+    m_max_retry_times = times;
+}
+
+void CosSysConfig::SetRetryBaseDelayInms(uint64_t time) {
+    m_retry_base_delay_in_ms = time;
+}
+
+void CosSysConfig::SetRetryMaxDelayInms(uint64_t time) {
+    m_retry_max_delay_in_ms = time;
+}
+
+void CosSysConfig::SetHedgeEnable(bool enable) {
+    m_hedge_enable = enable;
+}
+
+void CosSysConfig::SetHedgeDelayPercentile(unsigned percentile) {
+    m_hedge_delay_percentile = percentile;
+}
+
+void CosSysConfig::SetHedgeMinDelayInms(uint64_t time) {
+    m_hedge_min_delay_in_ms = time;
+}
+
+void CosSysConfig::SetExpectContinueThreshold(uint64_t threshold) {
+    m_expect_continue_threshold = threshold;
+}
+
+void CosSysConfig::SetExpectContinueTimeoutInms(uint64_t time) {
+    m_expect_continue_timeout_in_ms = time;
+}
+
+void CosSysConfig::SetListGzipEnable(bool enable) {
+    m_list_gzip_enable = enable;
+}
+
+void CosSysConfig::SetHttpTransport(const std::string& name) {
+    m_http_transport = name;
+}
+
+void CosSysConfig::SetDnsCacheEnable(bool enable) {
+    m_dns_cache_enable = enable;
+}
+
+void CosSysConfig::SetDnsCacheTtlInms(uint64_t time) {
+    m_dns_cache_ttl_in_ms = time;
+}
+
+void CosSysConfig::SetDnsNegativeTtlInms(uint64_t time) {
+    m_dns_negative_ttl_in_ms = time;
+}
+
+void CosSysConfig::SetDnsRotatePolicy(DNS_ROTATE_POLICY policy) {
+    m_dns_rotate_policy = policy;
+}
+
 void CosSysConfig::SetUploadPartSize(uint64_t part_size) {
     m_upload_part_size = part_size;
 }
@@ -129,6 +249,74 @@ int64_t CosSysConfig::GetKeepIntvl() {
     return m_keep_intvl;
 }
 
+unsigned CosSysConfig::GetMaxIdleSessionsPerHost() {
+    return m_max_idle_sessions_per_host;
+}
+
+uint64_t CosSysConfig::GetIdleSessionTimeoutInms() {
+    return m_idle_session_timeout_in_ms;
+}
+
+unsigned CosSysConfig::GetExecutorThreadNum() {
+    return m_executor_thread_num;
+}
+
+unsigned CosSysConfig::GetMaxRetryTimes() {
+    return m_max_retry_times;
+}
+
+uint64_t CosSysConfig::GetRetryBaseDelayInms() {
+    return m_retry_base_delay_in_ms;
+}
+
+uint64_t CosSysConfig::GetRetryMaxDelayInms() {
+    return m_retry_max_delay_in_ms;
+}
+
+bool CosSysConfig::IsHedgeEnable() {
+    return m_hedge_enable;
+}
+
+unsigned CosSysConfig::GetHedgeDelayPercentile() {
+    return m_hedge_delay_percentile;
+}
+
+uint64_t CosSysConfig::GetHedgeMinDelayInms() {
+    return m_hedge_min_delay_in_ms;
+}
+
+uint64_t CosSysConfig::GetExpectContinueThreshold() {
+    return m_expect_continue_threshold;
+}
+
+uint64_t CosSysConfig::GetExpectContinueTimeoutInms() {
+    return m_expect_continue_timeout_in_ms;
+}
+
+bool CosSysConfig::IsListGzipEnable() {
+    return m_list_gzip_enable;
+}
+
+std::string CosSysConfig::GetHttpTransport() {
+    return m_http_transport;
+}
+
+bool CosSysConfig::IsDnsCacheEnable() {
+    return m_dns_cache_enable;
+}
+
+uint64_t CosSysConfig::GetDnsCacheTtlInms() {
+    return m_dns_cache_ttl_in_ms;
+}
+
+uint64_t CosSysConfig::GetDnsNegativeTtlInms() {
+    return m_dns_negative_ttl_in_ms;
+}
+
+DNS_ROTATE_POLICY CosSysConfig::GetDnsRotatePolicy() {
+    return m_dns_rotate_policy;
+}
+
 void CosSysConfig::SetAuthExpiredTime(uint64_t time) {
     m_sign_expire_in_s = time;
 }
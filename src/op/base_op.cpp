@@ -13,8 +13,12 @@
 #include "request/base_req.h"
 #include "response/base_resp.h"
 #include "util/auth_tool.h"
+#include "util/body_source.h"
+#include "util/canonical_request.h"
 #include "util/http_sender.h"
 #include "util/codec_util.h"
+#include "util/hedged_request.h"
+#include "util/retry_policy.h"
 
 namespace qcloud_cos{
 
@@ -34,6 +38,27 @@ std::string BaseOp::GetSecretKey() const {
     return m_config->GetSecretKey();
 }
 
+bool BaseOp::SignRequest(const Credential& credential,
+                         const std::string& method,
+                         const std::string& path,
+                         const std::map<std::string, std::string>& params,
+                         std::map<std::string, std::string>* headers,
+                         CanonicalRequest* canonical_req) {
+    // 同一次签名只使用一份快照, 保证AccessKey/SecretKey/TmpToken相互匹配
+    if (!credential.GetTmpToken().empty()) {
+        (*headers)["x-cos-security-token"] = credential.GetTmpToken();
+    }
+
+    *canonical_req = CanonicalRequest(params, *headers);
+    std::string auth_str = AuthTool::Sign(credential.GetAccessKey(), credential.GetSecretKey(),
+                                          method, path, *canonical_req);
+    if (auth_str.empty()) {
+        return false;
+    }
+    (*headers)["Authorization"] = auth_str;
+    return true;
+}
+
 CosResult BaseOp::NormalAction(const std::string& host,
                                const std::string& path,
                                const BaseReq& req,
@@ -53,17 +78,13 @@ CosResult BaseOp::NormalAction(const std::string& host,
                                const std::map<std::string, std::string>& additional_params,
                                const std::string& req_body,
                                bool check_body,
-                               BaseResp* resp) {
+                               BaseResp* resp,
+                               bool is_decode_gzip) {
     CosResult result;
     std::map<std::string, std::string> req_headers = req.GetHeaders();
     std::map<std::string, std::string> req_params = req.GetParams();
     req_headers.insert(additional_headers.begin(), additional_headers.end());
     req_params.insert(additional_params.begin(), additional_params.end());
-    const std::string& tmp_token = m_config->GetTmpToken();
-    if (!tmp_token.empty()) {
-        req_headers["x-cos-security-token"] = tmp_token;
-    }
-
     // 1. 获取host
     if (!CosSysConfig::IsDomainSameToHost()) {
         req_headers["Host"] = host;
@@ -71,53 +92,79 @@ CosResult BaseOp::NormalAction(const std::string& host,
         req_headers["Host"] = CosSysConfig::GetDestDomain();
     }
 
-    // 2. 计算签名
-    std::string auth_str = AuthTool::Sign(GetAccessKey(), GetSecretKey(),
-                                          req.GetMethod(), req.GetPath(),
-                                          req_headers, req_params);
-    if (auth_str.empty()) {
-        result.SetErrorInfo("Generate auth str fail, check your access_key/secret_key.");
-        return result;
-    }
-    req_headers["Authorization"] = auth_str;
-
-    // 3. 发送请求
-    std::map<std::string, std::string> resp_headers;
-    std::string resp_body;
-
+    // 2. 发送请求, 失败时按重试策略退避后重新发送
     std::string dest_url = GetRealUrl(host, path, req.IsHttps());
-    std::string err_msg = "";
-    int http_code = HttpSender::SendRequest(req.GetMethod(), dest_url, req_params, req_headers,
-                                    req_body, req.GetConnTimeoutInms(), req.GetRecvTimeoutInms(),
-                                    &resp_headers, &resp_body, &err_msg);
-    if (http_code == -1) {
-        result.SetErrorInfo(err_msg);
-        return result;
-    }
+    RetryPolicy retry_policy;
+    for (unsigned attempt = 1; ; ++attempt) {
+        result.Clear();
+        result.SetAttemptNum(attempt);
+
+        // 3. 每次发送前读取新的密钥快照并重新签名, 签名与请求行共用同一次编码的params
+        CanonicalRequest canonical_req;
+        if (!SignRequest(*m_config->GetCredential(), req.GetMethod(), req.GetPath(),
+                         req_params, &req_headers, &canonical_req)) {
+            result.SetErrorInfo("Generate auth str fail, check your access_key/secret_key.");
+            return result;
+        }
 
-    // 4. 解析返回的xml字符串
-    result.SetHttpStatus(http_code);
-    if (http_code > 299 || http_code < 200) {
-        // 无法解析的错误, 填充到cos_result的error_info中
-        if (!result.ParseFromHttpResponse(resp_headers, resp_body)) {
-            result.SetErrorInfo(resp_body);
+        std::map<std::string, std::string> resp_headers;
+        std::string resp_body;
+        std::string err_msg = "";
+        RequestTiming timing;
+        // 开启对冲时, GET/HEAD请求在首字节迟迟未到时会再发出一个相同的请求
+        int http_code = HedgedRequest::SendRequest(req.GetMethod(), dest_url, canonical_req,
+                                                   req_headers, req_body,
+                                                   req.GetConnTimeoutInms(),
+                                                   req.GetRecvTimeoutInms(), &resp_headers,
+                                                   &resp_body, &err_msg, &timing,
+                                                   is_decode_gzip);
+        result.AddTiming(timing);
+        if (http_code == -1) {
+            result.SetErrorInfo(err_msg);
+        } else {
+            // 4. 解析返回的xml字符串
+            result.SetHttpStatus(http_code);
+            if (http_code > 299 || http_code < 200) {
+                // 无法解析的错误, 填充到cos_result的error_info中
+                if (!result.ParseFromHttpResponse(resp_headers, resp_body)) {
+                    result.SetErrorInfo(resp_body);
+                }
+            } else if (check_body && result.ParseFromHttpResponse(resp_headers, resp_body)) {
+                // 某些请求，如PutObjectCopy/Complete请求需要进一步检查Body
+                result.SetErrorInfo(resp_body);
+                return result;
+            } else {
+                result.SetSucc();
+                resp->ParseFromXmlString(resp_body);
+                resp->ParseFromHeaders(resp_headers);
+                resp->SetBody(resp_body);
+                // resp requestid to result
+                result.SetXCosRequestId(resp->GetXCosRequestId());
+                return result;
+            }
         }
-    } else {
-        // 某些请求，如PutObjectCopy/Complete请求需要进一步检查Body
-        if (check_body && result.ParseFromHttpResponse(resp_headers, resp_body)) {
-            result.SetErrorInfo(resp_body);
+
+        RetryableError error = RetryPolicy::Classify(http_code, result.GetErrorCode(), err_msg);
+        if (!retry_policy.WaitForRetry(req.GetMethod(), error, attempt)) {
             return result;
         }
-
-        result.SetSucc();
-        resp->ParseFromXmlString(resp_body);
-        resp->ParseFromHeaders(resp_headers);
-        resp->SetBody(resp_body);
-        // resp requestid to result
-        result.SetXCosRequestId(resp->GetXCosRequestId());
     }
+}
 
-    return result;
+CosResult BaseOp::ListAction(const std::string& host,
+                             const std::string& path,
+                             const BaseReq& req,
+                             BaseResp* resp) {
+    std::map<std::string, std::string> additional_headers;
+    std::map<std::string, std::string> additional_params;
+    // 列举结果为重复度很高的xml, 压缩后通常只有原大小的十分之一左右
+    // 只有此处主动声明接受gzip时才解压, 用户自行设置的Accept-Encoding不触发解压
+    bool is_decode_gzip = CosSysConfig::IsListGzipEnable();
+    if (is_decode_gzip) {
+        additional_headers["Accept-Encoding"] = "gzip";
+    }
+    return NormalAction(host, path, req, additional_headers, additional_params,
+                        "", false, resp, is_decode_gzip);
 }
 
 CosResult BaseOp::DownloadAction(const std::string& host,
@@ -128,11 +175,6 @@ CosResult BaseOp::DownloadAction(const std::string& host,
     CosResult result;
     std::map<std::string, std::string> req_headers = req.GetHeaders();
     std::map<std::string, std::string> req_params = req.GetParams();
-    const std::string& tmp_token = m_config->GetTmpToken();
-    if (!tmp_token.empty()) {
-        req_headers["x-cos-security-token"] = tmp_token;
-    }
-
     // 1. 获取host
     if (!CosSysConfig::IsDomainSameToHost()) {
         req_headers["Host"] = host;
@@ -140,56 +182,81 @@ CosResult BaseOp::DownloadAction(const std::string& host,
         req_headers["Host"] = CosSysConfig::GetDestDomain();
     }
 
-    // 2. 计算签名
-    std::string auth_str = AuthTool::Sign(GetAccessKey(), GetSecretKey(),
-                                          req.GetMethod(), req.GetPath(),
-                                          req_headers, req_params);
-    if (auth_str.empty()) {
-        result.SetErrorInfo("Generate auth str fail, check your access_key/secret_key.");
-        return result;
-    }
-    req_headers["Authorization"] = auth_str;
-
-    // 3. 发送请求
-    std::map<std::string, std::string> resp_headers;
-    std::string xml_err_str; // 发送失败返回的xml写入该字符串，避免直接输出到流中
-
+    // 2. 发送请求, 失败时按重试策略退避后重新发送
+    //    重试前输出流需回到起始位置; 不可定位的流只在错误响应时重试, 此时响应体未写入流
     std::string dest_url = GetRealUrl(host, path, req.IsHttps());
-    std::string err_msg = "";
-    uint64_t real_byte;
-    int http_code = HttpSender::SendRequest(req.GetMethod(), dest_url, req_params, req_headers,
-                                            "", req.GetConnTimeoutInms(), req.GetRecvTimeoutInms(),
-                                            &resp_headers, &xml_err_str, os, &err_msg,
-                                            &real_byte, req.CheckMD5());
-    if (http_code == -1) {
-        result.SetErrorInfo(err_msg);
-        return result;
-    }
+    std::streampos os_start_pos = os.tellp();
+    RetryPolicy retry_policy;
+    for (unsigned attempt = 1; ; ++attempt) {
+        result.Clear();
+        result.SetAttemptNum(attempt);
+
+        // 3. 每次发送前读取新的密钥快照并重新签名, 签名与请求行共用同一次编码的params
+        CanonicalRequest canonical_req;
+        if (!SignRequest(*m_config->GetCredential(), req.GetMethod(), req.GetPath(),
+                         req_params, &req_headers, &canonical_req)) {
+            result.SetErrorInfo("Generate auth str fail, check your access_key/secret_key.");
+            return result;
+        }
 
-    result.SetRealByte(real_byte);
-    // 4. 解析返回的xml字符串
-    result.SetHttpStatus(http_code);
-    if (http_code > 299 || http_code < 200) {
-        // 无法解析的错误, 填充到cos_result的error_info中
-        if (!result.ParseFromHttpResponse(resp_headers, xml_err_str)) {
-            result.SetErrorInfo(xml_err_str);
+        std::map<std::string, std::string> resp_headers;
+        std::string xml_err_str; // 发送失败返回的xml写入该字符串，避免直接输出到流中
+        std::string err_msg = "";
+        uint64_t real_byte = 0;
+        RequestTiming timing;
+        int http_code = HedgedRequest::SendRequest(req.GetMethod(), dest_url, canonical_req,
+                                                   req_headers, "", req.GetConnTimeoutInms(),
+                                                   req.GetRecvTimeoutInms(), &resp_headers,
+                                                   &xml_err_str, os, &err_msg, &real_byte,
+                                                   req.CheckMD5(), &timing);
+        result.AddTiming(timing);
+        result.SetRealByte(real_byte);
+        RetryableError error = kNotRetryable;
+        if (http_code == -1) {
+            result.SetErrorInfo(err_msg);
+            error = RetryPolicy::Classify(http_code, "", err_msg);
+        } else {
+            // 4. 解析返回的xml字符串
+            result.SetHttpStatus(http_code);
+            if (http_code > 299 || http_code < 200) {
+                // 无法解析的错误, 填充到cos_result的error_info中
+                if (!result.ParseFromHttpResponse(resp_headers, xml_err_str)) {
+                    result.SetErrorInfo(xml_err_str);
+                }
+                error = RetryPolicy::Classify(http_code, result.GetErrorCode(), err_msg);
+            } else {
+                result.SetSucc();
+                resp->ParseFromHeaders(resp_headers);
+                // resp requestid to result
+                result.SetXCosRequestId(resp->GetXCosRequestId());
+
+                // Check the resp content length header, when return 200, but size not match case.
+                if (resp->GetContentLength() != real_byte) {
+                    result.SetFail();
+                    result.SetErrorInfo("Download failed with incomplete file");
+                    SDK_LOG_ERR("Response content length [%ld] is not same to real recv byte [%ld]",
+                                resp->GetContentLength(), real_byte);
+                    // 连接中途断开导致的数据不完整
+                    error = kRetryNetworkError;
+                }
+            }
         }
-    } else {
-        result.SetSucc();
-        resp->ParseFromHeaders(resp_headers);
-        // resp requestid to result
-        result.SetXCosRequestId(resp->GetXCosRequestId());
-    }
 
-    // Check the resp content length header, when return 200, but size not match case.
-    if (result.IsSucc() && resp->GetContentLength() != real_byte) {
-        result.SetFail();
-        result.SetErrorInfo("Download failed with incomplete file");
-        SDK_LOG_ERR("Response content length [%ld] is not same to real recv byte [%ld]",
-                    resp->GetContentLength(), real_byte);
+        if (result.IsSucc() || !retry_policy.ShouldRetry(req.GetMethod(), error, attempt)) {
+            return result;
+        }
+        if (os_start_pos == std::streampos(-1)) {
+            if (http_code < 300) {
+                return result;
+            }
+        } else {
+            os.clear();
+            if (os.seekp(os_start_pos).fail()) {
+                return result;
+            }
+        }
+        retry_policy.Backoff(error, attempt);
     }
-
-    return result;
 }
 
 // TODO(sevenyou) 冗余代码
@@ -200,16 +267,22 @@ CosResult BaseOp::UploadAction(const std::string& host,
                                const std::map<std::string, std::string>& additional_params,
                                std::istream& is,
                                BaseResp* resp) {
+    StreamBodySource body(is);
+    return UploadAction(host, path, req, additional_headers, additional_params, body, resp);
+}
+
+CosResult BaseOp::UploadAction(const std::string& host,
+                               const std::string& path,
+                               const BaseReq& req,
+                               const std::map<std::string, std::string>& additional_headers,
+                               const std::map<std::string, std::string>& additional_params,
+                               BodySource& body,
+                               BaseResp* resp) {
     CosResult result;
     std::map<std::string, std::string> req_headers = req.GetHeaders();
     std::map<std::string, std::string> req_params = req.GetParams();
     req_headers.insert(additional_headers.begin(), additional_headers.end());
     req_params.insert(additional_params.begin(), additional_params.end());
-    const std::string& tmp_token = m_config->GetTmpToken();
-    if (!tmp_token.empty()) {
-        req_headers["x-cos-security-token"] = tmp_token;
-    }
-
     // 1. 获取host
     if (!CosSysConfig::IsDomainSameToHost()) {
         req_headers["Host"] = host;
@@ -217,47 +290,57 @@ CosResult BaseOp::UploadAction(const std::string& host,
         req_headers["Host"] = CosSysConfig::GetDestDomain();
     }
 
-    // 2. 计算签名
-    std::string auth_str = AuthTool::Sign(GetAccessKey(), GetSecretKey(),
-                                          req.GetMethod(), req.GetPath(),
-                                          req_headers, req_params);
-    if (auth_str.empty()) {
-        result.SetErrorInfo("Generate auth str fail, check your access_key/secret_key.");
-        return result;
-    }
-    req_headers["Authorization"] = auth_str;
-
-    // 3. 发送请求
-    std::map<std::string, std::string> resp_headers;
-    std::string resp_body;
-
+    // 2. 发送请求, 失败时按重试策略退避后从请求体起始位置重新发送
     std::string dest_url = GetRealUrl(host, path, req.IsHttps());
-    std::string err_msg = "";
-    int http_code = HttpSender::SendRequest(req.GetMethod(), dest_url, req_params, req_headers,
-                                            is, req.GetConnTimeoutInms(), req.GetRecvTimeoutInms(),
-                                            &resp_headers, &resp_body, &err_msg);
-    if (http_code == -1) {
-        result.SetErrorInfo(err_msg);
-        return result;
-    }
+    RetryPolicy retry_policy;
+    for (unsigned attempt = 1; ; ++attempt) {
+        result.Clear();
+        result.SetAttemptNum(attempt);
+
+        // 3. 每次发送前读取新的密钥快照并重新签名, 签名与请求行共用同一次编码的params
+        CanonicalRequest canonical_req;
+        if (!SignRequest(*m_config->GetCredential(), req.GetMethod(), req.GetPath(),
+                         req_params, &req_headers, &canonical_req)) {
+            result.SetErrorInfo("Generate auth str fail, check your access_key/secret_key.");
+            return result;
+        }
 
-    // 4. 解析返回的xml字符串
-    result.SetHttpStatus(http_code);
-    if (http_code > 299 || http_code < 200) {
-        // 无法解析的错误, 填充到cos_result的error_info中
-        if (!result.ParseFromHttpResponse(resp_headers, resp_body)) {
-            result.SetErrorInfo(resp_body);
+        std::map<std::string, std::string> resp_headers;
+        std::string resp_body;
+        std::string err_msg = "";
+        RequestContext ctx;
+        int http_code = HttpSender::SendRequest(req.GetMethod(), dest_url, canonical_req,
+                                                req_headers, body, req.GetConnTimeoutInms(),
+                                                req.GetRecvTimeoutInms(), &resp_headers,
+                                                &resp_body, &err_msg, false, &ctx);
+        result.AddTiming(ctx.GetTiming());
+        if (http_code == -1) {
+            result.SetErrorInfo(err_msg);
+        } else {
+            // 4. 解析返回的xml字符串
+            result.SetHttpStatus(http_code);
+            if (http_code > 299 || http_code < 200) {
+                // 无法解析的错误, 填充到cos_result的error_info中
+                if (!result.ParseFromHttpResponse(resp_headers, resp_body)) {
+                    result.SetErrorInfo(resp_body);
+                }
+            } else {
+                result.SetSucc();
+                resp->ParseFromXmlString(resp_body);
+                resp->ParseFromHeaders(resp_headers);
+                resp->SetBody(resp_body);
+                // resp requestid to result
+                result.SetXCosRequestId(resp->GetXCosRequestId());
+                return result;
+            }
         }
-    } else {
-        result.SetSucc();
-        resp->ParseFromXmlString(resp_body);
-        resp->ParseFromHeaders(resp_headers);
-        resp->SetBody(resp_body);
-        // resp requestid to result
-        result.SetXCosRequestId(resp->GetXCosRequestId());
-    }
 
-    return result;
+        RetryableError error = RetryPolicy::Classify(http_code, result.GetErrorCode(), err_msg);
+        if (!retry_policy.ShouldRetry(req.GetMethod(), error, attempt) || !body.Rewind()) {
+            return result;
+        }
+        retry_policy.Backoff(error, attempt);
+    }
 }
 
 // 如果设置了目的url, 那么就用设置的, 否则使用appid和bucket拼接的泛域名
@@ -53,14 +53,14 @@ CosResult BucketOp::GetBucket(const GetBucketReq& req, GetBucketResp* resp) {
     std::string host = CosSysConfig::GetHost(GetAppId(), m_config->GetRegion(),
                                              req.GetBucketName());
     std::string path = req.GetPath();
-    return NormalAction(host, path, req, "", false, resp);
+    return ListAction(host, path, req, resp);
 }
 
 CosResult BucketOp::ListMultipartUpload(const ListMultipartUploadReq& req, ListMultipartUploadResp* resp) {
     std::string host = CosSysConfig::GetHost(GetAppId(), m_config->GetRegion(),
                                              req.GetBucketName());
     std::string path = req.GetPath();
-    return NormalAction(host, path, req, "", false, resp);
+    return ListAction(host, path, req, resp);
 }
 
 CosResult BucketOp::DeleteBucket(const DeleteBucketReq& req, DeleteBucketResp* resp) {
@@ -264,7 +264,7 @@ CosResult BucketOp::GetBucketObjectVersions(const GetBucketObjectVersionsReq& re
     std::string host = CosSysConfig::GetHost(GetAppId(), m_config->GetRegion(),
                                              req.GetBucketName());
     std::string path = req.GetPath();
-    return NormalAction(host, path, req, "", false, resp);
+    return ListAction(host, path, req, resp);
 }
 
 CosResult BucketOp::PutBucketLogging(const PutBucketLoggingReq& req, 
@@ -0,0 +1,142 @@
+#include "op/download_checkpoint.h"
+
+#include <stdio.h>
+
+#include <fstream>
+
+#include "cos_defines.h"
+#include "cos_sys_config.h"
+#include "util/string_util.h"
+
+namespace qcloud_cos {
+
+DownloadCheckpoint::DownloadCheckpoint(const std::string& checkpoint_file)
+    : m_checkpoint_file(checkpoint_file), m_file_size(0), m_slice_size(0) {
+    pthread_mutex_init(&m_mutex, NULL);
+}
+
+DownloadCheckpoint::~DownloadCheckpoint() {
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool DownloadCheckpoint::Load() {
+    std::ifstream ifs(m_checkpoint_file.c_str(), std::ios::in);
+    if (!ifs.is_open()) {
+        return false;
+    }
+
+    m_etag.clear();
+    m_file_size = 0;
+    m_slice_size = 0;
+    m_slice_bitmap.clear();
+
+    std::vector<uint64_t> slices;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        size_t pos = line.find('=');
+        if (pos == std::string::npos) {
+            // 进程中断时最后一行可能不完整, 忽略
+            continue;
+        }
+
+        std::string key = line.substr(0, pos);
+        std::string value = line.substr(pos + 1);
+        if (key == "etag") {
+            m_etag = value;
+        } else if (key == "file_size") {
+            m_file_size = StringUtil::StringToUint64(value);
+        } else if (key == "slice_size") {
+            m_slice_size = StringUtil::StringToUint64(value);
+        } else if (key == "slice" && !value.empty()) {
+            slices.push_back(StringUtil::StringToUint64(value));
+        }
+    }
+
+    if (m_etag.empty() || m_slice_size == 0) {
+        SDK_LOG_WARN("Invalid download checkpoint file %s", m_checkpoint_file.c_str());
+        return false;
+    }
+
+    m_slice_bitmap.assign((m_file_size + m_slice_size - 1) / m_slice_size, false);
+    for (std::vector<uint64_t>::const_iterator itr = slices.begin(); itr != slices.end(); ++itr) {
+        if (*itr < m_slice_bitmap.size()) {
+            m_slice_bitmap[*itr] = true;
+        }
+    }
+    return true;
+}
+
+bool DownloadCheckpoint::Create(const std::string& etag, uint64_t file_size,
+                                uint64_t slice_size) {
+    m_etag = etag;
+    m_file_size = file_size;
+    m_slice_size = slice_size;
+    m_slice_bitmap.assign((file_size + slice_size - 1) / slice_size, false);
+
+    // 先写临时文件再rename, 避免中断后留下只有部分首部的断点文件
+    std::string tmp_file = m_checkpoint_file + ".tmp";
+    {
+        std::ofstream ofs(tmp_file.c_str(), std::ios::out | std::ios::trunc);
+        if (!ofs.is_open()) {
+            SDK_LOG_ERR("Create download checkpoint file %s fail", tmp_file.c_str());
+            return false;
+        }
+        ofs << "etag=" << m_etag << "\n"
+            << "file_size=" << m_file_size << "\n"
+            << "slice_size=" << m_slice_size << "\n";
+        ofs.flush();
+        if (!ofs.good()) {
+            SDK_LOG_ERR("Write download checkpoint file %s fail", tmp_file.c_str());
+            return false;
+        }
+    }
+
+    if (rename(tmp_file.c_str(), m_checkpoint_file.c_str()) != 0) {
+        SDK_LOG_ERR("Rename download checkpoint file %s fail", m_checkpoint_file.c_str());
+        remove(tmp_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool DownloadCheckpoint::AppendSlice(uint64_t slice_index) {
+    pthread_mutex_lock(&m_mutex);
+    if (slice_index < m_slice_bitmap.size()) {
+        m_slice_bitmap[slice_index] = true;
+    }
+    std::ofstream ofs(m_checkpoint_file.c_str(), std::ios::out | std::ios::app);
+    bool ret = false;
+    if (ofs.is_open()) {
+        ofs << "slice=" << slice_index << "\n";
+        ofs.flush();
+        ret = ofs.good();
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    if (!ret) {
+        SDK_LOG_WARN("Append slice %lu to download checkpoint file %s fail",
+                     slice_index, m_checkpoint_file.c_str());
+    }
+    return ret;
+}
+
+bool DownloadCheckpoint::IsMatch(const std::string& etag, uint64_t file_size,
+                                 uint64_t slice_size) const {
+    return m_etag == etag && m_file_size == file_size && m_slice_size == slice_size;
+}
+
+uint64_t DownloadCheckpoint::GetFinishedSliceNum() const {
+    uint64_t num = 0;
+    for (size_t i = 0; i < m_slice_bitmap.size(); ++i) {
+        if (m_slice_bitmap[i]) {
+            ++num;
+        }
+    }
+    return num;
+}
+
+void DownloadCheckpoint::Remove() {
+    remove(m_checkpoint_file.c_str());
+}
+
+} // namespace qcloud_cos
@@ -8,6 +8,8 @@
 #include "op/object_op.h"
 #include "request/object_req.h"
 #include "response/object_resp.h"
+#include "util/canonical_request.h"
+#include "util/retry_policy.h"
 
 namespace qcloud_cos{
 
@@ -15,7 +17,8 @@ FileCopyTask::FileCopyTask(const std::string& full_url,
                            uint64_t conn_timeout_in_ms,
                            uint64_t recv_timeout_in_ms)
     : m_full_url(full_url), m_conn_timeout_in_ms(conn_timeout_in_ms),
-      m_recv_timeout_in_ms(recv_timeout_in_ms), m_is_task_success(false), m_etag("") {
+      m_recv_timeout_in_ms(recv_timeout_in_ms), m_is_task_success(false),
+      m_http_status(0), m_etag(""), m_attempt_num(0) {
 }
 
 bool FileCopyTask::IsTaskSuccess() const {
@@ -43,40 +46,66 @@ void FileCopyTask::SetHeaders(const std::map<std::string, std::string>& headers)
     m_headers.clear();
     m_headers.insert(headers.begin(), headers.end());
 }
+
+void FileCopyTask::SetSignInfo(const Poco::SharedPtr<CosConfig>& config,
+                               const std::string& path) {
+    m_config = config;
+    m_path = path;
+}
+
 void FileCopyTask::Run() {
     m_is_task_success = false;
+    m_timing = RequestTiming();
     CopyTask();
+    m_total_timing.Add(m_timing);
 }
 
 void FileCopyTask::CopyTask() {
-    int loop = 0;
-    do {
-        loop++;
+    RetryPolicy retry_policy;
+    for (m_attempt_num = 1; ; ++m_attempt_num) {
         m_resp_headers.clear();
         m_resp = "";
+        m_err_msg = "";
+
+        // 每次发送前读取新的密钥快照并重新签名, 后台刷新的密钥在重试时即可生效
+        CanonicalRequest canonical_req;
+        if (!BaseOp::SignRequest(*m_config->GetCredential(), "PUT", m_path, m_params, &m_headers,
+                                 &canonical_req)) {
+            m_err_msg = "Generate auth str fail, check your access_key/secret_key.";
+            SDK_LOG_ERR("FileCopy: %s", m_err_msg.c_str());
+            m_http_status = -1;
+            return;
+        }
 
-        m_http_status = HttpSender::SendRequest("PUT", m_full_url, m_params, m_headers,
+        RequestContext ctx;
+        m_http_status = HttpSender::SendRequest("PUT", m_full_url, canonical_req, m_headers,
                                         "", m_conn_timeout_in_ms, m_recv_timeout_in_ms,
-                                        &m_resp_headers, &m_resp, &m_err_msg);
+                                        &m_resp_headers, &m_resp, &m_err_msg, false, &ctx);
+        m_timing.Add(ctx.GetTiming());
 
+        RetryableError error = kNotRetryable;
         if (m_http_status != 200) {
             SDK_LOG_ERR("FileUpload: url(%s) fail, httpcode:%d, resp: %s",
                         m_full_url.c_str(), m_http_status, m_resp.c_str());
-            m_is_task_success = false;
-            continue;
-        }
-
-        UploadPartCopyDataResp resp;
-        if (!resp.ParseFromXmlString(m_resp)) {
+            error = RetryPolicy::ClassifyResponse(m_http_status, m_resp, m_err_msg);
+        } else {
+            UploadPartCopyDataResp resp;
+            if (resp.ParseFromXmlString(m_resp)) {
+                m_etag = resp.GetEtag();
+                m_last_modified = resp.GetLastModified();
+                m_is_task_success = true;
+                return;
+            }
+            // 拷贝过程中出错时服务端也会返回200, 错误信息在响应体中
             SDK_LOG_ERR("FileUpload response string is illegal. try again.")
-            m_is_task_success = false;
-            continue;
+            error = kRetryServerError;
         }
 
-        m_etag = resp.GetEtag();
-        m_last_modified = resp.GetLastModified();
-        m_is_task_success = true;
-    } while (!m_is_task_success && loop <= kMaxRetryTimes);
+        m_is_task_success = false;
+        if (!retry_policy.WaitForRetry("PUT", error, m_attempt_num)) {
+            return;
+        }
+    }
 }
 
 }
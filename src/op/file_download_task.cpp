@@ -1,39 +1,123 @@
 #include "op/file_download_task.h"
 
+#include <errno.h>
 #include <stdint.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <map>
+#include <streambuf>
+#include <vector>
+
+#include "util/canonical_request.h"
+#include "util/retry_policy.h"
 
 namespace qcloud_cos{
 
+// 以pwrite将数据写入文件指定位置的streambuf, 各下载线程互不干扰, 无需lseek
+// 写入超过max_len的数据将被丢弃
+class PwriteStreamBuf : public std::streambuf {
+public:
+    PwriteStreamBuf(int fd, uint64_t offset, uint64_t max_len)
+        : m_fd(fd), m_offset(offset), m_max_len(max_len), m_written(0),
+          m_errno(0), m_buf(kBufSize) {
+        setp(&m_buf[0], &m_buf[0] + m_buf.size());
+    }
+
+    virtual ~PwriteStreamBuf() {}
+
+    uint64_t GetWrittenLen() const { return m_written; }
+
+    int GetErrno() const { return m_errno; }
+
+protected:
+    virtual int_type overflow(int_type c) {
+        if (!FlushBuf()) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    virtual int sync() {
+        return FlushBuf() ? 0 : -1;
+    }
+
+private:
+    bool FlushBuf() {
+        size_t len = pptr() - pbase();
+        if (m_written + len > m_max_len) {
+            len = m_max_len - m_written;
+        }
+
+        const char* data = pbase();
+        while (len > 0) {
+            ssize_t n = pwrite(m_fd, data, len, m_offset + m_written);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                m_errno = errno;
+                return false;
+            }
+            data += n;
+            len -= n;
+            m_written += n;
+        }
+        setp(&m_buf[0], &m_buf[0] + m_buf.size());
+        return true;
+    }
+
+private:
+    static const size_t kBufSize = 64 * 1024;
+
+    int m_fd;
+    uint64_t m_offset;
+    uint64_t m_max_len;
+    uint64_t m_written;
+    int m_errno;
+    std::vector<char> m_buf;
+};
+
 FileDownTask::FileDownTask(const std::string& full_url,
                            const std::map<std::string, std::string>& headers,
                            const std::map<std::string, std::string>& params,
                            uint64_t conn_timeout_in_ms,
                            uint64_t recv_timeout_in_ms,
+                           int fd,
                            uint64_t offset,
-                           unsigned char* pbuf,
                            const size_t data_len)
     : m_full_url(full_url), m_headers(headers), m_params(params),
       m_conn_timeout_in_ms(conn_timeout_in_ms),
       m_recv_timeout_in_ms(recv_timeout_in_ms),
-      m_offset(offset), m_data_buf_ptr(pbuf),
-      m_data_len(data_len), m_resp(""), m_is_task_success(false), m_real_down_len(0) {
+      m_fd(fd), m_offset(offset),
+      m_data_len(data_len), m_resp(""), m_is_task_success(false), m_real_down_len(0),
+      m_http_status(0), m_attempt_num(0) {
 }
 
 void FileDownTask::Run() {
     m_resp = "";
     m_is_task_success = false;
+    m_timing = RequestTiming();
     DownTask();
+    m_total_timing.Add(m_timing);
 }
 
-void FileDownTask::SetDownParams(unsigned char* pbuf, size_t data_len, uint64_t offset) {
-    m_data_buf_ptr = pbuf;
+void FileDownTask::SetDownParams(int fd, size_t data_len, uint64_t offset) {
+    m_fd = fd;
     m_data_len  = data_len;
     m_offset = offset;
 }
 
+void FileDownTask::SetSignInfo(const Poco::SharedPtr<CosConfig>& config,
+                               const std::string& path) {
+    m_config = config;
+    m_path = path;
+}
+
 size_t FileDownTask::GetDownLoadLen() {
     return m_real_down_len;
 }
@@ -63,26 +147,118 @@ void FileDownTask::DownTask() {
     // 增加Range头域，避免大文件时将整个文件下载
     m_headers["Range"] = range_head;
 
-    m_http_status = HttpSender::SendRequest("GET", m_full_url, m_params, m_headers,
-                                            "", m_conn_timeout_in_ms, m_recv_timeout_in_ms,
-                                            &m_resp_headers, &m_resp, &m_err_msg);
-
-    //当实际长度小于请求的数据长度时httpcode为206
-    if (m_http_status != 200 && m_http_status != 206) {
-        SDK_LOG_ERR("FileDownload: url(%s) fail, httpcode:%d, resp: %s",
-                    m_full_url.c_str(), m_http_status, m_resp.c_str());
-        m_is_task_success = false;
+    // 每次尝试都从分片起始位置覆盖写入, 重试不会产生重复数据
+    RetryPolicy retry_policy;
+    for (m_attempt_num = 1; ; ++m_attempt_num) {
+        m_resp_headers.clear();
+        m_resp = "";
+        m_err_msg = "";
         m_real_down_len = 0;
-        return;
+        m_is_task_success = false;
+
+        // 每次发送前读取新的密钥快照并重新签名, 后台刷新的密钥在重试时即可生效
+        CanonicalRequest canonical_req;
+        if (!BaseOp::SignRequest(*m_config->GetCredential(), "GET", m_path, m_params, &m_headers,
+                                 &canonical_req)) {
+            m_err_msg = "Generate auth str fail, check your access_key/secret_key.";
+            SDK_LOG_ERR("FileDownload: %s", m_err_msg.c_str());
+            m_http_status = -1;
+            return;
+        }
+
+        // 响应体直接从socket写入文件对应位置, 不经过内存缓冲
+        PwriteStreamBuf pwrite_buf(m_fd, m_offset, m_data_len);
+        std::ostream pwrite_stream(&pwrite_buf);
+        uint64_t real_byte = 0;
+        RequestContext ctx;
+        m_http_status = HttpSender::SendRequest("GET", m_full_url, canonical_req, m_headers,
+                                                "", m_conn_timeout_in_ms, m_recv_timeout_in_ms,
+                                                &m_resp_headers, &m_resp, pwrite_stream,
+                                                &m_err_msg, &real_byte, false, &ctx);
+        pwrite_stream.flush();
+        m_timing.Add(ctx.GetTiming());
+
+        if (pwrite_buf.GetErrno() != 0) {
+            // 本地写文件失败, 重试无益
+            m_err_msg = "pwrite file fail, errno=" + StringUtil::IntToString(pwrite_buf.GetErrno())
+                + ", offset=" + StringUtil::Uint64ToString(m_offset);
+            SDK_LOG_ERR("FileDownload: %s", m_err_msg.c_str());
+            m_http_status = -1;
+            return;
+        }
+
+        RetryableError error = kNotRetryable;
+        //当实际长度小于请求的数据长度时httpcode为206
+        if (m_http_status != 200 && m_http_status != 206) {
+            SDK_LOG_ERR("FileDownload: url(%s) fail, httpcode:%d, resp: %s",
+                        m_full_url.c_str(), m_http_status, m_resp.c_str());
+            error = RetryPolicy::ClassifyResponse(m_http_status, m_resp, m_err_msg);
+        } else {
+            m_real_down_len = pwrite_buf.GetWrittenLen();
+            if (m_real_down_len == m_data_len) {
+                m_is_task_success = true;
+                return;
+            }
+            // 连接中途断开导致数据不完整
+            m_err_msg = "download length not match, expect=" + StringUtil::Uint64ToString(m_data_len)
+                + ", real=" + StringUtil::Uint64ToString(m_real_down_len);
+            SDK_LOG_ERR("FileDownload: url(%s) %s", m_full_url.c_str(), m_err_msg.c_str());
+            m_http_status = -1;
+            error = kRetryNetworkError;
+        }
+
+        if (!retry_policy.WaitForRetry("GET", error, m_attempt_num)) {
+            return;
+        }
     }
+}
 
-    size_t buf_max_size = m_data_len;
-    size_t len = MIN(m_resp.length(), buf_max_size);
-    memcpy(m_data_buf_ptr, m_resp.c_str(), len);
-    m_real_down_len = len;
-    m_is_task_success = true;
-    m_resp = "";
-    return;
+FileDownPipeline::FileDownPipeline(uint64_t file_size, uint64_t slice_size,
+                                   const std::vector<bool>& finished_slices)
+    : m_file_size(file_size), m_slice_size(slice_size), m_next_offset(0),
+      m_finished_slices(finished_slices), m_failed_task(NULL) {
+    pthread_mutex_init(&m_mutex, NULL);
+}
+
+FileDownPipeline::~FileDownPipeline() {
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool FileDownPipeline::NextSlice(uint64_t* offset, size_t* len) {
+    bool has_slice = false;
+    pthread_mutex_lock(&m_mutex);
+    // 跳过断点续传时已完成的分片
+    while (m_next_offset < m_file_size) {
+        uint64_t slice_index = m_next_offset / m_slice_size;
+        if (slice_index >= m_finished_slices.size() || !m_finished_slices[slice_index]) {
+            break;
+        }
+        m_next_offset += MIN(m_slice_size, m_file_size - m_next_offset);
+    }
+
+    if (m_failed_task == NULL && m_next_offset < m_file_size) {
+        *offset = m_next_offset;
+        *len = MIN(m_slice_size, m_file_size - m_next_offset);
+        m_next_offset += *len;
+        has_slice = true;
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return has_slice;
+}
+
+void FileDownPipeline::Abort(FileDownTask* failed_task) {
+    pthread_mutex_lock(&m_mutex);
+    if (m_failed_task == NULL) {
+        m_failed_task = failed_task;
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+FileDownTask* FileDownPipeline::GetFailedTask() {
+    pthread_mutex_lock(&m_mutex);
+    FileDownTask* failed_task = m_failed_task;
+    pthread_mutex_unlock(&m_mutex);
+    return failed_task;
 }
 
 } // namespace qcloud_cos
@@ -7,9 +7,10 @@
 #include <sstream>
 
 #include "Poco/MD5Engine.h"
-#include "Poco/DigestStream.h"
-#include "Poco/StreamCopier.h"
 
+#include "util/body_source.h"
+#include "util/canonical_request.h"
+#include "util/retry_policy.h"
 #include "util/string_util.h"
 
 namespace qcloud_cos{
@@ -21,7 +22,7 @@ FileUploadTask::FileUploadTask(const std::string& full_url,
                                const size_t data_len)
     : m_full_url(full_url), m_data_buf_ptr(pbuf), m_data_len(data_len),
       m_conn_timeout_in_ms(conn_timeout_in_ms), m_recv_timeout_in_ms(recv_timeout_in_ms),
-      m_resp(""), m_is_task_success(false) {
+      m_resp(""), m_is_task_success(false), m_http_status(0), m_attempt_num(0) {
 }
 
 FileUploadTask::FileUploadTask(const std::string& full_url,
@@ -33,13 +34,16 @@ FileUploadTask::FileUploadTask(const std::string& full_url,
                                const size_t data_len)
     : m_full_url(full_url), m_base_headers(headers), m_base_params(params),
       m_conn_timeout_in_ms(conn_timeout_in_ms), m_recv_timeout_in_ms(recv_timeout_in_ms),
-      m_data_buf_ptr(pbuf), m_data_len(data_len), m_resp(""), m_is_task_success(false) {
+      m_data_buf_ptr(pbuf), m_data_len(data_len), m_resp(""), m_is_task_success(false),
+      m_http_status(0), m_attempt_num(0) {
 }
 
 void FileUploadTask::Run() {
     m_resp = "";
     m_is_task_success = false;
+    m_timing = RequestTiming();
     UploadTask();
+    m_total_timing.Add(m_timing);
 }
 
 void FileUploadTask::SetUploadBuf(unsigned char* pbuf, size_t data_len) {
@@ -77,46 +81,170 @@ void FileUploadTask::SetHeaders(const std::map<std::string, std::string>& header
     }
 }
 
-void FileUploadTask::UploadTask() {
-    int loop = 0;
+void FileUploadTask::SetSignInfo(const Poco::SharedPtr<CosConfig>& config,
+                                 const std::string& path) {
+    m_config = config;
+    m_path = path;
+}
 
-    std::string body((const char *)m_data_buf_ptr, m_data_len);
-    // 计算上传的md5
+void FileUploadTask::UploadTask() {
+    // 计算上传的md5, 直接基于分块缓冲区计算, 不做拷贝
     Poco::MD5Engine md5;
-    std::istringstream istr(body);
-    Poco::DigestOutputStream dos(md5);
-    Poco::StreamCopier::copyStream(istr, dos);
-    dos.close();
+    md5.update(m_data_buf_ptr, m_data_len);
     const std::string& md5_str = Poco::DigestEngine::digestToHex(md5.digest());
 
-    do {
-        loop++;
+    RetryPolicy retry_policy;
+    for (m_attempt_num = 1; ; ++m_attempt_num) {
         m_resp_headers.clear();
         m_resp = "";
-        
-        m_http_status = HttpSender::SendRequest("PUT", m_full_url, m_final_params, m_final_headers,
+        m_err_msg = "";
+
+        // 每次发送前读取新的密钥快照并重新签名, 后台刷新的密钥在重试时即可生效
+        CanonicalRequest canonical_req;
+        if (!BaseOp::SignRequest(*m_config->GetCredential(), "PUT", m_path, m_final_params, &m_final_headers,
+                                 &canonical_req)) {
+            m_err_msg = "Generate auth str fail, check your access_key/secret_key.";
+            SDK_LOG_ERR("FileUpload: %s", m_err_msg.c_str());
+            m_http_status = -1;
+            return;
+        }
+
+        BufferBodySource body(reinterpret_cast<const char*>(m_data_buf_ptr), m_data_len);
+        RequestContext ctx;
+        m_http_status = HttpSender::SendRequest("PUT", m_full_url, canonical_req, m_final_headers,
                                         body, m_conn_timeout_in_ms, m_recv_timeout_in_ms,
-                                        &m_resp_headers, &m_resp, &m_err_msg);
+                                        &m_resp_headers, &m_resp, &m_err_msg, false, &ctx);
+        m_timing.Add(ctx.GetTiming());
 
+        RetryableError error = kNotRetryable;
         if (m_http_status != 200) {
             SDK_LOG_ERR("FileUpload: url(%s) fail, httpcode:%d, resp: %s",
                         m_full_url.c_str(), m_http_status, m_resp.c_str());
-            m_is_task_success = false;
-            continue;
+            error = RetryPolicy::ClassifyResponse(m_http_status, m_resp, m_err_msg);
+        } else {
+            std::string etag;
+            std::map<std::string, std::string>::const_iterator c_itr = m_resp_headers.find("ETag");
+            if (c_itr != m_resp_headers.end()) {
+                etag = StringUtil::Trim(c_itr->second, "\"");
+            }
+            if (etag == md5_str) {
+                m_is_task_success = true;
+                return;
+            }
+            SDK_LOG_ERR("Response etag is not correct, try again. Expect md5 is %s, but return etag is %s.",
+                        md5_str.c_str(), etag.c_str());
+            error = kRetryChecksumMismatch;
         }
 
-        std::map<std::string, std::string>::const_iterator c_itr = m_resp_headers.find("ETag");
-        if (c_itr == m_resp_headers.end() || StringUtil::Trim(c_itr->second, "\"") != md5_str) {
-            SDK_LOG_ERR("Response etag is not correct, try again. Expect md5 is %s, but return etag is %s.",
-                        md5_str.c_str(), StringUtil::Trim(c_itr->second, "\"").c_str());
-            m_is_task_success = false;
-            continue;
+        m_is_task_success = false;
+        if (!retry_policy.WaitForRetry("PUT", error, m_attempt_num)) {
+            return;
         }
+    }
+}
+
+FileUploadPipeline::FileUploadPipeline(size_t buf_num, uint64_t part_size)
+    : m_push_finished(false), m_aborted(false), m_failed_task(NULL) {
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_free_cond, NULL);
+    pthread_cond_init(&m_ready_cond, NULL);
+    for (size_t i = 0; i < buf_num; ++i) {
+        unsigned char* buf = new unsigned char[part_size];
+        m_bufs.push_back(buf);
+        m_free_bufs.push_back(buf);
+    }
+}
+
+FileUploadPipeline::~FileUploadPipeline() {
+    for (size_t i = 0; i < m_bufs.size(); ++i) {
+        delete [] m_bufs[i];
+    }
+    pthread_cond_destroy(&m_ready_cond);
+    pthread_cond_destroy(&m_free_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+unsigned char* FileUploadPipeline::AcquireFreeBuf() {
+    pthread_mutex_lock(&m_mutex);
+    while (m_free_bufs.empty() && !m_aborted) {
+        pthread_cond_wait(&m_free_cond, &m_mutex);
+    }
 
-        m_is_task_success = true;
-    } while (!m_is_task_success && loop <= kMaxRetryTimes);
+    unsigned char* buf = NULL;
+    if (!m_aborted) {
+        buf = m_free_bufs.front();
+        m_free_bufs.pop_front();
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return buf;
+}
+
+void FileUploadPipeline::PushPart(uint64_t part_number, unsigned char* buf, uint64_t len) {
+    ReadyPart part;
+    part.m_part_number = part_number;
+    part.m_buf = buf;
+    part.m_len = len;
+
+    pthread_mutex_lock(&m_mutex);
+    m_ready_parts.push_back(part);
+    pthread_cond_signal(&m_ready_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void FileUploadPipeline::FinishPush() {
+    pthread_mutex_lock(&m_mutex);
+    m_push_finished = true;
+    pthread_cond_broadcast(&m_ready_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+bool FileUploadPipeline::PopPart(uint64_t* part_number, unsigned char** buf, uint64_t* len) {
+    pthread_mutex_lock(&m_mutex);
+    while (m_ready_parts.empty() && !m_push_finished && !m_aborted) {
+        pthread_cond_wait(&m_ready_cond, &m_mutex);
+    }
+
+    bool has_part = false;
+    if (!m_aborted && !m_ready_parts.empty()) {
+        const ReadyPart& part = m_ready_parts.front();
+        *part_number = part.m_part_number;
+        *buf = part.m_buf;
+        *len = part.m_len;
+        m_ready_parts.pop_front();
+        has_part = true;
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return has_part;
+}
+
+void FileUploadPipeline::CompletePart(uint64_t part_number, const std::string& etag,
+                                      unsigned char* buf) {
+    pthread_mutex_lock(&m_mutex);
+    m_part_etags[part_number] = etag;
+    pthread_mutex_unlock(&m_mutex);
+    ReleaseBuf(buf);
+}
+
+void FileUploadPipeline::AbortPart(uint64_t part_number, FileUploadTask* failed_task,
+                                   unsigned char* buf) {
+    pthread_mutex_lock(&m_mutex);
+    if (!m_aborted) {
+        SDK_LOG_ERR("Upload pipeline abort, part_number=%lu", part_number);
+        m_aborted = true;
+        m_failed_task = failed_task;
+    }
+    // 唤醒所有等待的读取线程和上传线程, 使其尽快退出
+    pthread_cond_broadcast(&m_free_cond);
+    pthread_cond_broadcast(&m_ready_cond);
+    pthread_mutex_unlock(&m_mutex);
+    ReleaseBuf(buf);
+}
 
-    return;
+void FileUploadPipeline::ReleaseBuf(unsigned char* buf) {
+    pthread_mutex_lock(&m_mutex);
+    m_free_bufs.push_back(buf);
+    pthread_cond_signal(&m_free_cond);
+    pthread_mutex_unlock(&m_mutex);
 }
 
 }
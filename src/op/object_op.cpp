@@ -11,19 +11,24 @@
 #include <stdint.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
+#include <algorithm>
 #include <map>
 
-#include "threadpool/boost/threadpool.hpp"
 #include <boost/bind.hpp>
 
 #include "cos_sys_config.h"
 #include "op/file_copy_task.h"
 #include "op/file_download_task.h"
+#include "op/download_checkpoint.h"
 #include "op/file_upload_task.h"
+#include "op/upload_checkpoint.h"
 #include "util/auth_tool.h"
+#include "util/body_source.h"
 #include "util/file_util.h"
 #include "util/http_sender.h"
 #include "util/string_util.h"
+#include "util/task_executor.h"
 
 #include "Poco/MD5Engine.h"
 #include "Poco/DigestStream.h"
@@ -89,30 +94,43 @@ CosResult ObjectOp::PutObject(const PutObjectByStreamReq& req, PutObjectByStream
     std::map<std::string, std::string> additional_params;
 
     std::istream& is = req.GetStream();
+    StreamBodySource stream_body(is, req.IsChunkedTransfer());
+    Md5BodySource md5_body(stream_body);
 
     // 如果传递的header中没有Content-MD5则进行SDK进行MD5校验
     bool is_check_md5 = false;
+    bool is_md5_while_sending = false;
     std::string md5_str = "";
     if (req.GetHeader("Content-MD5").empty()) {
-        Poco::MD5Engine md5;
-        Poco::DigestOutputStream dos(md5);
-        std::streampos pos = is.tellg();
-        Poco::StreamCopier::copyStream(is, dos);
-        is.clear();
-        is.seekg(pos);
-        dos.close();
-        md5_str = Poco::DigestEngine::digestToHex(md5.digest());
         is_check_md5 = true;
-        // 默认开启MD5校验
-        if (req.ShouldComputeContentMd5()) {
+        // 默认开启MD5校验, Content-MD5需在发送前确定, 只能预先读取一遍计算
+        // chunked上传的流不能预先读取
+        if (req.ShouldComputeContentMd5() && !req.IsChunkedTransfer()) {
+            Poco::MD5Engine md5;
+            Poco::DigestOutputStream dos(md5);
+            std::streampos pos = is.tellg();
+            Poco::StreamCopier::copyStream(is, dos);
+            is.clear();
+            is.seekg(pos);
+            dos.close();
+            md5_str = Poco::DigestEngine::digestToHex(md5.digest());
             std::string bin_str = CodecUtil::HexToBin(md5_str);
             std::string encode_str = CodecUtil::Base64Encode(bin_str);
             additional_headers.insert(std::make_pair("Content-MD5",encode_str));
+        } else {
+            // 关闭Content-MD5时边发送边计算MD5, 上传后与返回的ETag比对, 只读取一遍数据
+            is_md5_while_sending = true;
         }
     }
 
-    result = UploadAction(host, path, req, additional_headers,
-                          additional_params, is, resp);
+    if (is_md5_while_sending) {
+        result = UploadAction(host, path, req, additional_headers,
+                              additional_params, md5_body, resp);
+        md5_str = md5_body.GetMd5Hex();
+    } else {
+        result = UploadAction(host, path, req, additional_headers,
+                              additional_params, stream_body, resp);
+    }
 
     if (result.IsSucc() && is_check_md5 && md5_str != resp->GetEtag()) {
         result.SetFail();
@@ -139,29 +157,41 @@ CosResult ObjectOp::PutObject(const PutObjectByFileReq& req, PutObjectByFileResp
         return result;
     }
 
+    FileBodySource file_body(req.GetLocalFilePath(), 0,
+                             FileUtil::GetFileLen(req.GetLocalFilePath()));
+    Md5BodySource md5_body(file_body);
+
     // 如果传递的header中没有Content-MD5则进行SDK进行MD5校验
     bool is_check_md5 = false;
+    bool is_md5_while_sending = false;
     std::string md5_str = "";
     if (req.GetHeader("Content-MD5").empty()) {
-        Poco::MD5Engine md5;
-        Poco::DigestOutputStream dos(md5);
-        std::streampos pos = ifs.tellg();
-        Poco::StreamCopier::copyStream(ifs, dos);
-        ifs.clear();
-        ifs.seekg(pos);
-        dos.close();
-        md5_str = Poco::DigestEngine::digestToHex(md5.digest());
         is_check_md5 = true;
-        // 默认开启MD5校验
+        // 默认开启MD5校验, Content-MD5需在发送前确定, 只能预先读取一遍计算
         if (req.ShouldComputeContentMd5()) {
+            Poco::MD5Engine md5;
+            Poco::DigestOutputStream dos(md5);
+            Poco::StreamCopier::copyStream(ifs, dos);
+            dos.close();
+            md5_str = Poco::DigestEngine::digestToHex(md5.digest());
             std::string bin_str = CodecUtil::HexToBin(md5_str);
             std::string encode_str = CodecUtil::Base64Encode(bin_str);
             additional_headers.insert(std::make_pair("Content-MD5",encode_str));
+        } else {
+            // 关闭Content-MD5时边发送边计算MD5, 上传后与返回的ETag比对, 只读取一遍文件
+            is_md5_while_sending = true;
         }
     }
 
-    result = UploadAction(host, path, req, additional_headers,
-                          additional_params, ifs, resp);
+    // 文件按区间pread发送, 不经过ifstream
+    if (is_md5_while_sending) {
+        result = UploadAction(host, path, req, additional_headers,
+                              additional_params, md5_body, resp);
+        md5_str = md5_body.GetMd5Hex();
+    } else {
+        result = UploadAction(host, path, req, additional_headers,
+                              additional_params, file_body, resp);
+    }
     if (result.IsSucc() && is_check_md5 && md5_str != resp->GetEtag()) {
         result.SetFail();
         result.SetErrorInfo("Response etag is not correct, Please try again.");
@@ -237,29 +267,90 @@ CosResult ObjectOp::MultiUploadObject(const MultiUploadObjectReq& req,
         }
     }
 
-    InitMultiUploadResp init_resp;
-    init_req.SetConnTimeoutInms(req.GetConnTimeoutInms());
-    init_req.SetRecvTimeoutInms(req.GetRecvTimeoutInms());
-    result = InitMultiUpload(init_req, &init_resp);
-    if (!result.IsSucc()) {
-        SDK_LOG_ERR("Multi upload object fail, check init mutli result.");
-        resp->CopyFrom(init_resp);
-        return result;
+    // 开启断点续传时, 优先沿用断点文件中的upload_id, 并与服务端已上传的分块核对
+    std::string checkpoint_file = req.GetCheckpointFile();
+    bool is_resumable = !checkpoint_file.empty();
+    UploadCheckpoint checkpoint(checkpoint_file);
+    uint64_t file_size = FileUtil::GetFileLen(local_file_path);
+    uint64_t file_mtime = FileUtil::GetFileMtime(local_file_path);
+    std::string upload_id;
+    std::map<uint64_t, std::string> uploaded_parts;
+    if (is_resumable && checkpoint.Load()) {
+        // 只有确认旧的upload_id已不存在或已被Abort, 才新建上传, 否则旧上传的分块会一直遗留
+        // 无法确认时直接返回失败并保留断点文件, 下次调用时再核对
+        if (!checkpoint.IsMatch(file_size, file_mtime, req.GetPartSize())) {
+            SDK_LOG_WARN("Local file changed since last upload, abort upload_id=%s",
+                         checkpoint.GetUploadId().c_str());
+            AbortMultiUploadReq abort_req(bucket_name, object_name, checkpoint.GetUploadId());
+            AbortMultiUploadResp abort_resp;
+            CosResult abort_result = AbortMultiUpload(abort_req, &abort_resp);
+            if (!abort_result.IsSucc() && !IsNoSuchUpload(abort_result)) {
+                SDK_LOG_ERR("Abort outdated upload_id=%s fail, http_status=%d",
+                            checkpoint.GetUploadId().c_str(), abort_result.GetHttpStatus());
+                return abort_result;
+            }
+        } else {
+            CosResult list_result = ReconcileUploadedParts(req, checkpoint, &uploaded_parts);
+            if (list_result.IsSucc()) {
+                upload_id = checkpoint.GetUploadId();
+                SDK_LOG_INFO("Resume multi upload, upload_id=%s, uploaded part num=%lu",
+                             upload_id.c_str(), uploaded_parts.size());
+            } else if (IsNoSuchUpload(list_result)) {
+                // upload_id已失效(如已完成或已被Abort), 重新初始化上传
+                SDK_LOG_WARN("Upload_id=%s no longer exists, init a new multi upload",
+                             checkpoint.GetUploadId().c_str());
+                uploaded_parts.clear();
+            } else {
+                SDK_LOG_ERR("List parts of upload_id=%s fail, http_status=%d",
+                            checkpoint.GetUploadId().c_str(), list_result.GetHttpStatus());
+                return list_result;
+            }
+        }
     }
-    std::string upload_id = init_resp.GetUploadId();
+
     if (upload_id.empty()) {
-        SDK_LOG_ERR("Multi upload object fail, upload id is empty.");
-        resp->CopyFrom(init_resp);
-        return result;
+        InitMultiUploadResp init_resp;
+        init_req.SetConnTimeoutInms(req.GetConnTimeoutInms());
+        init_req.SetRecvTimeoutInms(req.GetRecvTimeoutInms());
+        result = InitMultiUpload(init_req, &init_resp);
+        if (!result.IsSucc()) {
+            SDK_LOG_ERR("Multi upload object fail, check init mutli result.");
+            resp->CopyFrom(init_resp);
+            return result;
+        }
+        upload_id = init_resp.GetUploadId();
+        if (upload_id.empty()) {
+            SDK_LOG_ERR("Multi upload object fail, upload id is empty.");
+            resp->CopyFrom(init_resp);
+            return result;
+        }
+
+        if (is_resumable && !checkpoint.Create(upload_id, file_size, file_mtime,
+                                               req.GetPartSize())) {
+            result.SetFail();
+            result.SetErrorInfo("Create checkpoint file fail, checkpoint file=" + checkpoint_file);
+            return result;
+        }
     }
 
     // 2. Multi Upload
     std::vector<std::string> etags;
     std::vector<uint64_t> part_numbers;
+    // 返回的耗时包括Init、各分块和Complete请求
+    RequestTiming timing = result.GetTiming();
     // TODO(返回值判断)
-    result = MultiThreadUpload(req, upload_id, &etags, &part_numbers);
+    result = MultiThreadUpload(req, upload_id, uploaded_parts,
+                               is_resumable ? &checkpoint : NULL, &etags, &part_numbers);
+    result.AddTiming(timing);
     if (!result.IsSucc()) {
         SDK_LOG_ERR("Multi upload object fail, check upload mutli result.");
+        if (is_resumable) {
+            // 保留已上传的分块, 下次调用时续传
+            SDK_LOG_INFO("Keep upload_id=%s for resume, checkpoint file=%s",
+                         upload_id.c_str(), checkpoint_file.c_str());
+            return result;
+        }
+
         // Copy失败则需要Abort
         AbortMultiUploadReq abort_req(req.GetBucketName(),
                 req.GetObjectName(), upload_id);
@@ -282,12 +373,49 @@ CosResult ObjectOp::MultiUploadObject(const MultiUploadObjectReq& req,
     comp_req.SetEtags(etags);
     comp_req.SetPartNumbers(part_numbers);
 
+    timing = result.GetTiming();
     result = CompleteMultiUpload(comp_req, &comp_resp);
+    result.AddTiming(timing);
     resp->CopyFrom(comp_resp);
+    if (result.IsSucc() && is_resumable) {
+        checkpoint.Remove();
+    }
 
     return result;
 }
 
+CosResult ObjectOp::ReconcileUploadedParts(const MultiUploadObjectReq& req,
+                                           const UploadCheckpoint& checkpoint,
+                                           std::map<uint64_t, std::string>* uploaded_parts) {
+    std::string part_number_marker = "";
+    while (true) {
+        ListPartsReq list_req(req.GetBucketName(), req.GetObjectName(), checkpoint.GetUploadId());
+        list_req.SetConnTimeoutInms(req.GetConnTimeoutInms());
+        list_req.SetRecvTimeoutInms(req.GetRecvTimeoutInms());
+        if (!part_number_marker.empty()) {
+            list_req.SetPartNumberMarker(part_number_marker);
+        }
+
+        ListPartsResp list_resp;
+        CosResult list_result = ListParts(list_req, &list_resp);
+        if (!list_result.IsSucc()) {
+            uploaded_parts->clear();
+            return list_result;
+        }
+
+        // 只有断点记录与服务端ETag一致的分块才视为已上传
+        checkpoint.MatchUploadedParts(list_resp.GetParts(), uploaded_parts);
+        if (!list_resp.IsTruncated()) {
+            return list_result;
+        }
+        part_number_marker = StringUtil::Uint64ToString(list_resp.GetNextPartNumberMarker());
+    }
+}
+
+bool ObjectOp::IsNoSuchUpload(const CosResult& result) {
+    return result.GetHttpStatus() == 404 && result.GetErrorCode() == "NoSuchUpload";
+}
+
 CosResult ObjectOp::InitMultiUpload(const InitMultiUploadReq& req, InitMultiUploadResp* resp) {
     std::string host = CosSysConfig::GetHost(GetAppId(), m_config->GetRegion(),
                                              req.GetBucketName());
@@ -315,11 +443,18 @@ CosResult ObjectOp::UploadPartData(const UploadPartDataReq& req, UploadPartDataR
         result.SetErrorInfo("Input Stream is empty.");
         return result;
     }
+    StreamBodySource stream_body(is, req.IsChunkedTransfer());
+    Md5BodySource md5_body(stream_body);
 
     // 如果传递的header中没有Content-MD5则SDK进行MD5校验
     bool is_check_md5 = false;
+    bool is_md5_while_sending = false;
     std::string md5_str = "";
-    if (req.GetHeader("Content-MD5").empty()) {
+    if (req.GetHeader("Content-MD5").empty() && req.IsChunkedTransfer()) {
+        // chunked上传的流不能预先读取, 边发送边计算MD5, 上传后与返回的ETag比对
+        is_check_md5 = true;
+        is_md5_while_sending = true;
+    } else if (req.GetHeader("Content-MD5").empty()) {
         Poco::MD5Engine md5;
         Poco::DigestOutputStream dos(md5);
         std::streampos pos = is.tellg();
@@ -337,8 +472,14 @@ CosResult ObjectOp::UploadPartData(const UploadPartDataReq& req, UploadPartDataR
         }
     }
 
-    result = UploadAction(host, path, req, additional_headers,
-                          additional_params, is, resp);
+    if (is_md5_while_sending) {
+        result = UploadAction(host, path, req, additional_headers,
+                              additional_params, md5_body, resp);
+        md5_str = md5_body.GetMd5Hex();
+    } else {
+        result = UploadAction(host, path, req, additional_headers,
+                              additional_params, stream_body, resp);
+    }
 
     if (result.IsSucc() && is_check_md5 && md5_str != resp->GetEtag()) {
         result.SetFail();
@@ -401,7 +542,7 @@ CosResult ObjectOp::ListParts(const ListPartsReq& req, ListPartsResp* resp) {
     std::string host = CosSysConfig::GetHost(GetAppId(), m_config->GetRegion(),
                                              req.GetBucketName());
     std::string path = req.GetPath();
-    return NormalAction(host, path, req, "", false, resp);
+    return ListAction(host, path, req, resp);
 }
 
 CosResult ObjectOp::GetObjectACL(const GetObjectACLReq& req,
@@ -536,7 +677,11 @@ CosResult ObjectOp::Copy(const CopyReq& req, CopyResp* resp) {
         init_req.SetRecvTimeoutInms(req.GetRecvTimeoutInms());
         init_req.AddHeaders(req.GetInitHeader());
 
+        // 返回的耗时包括Head、Init、各分块和Complete请求
+        RequestTiming timing = result.GetTiming();
         result = InitMultiUpload(init_req, &init_resp);
+        result.AddTiming(timing);
+        timing = result.GetTiming();
         if (!result.IsSucc()) {
             SDK_LOG_ERR("InitMultiUpload in Copy fail, req=[%s], result=[%s]",
                           init_req.DebugString().c_str(), result.DebugString().c_str());
@@ -558,13 +703,14 @@ CosResult ObjectOp::Copy(const CopyReq& req, CopyResp* resp) {
             pool_size = max_task_num;
         }
 
-        boost::threadpool::pool tp(pool_size);
+        TaskGroup tp(pool_size);
         std::string path = "/" + req.GetObjectName();
         std::string host = CosSysConfig::GetHost(GetAppId(), m_config->GetRegion(), req.GetBucketName());
         std::string dest_url = GetRealUrl(host, path, req.IsHttps());
         FileCopyTask** pptaskArr = new FileCopyTask*[pool_size];
         for (int i = 0; i < pool_size; ++i) {
             pptaskArr[i] = new FileCopyTask(dest_url, req.GetConnTimeoutInms(), req.GetRecvTimeoutInms());
+            pptaskArr[i]->SetSignInfo(m_config, path);
         }
 
         while (offset < file_size) {
@@ -580,17 +726,21 @@ CosResult ObjectOp::Copy(const CopyReq& req, CopyResp* resp) {
                 std::string range = "bytes=" + StringUtil::Uint64ToString(offset) + "-" + StringUtil::Uint64ToString(end);
 
                 FileCopyTask* ptask = pptaskArr[task_index];
-                FillCopyTask(upload_id, host, path, part_number, range,
+                FillCopyTask(upload_id, host, part_number, range,
                              part_copy_headers, req.GetParams(), ptask);
 
-                tp.schedule(boost::bind(&FileCopyTask::Run, ptask));
+                tp.Schedule(boost::bind(&FileCopyTask::Run, ptask));
                 part_numbers.push_back(part_number);
                 ++part_number;
                 offset = end + 1;
             }
 
             unsigned task_num = task_index;
-            tp.wait();
+            tp.Wait();
+
+            for (task_index = 0; task_index < task_num; ++task_index) {
+                timing.Add(pptaskArr[task_index]->GetTiming());
+            }
 
             for (task_index = 0; task_index < task_num; ++task_index) {
                 FileCopyTask* ptask = pptaskArr[task_index];
@@ -618,6 +768,7 @@ CosResult ObjectOp::Copy(const CopyReq& req, CopyResp* resp) {
                         SDK_LOG_ERR("Copy failed, abort upload part copy, upload_id=%s", upload_id.c_str());
                         CosResult ret;
 
+                        ret.SetTiming(timing);
                         ret.SetHttpStatus(ptask->GetHttpStatus());
                         if (ptask->GetHttpStatus() == -1) {
                             ret.SetErrorInfo(ptask->GetErrMsg());
@@ -643,6 +794,7 @@ CosResult ObjectOp::Copy(const CopyReq& req, CopyResp* resp) {
         comp_req.SetPartNumbers(part_numbers);
 
         result = CompleteMultiUpload(comp_req, &comp_resp);
+        result.AddTiming(timing);
         if (result.IsSucc()) {
             resp->CopyFrom(comp_resp);
         }
@@ -706,27 +858,41 @@ CosResult ObjectOp::MultiThreadDownload(const MultiGetObjectReq& req, MultiGetOb
         headers["Host"] = CosSysConfig::GetDestDomain();
     }
 
-    const std::string& tmp_token = m_config->GetTmpToken();
-    if (!tmp_token.empty()) {
-        headers["x-cos-security-token"] = tmp_token;
-    }
-
-    std::string auth_str = AuthTool::Sign(GetAccessKey(), GetSecretKey(),
-                                          req.GetMethod(), path, headers, params);
-    if (auth_str.empty()) {
-        result.SetErrorInfo("Generate auth str fail, check your access_key/secret_key.");
-        return result;
-    }
-    headers["Authorization"] = auth_str;
-
     uint64_t file_size = head_resp.GetContentLength();
+    unsigned slice_size = req.GetSliceSize();
 
-    // 3. 打开本地文件
+    // 开启断点续传时, 数据写入临时文件, 并通过If-Match保证续传期间object未被修改
+    std::string checkpoint_file = req.GetCheckpointFile();
+    bool is_resumable = !checkpoint_file.empty();
     std::string local_path = req.GetLocalFilePath();
-    int fd = open(local_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+    std::string write_path = is_resumable ? local_path + ".download" : local_path;
+    DownloadCheckpoint checkpoint(checkpoint_file);
+    std::vector<bool> finished_slices;
+    bool is_resume = false;
+    if (is_resumable) {
+        headers["If-Match"] = "\"" + head_resp.GetEtag() + "\"";
+        // 临时文件已不存在时, 断点记录的分片也无效
+        if (checkpoint.Load() && checkpoint.IsMatch(head_resp.GetEtag(), file_size, slice_size)
+            && access(write_path.c_str(), F_OK) == 0) {
+            finished_slices = checkpoint.GetSliceBitmap();
+            is_resume = true;
+            SDK_LOG_INFO("Resume download, finished slice num=%lu",
+                         checkpoint.GetFinishedSliceNum());
+        } else if (!checkpoint.Create(head_resp.GetEtag(), file_size, slice_size)) {
+            result.SetErrorInfo("Create checkpoint file fail, checkpoint file=" + checkpoint_file);
+            return result;
+        }
+    }
+
+    // 3. 打开本地文件, 续传时不能截断已下载的数据
+    int open_flags = O_WRONLY | O_CREAT;
+    if (!is_resume) {
+        open_flags |= O_TRUNC;
+    }
+    int fd = open(write_path.c_str(), open_flags,
                   S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
     if (-1 == fd) {
-        std::string err_info = "open file(" + local_path + ") fail, errno="
+        std::string err_info = "open file(" + write_path + ") fail, errno="
             + StringUtil::IntToString(errno);
         SDK_LOG_ERR("%s", err_info.c_str());
         result.SetErrorInfo(err_info);
@@ -735,109 +901,65 @@ CosResult ObjectOp::MultiThreadDownload(const MultiGetObjectReq& req, MultiGetOb
 
     // 4. 多线程下载
     unsigned pool_size = req.GetThreadPoolSize();
-    unsigned slice_size = req.GetSliceSize();
     unsigned max_task_num = file_size / slice_size + 1;
     if (max_task_num < pool_size) {
         pool_size = max_task_num;
     }
 
-    unsigned char** file_content_buf = new unsigned char* [pool_size];
-    for(unsigned i = 0; i < pool_size; ++i) {
-        file_content_buf[i] = new unsigned char[slice_size];
-    }
-
     std::string dest_url = GetRealUrl(host, path, req.IsHttps());
     FileDownTask** pptaskArr = new FileDownTask*[pool_size];
     for (unsigned i = 0; i < pool_size; ++i) {
         pptaskArr[i] = new FileDownTask(dest_url, headers, params,
                                 req.GetConnTimeoutInms(), req.GetRecvTimeoutInms());
+        pptaskArr[i]->SetSignInfo(m_config, path);
     }
 
     SDK_LOG_DBG("download data,url=%s, poolsize=%u,slice_size=%u,file_size=%lu",
                 dest_url.c_str(), pool_size, slice_size, file_size);
 
-    std::vector<uint64_t> vec_offset;
-    vec_offset.resize(pool_size);
-    boost::threadpool::pool tp(pool_size);
-    uint64_t offset =0;
-    bool task_fail_flag = false;
-    unsigned down_times = 0;
-    bool is_header_set = false;
-    while(offset < file_size) {
-        SDK_LOG_DBG("down data, offset=%lu, file_size=%lu", offset, file_size);
-        unsigned task_index = 0;
-        vec_offset.clear();
-        for (; task_index < pool_size && (offset < file_size); ++task_index) {
-            SDK_LOG_DBG("down data, task_index=%d, file_size=%lu, offset=%lu",
-                        task_index, file_size, offset);
-            FileDownTask* ptask = pptaskArr[task_index];
-
-            ptask->SetDownParams(file_content_buf[task_index], slice_size, offset);
-            tp.schedule(boost::bind(&FileDownTask::Run, ptask));
-            vec_offset[task_index] = offset;
-            offset += slice_size;
-            ++down_times;
-        }
+    // 每个下载线程领取分片后直接pwrite到文件对应位置, 完成后立即领取下一个分片
+    FileDownPipeline pipeline(file_size, slice_size, finished_slices);
+    TaskGroup tp(pool_size);
+    for (unsigned i = 0; i < pool_size; ++i) {
+        tp.Schedule(boost::bind(&ObjectOp::DownloadSliceWorker, this, fd, &pipeline,
+                                is_resumable ? &checkpoint : NULL, slice_size,
+                                pptaskArr[i]));
+    }
+    tp.Wait();
 
-        unsigned task_num = task_index;
-
-        tp.wait();
-
-        for (task_index = 0; task_index < task_num; ++task_index) {
-            FileDownTask *ptask = pptaskArr[task_index];
-            if (!ptask->IsTaskSuccess()) {
-                const std::string& task_resp = ptask->GetTaskResp();
-                const std::map<std::string, std::string>& task_resp_headers
-                    = ptask->GetRespHeaders();
-                SDK_LOG_ERR("down data, down task fail, rsp:%s", task_resp.c_str());
-                result.SetHttpStatus(ptask->GetHttpStatus());
-                if (ptask->GetHttpStatus() == -1) {
-                    result.SetErrorInfo(ptask->GetErrMsg());
-                } else if (!result.ParseFromHttpResponse(task_resp_headers, task_resp)) {
-                    result.SetErrorInfo(task_resp);
-                }
-                resp->ParseFromHeaders(ptask->GetRespHeaders());
+    // 返回的耗时包括HeadObject和各分片请求
+    for (unsigned i = 0; i < pool_size; ++i) {
+        result.AddTiming(pptaskArr[i]->GetTotalTiming());
+    }
 
-                task_fail_flag = true;
+    FileDownTask* failed_task = pipeline.GetFailedTask();
+    if (failed_task != NULL) {
+        const std::string& task_resp = failed_task->GetTaskResp();
+        const std::map<std::string, std::string>& task_resp_headers
+            = failed_task->GetRespHeaders();
+        SDK_LOG_ERR("down data, down task fail, rsp:%s", task_resp.c_str());
+        result.SetHttpStatus(failed_task->GetHttpStatus());
+        if (failed_task->GetHttpStatus() == -1) {
+            result.SetErrorInfo(failed_task->GetErrMsg());
+        } else if (!result.ParseFromHttpResponse(task_resp_headers, task_resp)) {
+            result.SetErrorInfo(task_resp);
+        }
+        resp->ParseFromHeaders(task_resp_headers);
+
+        // object在续传期间已被修改, 已下载的数据作废, 下次调用重新下载
+        if (is_resumable && failed_task->GetHttpStatus() == 412) {
+            SDK_LOG_WARN("Object changed during resumable download, discard %s",
+                         write_path.c_str());
+            checkpoint.Remove();
+            unlink(write_path.c_str());
+        }
+    } else {
+        for (unsigned i = 0; i < pool_size; ++i) {
+            if (pptaskArr[i]->IsTaskSuccess()) {
+                resp->ParseFromHeaders(pptaskArr[i]->GetRespHeaders());
                 break;
-            } else {
-                if (-1 == lseek(fd, vec_offset[task_index], SEEK_SET)) {
-                    std::string err_info = "down data, lseek ret="
-                        + StringUtil::IntToString(errno) + ", offset="
-                        + StringUtil::Uint64ToString(vec_offset[task_index]);
-                    SDK_LOG_ERR("%s", err_info.c_str());
-                    result.SetErrorInfo(err_info);
-                    task_fail_flag = true;
-                    break;
-                }
-
-                if (-1 == write(fd, file_content_buf[task_index], ptask->GetDownLoadLen())) {
-                    std::string err_info = "down data, write ret="
-                        + StringUtil::IntToString(errno) + ", len="
-                        + StringUtil::Uint64ToString(ptask->GetDownLoadLen());
-                    SDK_LOG_ERR("%s", err_info.c_str());
-                    result.SetErrorInfo(err_info);
-                    task_fail_flag = true;
-                    break;
-                }
-
-                if (!is_header_set) {
-                    resp->ParseFromHeaders(ptask->GetRespHeaders());
-                    is_header_set = true;
-                }
-                SDK_LOG_DBG("down data, down_times=%u,task_index=%d, file_size=%lu, "
-                            "offset=%lu, downlen:%lu ",
-                            down_times,task_index, file_size,
-                            vec_offset[task_index], ptask->GetDownLoadLen());
             }
         }
-
-        if (task_fail_flag) {
-            break;
-        }
-    }
-
-    if (!task_fail_flag) {
         result.SetSucc();
         // 下载成功则用head得到的content_length和etag设置get response
         resp->SetContentLength(file_size);
@@ -847,20 +969,50 @@ CosResult ObjectOp::MultiThreadDownload(const MultiGetObjectReq& req, MultiGetOb
     // 4. 释放所有资源
     close(fd);
     for(unsigned i = 0; i < pool_size; i++){
-        delete [] file_content_buf[i];
         delete pptaskArr[i];
     }
     delete [] pptaskArr;
-    delete [] file_content_buf;
 
-    uint64_t file_len = offset > file_size ? file_size : offset;
+    // 5. 续传下载完成后原子地重命名为目标文件
+    if (result.IsSucc() && is_resumable) {
+        if (rename(write_path.c_str(), local_path.c_str()) != 0) {
+            std::string err_info = "rename file(" + write_path + ") to (" + local_path
+                + ") fail, errno=" + StringUtil::IntToString(errno);
+            SDK_LOG_ERR("%s", err_info.c_str());
+            result.SetFail();
+            result.SetErrorInfo(err_info);
+        } else {
+            checkpoint.Remove();
+        }
+    }
 
     return result;
 }
 
+void ObjectOp::DownloadSliceWorker(int fd, FileDownPipeline* pipeline,
+                                   DownloadCheckpoint* checkpoint, uint64_t slice_size,
+                                   FileDownTask* task) {
+    uint64_t offset = 0;
+    size_t len = 0;
+    while (pipeline->NextSlice(&offset, &len)) {
+        task->SetDownParams(fd, len, offset);
+        task->Run();
+        if (!task->IsTaskSuccess()) {
+            pipeline->Abort(task);
+            return;
+        }
+        if (checkpoint != NULL) {
+            checkpoint->AppendSlice(offset / slice_size);
+        }
+        SDK_LOG_DBG("down data, offset=%lu, downlen:%lu", offset, task->GetDownLoadLen());
+    }
+}
+
 // TODO(sevenyou) 多线程上传, 返回的resp内容需要再斟酌下.
 CosResult ObjectOp::MultiThreadUpload(const MultiUploadObjectReq& req,
                                       const std::string& upload_id,
+                                      const std::map<uint64_t, std::string>& uploaded_parts,
+                                      UploadCheckpoint* checkpoint,
                                       std::vector<std::string>* etags_ptr,
                                       std::vector<uint64_t>* part_numbers_ptr) {
     CosResult result;
@@ -879,15 +1031,8 @@ CosResult ObjectOp::MultiThreadUpload(const MultiUploadObjectReq& req,
     uint64_t file_size = FileUtil::GetFileLen(local_file_path);
 
     // 2. 初始化upload task
-    uint64_t offset = 0;
-    bool task_fail_flag = false;
-
     uint64_t part_size = req.GetPartSize();
     int pool_size = req.GetThreadPoolSize();
-    unsigned char** file_content_buf = new unsigned char*[pool_size];
-    for(int i = 0; i < pool_size; ++i) {
-        file_content_buf[i] = new unsigned char[part_size];
-    }
 
     // get headers and params
     std::map<std::string, std::string> headers = req.GetHeaders();
@@ -896,82 +1041,87 @@ CosResult ObjectOp::MultiThreadUpload(const MultiUploadObjectReq& req,
     std::string dest_url = GetRealUrl(host, path, req.IsHttps());
     FileUploadTask** pptaskArr = new FileUploadTask*[pool_size];
     for (int i = 0; i < pool_size; ++i) {
-        pptaskArr[i] = new FileUploadTask(dest_url, headers, params, 
+        pptaskArr[i] = new FileUploadTask(dest_url, headers, params,
                            req.GetConnTimeoutInms(), req.GetRecvTimeoutInms());
+        pptaskArr[i]->SetSignInfo(m_config, path);
     }
 
     SDK_LOG_DBG("upload data,url=%s, poolsize=%u, part_size=%lu, file_size=%lu",
                 dest_url.c_str(), pool_size, part_size, file_size);
 
-    boost::threadpool::pool tp(pool_size);
-
-    // 3. 多线程upload
-    {
-        uint64_t part_number = 1;
-        while (offset < file_size) {
-            int task_index = 0;
-            for (; task_index < pool_size; ++task_index) {
-                fin.read((char *)file_content_buf[task_index], part_size);
-                size_t read_len = fin.gcount();
-                if (read_len == 0 && fin.eof()) {
-                    SDK_LOG_DBG("read over, task_index: %d", task_index);
-                    break;
-                }
+    // 缓冲区数量为上传线程数的两倍, 上传线程全部忙碌时读取线程仍可预读后续分块
+    FileUploadPipeline pipeline(pool_size * 2, part_size);
+    TaskGroup tp(pool_size);
 
-                SDK_LOG_DBG("upload data, part_number=%lu, task_index=%d, file_size=%lu, offset=%lu, len=%lu",
-                            part_number, task_index, file_size, offset, read_len);
-
-                FileUploadTask* ptask = pptaskArr[task_index];
-                FillUploadTask(upload_id, host, path, file_content_buf[task_index], read_len,
-                               part_number, ptask);
-                tp.schedule(boost::bind(&FileUploadTask::Run, ptask));
-                offset += read_len;
-                part_numbers_ptr->push_back(part_number);
-                ++part_number;
-            }
+    // 3. 多线程upload, 每个上传线程循环取分块上传, 不再按批次等待
+    for (int i = 0; i < pool_size; ++i) {
+        tp.Schedule(boost::bind(&ObjectOp::UploadPartWorker, this, upload_id, host,
+                                &pipeline, checkpoint, pptaskArr[i]));
+    }
 
-            int max_task_num = task_index;
+    uint64_t offset = 0;
+    uint64_t part_number = 1;
+    while (offset < file_size) {
+        // 断点续传时跳过已上传的分块
+        if (uploaded_parts.count(part_number) > 0) {
+            uint64_t skip_len = MIN(part_size, file_size - offset);
+            offset += skip_len;
+            fin.seekg(offset, std::ios::beg);
+            ++part_number;
+            continue;
+        }
 
-            tp.wait();
-            for (task_index = 0; task_index < max_task_num; ++task_index) {
-                FileUploadTask* ptask = pptaskArr[task_index];
-                if (!ptask->IsTaskSuccess()) {
-                    const std::string& task_resp = ptask->GetTaskResp();
-                    const std::map<std::string, std::string>& task_resp_headers = ptask->GetRespHeaders();
-                    SDK_LOG_ERR("upload data, upload task fail, rsp:%s", task_resp.c_str());
-                    result.SetHttpStatus(ptask->GetHttpStatus());
-                    if (ptask->GetHttpStatus() == -1) {
-                        result.SetErrorInfo(ptask->GetErrMsg());
-                    } else if (!result.ParseFromHttpResponse(task_resp_headers, task_resp)) {
-                        result.SetErrorInfo(task_resp);
-                    }
+        unsigned char* buf = pipeline.AcquireFreeBuf();
+        if (buf == NULL) {
+            SDK_LOG_ERR("upload data, pipeline aborted, stop reading at part_number=%lu",
+                        part_number);
+            break;
+        }
 
-                    task_fail_flag = true;
-                    break;
-                }
+        fin.read((char *)buf, part_size);
+        size_t read_len = fin.gcount();
+        if (read_len == 0) {
+            SDK_LOG_DBG("read over, part_number: %lu", part_number);
+            pipeline.ReleaseBuf(buf);
+            break;
+        }
 
-                // 找不到etag也算失败
-                const std::map<std::string, std::string>& resp_header = ptask->GetRespHeaders();
-                std::map<std::string, std::string>::const_iterator itr = resp_header.find("ETag");
-                if (itr != resp_header.end()) {
-                    etags_ptr->push_back(itr->second);
-                } else {
-                    std::string err_info = "upload data, upload task succ, "
-                        "but response header missing etag field.";
-                    SDK_LOG_ERR("%s", err_info.c_str());
-                    result.SetHttpStatus(ptask->GetHttpStatus());
-                    task_fail_flag = true;
-                    break;
-                }
-            }
+        SDK_LOG_DBG("upload data, part_number=%lu, file_size=%lu, offset=%lu, len=%lu",
+                    part_number, file_size, offset, read_len);
+        pipeline.PushPart(part_number, buf, read_len);
+        offset += read_len;
+        ++part_number;
+    }
+    pipeline.FinishPush();
+    tp.Wait();
 
-            if (task_fail_flag) {
-                break;
-            }
-        }
+    for (int i = 0; i < pool_size; ++i) {
+        result.AddTiming(pptaskArr[i]->GetTotalTiming());
     }
 
-    if (!task_fail_flag) {
+    FileUploadTask* failed_task = pipeline.GetFailedTask();
+    if (failed_task != NULL) {
+        const std::string& task_resp = failed_task->GetTaskResp();
+        const std::map<std::string, std::string>& task_resp_headers =
+            failed_task->GetRespHeaders();
+        SDK_LOG_ERR("upload data, upload task fail, rsp:%s", task_resp.c_str());
+        result.SetHttpStatus(failed_task->GetHttpStatus());
+        if (failed_task->GetHttpStatus() == -1) {
+            result.SetErrorInfo(failed_task->GetErrMsg());
+        } else if (!result.ParseFromHttpResponse(task_resp_headers, task_resp)) {
+            result.SetErrorInfo(task_resp);
+        }
+    } else if (offset < file_size) {
+        result.SetErrorInfo("read local file fail, local_file=" + local_file_path);
+    } else {
+        // 上传结果按完成顺序乱序返回, 与已上传的分块合并, 按分块号整理后交给Complete
+        std::map<uint64_t, std::string> part_etags = uploaded_parts;
+        part_etags.insert(pipeline.GetPartEtags().begin(), pipeline.GetPartEtags().end());
+        for (std::map<uint64_t, std::string>::const_iterator itr = part_etags.begin();
+             itr != part_etags.end(); ++itr) {
+            part_numbers_ptr->push_back(itr->first);
+            etags_ptr->push_back(itr->second);
+        }
         result.SetSucc();
     }
 
@@ -982,14 +1132,39 @@ CosResult ObjectOp::MultiThreadUpload(const MultiUploadObjectReq& req,
     }
     delete [] pptaskArr;
 
-    for (int i = 0; i < pool_size; ++i) {
-        delete [] file_content_buf[i];
-    }
-    delete [] file_content_buf;
-
     return result;
 }
 
+void ObjectOp::UploadPartWorker(const std::string& upload_id, const std::string& host,
+                                FileUploadPipeline* pipeline, UploadCheckpoint* checkpoint,
+                                FileUploadTask* task) {
+    uint64_t part_number = 0;
+    unsigned char* buf = NULL;
+    uint64_t len = 0;
+    while (pipeline->PopPart(&part_number, &buf, &len)) {
+        FillUploadTask(upload_id, host, buf, len, part_number, task);
+        task->Run();
+        if (!task->IsTaskSuccess()) {
+            pipeline->AbortPart(part_number, task, buf);
+            return;
+        }
+
+        // 找不到etag也算失败
+        const std::map<std::string, std::string>& resp_header = task->GetRespHeaders();
+        std::map<std::string, std::string>::const_iterator itr = resp_header.find("ETag");
+        if (itr == resp_header.end()) {
+            SDK_LOG_ERR("upload data, upload task succ, but response header missing etag field,"
+                        " part_number=%lu", part_number);
+            pipeline->AbortPart(part_number, task, buf);
+            return;
+        }
+        pipeline->CompletePart(part_number, itr->second, buf);
+        if (checkpoint != NULL) {
+            checkpoint->AppendPart(part_number, itr->second);
+        }
+    }
+}
+
 uint64_t ObjectOp::GetContent(const std::string& src, std::string* file_content) const {
     //读取文件内容
     const unsigned char * pbuf = NULL;
@@ -1000,9 +1175,8 @@ uint64_t ObjectOp::GetContent(const std::string& src, std::string* file_content)
 }
 
 void ObjectOp::FillUploadTask(const std::string& upload_id, const std::string& host,
-                              const std::string& path, unsigned char* file_content_buf,
-                              uint64_t len, uint64_t part_number,
-                              FileUploadTask* task_ptr) {
+                              unsigned char* file_content_buf, uint64_t len,
+                              uint64_t part_number, FileUploadTask* task_ptr) {
     std::map<std::string, std::string> req_params;
     req_params.insert(std::make_pair("uploadId", upload_id));
     req_params.insert(std::make_pair("partNumber", StringUtil::Uint64ToString(part_number)));
@@ -1013,15 +1187,8 @@ void ObjectOp::FillUploadTask(const std::string& upload_id, const std::string& h
     } else {
         req_headers["Host"] = CosSysConfig::GetDestDomain();
     }
-    std::string auth_str = AuthTool::Sign(GetAccessKey(), GetSecretKey(), "PUT",
-                                          path, req_headers, req_params);
-    req_headers["Authorization"] = auth_str;
-
-    const std::string& tmp_token = m_config->GetTmpToken();
-    if (!tmp_token.empty()) {
-        req_headers["x-cos-security-token"] = tmp_token;
-    }
 
+    // 签名由任务在每次发送前完成
     task_ptr->SetParams(req_params);
     task_ptr->SetHeaders(req_headers);
     task_ptr->SetUploadBuf(file_content_buf, len);
@@ -1029,7 +1196,6 @@ void ObjectOp::FillUploadTask(const std::string& upload_id, const std::string& h
 
 void ObjectOp::FillCopyTask(const std::string& upload_id,
                             const std::string& host,
-                            const std::string& path,
                             uint64_t part_number,
                             const std::string& range,
                             const std::map<std::string, std::string>& headers,
@@ -1047,26 +1213,21 @@ void ObjectOp::FillCopyTask(const std::string& upload_id,
     }
 
     req_headers["x-cos-copy-source-range"] = range;
-    std::string auth_str = AuthTool::Sign(GetAccessKey(), GetSecretKey(), "PUT",
-                                          path, req_headers, req_params);
-    req_headers["Authorization"] = auth_str;
-
-    const std::string& tmp_token = m_config->GetTmpToken();
-    if (!tmp_token.empty()) {
-        req_headers["x-cos-security-token"] = tmp_token;
-    }
 
+    // 签名由任务在每次发送前完成
     task_ptr->SetParams(req_params);
     task_ptr->SetHeaders(req_headers);
 }
 
 std::string ObjectOp::GeneratePresignedUrl(const GeneratePresignedUrlReq& req) {
     std::string auth_str = "";
+    const Credential& credential = *m_config->GetCredential();
     if (req.GetStartTimeInSec() == 0 || req.GetExpiredTimeInSec() == 0) {
-        auth_str = AuthTool::Sign(GetAccessKey(), GetSecretKey(), req.GetMethod(),
-                req.GetPath(), req.GetHeaders(), req.GetParams());
+        auth_str = AuthTool::Sign(credential.GetAccessKey(), credential.GetSecretKey(),
+                req.GetMethod(), req.GetPath(), req.GetHeaders(), req.GetParams());
     } else {
-        auth_str = AuthTool::Sign(GetAccessKey(), GetSecretKey(), req.GetMethod(),
+        auth_str = AuthTool::Sign(credential.GetAccessKey(), credential.GetSecretKey(),
+                req.GetMethod(),
                 req.GetPath(), req.GetHeaders(), req.GetParams(),
                 req.GetStartTimeInSec(), req.GetStartTimeInSec() + req.GetExpiredTimeInSec());
     }
@@ -1097,6 +1258,79 @@ std::string ObjectOp::GeneratePresignedUrl(const GeneratePresignedUrlReq& req) {
     return signed_url;
 }
 
+namespace {
+// 每个分段至少包含的对象数, 批次较小时不值得分发到多个线程
+const size_t kMinPresignUrlsPerTask = 256;
+
+// 一个批次内共享的签名和url前缀, 各分段只写urls中自己负责的下标
+struct PresignUrlBatch {
+    const BatchSigner* m_signer;
+    const std::vector<std::string>* m_object_names;
+    std::vector<std::string>* m_urls;
+    std::string m_url_prefix;
+    std::string m_sign_prefix;
+
+    void Run(size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const std::string& object_name = (*m_object_names)[i];
+            std::string& url = (*m_urls)[i];
+            url.clear();
+            url.reserve(m_url_prefix.size() + object_name.size() * 3
+                        + m_sign_prefix.size() + 2 * SHA_DIGESTSIZE);
+            // 与GeneratePresignedUrl一致, path为"/" + object_name;
+            // EncodeKey逐字符编码且不编码'/', 前缀可以预先编码
+            url.append(m_url_prefix).append(CodecUtil::EncodeKey(object_name));
+            // 签名的16进制值无需编码
+            url.append(m_sign_prefix).append(m_signer->GetSignature("/" + object_name));
+        }
+    }
+};
+} // namespace
+
+bool ObjectOp::GeneratePresignedUrls(const std::string& bucket_name,
+                                     const std::vector<std::string>& object_names,
+                                     HTTP_METHOD http_method,
+                                     uint64_t start_time_in_s,
+                                     uint64_t end_time_in_s,
+                                     std::vector<std::string>* urls,
+                                     unsigned thread_num) {
+    urls->resize(object_names.size());
+    const Credential& credential = *m_config->GetCredential();
+    BatchSigner signer(credential.GetAccessKey(), credential.GetSecretKey(),
+                       StringUtil::HttpMethodToString(http_method),
+                       start_time_in_s, end_time_in_s);
+    if (!signer.IsValid()) {
+        urls->assign(object_names.size(), "");
+        return false;
+    }
+
+    std::string host = CosSysConfig::GetHost(GetAppId(), m_config->GetRegion(), bucket_name);
+    PresignUrlBatch batch;
+    batch.m_signer = &signer;
+    batch.m_object_names = &object_names;
+    batch.m_urls = urls;
+    batch.m_url_prefix = GetRealUrl(host, "/", false);
+    batch.m_sign_prefix = "?sign=" + CodecUtil::EncodeKey(signer.GetSignPrefix());
+
+    size_t task_num = object_names.size() / kMinPresignUrlsPerTask;
+    if (task_num > thread_num) {
+        task_num = thread_num;
+    }
+    if (task_num <= 1) {
+        batch.Run(0, object_names.size());
+        return true;
+    }
+
+    size_t step = (object_names.size() + task_num - 1) / task_num;
+    TaskGroup tp(task_num);
+    for (size_t begin = 0; begin < object_names.size(); begin += step) {
+        size_t end = std::min(begin + step, object_names.size());
+        tp.Schedule(boost::bind(&PresignUrlBatch::Run, &batch, begin, end));
+    }
+    tp.Wait();
+    return true;
+}
+
 CosResult ObjectOp::OptionsObject(const OptionsObjectReq& req, OptionsObjectResp* resp) {
     std::string host = CosSysConfig::GetHost(GetAppId(), m_config->GetRegion(), req.GetBucketName());
     std::string path = req.GetPath();
@@ -0,0 +1,146 @@
+#include "op/upload_checkpoint.h"
+
+#include <stdio.h>
+
+#include <fstream>
+
+#include "cos_defines.h"
+#include "cos_sys_config.h"
+#include "util/string_util.h"
+
+namespace qcloud_cos {
+
+UploadCheckpoint::UploadCheckpoint(const std::string& checkpoint_file)
+    : m_checkpoint_file(checkpoint_file), m_file_size(0), m_file_mtime(0), m_part_size(0) {
+    pthread_mutex_init(&m_mutex, NULL);
+}
+
+UploadCheckpoint::~UploadCheckpoint() {
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool UploadCheckpoint::Load() {
+    std::ifstream ifs(m_checkpoint_file.c_str(), std::ios::in);
+    if (!ifs.is_open()) {
+        return false;
+    }
+
+    m_upload_id.clear();
+    m_parts.clear();
+    m_file_size = 0;
+    m_file_mtime = 0;
+    m_part_size = 0;
+
+    std::string line;
+    while (std::getline(ifs, line)) {
+        size_t pos = line.find('=');
+        if (pos == std::string::npos) {
+            // 进程中断时最后一行可能不完整, 忽略
+            continue;
+        }
+
+        std::string key = line.substr(0, pos);
+        std::string value = line.substr(pos + 1);
+        if (key == "upload_id") {
+            m_upload_id = value;
+        } else if (key == "file_size") {
+            m_file_size = StringUtil::StringToUint64(value);
+        } else if (key == "file_mtime") {
+            m_file_mtime = StringUtil::StringToUint64(value);
+        } else if (key == "part_size") {
+            m_part_size = StringUtil::StringToUint64(value);
+        } else if (key == "part") {
+            size_t sep = value.find(' ');
+            if (sep == std::string::npos || sep + 1 >= value.size()) {
+                continue;
+            }
+            uint64_t part_number = StringUtil::StringToUint64(value.substr(0, sep));
+            if (part_number > 0) {
+                m_parts[part_number] = value.substr(sep + 1);
+            }
+        }
+    }
+
+    if (m_upload_id.empty() || m_part_size == 0) {
+        SDK_LOG_WARN("Invalid upload checkpoint file %s", m_checkpoint_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool UploadCheckpoint::Create(const std::string& upload_id, uint64_t file_size,
+                              uint64_t file_mtime, uint64_t part_size) {
+    m_upload_id = upload_id;
+    m_file_size = file_size;
+    m_file_mtime = file_mtime;
+    m_part_size = part_size;
+    m_parts.clear();
+
+    // 先写临时文件再rename, 避免中断后留下只有部分首部的断点文件
+    std::string tmp_file = m_checkpoint_file + ".tmp";
+    {
+        std::ofstream ofs(tmp_file.c_str(), std::ios::out | std::ios::trunc);
+        if (!ofs.is_open()) {
+            SDK_LOG_ERR("Create upload checkpoint file %s fail", tmp_file.c_str());
+            return false;
+        }
+        ofs << "upload_id=" << m_upload_id << "\n"
+            << "file_size=" << m_file_size << "\n"
+            << "file_mtime=" << m_file_mtime << "\n"
+            << "part_size=" << m_part_size << "\n";
+        ofs.flush();
+        if (!ofs.good()) {
+            SDK_LOG_ERR("Write upload checkpoint file %s fail", tmp_file.c_str());
+            return false;
+        }
+    }
+
+    if (rename(tmp_file.c_str(), m_checkpoint_file.c_str()) != 0) {
+        SDK_LOG_ERR("Rename upload checkpoint file %s fail", m_checkpoint_file.c_str());
+        remove(tmp_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool UploadCheckpoint::AppendPart(uint64_t part_number, const std::string& etag) {
+    pthread_mutex_lock(&m_mutex);
+    m_parts[part_number] = etag;
+    std::ofstream ofs(m_checkpoint_file.c_str(), std::ios::out | std::ios::app);
+    bool ret = false;
+    if (ofs.is_open()) {
+        ofs << "part=" << part_number << " " << etag << "\n";
+        ofs.flush();
+        ret = ofs.good();
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    if (!ret) {
+        SDK_LOG_WARN("Append part %lu to upload checkpoint file %s fail",
+                     part_number, m_checkpoint_file.c_str());
+    }
+    return ret;
+}
+
+bool UploadCheckpoint::IsMatch(uint64_t file_size, uint64_t file_mtime,
+                               uint64_t part_size) const {
+    return m_file_size == file_size && m_file_mtime == file_mtime && m_part_size == part_size;
+}
+
+void UploadCheckpoint::MatchUploadedParts(const std::vector<Part>& server_parts,
+                                          std::map<uint64_t, std::string>* uploaded_parts) const {
+    for (std::vector<Part>::const_iterator itr = server_parts.begin();
+         itr != server_parts.end(); ++itr) {
+        std::map<uint64_t, std::string>::const_iterator c_itr = m_parts.find(itr->m_part_num);
+        if (c_itr != m_parts.end()
+            && StringUtil::Trim(c_itr->second, "\"") == StringUtil::Trim(itr->m_etag, "\"")) {
+            (*uploaded_parts)[itr->m_part_num] = c_itr->second;
+        }
+    }
+}
+
+void UploadCheckpoint::Remove() {
+    remove(m_checkpoint_file.c_str());
+}
+
+} // namespace qcloud_cos
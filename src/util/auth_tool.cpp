@@ -12,78 +12,48 @@
 #include "util/sha1.h"
 #include "util/string_util.h"
 #include "util/http_sender.h"
+#include "util/simple_mutex.h"
 #include "cos_sys_config.h"
 
 namespace qcloud_cos {
 
-void AuthTool::FilterAndSetSignHeader(const std::map<std::string,std::string> &headers,
-                                      std::map<std::string, std::string>* filted_req_headers) {
-    for(std::map<std::string, std::string>::const_iterator itr = headers.begin();
-        itr != headers.end(); ++itr) {
-        if( !strcasecmp(itr->first.c_str(), "host")
-            || !strcasecmp(itr->first.c_str(), "content-type")
-            || !strcasecmp(itr->first.c_str(), "content-md5")
-            || !strcasecmp(itr->first.c_str(), "content-disposition")
-            || !strcasecmp(itr->first.c_str(), "content-encoding")
-            || !strcasecmp(itr->first.c_str(), "content-length")
-            || !strcasecmp(itr->first.c_str(), "transfer-encoding")
-            || !strcasecmp(itr->first.c_str(), "range")
-            || !strncmp(itr->first.c_str(), "x-cos", 5)) {
-            filted_req_headers->insert(std::make_pair(itr->first, itr->second));
+namespace {
+// 缓存的sign key数量上限, 超过后整体清空; 同一key-time窗口内的请求共享一份
+const size_t kMaxSignKeyCacheSize = 64;
+
+const std::string kRootUri = "/";
+
+typedef Poco::SharedPtr<const HmacSha1Ctx> HmacSha1CtxPtr;
+
+SimpleMutex s_sign_key_mutex;
+// (secret_key, key-time) => 以sign key为密钥的HMAC预计算状态
+std::map<std::string, HmacSha1CtxPtr> s_sign_key_cache;
+
+// 获取sign_key = HmacSha1Hex(key_time, secret_key)对应的HMAC状态,
+// 同一窗口内只派生一次sign key, 签名时只需对StringToSign做哈希
+// 预计算状态只读, 返回共享指针, 命中缓存时不复制EVP上下文
+HmacSha1CtxPtr GetSignKeyHmac(const std::string& secret_key, const std::string& key_time) {
+    std::string cache_key = key_time + "\n" + secret_key;
+    {
+        SimpleMutexLocker locker(&s_sign_key_mutex);
+        std::map<std::string, HmacSha1CtxPtr>::const_iterator itr
+            = s_sign_key_cache.find(cache_key);
+        if (itr != s_sign_key_cache.end()) {
+            return itr->second;
         }
     }
-}
-
-void AuthTool::FillMap(const std::map<std::string,std::string> &params,
-                       bool key_encode,
-                       bool value_encode,
-                       bool value_lower,
-                       std::string* param_list,
-                       std::string* param_value_list) {
-    if (params.empty()) {
-        return;
-    }
-
-    std::map<std::string, std::string>::const_iterator itr;
-    std::map<std::string, std::string> trim_params;
-
-    for (itr = params.begin(); itr != params.end(); ++itr) {
-        std::string key = itr->first;
-        std::string value;
-
-        if(value_encode) {
-            value = CodecUtil::UrlEncode(itr->second);
-        } else {
-            value = itr->second;
-        }
-
-        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-        if(value_lower) {
-            std::transform(value.begin(), value.end(), value.begin(), ::tolower);
-        }
-        trim_params[key] = value;
-    }
 
-    itr = trim_params.begin();
+    std::string sign_key = HmacSha1Ctx(secret_key).HexDigest(key_time);
+    HmacSha1CtxPtr sign_key_hmac(new HmacSha1Ctx(sign_key));
 
-    if (key_encode) {
-        param_list->append(CodecUtil::UrlEncode(itr->first));
-        *param_value_list += CodecUtil::UrlEncode(itr->first) + "=" + itr->second;
-    } else {
-        param_list->append(itr->first);
-        *param_value_list += itr->first + "=" + itr->second;
-    }
-
-    for (++itr; itr != trim_params.end(); ++itr) {
-        if(key_encode) {
-            *param_list += ";" + CodecUtil::UrlEncode(itr->first);
-            *param_value_list += "&" + CodecUtil::UrlEncode(itr->first) + "=" + itr->second;
-        } else {
-            *param_list += ";" + itr->first;
-            *param_value_list += "&" + itr->first + "=" + itr->second;
-        }
+    SimpleMutexLocker locker(&s_sign_key_mutex);
+    if (s_sign_key_cache.size() >= kMaxSignKeyCacheSize) {
+        s_sign_key_cache.clear();
     }
+    s_sign_key_cache[cache_key] = sign_key_hmac;
+    return sign_key_hmac;
 }
+} // namespace
 
 std::string AuthTool::Sign(const std::string& access_key, const std::string& secret_key,
                            const std::string& http_method, const std::string& in_uri,
@@ -106,51 +76,116 @@ std::string AuthTool::Sign(const std::string& access_key, const std::string& sec
     if (access_key.empty() || secret_key.empty()) {
         return "";
     }
-    std::string start_end_time_str = StringUtil::Uint64ToString(start_time_in_s) + ";"
-        + StringUtil::Uint64ToString(end_time_in_s);
-
-    // 1. 获取签名所需的path/params/headers
-    std::map<std::string, std::string> filted_req_headers;
-    FilterAndSetSignHeader(headers, &filted_req_headers);
+    CanonicalRequest canonical_req(params, headers);
+    return Sign(access_key, secret_key, http_method, in_uri, canonical_req,
+                start_time_in_s, end_time_in_s);
+}
 
-    // 2. 将header和params拼接为字符串
-    std::string header_list, header_value_list;
-    std::string param_list, param_value_list;
+std::string AuthTool::Sign(const std::string& access_key, const std::string& secret_key,
+                           const std::string& http_method, const std::string& in_uri,
+                           const CanonicalRequest& canonical_req) {
+    uint64_t expired_time_in_s = CosSysConfig::GetAuthExpiredTime();
+    uint64_t start_time_in_s = HttpSender::GetTimeStampInUs() / 1000000;
+    uint64_t end_time_in_s = start_time_in_s + expired_time_in_s;
 
-    FillMap(params, true, true, false, &param_list, &param_value_list);
-    FillMap(filted_req_headers, false, true, false, &header_list, &header_value_list);
+    return Sign(access_key, secret_key, http_method, in_uri, canonical_req, start_time_in_s,
+                end_time_in_s);
+}
 
-    std::string uri = in_uri;
-    if (uri.empty()) {
-        uri = "/";
+std::string AuthTool::Sign(const std::string& access_key, const std::string& secret_key,
+                           const std::string& http_method, const std::string& in_uri,
+                           const CanonicalRequest& canonical_req,
+                           uint64_t start_time_in_s,
+                           uint64_t end_time_in_s) {
+    if (access_key.empty() || secret_key.empty()) {
+        return "";
     }
+    std::string start_end_time_str = StringUtil::Uint64ToString(start_time_in_s) + ";"
+        + StringUtil::Uint64ToString(end_time_in_s);
+
+    // 1. 签名所需的params/headers已由CanonicalRequest排序、编码
+    const std::string& uri = in_uri.empty() ? kRootUri : in_uri;
 
-    // 3. format string
-    std::string lower_method = StringUtil::StringToLower(http_method);
-    std::string format_str= lower_method + "\n" + uri + "\n"
-        + param_value_list + "\n" + header_value_list + "\n";
+    // 2. format string
+    std::string format_str;
+    format_str.reserve(http_method.size() + uri.size()
+                       + canonical_req.GetParamValueList().size()
+                       + canonical_req.GetHeaderValueList().size() + 4);
+    for (std::string::const_iterator itr = http_method.begin(); itr != http_method.end(); ++itr) {
+        format_str.push_back(::tolower((unsigned char)*itr));
+    }
+    format_str.append("\n").append(uri).append("\n");
+    format_str.append(canonical_req.GetParamValueList()).append("\n");
+    format_str.append(canonical_req.GetHeaderValueList()).append("\n");
 
-    // 4. StringToSign
+    // 3. StringToSign
     Sha1 sha1;
     sha1.Append(format_str.c_str(), format_str.size());
     std::string string_to_sign= "sha1\n" + start_end_time_str + "\n" + sha1.Final() + "\n";
 
-    // 5. signature
-    std::string sign_key = CodecUtil::HmacSha1Hex(start_end_time_str, secret_key);
-    std::transform(sign_key.begin(), sign_key.end(), sign_key.begin(), ::tolower);
+    // 4. signature
+    std::string signature
+        = GetSignKeyHmac(secret_key, start_end_time_str)->HexDigest(string_to_sign);
 
-    std::string signature = CodecUtil::HmacSha1Hex(string_to_sign, sign_key);
-    std::transform(signature.begin(), signature.end(), signature.begin(), ::tolower);
-
-    // 6. 拼接
+    // 5. 拼接
     std::string req_sign = "q-sign-algorithm=sha1&q-ak=" + access_key +
                            "&q-sign-time=" + start_end_time_str +
                            "&q-key-time=" + start_end_time_str +
-                           "&q-header-list=" + header_list +
-                           "&q-url-param-list=" + param_list +
+                           "&q-header-list=" + canonical_req.GetHeaderList() +
+                           "&q-url-param-list=" + canonical_req.GetParamList() +
                            "&q-signature=" + signature;
 
     return req_sign;
 }
 
+BatchSigner::BatchSigner(const std::string& secret_id,
+                         const std::string& secret_key,
+                         const std::string& http_method,
+                         uint64_t start_time_in_s,
+                         uint64_t end_time_in_s)
+    : m_is_valid(!secret_id.empty() && !secret_key.empty()) {
+    if (!m_is_valid) {
+        return;
+    }
+
+    if (start_time_in_s == 0 || end_time_in_s <= start_time_in_s) {
+        start_time_in_s = HttpSender::GetTimeStampInUs() / 1000000;
+        end_time_in_s = start_time_in_s + CosSysConfig::GetAuthExpiredTime();
+    }
+    m_key_time = StringUtil::Uint64ToString(start_time_in_s) + ";"
+        + StringUtil::Uint64ToString(end_time_in_s);
+
+    for (std::string::const_iterator itr = http_method.begin(); itr != http_method.end(); ++itr) {
+        m_lower_method.push_back(::tolower((unsigned char)*itr));
+    }
+
+    // 不带header/param, 签名串中只有q-signature随uri变化
+    m_sign_prefix = "q-sign-algorithm=sha1&q-ak=" + secret_id +
+                    "&q-sign-time=" + m_key_time +
+                    "&q-key-time=" + m_key_time +
+                    "&q-header-list=&q-url-param-list=&q-signature=";
+    m_sign_key_hmac = GetSignKeyHmac(secret_key, m_key_time);
+}
+
+std::string BatchSigner::GetSignature(const std::string& uri) const {
+    if (!m_is_valid) {
+        return "";
+    }
+
+    // 与AuthTool::Sign中params/headers为空时的format string一致
+    const std::string& real_uri = uri.empty() ? kRootUri : uri;
+    std::string format_str;
+    format_str.reserve(m_lower_method.size() + real_uri.size() + 4);
+    format_str.append(m_lower_method).append("\n").append(real_uri).append("\n\n\n");
+
+    Sha1 sha1;
+    sha1.Append(format_str.c_str(), format_str.size());
+    std::string string_to_sign;
+    string_to_sign.reserve(m_key_time.size() + 2 * SHA_DIGESTSIZE + 7);
+    string_to_sign.append("sha1\n").append(m_key_time).append("\n")
+                  .append(sha1.Final()).append("\n");
+
+    return m_sign_key_hmac->HexDigest(string_to_sign);
+}
+
 } // namespace qcloud_cos
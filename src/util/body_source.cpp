@@ -0,0 +1,152 @@
+#include "util/body_source.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "Poco/DigestStream.h"
+#include "Poco/StreamCopier.h"
+
+namespace qcloud_cos {
+
+namespace {
+
+// 单次写入/读取的块大小
+const size_t kBodyChunkSize = 64 * 1024;
+
+} // namespace
+
+uint64_t BufferBodySource::WriteTo(std::ostream& os) {
+    size_t offset = 0;
+    while (offset < m_len && os.good()) {
+        size_t n = m_len - offset < kBodyChunkSize ? m_len - offset : kBodyChunkSize;
+        os.write(m_data + offset, n);
+        offset += n;
+    }
+    return offset;
+}
+
+size_t BufferBodySource::Read(char* buf, size_t len) {
+    size_t n = m_len - m_read_offset < len ? m_len - m_read_offset : len;
+    memcpy(buf, m_data + m_read_offset, n);
+    m_read_offset += n;
+    return n;
+}
+
+FileBodySource::~FileBodySource() {
+    if (m_read_fd >= 0) {
+        close(m_read_fd);
+    }
+}
+
+uint64_t FileBodySource::WriteTo(std::ostream& os) {
+    int fd = open(m_file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Open file " + m_file_path + " fail, " + strerror(errno));
+    }
+
+    std::vector<char> buf(kBodyChunkSize);
+    uint64_t sent = 0;
+    while (sent < m_len && os.good()) {
+        size_t want = m_len - sent < kBodyChunkSize ? m_len - sent : kBodyChunkSize;
+        ssize_t n = pread(fd, &buf[0], want, m_offset + sent);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            std::string err = n < 0 ? strerror(errno) : "unexpected end of file";
+            close(fd);
+            throw std::runtime_error("Read file " + m_file_path + " fail, " + err);
+        }
+        os.write(&buf[0], n);
+        sent += n;
+    }
+    close(fd);
+    return sent;
+}
+
+size_t FileBodySource::Read(char* buf, size_t len) {
+    if (m_read_offset >= m_len) {
+        return 0;
+    }
+    if (m_read_fd < 0) {
+        m_read_fd = open(m_file_path.c_str(), O_RDONLY);
+        if (m_read_fd < 0) {
+            throw std::runtime_error("Open file " + m_file_path + " fail, " + strerror(errno));
+        }
+    }
+
+    size_t want = m_len - m_read_offset < len ? m_len - m_read_offset : len;
+    ssize_t n = 0;
+    do {
+        n = pread(m_read_fd, buf, want, m_offset + m_read_offset);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        std::string err = n < 0 ? strerror(errno) : "unexpected end of file";
+        throw std::runtime_error("Read file " + m_file_path + " fail, " + err);
+    }
+    m_read_offset += n;
+    return n;
+}
+
+uint64_t StreamBodySource::GetLength() {
+    std::streampos pos = m_is.tellg();
+    m_is.seekg(0, std::ios::end);
+    std::streampos end = m_is.tellg();
+    m_is.seekg(pos);
+    return static_cast<uint64_t>(end - pos);
+}
+
+uint64_t StreamBodySource::WriteTo(std::ostream& os) {
+    return Poco::StreamCopier::copyStream64(m_is, os);
+}
+
+size_t StreamBodySource::Read(char* buf, size_t len) {
+    m_is.read(buf, len);
+    if (m_is.bad()) {
+        throw std::runtime_error("Read body stream fail");
+    }
+    return static_cast<size_t>(m_is.gcount());
+}
+
+bool StreamBodySource::Rewind() {
+    if (m_start_pos == std::streampos(-1)) {
+        return false;
+    }
+    m_is.clear();
+    m_is.seekg(m_start_pos);
+    return !m_is.fail();
+}
+
+uint64_t Md5BodySource::WriteTo(std::ostream& os) {
+    m_md5.reset();
+    Poco::DigestOutputStream dos(m_md5, os);
+    uint64_t len = m_source.WriteTo(dos);
+    dos.close();
+    m_md5_hex = Poco::DigestEngine::digestToHex(m_md5.digest());
+    return len;
+}
+
+size_t Md5BodySource::Read(char* buf, size_t len) {
+    size_t n = m_source.Read(buf, len);
+    if (n > 0) {
+        m_md5.update(buf, n);
+    } else if (!m_is_read_done) {
+        m_md5_hex = Poco::DigestEngine::digestToHex(m_md5.digest());
+        m_is_read_done = true;
+    }
+    return n;
+}
+
+bool Md5BodySource::Rewind() {
+    m_md5.reset();
+    m_md5_hex.clear();
+    m_is_read_done = false;
+    return m_source.Rewind();
+}
+
+} // namespace qcloud_cos
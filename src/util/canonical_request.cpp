@@ -0,0 +1,203 @@
+#include "util/canonical_request.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "util/codec_util.h"
+
+namespace qcloud_cos {
+
+namespace {
+struct SignEntry {
+    const std::string* m_key;
+    const std::string* m_value;
+    // params编码后的key/value在query串中的位置, header不使用
+    size_t m_enc_key_pos;
+    size_t m_enc_key_len;
+    size_t m_enc_value_pos;
+    size_t m_enc_value_len;
+};
+
+// 等价于比较两个key小写后的字符串
+bool LessIgnoreCase(const SignEntry& lhs, const SignEntry& rhs) {
+    const std::string& l = *lhs.m_key;
+    const std::string& r = *rhs.m_key;
+    size_t len = std::min(l.size(), r.size());
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char lc = tolower((unsigned char)l[i]);
+        unsigned char rc = tolower((unsigned char)r[i]);
+        if (lc != rc) {
+            return lc < rc;
+        }
+    }
+    return l.size() < r.size();
+}
+
+bool EqualIgnoreCase(const SignEntry& lhs, const SignEntry& rhs) {
+    return lhs.m_key->size() == rhs.m_key->size()
+        && !LessIgnoreCase(lhs, rhs) && !LessIgnoreCase(rhs, lhs);
+}
+
+// 追加已编码key的小写形式, %XX转义中的十六进制字符保持原样,
+// 结果与先小写再编码一致
+void AppendLowerEncoded(const std::string& src, size_t pos, size_t len, std::string* out) {
+    size_t end = pos + len;
+    while (pos < end) {
+        // 原始的%也会被编码, 编码结果中的%一定是转义的开头
+        if (src[pos] == '%') {
+            out->append(src, pos, 3);
+            pos += 3;
+        } else {
+            out->push_back(tolower((unsigned char)src[pos]));
+            ++pos;
+        }
+    }
+}
+
+void AppendLower(const std::string& src, std::string* out) {
+    for (std::string::const_iterator itr = src.begin(); itr != src.end(); ++itr) {
+        out->push_back(tolower((unsigned char)*itr));
+    }
+}
+
+// 按小写key排序, 小写后相同的key只保留最后一个(与按小写key覆盖写入map的结果一致)
+void SortAndUnique(std::vector<SignEntry>* entries) {
+    std::stable_sort(entries->begin(), entries->end(), LessIgnoreCase);
+    std::vector<SignEntry>::iterator out = entries->begin();
+    for (std::vector<SignEntry>::iterator itr = entries->begin(); itr != entries->end(); ++itr) {
+        if (itr + 1 != entries->end() && EqualIgnoreCase(*itr, *(itr + 1))) {
+            continue;
+        }
+        *out++ = *itr;
+    }
+    entries->erase(out, entries->end());
+}
+} // namespace
+
+CanonicalRequest::CanonicalRequest(const std::map<std::string, std::string>& params) {
+    BuildParams(params, false);
+}
+
+CanonicalRequest::CanonicalRequest(const std::map<std::string, std::string>& params,
+                                   const std::map<std::string, std::string>& headers) {
+    BuildParams(params, true);
+    BuildHeaders(headers);
+}
+
+bool CanonicalRequest::IsSignHeader(const std::string& key) {
+    const char* k = key.c_str();
+    return !strcasecmp(k, "host")
+        || !strcasecmp(k, "content-type")
+        || !strcasecmp(k, "content-md5")
+        || !strcasecmp(k, "content-disposition")
+        || !strcasecmp(k, "content-encoding")
+        || !strcasecmp(k, "content-length")
+        || !strcasecmp(k, "transfer-encoding")
+        || !strcasecmp(k, "range")
+        || !strncmp(k, "x-cos", 5);
+}
+
+void CanonicalRequest::BuildParams(const std::map<std::string, std::string>& params,
+                                   bool with_sign_list) {
+    if (params.empty()) {
+        return;
+    }
+
+    size_t raw_len = 0;
+    for (std::map<std::string, std::string>::const_iterator itr = params.begin();
+         itr != params.end(); ++itr) {
+        raw_len += itr->first.size() + itr->second.size() + 2;
+    }
+    m_query_str.reserve(raw_len);
+
+    // 1. 按原始key顺序编码一次, 直接写入query串, 签名列表引用其中的编码结果
+    std::vector<SignEntry> entries;
+    if (with_sign_list) {
+        entries.reserve(params.size());
+    }
+    for (std::map<std::string, std::string>::const_iterator itr = params.begin();
+         itr != params.end(); ++itr) {
+        m_query_str.push_back(m_query_str.empty() ? '?' : '&');
+
+        SignEntry entry;
+        entry.m_key = &itr->first;
+        entry.m_value = &itr->second;
+        entry.m_enc_key_pos = m_query_str.size();
+        CodecUtil::UrlEncode(itr->first, &m_query_str);
+        entry.m_enc_key_len = m_query_str.size() - entry.m_enc_key_pos;
+
+        if (!itr->second.empty()) {
+            m_query_str.push_back('=');
+        }
+        entry.m_enc_value_pos = m_query_str.size();
+        CodecUtil::UrlEncode(itr->second, &m_query_str);
+        entry.m_enc_value_len = m_query_str.size() - entry.m_enc_value_pos;
+
+        if (with_sign_list) {
+            entries.push_back(entry);
+        }
+    }
+
+    if (!with_sign_list) {
+        return;
+    }
+
+    // 2. 按小写key生成签名列表
+    SortAndUnique(&entries);
+    m_param_list.reserve(m_query_str.size());
+    m_param_value_list.reserve(m_query_str.size());
+    for (std::vector<SignEntry>::const_iterator itr = entries.begin();
+         itr != entries.end(); ++itr) {
+        if (itr != entries.begin()) {
+            m_param_list.push_back(';');
+            m_param_value_list.push_back('&');
+        }
+        AppendLowerEncoded(m_query_str, itr->m_enc_key_pos, itr->m_enc_key_len, &m_param_list);
+        AppendLowerEncoded(m_query_str, itr->m_enc_key_pos, itr->m_enc_key_len,
+                           &m_param_value_list);
+        m_param_value_list.push_back('=');
+        m_param_value_list.append(m_query_str, itr->m_enc_value_pos, itr->m_enc_value_len);
+    }
+}
+
+void CanonicalRequest::BuildHeaders(const std::map<std::string, std::string>& headers) {
+    std::vector<SignEntry> entries;
+    entries.reserve(headers.size());
+    size_t raw_len = 0;
+    for (std::map<std::string, std::string>::const_iterator itr = headers.begin();
+         itr != headers.end(); ++itr) {
+        if (!IsSignHeader(itr->first)) {
+            continue;
+        }
+        SignEntry entry;
+        entry.m_key = &itr->first;
+        entry.m_value = &itr->second;
+        entries.push_back(entry);
+        raw_len += itr->first.size() + itr->second.size() + 2;
+    }
+
+    if (entries.empty()) {
+        return;
+    }
+
+    SortAndUnique(&entries);
+    m_header_list.reserve(raw_len);
+    m_header_value_list.reserve(raw_len);
+    for (std::vector<SignEntry>::const_iterator itr = entries.begin();
+         itr != entries.end(); ++itr) {
+        if (itr != entries.begin()) {
+            m_header_list.push_back(';');
+            m_header_value_list.push_back('&');
+        }
+        AppendLower(*itr->m_key, &m_header_list);
+        AppendLower(*itr->m_key, &m_header_value_list);
+        m_header_value_list.push_back('=');
+        CodecUtil::UrlEncode(*itr->m_value, &m_header_value_list);
+    }
+}
+
+} // namespace qcloud_cos
@@ -1,6 +1,5 @@
 #include "util/codec_util.h"
 
-#include <cassert>
 #include <string.h>
 
 #include <algorithm>
@@ -19,102 +18,223 @@
 
 namespace qcloud_cos {
 
-#define REVERSE_HEX(c) ( ((c) >= 'A') ? ((c) & 0xDF) - 'A' + 10 : (c) - '0' )
 #define HMAC_LENGTH 20
 
-unsigned char CodecUtil::ToHex(const unsigned char& x) {
+namespace {
+const char kHexChars[] = "0123456789ABCDEF";
+
+const char kBase64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// kCharFlags中的标记位
+const unsigned char kUrlUnreserved = 0x01;  // UrlEncode不转义的字符: 字母、数字及-_.~
+const unsigned char kKeyUnreserved = 0x02;  // EncodeKey不转义的字符: 在上面的基础上再加/
+
+// 按字节查表, 代替逐个字符调用isalnum并比较各个符号(等价于C locale下的isalnum)
+const unsigned char kCharFlags[256] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0x02,
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x03,
+    0x00, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03,
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x00, 0x00, 0x00, 0x03, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+// 16进制字符对应的值, 其他字符为0xFF
+const unsigned char kHexValues[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+// base64字符对应的6位值, 其他字符(包括填充字符=)为0xFF
+const unsigned char kBase64Values[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+// 百分号编码后追加到out之后: 先统计需要转义的字符数, 一次分配好空间再按字节写入
+void AppendPercentEncoded(const std::string& str, unsigned char unreserved_flag,
+                          std::string* out) {
+    const unsigned char* src = (const unsigned char*)str.data();
+    size_t length = str.size();
+    size_t escaped_num = 0;
+    for (size_t i = 0; i < length; ++i) {
+        escaped_num += !(kCharFlags[src[i]] & unreserved_flag);
+    }
+    if (escaped_num == 0) {
+        out->append(str);
+        return;
+    }
+
+    size_t old_size = out->size();
+    out->resize(old_size + length + escaped_num * 2);
+    char* dst = &(*out)[old_size];
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char c = src[i];
+        if (kCharFlags[c] & unreserved_flag) {
+            *dst++ = c;
+        } else {
+            dst[0] = '%';
+            dst[1] = kHexChars[c >> 4];
+            dst[2] = kHexChars[c & 15];
+            dst += 3;
+        }
+    }
+}
+} // namespace
+
+unsigned char CodecUtil::ToHex(const unsigned char&  x) {
     return x > 9 ? (x - 10 + 'A') : x + '0';
 }
 
 void CodecUtil::BinToHex(const unsigned char *bin,unsigned int binLen, char *hex) {
-    for(unsigned int i = 0; i < binLen; ++i) {
-        hex[i<<1] = ToHex(bin[i] >> 4);
-        hex[(i<<1)+1] = ToHex(bin[i] & 15 );
+    for (unsigned int i = 0; i < binLen; ++i) {
+        hex[i << 1] = kHexChars[bin[i] >> 4];
+        hex[(i << 1) + 1] = kHexChars[bin[i] & 15];
     }
 }
 
 std::string CodecUtil::EncodeKey(const std::string& key) {
-    std::string encodedKey = "";
-    std::size_t length = key.length();
-    for (size_t i = 0; i < length; ++i) {
-        if (isalnum((unsigned char)key[i]) ||
-            (key[i] == '-') ||
-            (key[i] == '_') ||
-            (key[i] == '.') ||
-            (key[i] == '~') ||
-            (key[i] == '/')) {
-            encodedKey += key[i];
-        } else {
-            encodedKey += '%';
-            encodedKey += ToHex((unsigned char)key[i] >> 4);
-            encodedKey += ToHex((unsigned char)key[i] % 16);
-        }
-    }
+    std::string encodedKey;
+    AppendPercentEncoded(key, kKeyUnreserved, &encodedKey);
     return encodedKey;
 }
 
 std::string CodecUtil::UrlEncode(const std::string& str) {
-    std::string encodedUrl = "";
-    std::size_t length = str.length();
-    for (size_t i = 0; i < length; ++i) {
-        if (isalnum((unsigned char)str[i]) ||
-            (str[i] == '-') ||
-            (str[i] == '_') ||
-            (str[i] == '.') ||
-            (str[i] == '~')) {
-
-            encodedUrl += str[i];
-        } else {
-            encodedUrl += '%';
-            encodedUrl += ToHex((unsigned char)str[i] >> 4);
-            encodedUrl += ToHex((unsigned char)str[i] % 16);
-        }
-    }
+    std::string encodedUrl;
+    UrlEncode(str, &encodedUrl);
     return encodedUrl;
 }
 
-std::string CodecUtil::Base64Encode(const std::string& plain_text) {
-    static const char b64_table[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+void CodecUtil::UrlEncode(const std::string& str, std::string* out) {
+    AppendPercentEncoded(str, kUrlUnreserved, out);
+}
 
+std::string CodecUtil::Base64Encode(const std::string& plain_text) {
+    const unsigned char* src = (const unsigned char*)plain_text.data();
     const std::size_t plain_text_len = plain_text.size();
     std::string retval((((plain_text_len + 2) / 3) * 4), '=');
-    std::size_t outpos = 0;
-    int bits_collected = 0;
-    unsigned int accumulator = 0;
-    const std::string::const_iterator plain_text_end = plain_text.end();
-
-    for (std::string::const_iterator i = plain_text.begin(); i != plain_text_end; ++i) {
-        accumulator = (accumulator << 8) | (*i & 0xffu);
-        bits_collected += 8;
-        while (bits_collected >= 6) {
-            bits_collected -= 6;
-            retval[outpos++] = b64_table[(accumulator >> bits_collected) & 0x3fu];
+    if (plain_text_len == 0) {
+        return retval;
+    }
+
+    // 每3字节一组编码为4个字符, 末尾不足3字节的部分保留预先填充的=
+    char* dst = &retval[0];
+    std::size_t i = 0;
+    for (; i + 3 <= plain_text_len; i += 3) {
+        uint32_t group = (src[i] << 16) | (src[i + 1] << 8) | src[i + 2];
+        dst[0] = kBase64Chars[group >> 18];
+        dst[1] = kBase64Chars[(group >> 12) & 0x3f];
+        dst[2] = kBase64Chars[(group >> 6) & 0x3f];
+        dst[3] = kBase64Chars[group & 0x3f];
+        dst += 4;
+    }
+
+    std::size_t rest = plain_text_len - i;
+    if (rest > 0) {
+        uint32_t group = src[i] << 16;
+        if (rest == 2) {
+            group |= src[i + 1] << 8;
+            dst[2] = kBase64Chars[(group >> 6) & 0x3f];
+        }
+        dst[0] = kBase64Chars[group >> 18];
+        dst[1] = kBase64Chars[(group >> 12) & 0x3f];
+    }
+    return retval;
+}
+
+std::string CodecUtil::Base64Decode(const std::string& encoded_text) {
+    const std::size_t encoded_len = encoded_text.size();
+    if (encoded_len == 0 || encoded_len % 4 != 0) {
+        return "";
+    }
+
+    std::size_t pad_len = 0;
+    if (encoded_text[encoded_len - 1] == '=') {
+        pad_len = encoded_text[encoded_len - 2] == '=' ? 2 : 1;
+    }
+
+    const unsigned char* src = (const unsigned char*)encoded_text.data();
+    std::string retval(encoded_len / 4 * 3 - pad_len, '\0');
+    unsigned char* dst = (unsigned char*)&retval[0];
+    // 最后一组带填充时单独处理, 其余字符中出现=视为非法
+    std::size_t full_len = pad_len > 0 ? encoded_len - 4 : encoded_len;
+    std::size_t i = 0;
+    for (; i < full_len; i += 4) {
+        unsigned char a = kBase64Values[src[i]];
+        unsigned char b = kBase64Values[src[i + 1]];
+        unsigned char c = kBase64Values[src[i + 2]];
+        unsigned char d = kBase64Values[src[i + 3]];
+        if ((a | b | c | d) & 0x80) {
+            return "";
         }
+        uint32_t group = (a << 18) | (b << 12) | (c << 6) | d;
+        dst[0] = group >> 16;
+        dst[1] = (group >> 8) & 0xff;
+        dst[2] = group & 0xff;
+        dst += 3;
     }
 
-    if (bits_collected > 0) {
-        assert(bits_collected < 6);
-        accumulator <<= 6 - bits_collected;
-        retval[outpos++] = b64_table[accumulator & 0x3fu];
+    if (pad_len > 0) {
+        unsigned char a = kBase64Values[src[i]];
+        unsigned char b = kBase64Values[src[i + 1]];
+        unsigned char c = pad_len == 1 ? kBase64Values[src[i + 2]] : 0;
+        if ((a | b | c) & 0x80) {
+            return "";
+        }
+        uint32_t group = (a << 18) | (b << 12) | (c << 6);
+        dst[0] = group >> 16;
+        if (pad_len == 1) {
+            dst[1] = (group >> 8) & 0xff;
+        }
     }
-    assert(outpos >= (retval.size() - 2));
-    assert(outpos <= retval.size());
     return retval;
 }
 
 std::string CodecUtil::HmacSha1(const std::string& plainText, const std::string& key) {
-    const EVP_MD *engine = EVP_sha1();
-    unsigned char *output = (unsigned char *)malloc(EVP_MAX_MD_SIZE);
+    // 一次性接口, 不必在堆上分配输出缓冲区和HMAC上下文
+    unsigned char output[EVP_MAX_MD_SIZE];
     unsigned int output_len = 0;
-    HMAC_CTX *ctx = HMAC_CTX_new();
-    HMAC_CTX_reset(ctx);
-    HMAC_Init_ex(ctx, (char *)key.c_str(), key.length(), engine, NULL);
-    HMAC_Update(ctx, (unsigned char*)plainText.c_str(), plainText.length());
-    HMAC_Final(ctx, output, &output_len);
-    HMAC_CTX_free(ctx);
-    std::string hmac_sha1_ret((char *)output, output_len);
-    free(output);
-    return hmac_sha1_ret;
+    HMAC(EVP_sha1(), key.data(), key.length(),
+         (const unsigned char*)plainText.data(), plainText.length(), output, &output_len);
+    return std::string((char *)output, output_len);
 }
 
 std::string CodecUtil::HmacSha1Hex(const std::string& plain_text,const std::string& key) {
@@ -140,26 +260,15 @@ std::string CodecUtil::HexToBin(const std::string &strHex) {
         return "";
     }
 
-    std::string strBin;
-    strBin.resize(strHex.size() / 2);
+    const unsigned char* src = (const unsigned char*)strHex.data();
+    std::string strBin(strHex.size() / 2, '\0');
     for (size_t i = 0; i < strBin.size(); i++) {
-        uint8_t cTmp = 0;
-        for (size_t j = 0; j < 2; j++) {
-            char cCur = strHex[2 * i + j];
-            if (cCur >= '0' && cCur <= '9') {
-                cTmp = (cTmp << 4) + (cCur - '0');
-            }
-            else if (cCur >= 'a' && cCur <= 'f') {
-                cTmp = (cTmp << 4) + (cCur - 'a' + 10);
-            }
-            else if (cCur >= 'A' && cCur <= 'F') {
-                cTmp = (cTmp << 4) + (cCur - 'A' + 10);
-            }
-            else {
-                return "";
-            }
+        unsigned char high = kHexValues[src[2 * i]];
+        unsigned char low = kHexValues[src[2 * i + 1]];
+        if ((high | low) & 0xF0) {
+            return "";
         }
-        strBin[i] = cTmp;
+        strBin[i] = (high << 4) | low;
     }
     return strBin;
 }// end of HexToBin
@@ -0,0 +1,169 @@
+#include "util/credential.h"
+
+#include <errno.h>
+#include <sys/time.h>
+
+#include <exception>
+
+#include "cos_sys_config.h"
+#include "util/http_sender.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 被替换的快照保留的时间, 远大于一次组包和签名的耗时
+const uint64_t kRetiredKeepTimeInS = 60;
+
+// 获取密钥失败后的重试间隔
+const uint64_t kRefreshRetryIntervalInS = 5;
+
+uint64_t GetTimeStampInS() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec;
+}
+} // namespace
+
+AtomicCredential::AtomicCredential() : m_current(new Credential()) {
+}
+
+AtomicCredential::~AtomicCredential() {
+    delete m_current;
+    for (std::deque<RetiredCredential>::iterator itr = m_retired.begin();
+         itr != m_retired.end(); ++itr) {
+        delete itr->m_credential;
+    }
+}
+
+void AtomicCredential::Set(const Credential& credential) {
+    const Credential* new_credential = new Credential(credential);
+    // 保留时间按单调时钟计算, 系统时间跳变时不会提前释放读者仍在使用的快照
+    uint64_t now_in_s = HttpSender::GetMonotonicTimeInUs() / 1000000;
+
+    SimpleMutexLocker locker(&m_mutex);
+    RetiredCredential retired;
+    retired.m_credential = __atomic_exchange_n(&m_current, new_credential, __ATOMIC_ACQ_REL);
+    retired.m_retired_time_in_s = now_in_s;
+    m_retired.push_back(retired);
+
+    // 读者已不可能再持有超过保留时间的快照
+    while (!m_retired.empty()
+           && m_retired.front().m_retired_time_in_s + kRetiredKeepTimeInS < now_in_s) {
+        delete m_retired.front().m_credential;
+        m_retired.pop_front();
+    }
+}
+
+CredentialRefresher::CredentialRefresher(const Poco::SharedPtr<CredentialProvider>& provider,
+                                         AtomicCredential* credential,
+                                         uint64_t refresh_ahead_in_s)
+    : m_provider(provider), m_credential(credential),
+      m_refresh_ahead_in_s(refresh_ahead_in_s), m_started(false), m_stopping(false) {
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+}
+
+CredentialRefresher::~CredentialRefresher() {
+    pthread_mutex_lock(&m_mutex);
+    m_stopping = true;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    if (m_started) {
+        pthread_join(m_tid, NULL);
+    }
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool CredentialRefresher::Start() {
+    if (m_started) {
+        return true;
+    }
+
+    if (!Refresh()) {
+        return false;
+    }
+
+    int ret = pthread_create(&m_tid, NULL, ThreadEntry, this);
+    if (ret != 0) {
+        SDK_LOG_ERR("Create credential refresh thread fail, ret=%d", ret);
+        return false;
+    }
+    m_started = true;
+    return true;
+}
+
+void* CredentialRefresher::ThreadEntry(void* arg) {
+    static_cast<CredentialRefresher*>(arg)->Run();
+    return NULL;
+}
+
+void CredentialRefresher::Run() {
+    uint64_t delay_in_s = GetRefreshDelayInSec();
+    pthread_mutex_lock(&m_mutex);
+    while (!m_stopping) {
+        if (delay_in_s == 0) {
+            // 永久密钥不需要刷新, 等待退出
+            pthread_cond_wait(&m_cond, &m_mutex);
+            continue;
+        }
+
+        struct timespec abstime;
+        abstime.tv_sec = GetTimeStampInS() + delay_in_s;
+        abstime.tv_nsec = 0;
+        int ret = 0;
+        while (!m_stopping && ret != ETIMEDOUT) {
+            ret = pthread_cond_timedwait(&m_cond, &m_mutex, &abstime);
+        }
+        if (m_stopping) {
+            break;
+        }
+
+        pthread_mutex_unlock(&m_mutex);
+        if (Refresh()) {
+            delay_in_s = GetRefreshDelayInSec();
+        } else {
+            delay_in_s = kRefreshRetryIntervalInS;
+        }
+        pthread_mutex_lock(&m_mutex);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+bool CredentialRefresher::Refresh() {
+    Credential credential;
+    bool succ = false;
+    try {
+        succ = m_provider->FetchCredential(&credential);
+    } catch (const std::exception& ex) {
+        SDK_LOG_ERR("Fetch credential throw exception, %s", ex.what());
+    } catch (...) {
+        SDK_LOG_ERR("Fetch credential throw unknown exception");
+    }
+
+    if (!succ || credential.GetAccessKey().empty() || credential.GetSecretKey().empty()) {
+        SDK_LOG_ERR("Fetch credential fail, retry in %lu seconds", kRefreshRetryIntervalInS);
+        return false;
+    }
+
+    m_credential->Set(credential);
+    SDK_LOG_INFO("Credential refreshed, expired_time=%lu", credential.GetExpiredTimeInSec());
+    return true;
+}
+
+uint64_t CredentialRefresher::GetRefreshDelayInSec() const {
+    uint64_t expired_time_in_s = m_credential->Get()->GetExpiredTimeInSec();
+    if (expired_time_in_s == 0) {
+        return 0;
+    }
+
+    uint64_t now_in_s = GetTimeStampInS();
+    uint64_t remain_in_s = expired_time_in_s > now_in_s ? expired_time_in_s - now_in_s : 0;
+    // 有效期短于提前量时, 在剩余有效期过半时刷新
+    uint64_t delay_in_s = remain_in_s > m_refresh_ahead_in_s * 2
+        ? remain_in_s - m_refresh_ahead_in_s : remain_in_s / 2;
+    return delay_in_s > 0 ? delay_in_s : 1;
+}
+
+} // namespace qcloud_cos
@@ -0,0 +1,868 @@
+#include "util/curl_http_transport.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "Poco/MD5Engine.h"
+#include "Poco/URI.h"
+
+#include "cos_sys_config.h"
+#include "util/body_source.h"
+#include "util/codec_util.h"
+#include "util/http_sender.h"
+#include "util/string_util.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 事件循环单次poll的最长等待时间, 也是检查请求是否被取消的间隔
+const int kPollIntervalInms = 100;
+
+// 每个传输的请求体/响应体缓冲区大小, 请求体剩余不足一半时由调用线程补充
+const size_t kBodyBufferSize = 256 * 1024;
+
+const char kTransportStoppedErrMsg[] = "transport is stopped";
+
+pthread_once_t s_curl_init_once = PTHREAD_ONCE_INIT;
+
+// curl_global_init不是线程安全的, 只在创建第一个传输层时调用一次
+void InitCurl() {
+    curl_global_init(CURL_GLOBAL_ALL);
+}
+
+void SetErrBuf(char* err_buf, const char* msg) {
+    strncpy(err_buf, msg, CURL_ERROR_SIZE - 1);
+    err_buf[CURL_ERROR_SIZE - 1] = '\0';
+}
+
+// 与poco传输层的异常信息保持一致, RetryPolicy据此判断能否重试
+const char* GetErrPrefix(CURLcode code) {
+    switch (code) {
+    case CURLE_OPERATION_TIMEDOUT:
+        return "TimeoutException:";
+    case CURLE_UNSUPPORTED_PROTOCOL:
+    case CURLE_FAILED_INIT:
+    case CURLE_URL_MALFORMAT:
+    case CURLE_OUT_OF_MEMORY:
+    case CURLE_WRITE_ERROR:
+    case CURLE_READ_ERROR:
+    case CURLE_ABORTED_BY_CALLBACK:
+    case CURLE_BAD_FUNCTION_ARGUMENT:
+        return "Exception:";
+    default:
+        return "Net Exception:";
+    }
+}
+} // namespace
+
+// 一次传输的全部状态, 由调用线程创建并持有
+// 请求体/响应体经由缓冲区在调用线程与事件循环线程之间传递, 缓冲区及标记m_mutex的字段由m_mutex保护,
+// 其余字段在传输期间只由事件循环线程访问
+struct CurlHttpTransport::Transfer {
+    Transfer(RequestContext* ctx, RequestTiming* timing)
+        : m_easy(NULL), m_header_list(NULL), m_ctx(ctx), m_timing(timing),
+          m_req_body(NULL), m_body_len(-1), m_body_done_in_us(0), m_is_upload(false),
+          m_send_offset(0), m_fill_bytes(0), m_is_body_eof(false), m_is_rewind_needed(false),
+          m_body_generation(0), m_is_read_paused(false), m_is_write_paused(false),
+          m_is_write_failed(false), m_resp_headers(NULL), m_resp_stream(NULL),
+          m_xml_err_str(NULL), m_http_code(0), m_is_check_md5(false), m_is_md5_enabled(false),
+          m_is_cancelled(false), m_body_bytes(0), m_start_in_us(0), m_is_done(false),
+          m_result(CURLE_OK) {
+        m_err_buf[0] = '\0';
+        *m_timing = RequestTiming();
+        m_timing->m_request_num = 1;
+        pthread_mutex_init(&m_mutex, NULL);
+        pthread_cond_init(&m_cond, NULL);
+    }
+
+    ~Transfer() {
+        if (m_easy != NULL) {
+            curl_easy_cleanup(m_easy);
+        }
+        if (m_header_list != NULL) {
+            curl_slist_free_all(m_header_list);
+        }
+        pthread_cond_destroy(&m_cond);
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    // 下载请求只有200/206的响应体写入resp_stream, 错误响应写入xml_err_str
+    bool IsWriteToStream() const {
+        return m_xml_err_str == NULL || m_http_code == 200 || m_http_code == 206;
+    }
+
+    // 调用线程需要补充请求体
+    bool IsFillNeeded() const {
+        return m_is_upload && !m_is_body_eof && m_body_err_msg.empty()
+            && m_send_buf.size() - m_send_offset <= kBodyBufferSize / 2;
+    }
+
+    // 调用线程有待处理的工作, 传输结束后仍需先取走剩余的响应体
+    bool HasCallerWork() const {
+        return !m_recv_buf.empty() || m_is_done || m_is_rewind_needed || IsFillNeeded();
+    }
+
+    static size_t OnReadBody(char* buf, size_t size, size_t nitems, void* userdata);
+
+    static int OnSeekBody(void* userdata, curl_off_t offset, int origin);
+
+    static size_t OnHeader(char* buf, size_t size, size_t nitems, void* userdata);
+
+    static size_t OnWriteBody(char* buf, size_t size, size_t nmemb, void* userdata);
+
+    CURL* m_easy;
+    curl_slist* m_header_list;
+    char m_err_buf[CURL_ERROR_SIZE];
+    RequestContext* m_ctx;
+    RequestTiming* m_timing;
+
+    BodySource* m_req_body;             // 只由调用线程读取
+    int64_t m_body_len;                 // chunked上传时为-1
+    std::string m_body_err_msg;         // m_mutex, 读取请求体时抛出的异常
+    uint64_t m_body_done_in_us;
+    bool m_is_upload;
+
+    // 请求体缓冲区, 调用线程从m_req_body读入, 事件循环线程在OnReadBody中取走, 均由m_mutex保护
+    std::string m_send_buf;
+    size_t m_send_offset;               // m_send_buf中已被curl取走的字节数
+    uint64_t m_fill_bytes;              // 调用线程已从m_req_body读出的字节数
+    bool m_is_body_eof;
+    bool m_is_rewind_needed;            // curl要求重发请求体, 调用线程需回到起始位置
+    unsigned m_body_generation;         // 每次重发时加1, 丢弃重发前读出的数据
+    bool m_is_read_paused;              // 缓冲区为空时暂停发送, 补充后由事件循环恢复
+
+    // 响应体缓冲区, 事件循环线程在OnWriteBody中写入, 调用线程取走后写入resp_stream, 均由m_mutex保护
+    std::string m_recv_buf;
+    bool m_is_write_paused;             // 缓冲区已满时暂停接收, 取走后由事件循环恢复
+    bool m_is_write_failed;
+
+    std::map<std::string, std::string>* m_resp_headers;
+    std::map<std::string, std::string> m_headers;   // 最终响应的头部, 结束后合并到m_resp_headers
+    std::ostream* m_resp_stream;        // 只由调用线程写入
+    std::string* m_xml_err_str;         // 只由调用线程写入
+    int m_http_code;                    // m_mutex
+    std::string m_etag;
+    bool m_is_check_md5;
+    bool m_is_md5_enabled;              // m_mutex, 收到响应头后根据ETag确定是否需要校验
+    Poco::MD5Engine m_md5;              // 只由调用线程更新
+    bool m_is_cancelled;
+    uint64_t m_body_bytes;              // 只由调用线程更新
+    uint64_t m_start_in_us;
+
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    bool m_is_done;
+    CURLcode m_result;
+};
+
+size_t CurlHttpTransport::Transfer::OnReadBody(char* buf, size_t size, size_t nitems,
+                                               void* userdata) {
+    // 只从缓冲区拷贝, 缓冲区为空时暂停发送, 由调用线程读取m_req_body后补充
+    Transfer* transfer = static_cast<Transfer*>(userdata);
+    size_t len = size * nitems;
+    size_t ret = 0;
+    pthread_mutex_lock(&transfer->m_mutex);
+    size_t remain = transfer->m_send_buf.size() - transfer->m_send_offset;
+    if (!transfer->m_body_err_msg.empty()) {
+        ret = CURL_READFUNC_ABORT;
+    } else if (remain > 0) {
+        ret = std::min(len, remain);
+        memcpy(buf, transfer->m_send_buf.data() + transfer->m_send_offset, ret);
+        transfer->m_send_offset += ret;
+        RequestTiming* timing = transfer->m_timing;
+        timing->m_bytes_sent += ret;
+        bool is_all_sent = (transfer->m_is_body_eof && remain == ret) || (transfer->m_body_len >= 0
+            && timing->m_bytes_sent >= static_cast<uint64_t>(transfer->m_body_len));
+        if (is_all_sent) {
+            transfer->m_body_done_in_us = HttpSender::GetMonotonicTimeInUs();
+        } else if (transfer->IsFillNeeded()) {
+            pthread_cond_signal(&transfer->m_cond);
+        }
+    } else if (transfer->m_is_body_eof) {
+        if (transfer->m_body_done_in_us == 0) {
+            transfer->m_body_done_in_us = HttpSender::GetMonotonicTimeInUs();
+        }
+        ret = 0;
+    } else {
+        transfer->m_is_read_paused = true;
+        pthread_cond_signal(&transfer->m_cond);
+        ret = CURL_READFUNC_PAUSE;
+    }
+    pthread_mutex_unlock(&transfer->m_mutex);
+    return ret;
+}
+
+int CurlHttpTransport::Transfer::OnSeekBody(void* userdata, curl_off_t offset, int origin) {
+    // curl需要重发请求体时(如服务端在100 Continue前关闭连接)回到起始位置
+    // 丢弃已缓冲的数据, 由调用线程Rewind后重新补充, 在此之前OnReadBody会暂停发送
+    Transfer* transfer = static_cast<Transfer*>(userdata);
+    if (offset != 0 || origin != SEEK_SET) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    pthread_mutex_lock(&transfer->m_mutex);
+    transfer->m_send_buf.clear();
+    transfer->m_send_offset = 0;
+    transfer->m_fill_bytes = 0;
+    transfer->m_is_body_eof = false;
+    transfer->m_is_rewind_needed = true;
+    ++transfer->m_body_generation;
+    transfer->m_timing->m_bytes_sent = 0;
+    transfer->m_body_done_in_us = 0;
+    pthread_cond_signal(&transfer->m_cond);
+    pthread_mutex_unlock(&transfer->m_mutex);
+    return CURL_SEEKFUNC_OK;
+}
+
+size_t CurlHttpTransport::Transfer::OnHeader(char* buf, size_t size, size_t nitems,
+                                             void* userdata) {
+    Transfer* transfer = static_cast<Transfer*>(userdata);
+    size_t len = size * nitems;
+    std::string line(buf, len);
+    while (!line.empty() && (line[line.size() - 1] == '\r' || line[line.size() - 1] == '\n')) {
+        line.erase(line.size() - 1);
+    }
+
+    if (StringUtil::StringStartsWith(line, "HTTP/")) {
+        // 新的状态行(如100 Continue之后的最终响应), 丢弃之前的头部
+        transfer->m_headers.clear();
+        return len;
+    }
+    if (!line.empty()) {
+        size_t pos = line.find(':');
+        if (pos != std::string::npos) {
+            std::string name = line.substr(0, pos);
+            std::string value = line.substr(pos + 1);
+            transfer->m_headers.insert(std::make_pair(StringUtil::Trim(name),
+                                                      StringUtil::Trim(value)));
+        }
+        return len;
+    }
+
+    // 空行表示头部结束, 1xx中间响应之后还会收到最终响应
+    long http_code = 0;
+    curl_easy_getinfo(transfer->m_easy, CURLINFO_RESPONSE_CODE, &http_code);
+    if (http_code < 200) {
+        return len;
+    }
+    pthread_mutex_lock(&transfer->m_mutex);
+    transfer->m_http_code = static_cast<int>(http_code);
+    pthread_mutex_unlock(&transfer->m_mutex);
+    if (transfer->m_ctx != NULL && !transfer->m_ctx->OnResponseHeader()) {
+        transfer->m_is_cancelled = true;
+        return 0;
+    }
+
+    std::map<std::string, std::string>::const_iterator etag_itr
+        = transfer->m_headers.find("ETag");
+    if (etag_itr != transfer->m_headers.end()) {
+        transfer->m_etag = StringUtil::Trim(etag_itr->second, "\"");
+    }
+    pthread_mutex_lock(&transfer->m_mutex);
+    transfer->m_is_md5_enabled = transfer->m_is_check_md5 && transfer->IsWriteToStream()
+        && !StringUtil::IsV4ETag(transfer->m_etag)
+        && !StringUtil::IsMultipartUploadETag(transfer->m_etag);
+    pthread_mutex_unlock(&transfer->m_mutex);
+    return len;
+}
+
+size_t CurlHttpTransport::Transfer::OnWriteBody(char* buf, size_t size, size_t nmemb,
+                                                void* userdata) {
+    // 只拷贝到缓冲区, 由调用线程写入resp_stream; 缓冲区已满时暂停接收, curl保留本次的数据
+    Transfer* transfer = static_cast<Transfer*>(userdata);
+    size_t len = size * nmemb;
+    size_t ret = len;
+    pthread_mutex_lock(&transfer->m_mutex);
+    std::string& recv_buf = transfer->m_recv_buf;
+    if (transfer->m_is_write_failed) {
+        ret = 0;
+    } else if (!recv_buf.empty() && recv_buf.size() + len > kBodyBufferSize) {
+        transfer->m_is_write_paused = true;
+        ret = CURL_WRITEFUNC_PAUSE;
+    } else {
+        if (recv_buf.empty()) {
+            pthread_cond_signal(&transfer->m_cond);
+        }
+        recv_buf.append(buf, len);
+    }
+    pthread_mutex_unlock(&transfer->m_mutex);
+    return ret;
+}
+
+CurlHttpTransport::CurlHttpTransport()
+    : m_multi(NULL), m_share(NULL), m_loop_started(false), m_stopping(false) {
+    pthread_once(&s_curl_init_once, InitCurl);
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_mutex_init(&m_share_mutex, NULL);
+
+    m_share = curl_share_init();
+    if (m_share != NULL) {
+        curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, LockShare);
+        curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, UnlockShare);
+        curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    m_multi = curl_multi_init();
+    if (m_multi == NULL) {
+        SDK_LOG_ERR("Init curl multi handle fail");
+        m_stopping = true;
+        return;
+    }
+    // 连接缓存的总上限, 超出时关闭最久未用的连接
+    curl_multi_setopt(m_multi, CURLMOPT_MAXCONNECTS,
+                      static_cast<long>(CosSysConfig::GetMaxIdleSessionsPerHost()));
+
+    if (pthread_create(&m_loop_tid, NULL, LoopEntry, this) != 0) {
+        SDK_LOG_ERR("Create curl event loop thread fail");
+        m_stopping = true;
+        return;
+    }
+    m_loop_started = true;
+}
+
+CurlHttpTransport::~CurlHttpTransport() {
+    pthread_mutex_lock(&m_mutex);
+    m_stopping = true;
+    pthread_mutex_unlock(&m_mutex);
+    if (m_loop_started) {
+        curl_multi_wakeup(m_multi);
+        pthread_join(m_loop_tid, NULL);
+    }
+    if (m_multi != NULL) {
+        curl_multi_cleanup(m_multi);
+    }
+    if (m_share != NULL) {
+        curl_share_cleanup(m_share);
+    }
+    pthread_mutex_destroy(&m_share_mutex);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+int CurlHttpTransport::SendRequest(const std::string& http_method,
+                                   const std::string& url_str,
+                                   const CanonicalRequest& req_params,
+                                   const std::map<std::string, std::string>& req_headers,
+                                   BodySource& req_body,
+                                   uint64_t conn_timeout_in_ms,
+                                   uint64_t recv_timeout_in_ms,
+                                   std::map<std::string, std::string>* resp_headers,
+                                   std::ostream& resp_stream,
+                                   std::string* err_msg,
+                                   bool is_check_md5,
+                                   RequestContext* ctx) {
+    RequestTiming local_timing;
+    Transfer transfer(ctx, ctx != NULL ? ctx->MutableTiming() : &local_timing);
+    transfer.m_req_body = &req_body;
+    transfer.m_resp_headers = resp_headers;
+    transfer.m_resp_stream = &resp_stream;
+    transfer.m_is_check_md5 = is_check_md5;
+    if (!SetupTransfer(&transfer, http_method, url_str, req_params, req_headers,
+                       conn_timeout_in_ms, recv_timeout_in_ms,
+                       ctx != NULL && ctx->IsDecodeGzip(),
+                       err_msg)) {
+        return -1;
+    }
+
+    Perform(&transfer);
+    return FinishTransfer(&transfer, err_msg);
+}
+
+int CurlHttpTransport::SendRequest(const std::string& http_method,
+                                   const std::string& url_str,
+                                   const CanonicalRequest& req_params,
+                                   const std::map<std::string, std::string>& req_headers,
+                                   const std::string& req_body,
+                                   uint64_t conn_timeout_in_ms,
+                                   uint64_t recv_timeout_in_ms,
+                                   std::map<std::string, std::string>* resp_headers,
+                                   std::string* xml_err_str,
+                                   std::ostream& resp_stream,
+                                   std::string* err_msg,
+                                   uint64_t* real_byte,
+                                   bool is_check_md5,
+                                   RequestContext* ctx) {
+    BufferBodySource body(req_body);
+    RequestTiming local_timing;
+    Transfer transfer(ctx, ctx != NULL ? ctx->MutableTiming() : &local_timing);
+    transfer.m_req_body = &body;
+    transfer.m_resp_headers = resp_headers;
+    transfer.m_resp_stream = &resp_stream;
+    transfer.m_xml_err_str = xml_err_str;
+    transfer.m_is_check_md5 = is_check_md5;
+    // 下载的数据原样写入, 不因Accept-Encoding而解压
+    if (!SetupTransfer(&transfer, http_method, url_str, req_params, req_headers,
+                       conn_timeout_in_ms, recv_timeout_in_ms, false, err_msg)) {
+        return -1;
+    }
+
+    Perform(&transfer);
+    int ret = FinishTransfer(&transfer, err_msg);
+    *real_byte = transfer.m_body_bytes;
+    return ret;
+}
+
+bool CurlHttpTransport::SetupTransfer(Transfer* transfer,
+                                      const std::string& http_method,
+                                      const std::string& url_str,
+                                      const CanonicalRequest& req_params,
+                                      const std::map<std::string, std::string>& req_headers,
+                                      uint64_t conn_timeout_in_ms,
+                                      uint64_t recv_timeout_in_ms,
+                                      bool is_decode_gzip,
+                                      std::string* err_msg) {
+    std::string full_url;
+    try {
+        Poco::URI url(url_str);
+        std::string path = url.getPath();
+        if (path.empty()) {
+            path += "/";
+        }
+        full_url = url.getScheme() + "://" + url.getAuthority()
+            + CodecUtil::EncodeKey(path) + req_params.GetQueryString();
+    } catch (const std::exception& ex) {
+        SDK_LOG_ERR("Exception:%s", ex.what());
+        *err_msg = "Exception:" + std::string(ex.what());
+        return false;
+    }
+
+    CURL* easy = curl_easy_init();
+    if (easy == NULL) {
+        *err_msg = "Exception:init curl easy handle fail";
+        return false;
+    }
+    transfer->m_easy = easy;
+
+    // 1. 基本选项, path已按COS的规则编码, 不允许curl再做规范化
+    curl_easy_setopt(easy, CURLOPT_URL, full_url.c_str());
+    curl_easy_setopt(easy, CURLOPT_PATH_AS_IS, 1L);
+    curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer);
+    curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, transfer->m_err_buf);
+    if (m_share != NULL) {
+        curl_easy_setopt(easy, CURLOPT_SHARE, m_share);
+    }
+
+    // 2. 超时与连接复用, 接收超时与poco一致, 指连续多久收不到数据
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(conn_timeout_in_ms));
+    curl_easy_setopt(easy, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(easy, CURLOPT_LOW_SPEED_TIME,
+                     static_cast<long>((recv_timeout_in_ms + 999) / 1000));
+    curl_easy_setopt(easy, CURLOPT_TCP_NODELAY, 1L);
+    if (CosSysConfig::GetKeepAlive()) {
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPIDLE,
+                         static_cast<long>(CosSysConfig::GetKeepIdle()));
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPINTVL,
+                         static_cast<long>(CosSysConfig::GetKeepIntvl()));
+    } else {
+        curl_easy_setopt(easy, CURLOPT_FORBID_REUSE, 1L);
+    }
+    // libcurl自带DNS缓存且连接失败时会尝试下一个地址, 只需对齐缓存时间并打乱地址顺序
+    if (CosSysConfig::IsDnsCacheEnable()) {
+        curl_easy_setopt(easy, CURLOPT_DNS_CACHE_TIMEOUT,
+                         static_cast<long>((CosSysConfig::GetDnsCacheTtlInms() + 999) / 1000));
+        curl_easy_setopt(easy, CURLOPT_DNS_SHUFFLE_ADDRESSES, 1L);
+    }
+
+    // 3. 请求方法与请求体
+    BodySource& req_body = *transfer->m_req_body;
+    const char* method = http_method.c_str();
+    bool is_chunked = req_body.IsChunked();
+    uint64_t body_len = is_chunked ? 0 : req_body.GetLength();
+    curl_slist* header_list = NULL;
+    if (!strcasecmp(method, "HEAD")) {
+        curl_easy_setopt(easy, CURLOPT_NOBODY, 1L);
+    } else if (!strcasecmp(method, "GET") && !is_chunked && body_len == 0) {
+        curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+    } else {
+        transfer->m_is_upload = true;
+        curl_easy_setopt(easy, CURLOPT_UPLOAD, 1L);
+        curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, method);
+        curl_easy_setopt(easy, CURLOPT_READFUNCTION, Transfer::OnReadBody);
+        curl_easy_setopt(easy, CURLOPT_READDATA, transfer);
+        curl_easy_setopt(easy, CURLOPT_SEEKFUNCTION, Transfer::OnSeekBody);
+        curl_easy_setopt(easy, CURLOPT_SEEKDATA, transfer);
+        // 不设置长度时curl以chunked编码发送
+        if (!is_chunked) {
+            transfer->m_body_len = static_cast<int64_t>(body_len);
+            curl_easy_setopt(easy, CURLOPT_INFILESIZE_LARGE, static_cast<curl_off_t>(body_len));
+        }
+        // curl默认对大于1M的请求体使用100-continue, 这里改为与poco一致由配置决定
+        if (ShouldExpectContinue(req_body)) {
+            header_list = curl_slist_append(header_list, "Expect: 100-continue");
+            curl_easy_setopt(easy, CURLOPT_EXPECT_100_TIMEOUT_MS,
+                             static_cast<long>(CosSysConfig::GetExpectContinueTimeoutInms()));
+        } else {
+            header_list = curl_slist_append(header_list, "Expect:");
+        }
+    }
+
+    // 4. 请求头, 值为空的头部在curl中须写作"Name;"
+    for (std::map<std::string, std::string>::const_iterator c_itr = req_headers.begin();
+         c_itr != req_headers.end(); ++c_itr) {
+        std::string line = c_itr->second.empty() ? c_itr->first + ";"
+                                                 : c_itr->first + ": " + c_itr->second;
+        header_list = curl_slist_append(header_list, line.c_str());
+    }
+    transfer->m_header_list = header_list;
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, header_list);
+    if (is_decode_gzip) {
+        // 请求头中已有Accept-Encoding, 此处只开启curl的自动解压
+        curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, "gzip");
+    }
+
+    // 5. 响应回调
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, Transfer::OnHeader);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, transfer);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, Transfer::OnWriteBody);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, transfer);
+    return true;
+}
+
+void CurlHttpTransport::Perform(Transfer* transfer) {
+    pthread_mutex_lock(&m_mutex);
+    if (m_stopping) {
+        pthread_mutex_unlock(&m_mutex);
+        SetErrBuf(transfer->m_err_buf, kTransportStoppedErrMsg);
+        transfer->m_result = CURLE_FAILED_INIT;
+        return;
+    }
+    m_pending_transfers.push_back(transfer);
+    pthread_mutex_unlock(&m_mutex);
+    curl_multi_wakeup(m_multi);
+
+    // 读取请求体和写入响应体都在调用线程中进行, 慢速的BodySource或resp_stream不会阻塞事件循环
+    std::string data;
+    pthread_mutex_lock(&transfer->m_mutex);
+    for (;;) {
+        while (!transfer->HasCallerWork()) {
+            pthread_cond_wait(&transfer->m_cond, &transfer->m_mutex);
+        }
+
+        if (!transfer->m_recv_buf.empty()) {
+            data.clear();
+            data.swap(transfer->m_recv_buf);
+            pthread_mutex_unlock(&transfer->m_mutex);
+            bool is_write_ok = WriteResponseBody(transfer, data);
+            pthread_mutex_lock(&transfer->m_mutex);
+            if (!is_write_ok) {
+                transfer->m_is_write_failed = true;
+            }
+        } else if (transfer->m_is_done) {
+            break;
+        } else if (transfer->m_is_rewind_needed) {
+            transfer->m_is_rewind_needed = false;
+            pthread_mutex_unlock(&transfer->m_mutex);
+            std::string err_msg;
+            try {
+                if (!transfer->m_req_body->Rewind()) {
+                    err_msg = "Request body can not be rewound";
+                }
+            } catch (const std::exception& ex) {
+                err_msg = ex.what();
+            }
+            pthread_mutex_lock(&transfer->m_mutex);
+            if (!err_msg.empty()) {
+                transfer->m_body_err_msg = err_msg;
+            }
+        } else {
+            FillRequestBody(transfer, &data);
+        }
+
+        // 缓冲区已补充或取走, 由事件循环恢复暂停的传输
+        if (transfer->m_is_read_paused || transfer->m_is_write_paused) {
+            curl_multi_wakeup(m_multi);
+        }
+    }
+    pthread_mutex_unlock(&transfer->m_mutex);
+}
+
+void CurlHttpTransport::FillRequestBody(Transfer* transfer, std::string* buf) {
+    unsigned generation = transfer->m_body_generation;
+    uint64_t fill_bytes = transfer->m_fill_bytes;
+    size_t len = kBodyBufferSize - (transfer->m_send_buf.size() - transfer->m_send_offset);
+    pthread_mutex_unlock(&transfer->m_mutex);
+
+    buf->resize(len);
+    size_t n = 0;
+    bool is_eof = false;
+    std::string err_msg;
+    try {
+        n = transfer->m_req_body->Read(&(*buf)[0], len);
+        is_eof = n == 0 || (transfer->m_body_len >= 0
+            && fill_bytes + n >= static_cast<uint64_t>(transfer->m_body_len));
+        if (is_eof && n > 0) {
+            // 已读满声明的长度, 再读一次确认结束, Md5BodySource在读到结尾时生成摘要
+            char probe = 0;
+            if (transfer->m_req_body->Read(&probe, 1) != 0) {
+                err_msg = "Request body is longer than its length";
+            }
+        }
+    } catch (const std::exception& ex) {
+        err_msg = ex.what();
+    }
+
+    pthread_mutex_lock(&transfer->m_mutex);
+    if (generation != transfer->m_body_generation) {
+        // 读取期间curl要求重发, 本次读出的数据作废
+        return;
+    }
+    if (!err_msg.empty()) {
+        transfer->m_body_err_msg = err_msg;
+        return;
+    }
+    transfer->m_send_buf.erase(0, transfer->m_send_offset);
+    transfer->m_send_offset = 0;
+    transfer->m_send_buf.append(buf->data(), n);
+    transfer->m_fill_bytes += n;
+    transfer->m_is_body_eof = is_eof;
+}
+
+bool CurlHttpTransport::WriteResponseBody(Transfer* transfer, const std::string& data) {
+    pthread_mutex_lock(&transfer->m_mutex);
+    bool is_write_to_stream = transfer->IsWriteToStream();
+    bool is_md5_enabled = transfer->m_is_md5_enabled;
+    pthread_mutex_unlock(&transfer->m_mutex);
+
+    transfer->m_body_bytes += data.size();
+    if (!is_write_to_stream) {
+        transfer->m_xml_err_str->append(data);
+        return true;
+    }
+    if (is_md5_enabled) {
+        transfer->m_md5.update(data.data(), data.size());
+    }
+    transfer->m_resp_stream->write(data.data(), data.size());
+    return transfer->m_resp_stream->good();
+}
+
+int CurlHttpTransport::FinishTransfer(Transfer* transfer, std::string* err_msg) {
+    // 1. 由curl记录的各时间点(自传输开始起的微秒数)换算各阶段耗时
+    curl_off_t dns_time = 0;
+    curl_off_t connect_time = 0;
+    curl_off_t tls_time = 0;
+    curl_off_t pretransfer_time = 0;
+    curl_off_t first_byte_time = 0;
+    curl_off_t total_time = 0;
+    curl_off_t size_download = 0;
+    long new_connect_num = 0;
+    CURL* easy = transfer->m_easy;
+    curl_easy_getinfo(easy, CURLINFO_NAMELOOKUP_TIME_T, &dns_time);
+    curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME_T, &connect_time);
+    curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME_T, &tls_time);
+    curl_easy_getinfo(easy, CURLINFO_PRETRANSFER_TIME_T, &pretransfer_time);
+    curl_easy_getinfo(easy, CURLINFO_STARTTRANSFER_TIME_T, &first_byte_time);
+    curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME_T, &total_time);
+    curl_easy_getinfo(easy, CURLINFO_SIZE_DOWNLOAD_T, &size_download);
+    curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &new_connect_num);
+
+    RequestTiming* timing = transfer->m_timing;
+    if (new_connect_num > 0) {
+        timing->m_new_session_num = 1;
+        timing->m_dns_time_in_us = dns_time;
+        timing->m_connect_time_in_us = connect_time > dns_time ? connect_time - dns_time : 0;
+        timing->m_tls_time_in_us = tls_time > connect_time ? tls_time - connect_time : 0;
+    }
+    if (total_time == 0 && transfer->m_start_in_us > 0) {
+        // 被取消或中止的传输没有总耗时
+        total_time = HttpSender::GetMonotonicTimeInUs() - transfer->m_start_in_us;
+    }
+    curl_off_t sent_time = pretransfer_time;
+    if (transfer->m_body_done_in_us > transfer->m_start_in_us + pretransfer_time) {
+        sent_time = transfer->m_body_done_in_us - transfer->m_start_in_us;
+    }
+    timing->m_send_time_in_us = sent_time - pretransfer_time;
+    timing->m_first_byte_time_in_us = first_byte_time > sent_time
+        ? first_byte_time - sent_time : 0;
+    timing->m_recv_time_in_us = total_time > first_byte_time && first_byte_time > 0
+        ? total_time - first_byte_time : 0;
+    timing->m_total_time_in_us = total_time;
+    timing->m_bytes_received = size_download;
+
+    // 2. 错误处理
+    if (transfer->m_is_cancelled) {
+        SDK_LOG_INFO("Request cancelled, status=%d", transfer->m_http_code);
+        *err_msg = kCancelledErrMsg;
+        return -1;
+    }
+    if (!transfer->m_body_err_msg.empty()) {
+        SDK_LOG_ERR("Exception:%s", transfer->m_body_err_msg.c_str());
+        *err_msg = "Exception:" + transfer->m_body_err_msg;
+        return -1;
+    }
+    if (transfer->m_is_write_failed) {
+        *err_msg = "Exception:write response body fail";
+        SDK_LOG_ERR("%s", err_msg->c_str());
+        return -1;
+    }
+    if (transfer->m_result != CURLE_OK) {
+        std::string detail = transfer->m_err_buf[0] != '\0'
+            ? transfer->m_err_buf : curl_easy_strerror(transfer->m_result);
+        *err_msg = GetErrPrefix(transfer->m_result) + detail;
+        SDK_LOG_ERR("%s", err_msg->c_str());
+        return -1;
+    }
+
+    // 3. 处理返回
+    int ret = transfer->m_http_code;
+    transfer->m_resp_headers->insert(transfer->m_headers.begin(), transfer->m_headers.end());
+    if (transfer->m_is_md5_enabled) {
+        std::string md5_str = Poco::DigestEngine::digestToHex(transfer->m_md5.digest());
+        if (transfer->m_etag != md5_str) {
+            *err_msg = "Md5 of response body is not equal to the etag in the header."
+                " Body Md5= " + md5_str + ", etag=" + transfer->m_etag;
+            SDK_LOG_ERR("Check Md5 fail, %s", err_msg->c_str());
+            ret = -1;
+        }
+    }
+
+#ifdef __COS_DEBUG__
+    SDK_LOG_DBG("response header :\n");
+    for (std::map<std::string, std::string>::const_iterator itr = transfer->m_headers.begin();
+         itr != transfer->m_headers.end(); ++itr) {
+        SDK_LOG_DBG("key=[%s], value=[%s]\n", itr->first.c_str(), itr->second.c_str());
+    }
+#endif
+    SDK_LOG_INFO("Send request over, status=%d", transfer->m_http_code);
+    return ret;
+}
+
+void* CurlHttpTransport::LoopEntry(void* arg) {
+    static_cast<CurlHttpTransport*>(arg)->RunLoop();
+    return NULL;
+}
+
+void CurlHttpTransport::RunLoop() {
+    while (AddPendingTransfers()) {
+        int running_num = 0;
+        curl_multi_perform(m_multi, &running_num);
+
+        int msg_num = 0;
+        CURLMsg* msg = NULL;
+        while ((msg = curl_multi_info_read(m_multi, &msg_num)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            // remove_handle之后msg失效, 先取出所需字段
+            CURL* easy = msg->easy_handle;
+            CURLcode result = msg->data.result;
+            char* priv = NULL;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, &priv);
+            Transfer* transfer = reinterpret_cast<Transfer*>(priv);
+            curl_multi_remove_handle(m_multi, easy);
+            m_running_transfers.erase(transfer);
+            CompleteTransfer(transfer, result);
+        }
+
+        RemoveCancelledTransfers();
+        ResumePausedTransfers();
+        // 有新请求提交或调用线程处理完缓冲区时由curl_multi_wakeup唤醒
+        curl_multi_poll(m_multi, NULL, 0, kPollIntervalInms, NULL);
+    }
+    AbortAllTransfers();
+}
+
+bool CurlHttpTransport::AddPendingTransfers() {
+    std::deque<Transfer*> transfers;
+    pthread_mutex_lock(&m_mutex);
+    bool is_stopping = m_stopping;
+    transfers.swap(m_pending_transfers);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (std::deque<Transfer*>::iterator itr = transfers.begin();
+         itr != transfers.end(); ++itr) {
+        Transfer* transfer = *itr;
+        if (is_stopping) {
+            SetErrBuf(transfer->m_err_buf, kTransportStoppedErrMsg);
+            CompleteTransfer(transfer, CURLE_FAILED_INIT);
+            continue;
+        }
+        transfer->m_start_in_us = HttpSender::GetMonotonicTimeInUs();
+        CURLMcode code = curl_multi_add_handle(m_multi, transfer->m_easy);
+        if (code != CURLM_OK) {
+            SetErrBuf(transfer->m_err_buf, curl_multi_strerror(code));
+            CompleteTransfer(transfer, CURLE_FAILED_INIT);
+            continue;
+        }
+        m_running_transfers.insert(transfer);
+    }
+    return !is_stopping;
+}
+
+void CurlHttpTransport::RemoveCancelledTransfers() {
+    std::set<Transfer*>::iterator itr = m_running_transfers.begin();
+    while (itr != m_running_transfers.end()) {
+        Transfer* transfer = *itr;
+        if (transfer->m_ctx == NULL || !transfer->m_ctx->IsCancelled()) {
+            ++itr;
+            continue;
+        }
+        curl_multi_remove_handle(m_multi, transfer->m_easy);
+        m_running_transfers.erase(itr++);
+        transfer->m_is_cancelled = true;
+        CompleteTransfer(transfer, CURLE_ABORTED_BY_CALLBACK);
+    }
+}
+
+void CurlHttpTransport::ResumePausedTransfers() {
+    for (std::set<Transfer*>::iterator itr = m_running_transfers.begin();
+         itr != m_running_transfers.end(); ++itr) {
+        Transfer* transfer = *itr;
+        pthread_mutex_lock(&transfer->m_mutex);
+        bool is_resume_read = transfer->m_is_read_paused
+            && (transfer->m_send_offset < transfer->m_send_buf.size()
+                || transfer->m_is_body_eof || !transfer->m_body_err_msg.empty());
+        bool is_resume_write = transfer->m_is_write_paused
+            && (transfer->m_recv_buf.empty() || transfer->m_is_write_failed);
+        if (is_resume_read) {
+            transfer->m_is_read_paused = false;
+        }
+        if (is_resume_write) {
+            transfer->m_is_write_paused = false;
+        }
+        int pause_state = (transfer->m_is_read_paused ? CURLPAUSE_SEND : 0)
+            | (transfer->m_is_write_paused ? CURLPAUSE_RECV : 0);
+        pthread_mutex_unlock(&transfer->m_mutex);
+
+        // 恢复时curl可能立即回调OnReadBody/OnWriteBody, 不能持有m_mutex
+        if (is_resume_read || is_resume_write) {
+            curl_easy_pause(transfer->m_easy, pause_state);
+        }
+    }
+}
+
+void CurlHttpTransport::CompleteTransfer(Transfer* transfer, CURLcode result) {
+    // 唤醒后调用线程会立即销毁transfer, 解锁后不能再访问
+    pthread_mutex_lock(&transfer->m_mutex);
+    transfer->m_result = result;
+    transfer->m_is_done = true;
+    pthread_cond_signal(&transfer->m_cond);
+    pthread_mutex_unlock(&transfer->m_mutex);
+}
+
+void CurlHttpTransport::AbortAllTransfers() {
+    for (std::set<Transfer*>::iterator itr = m_running_transfers.begin();
+         itr != m_running_transfers.end(); ++itr) {
+        Transfer* transfer = *itr;
+        curl_multi_remove_handle(m_multi, transfer->m_easy);
+        SetErrBuf(transfer->m_err_buf, kTransportStoppedErrMsg);
+        CompleteTransfer(transfer, CURLE_FAILED_INIT);
+    }
+    m_running_transfers.clear();
+}
+
+void CurlHttpTransport::LockShare(CURL* /*handle*/, curl_lock_data /*data*/,
+                                  curl_lock_access /*access*/, void* userptr) {
+    pthread_mutex_lock(&static_cast<CurlHttpTransport*>(userptr)->m_share_mutex);
+}
+
+void CurlHttpTransport::UnlockShare(CURL* /*handle*/, curl_lock_data /*data*/, void* userptr) {
+    pthread_mutex_unlock(&static_cast<CurlHttpTransport*>(userptr)->m_share_mutex);
+}
+
+} // namespace qcloud_cos
@@ -0,0 +1,213 @@
+#include "util/dns_cache.h"
+
+#include <algorithm>
+
+#include "Poco/Exception.h"
+#include "Poco/Net/DNS.h"
+#include "Poco/Net/HostEntry.h"
+
+#include "cos_sys_config.h"
+#include "util/http_sender.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 候选地址的排序依据: 近期连接失败的排在最后, 其次按已建立连接数(仅least_loaded), 最后按轮询顺序
+struct Candidate {
+    bool m_is_failed;
+    unsigned m_load;
+    size_t m_order;
+    const std::string* m_addr;
+
+    bool operator<(const Candidate& other) const {
+        if (m_is_failed != other.m_is_failed) {
+            return !m_is_failed;
+        }
+        if (m_load != other.m_load) {
+            return m_load < other.m_load;
+        }
+        return m_order < other.m_order;
+    }
+};
+} // namespace
+
+bool SystemDnsResolver::Resolve(const std::string& host, std::vector<std::string>* addrs,
+                                std::string* err_msg) {
+    try {
+        Poco::Net::HostEntry entry = Poco::Net::DNS::hostByName(host);
+        const Poco::Net::HostEntry::AddressList& addr_list = entry.addresses();
+        for (Poco::Net::HostEntry::AddressList::const_iterator itr = addr_list.begin();
+             itr != addr_list.end(); ++itr) {
+            addrs->push_back(itr->toString());
+        }
+    } catch (const Poco::Exception& ex) {
+        *err_msg = ex.displayText();
+        return false;
+    }
+
+    if (addrs->empty()) {
+        *err_msg = "No address found for " + host;
+        return false;
+    }
+    return true;
+}
+
+DnsCache& DnsCache::Instance() {
+    static DnsCache cache;
+    return cache;
+}
+
+uint64_t DnsCache::GetNowInMs() {
+    return HttpSender::GetMonotonicTimeInUs() / 1000;
+}
+
+void DnsCache::SetResolver(const Poco::SharedPtr<DnsResolver>& resolver) {
+    SimpleMutexLocker locker(&m_mutex);
+    if (resolver.isNull()) {
+        m_resolver = new SystemDnsResolver();
+    } else {
+        m_resolver = resolver;
+    }
+    m_entries.clear();
+    m_addr_states.clear();
+}
+
+bool DnsCache::GetAddresses(const std::string& host, std::vector<std::string>* addrs,
+                            std::string* err_msg) {
+    uint64_t now_in_ms = GetNowInMs();
+    Poco::SharedPtr<DnsResolver> resolver;
+    {
+        SimpleMutexLocker locker(&m_mutex);
+        std::map<std::string, Entry>::iterator itr = m_entries.find(host);
+        if (itr != m_entries.end() && now_in_ms < itr->second.m_expire_in_ms) {
+            ++m_hit_num;
+            if (itr->second.m_addrs.empty()) {
+                *err_msg = itr->second.m_err_msg;
+                return false;
+            }
+            SelectAddresses(&itr->second, now_in_ms, addrs);
+            return true;
+        }
+        ++m_resolve_num;
+        resolver = m_resolver;
+    }
+
+    // 在锁外解析, 避免慢解析阻塞其他域名; 同一域名并发未命中时可能重复解析, 结果以最后一次为准
+    std::vector<std::string> resolved_addrs;
+    std::string resolve_err_msg;
+    uint64_t begin_in_us = HttpSender::GetMonotonicTimeInUs();
+    bool is_resolved = resolver->Resolve(host, &resolved_addrs, &resolve_err_msg)
+        && !resolved_addrs.empty();
+    uint64_t end_in_us = HttpSender::GetMonotonicTimeInUs();
+    now_in_ms = end_in_us / 1000;
+    SDK_LOG_DBG("Resolve host %s, result=%d, addr_num=%u, time_in_us=%lu", host.c_str(),
+                is_resolved, static_cast<unsigned>(resolved_addrs.size()),
+                static_cast<unsigned long>(end_in_us - begin_in_us));
+
+    SimpleMutexLocker locker(&m_mutex);
+    std::map<std::string, Entry>::iterator itr = m_entries.find(host);
+    if (itr == m_entries.end()) {
+        Entry entry;
+        entry.m_expire_in_ms = 0;
+        // 以当前时间作为轮询起点, 避免各进程都从第一个地址开始
+        entry.m_next_index = static_cast<size_t>(now_in_ms);
+        itr = m_entries.insert(std::make_pair(host, entry)).first;
+    }
+
+    Entry& entry = itr->second;
+    if (is_resolved) {
+        entry.m_addrs.swap(resolved_addrs);
+        entry.m_err_msg.clear();
+        entry.m_expire_in_ms = now_in_ms + CosSysConfig::GetDnsCacheTtlInms();
+    } else if (!entry.m_addrs.empty()) {
+        SDK_LOG_WARN("Resolve host %s fail, %s, keep using stale addresses",
+                     host.c_str(), resolve_err_msg.c_str());
+        entry.m_expire_in_ms = now_in_ms + CosSysConfig::GetDnsNegativeTtlInms();
+    } else {
+        SDK_LOG_ERR("Resolve host %s fail, %s", host.c_str(), resolve_err_msg.c_str());
+        entry.m_err_msg = "Resolve host " + host + " fail, " + resolve_err_msg;
+        entry.m_expire_in_ms = now_in_ms + CosSysConfig::GetDnsNegativeTtlInms();
+        *err_msg = entry.m_err_msg;
+        return false;
+    }
+
+    SelectAddresses(&entry, now_in_ms, addrs);
+    return true;
+}
+
+void DnsCache::SelectAddresses(Entry* entry, uint64_t now_in_ms,
+                               std::vector<std::string>* addrs) {
+    size_t addr_num = entry->m_addrs.size();
+    size_t start_index = entry->m_next_index % addr_num;
+    entry->m_next_index = start_index + 1;
+    bool is_least_loaded = CosSysConfig::GetDnsRotatePolicy() == DNS_ROTATE_LEAST_LOADED;
+
+    std::vector<Candidate> candidates(addr_num);
+    for (size_t i = 0; i < addr_num; ++i) {
+        Candidate& candidate = candidates[i];
+        candidate.m_addr = &entry->m_addrs[(start_index + i) % addr_num];
+        candidate.m_order = i;
+        candidate.m_is_failed = false;
+        candidate.m_load = 0;
+
+        std::map<std::string, AddrState>::const_iterator itr =
+            m_addr_states.find(*candidate.m_addr);
+        if (itr != m_addr_states.end()) {
+            candidate.m_is_failed = now_in_ms < itr->second.m_fail_until_in_ms;
+            candidate.m_load = is_least_loaded ? itr->second.m_conn_num : 0;
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    addrs->clear();
+    for (size_t i = 0; i < addr_num; ++i) {
+        addrs->push_back(*candidates[i].m_addr);
+    }
+}
+
+void DnsCache::MarkFailed(const std::string& addr) {
+    SimpleMutexLocker locker(&m_mutex);
+    m_addr_states[addr].m_fail_until_in_ms = GetNowInMs() + CosSysConfig::GetDnsNegativeTtlInms();
+}
+
+void DnsCache::AddConnection(const std::string& addr) {
+    SimpleMutexLocker locker(&m_mutex);
+    AddrState& state = m_addr_states[addr];
+    ++state.m_conn_num;
+    // 能够建立连接说明地址已恢复
+    state.m_fail_until_in_ms = 0;
+}
+
+void DnsCache::RemoveConnection(const std::string& addr) {
+    SimpleMutexLocker locker(&m_mutex);
+    std::map<std::string, AddrState>::iterator itr = m_addr_states.find(addr);
+    if (itr == m_addr_states.end()) {
+        return;
+    }
+    if (itr->second.m_conn_num > 0) {
+        --itr->second.m_conn_num;
+    }
+    if (itr->second.m_conn_num == 0 && itr->second.m_fail_until_in_ms <= GetNowInMs()) {
+        m_addr_states.erase(itr);
+    }
+}
+
+void DnsCache::Clear() {
+    SimpleMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_addr_states.clear();
+    m_hit_num = 0;
+    m_resolve_num = 0;
+}
+
+void DnsCache::GetStats(uint64_t* hit_num, uint64_t* resolve_num) {
+    SimpleMutexLocker locker(&m_mutex);
+    if (hit_num != NULL) {
+        *hit_num = m_hit_num;
+    }
+    if (resolve_num != NULL) {
+        *resolve_num = m_resolve_num;
+    }
+}
+
+} // namespace qcloud_cos
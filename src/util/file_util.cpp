@@ -1,5 +1,7 @@
 #include "util/file_util.h"
 
+#include <sys/stat.h>
+
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -31,4 +33,12 @@ uint64_t FileUtil::GetFileLen(const std::string& local_file_path) {
     file_input.close();
     return file_len;
 }
+
+uint64_t FileUtil::GetFileMtime(const std::string& local_file_path) {
+    struct stat st;
+    if (stat(local_file_path.c_str(), &st) != 0) {
+        return 0;
+    }
+    return st.st_mtime;
+}
 } //namespace qcloud_cos
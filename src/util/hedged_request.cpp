@@ -0,0 +1,498 @@
+#include "util/hedged_request.h"
+
+#include <pthread.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "Poco/SharedPtr.h"
+
+#include "cos_sys_config.h"
+#include "util/http_sender.h"
+#include "util/noncopyable.h"
+#include "util/simple_mutex.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 每种方法保留的首字节耗时样本数
+const size_t kLatencySampleNum = 512;
+// 样本数达到该值后才开始对冲
+const uint64_t kMinLatencySampleNum = 32;
+// 每新增多少个样本重新计算一次分位数
+const uint64_t kDelayUpdateInterval = 16;
+// 发出对冲请求的工作线程数上限, 线程均忙碌时放弃新的对冲
+const size_t kMaxHedgeWorkerNum = 16;
+
+uint64_t s_request_num = 0;
+uint64_t s_hedge_num = 0;
+uint64_t s_hedge_win_num = 0;
+
+// 原请求首字节耗时的滑动窗口, 定期取分位数作为对冲等待时间
+class LatencyTracker : private NonCopyable {
+public:
+    LatencyTracker() : m_samples(kLatencySampleNum, 0), m_sample_num(0), m_delay_in_us(0) {}
+
+    void Add(uint64_t latency_in_us) {
+        SimpleMutexLocker locker(&m_mutex);
+        m_samples[m_sample_num % kLatencySampleNum] = latency_in_us;
+        ++m_sample_num;
+        if (m_sample_num >= kMinLatencySampleNum && m_sample_num % kDelayUpdateInterval == 0) {
+            UpdateDelay();
+        }
+    }
+
+    // 返回0表示样本不足
+    uint64_t GetDelayInUs() {
+        SimpleMutexLocker locker(&m_mutex);
+        return m_delay_in_us;
+    }
+
+private:
+    // 调用方需持有m_mutex
+    void UpdateDelay() {
+        size_t sample_num = std::min<uint64_t>(m_sample_num, kLatencySampleNum);
+        std::vector<uint64_t> samples(m_samples.begin(), m_samples.begin() + sample_num);
+        unsigned percentile = std::max(1u, std::min(100u, CosSysConfig::GetHedgeDelayPercentile()));
+        size_t index = std::min(sample_num - 1, sample_num * percentile / 100);
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        m_delay_in_us = std::max(samples[index], CosSysConfig::GetHedgeMinDelayInms() * 1000);
+    }
+
+private:
+    SimpleMutex m_mutex;
+    std::vector<uint64_t> m_samples;
+    uint64_t m_sample_num;
+    uint64_t m_delay_in_us;
+};
+
+LatencyTracker s_get_tracker;
+LatencyTracker s_head_tracker;
+
+LatencyTracker* GetTracker(const std::string& http_method) {
+    if (!strcasecmp(http_method.c_str(), "GET")) {
+        return &s_get_tracker;
+    }
+    if (!strcasecmp(http_method.c_str(), "HEAD")) {
+        return &s_head_tracker;
+    }
+    return NULL;
+}
+
+class HedgeGroup;
+
+// 原请求(index为0)或对冲请求(index为1), 收到响应头时向HedgeGroup争取胜出
+class HedgeAttempt : public RequestContext {
+public:
+    HedgeAttempt()
+        : m_group(NULL), m_index(0), m_http_code(-1), m_real_byte(0) {}
+
+    virtual bool OnResponseHeader();
+
+    HedgeGroup* m_group;
+    int m_index;
+    int m_http_code;
+    std::map<std::string, std::string> m_resp_headers;
+    std::string m_resp_body;    // 下载到流时为错误响应的xml
+    std::string m_err_msg;
+    uint64_t m_real_byte;
+};
+
+// 一个请求的原请求和对冲请求共享的状态, 由调用方和对冲工作线程通过SharedPtr共同持有
+// 对冲请求可能晚于调用方返回, 因此请求参数均为拷贝; resp_stream只有胜出的一方会写入
+class HedgeGroup : private NonCopyable {
+public:
+    HedgeGroup(const std::string& http_method,
+               const std::string& url_str,
+               const CanonicalRequest& req_params,
+               const std::map<std::string, std::string>& req_headers,
+               uint64_t conn_timeout_in_ms,
+               uint64_t recv_timeout_in_ms,
+               std::ostream* resp_stream,
+               bool is_check_md5,
+               LatencyTracker* tracker)
+        : m_http_method(http_method), m_url(url_str), m_req_params(req_params),
+          m_req_headers(req_headers), m_conn_timeout_in_ms(conn_timeout_in_ms),
+          m_recv_timeout_in_ms(recv_timeout_in_ms), m_resp_stream(resp_stream),
+          m_is_check_md5(is_check_md5), m_tracker(tracker),
+          m_start_time_in_us(HttpSender::GetTimeStampInUs()),
+          m_winner(-1), m_hedged(false), m_closed(false) {
+        pthread_mutex_init(&m_mutex, NULL);
+        pthread_cond_init(&m_cond, NULL);
+        for (int i = 0; i < 2; ++i) {
+            m_attempts[i].m_group = this;
+            m_attempts[i].m_index = i;
+            m_finished[i] = false;
+        }
+    }
+
+    ~HedgeGroup() {
+        pthread_cond_destroy(&m_cond);
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    void RunAttempt(int index) {
+        HedgeAttempt& attempt = m_attempts[index];
+        if (m_resp_stream != NULL) {
+            attempt.m_http_code = HttpSender::SendRequest(m_http_method, m_url, m_req_params,
+                                                          m_req_headers, "",
+                                                          m_conn_timeout_in_ms,
+                                                          m_recv_timeout_in_ms,
+                                                          &attempt.m_resp_headers,
+                                                          &attempt.m_resp_body, *m_resp_stream,
+                                                          &attempt.m_err_msg,
+                                                          &attempt.m_real_byte,
+                                                          m_is_check_md5, &attempt);
+        } else {
+            attempt.m_http_code = HttpSender::SendRequest(m_http_method, m_url, m_req_params,
+                                                          m_req_headers, std::string(),
+                                                          m_conn_timeout_in_ms,
+                                                          m_recv_timeout_in_ms,
+                                                          &attempt.m_resp_headers,
+                                                          &attempt.m_resp_body,
+                                                          &attempt.m_err_msg,
+                                                          false, &attempt);
+        }
+
+        pthread_mutex_lock(&m_mutex);
+        m_finished[index] = true;
+        pthread_cond_broadcast(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    // 第一个收到响应头的请求胜出, 并取消另一方
+    bool Claim(int index) {
+        pthread_mutex_lock(&m_mutex);
+        if (m_winner < 0) {
+            m_winner = index;
+        }
+        bool won = m_winner == index;
+        pthread_mutex_unlock(&m_mutex);
+
+        if (won) {
+            // 原请求落败时记录其已等待的时间, 该值不小于对冲等待时间,
+            // 保证分位数不会因慢请求被取消而逐渐偏低
+            m_tracker->Add(HttpSender::GetTimeStampInUs() - m_start_time_in_us);
+            m_attempts[1 - index].Cancel();
+            if (index == 1) {
+                __atomic_add_fetch(&s_hedge_win_num, 1, __ATOMIC_RELAXED);
+            }
+        }
+        return won;
+    }
+
+    // 须在发出原请求之前调用
+    void SetDecodeGzip(bool is_decode_gzip) {
+        for (int i = 0; i < 2; ++i) {
+            m_attempts[i].SetDecodeGzip(is_decode_gzip);
+        }
+    }
+
+    // 原请求仍在等待响应时标记为已对冲并返回true
+    bool BeginHedge() {
+        pthread_mutex_lock(&m_mutex);
+        bool hedge = m_winner < 0 && !m_closed;
+        m_hedged = hedge;
+        pthread_mutex_unlock(&m_mutex);
+        return hedge;
+    }
+
+    // 原请求结束后由调用方调用, 等待胜出的请求结束, 无胜出者时等待已发出的请求全部结束
+    // 返回作为结果的请求, 无胜出者时为原请求
+    const HedgeAttempt& Wait() {
+        pthread_mutex_lock(&m_mutex);
+        m_closed = true;
+        while (!(m_winner >= 0 && m_finished[m_winner])
+               && !(m_finished[0] && (!m_hedged || m_finished[1]))) {
+            pthread_cond_wait(&m_cond, &m_mutex);
+        }
+        int index = m_winner >= 0 ? m_winner : 0;
+        pthread_mutex_unlock(&m_mutex);
+        return m_attempts[index];
+    }
+
+private:
+    std::string m_http_method;
+    std::string m_url;
+    CanonicalRequest m_req_params;
+    std::map<std::string, std::string> m_req_headers;
+    uint64_t m_conn_timeout_in_ms;
+    uint64_t m_recv_timeout_in_ms;
+    std::ostream* m_resp_stream;
+    bool m_is_check_md5;
+    LatencyTracker* m_tracker;
+    uint64_t m_start_time_in_us;    // 原请求的发出时间
+
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    HedgeAttempt m_attempts[2];
+    bool m_finished[2];
+    int m_winner;
+    bool m_hedged;
+    bool m_closed;      // 原请求已结束, 不再发出对冲请求
+};
+
+bool HedgeAttempt::OnResponseHeader() {
+    return !IsCancelled() && m_group->Claim(m_index);
+}
+
+// 到达对冲等待时间后由定时线程交给工作线程发出对冲请求, 定时线程在首次使用时启动
+// 工作线程按需创建并常驻, 数量不超过kMaxHedgeWorkerNum
+class HedgeScheduler : private NonCopyable {
+public:
+    static HedgeScheduler& Instance() {
+        static HedgeScheduler scheduler;
+        return scheduler;
+    }
+
+    // 定时线程启动失败时返回false, 此时不对冲
+    bool Schedule(const Poco::SharedPtr<HedgeGroup>& group, uint64_t deadline_in_us) {
+        pthread_mutex_lock(&m_mutex);
+        if (!m_started) {
+            int ret = pthread_create(&m_tid, NULL, ThreadEntry, this);
+            if (ret != 0) {
+                pthread_mutex_unlock(&m_mutex);
+                SDK_LOG_ERR("Create hedge scheduler thread fail, ret=%d", ret);
+                return false;
+            }
+            m_started = true;
+        }
+        m_timers.insert(std::make_pair(deadline_in_us, group));
+        pthread_cond_signal(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+        return true;
+    }
+
+private:
+    typedef std::multimap<uint64_t, Poco::SharedPtr<HedgeGroup> > TimerMap;
+
+    HedgeScheduler() : m_started(false), m_stopping(false), m_idle_worker_num(0) {
+        pthread_mutex_init(&m_mutex, NULL);
+        pthread_cond_init(&m_cond, NULL);
+        pthread_cond_init(&m_worker_cond, NULL);
+    }
+
+    ~HedgeScheduler() {
+        pthread_mutex_lock(&m_mutex);
+        m_stopping = true;
+        pthread_cond_signal(&m_cond);
+        pthread_cond_broadcast(&m_worker_cond);
+        pthread_mutex_unlock(&m_mutex);
+
+        if (m_started) {
+            pthread_join(m_tid, NULL);
+        }
+        for (size_t i = 0; i < m_worker_tids.size(); ++i) {
+            pthread_join(m_worker_tids[i], NULL);
+        }
+        pthread_cond_destroy(&m_worker_cond);
+        pthread_cond_destroy(&m_cond);
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    static void* ThreadEntry(void* arg) {
+        static_cast<HedgeScheduler*>(arg)->Run();
+        return NULL;
+    }
+
+    static void* WorkerEntry(void* arg) {
+        static_cast<HedgeScheduler*>(arg)->WorkerRun();
+        return NULL;
+    }
+
+    // 调用方需持有m_mutex; 空闲线程不足时新建工作线程, 已达上限则放弃本次对冲
+    void Dispatch(const Poco::SharedPtr<HedgeGroup>& group) {
+        if (m_ready_groups.size() >= m_idle_worker_num) {
+            if (m_worker_tids.size() >= kMaxHedgeWorkerNum) {
+                SDK_LOG_WARN("All %u hedge workers are busy, skip hedge",
+                             static_cast<unsigned>(m_worker_tids.size()));
+                return;
+            }
+            pthread_t tid;
+            int ret = pthread_create(&tid, NULL, WorkerEntry, this);
+            if (ret != 0) {
+                SDK_LOG_ERR("Create hedge worker thread fail, ret=%d", ret);
+                return;
+            }
+            m_worker_tids.push_back(tid);
+        }
+        m_ready_groups.push_back(group);
+        pthread_cond_signal(&m_worker_cond);
+    }
+
+    // 对冲请求在工作线程上真正发出前再确认原请求仍未结束
+    void WorkerRun() {
+        pthread_mutex_lock(&m_mutex);
+        while (true) {
+            while (m_ready_groups.empty() && !m_stopping) {
+                ++m_idle_worker_num;
+                pthread_cond_wait(&m_worker_cond, &m_mutex);
+                --m_idle_worker_num;
+            }
+            if (m_stopping) {
+                break;
+            }
+
+            Poco::SharedPtr<HedgeGroup> group = m_ready_groups.front();
+            m_ready_groups.pop_front();
+            pthread_mutex_unlock(&m_mutex);
+            if (group->BeginHedge()) {
+                __atomic_add_fetch(&s_hedge_num, 1, __ATOMIC_RELAXED);
+                group->RunAttempt(1);
+            }
+            // 在加锁前释放对HedgeGroup的引用
+            group = NULL;
+            pthread_mutex_lock(&m_mutex);
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    void Run() {
+        pthread_mutex_lock(&m_mutex);
+        while (!m_stopping) {
+            if (m_timers.empty()) {
+                pthread_cond_wait(&m_cond, &m_mutex);
+                continue;
+            }
+
+            TimerMap::iterator itr = m_timers.begin();
+            if (itr->first > HttpSender::GetTimeStampInUs()) {
+                struct timespec abstime;
+                abstime.tv_sec = itr->first / 1000000;
+                abstime.tv_nsec = (itr->first % 1000000) * 1000;
+                pthread_cond_timedwait(&m_cond, &m_mutex, &abstime);
+                continue;
+            }
+
+            Dispatch(itr->second);
+            m_timers.erase(itr);
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+private:
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    TimerMap m_timers;
+    pthread_t m_tid;
+    bool m_started;
+    bool m_stopping;
+
+    pthread_cond_t m_worker_cond;
+    std::deque<Poco::SharedPtr<HedgeGroup> > m_ready_groups;
+    std::vector<pthread_t> m_worker_tids;
+    size_t m_idle_worker_num;
+};
+
+// 发出原请求, 超过对冲等待时间仍未收到响应时由定时线程发出对冲请求
+const HedgeAttempt& RunHedgeGroup(const Poco::SharedPtr<HedgeGroup>& group,
+                                  LatencyTracker* tracker) {
+    __atomic_add_fetch(&s_request_num, 1, __ATOMIC_RELAXED);
+    uint64_t delay_in_us = tracker->GetDelayInUs();
+    if (delay_in_us > 0) {
+        HedgeScheduler::Instance().Schedule(group, HttpSender::GetTimeStampInUs() + delay_in_us);
+    }
+    group->RunAttempt(0);
+    return group->Wait();
+}
+} // namespace
+
+int HedgedRequest::SendRequest(const std::string& http_method,
+                               const std::string& url_str,
+                               const CanonicalRequest& req_params,
+                               const std::map<std::string, std::string>& req_headers,
+                               const std::string& req_body,
+                               uint64_t conn_timeout_in_ms,
+                               uint64_t recv_timeout_in_ms,
+                               std::map<std::string, std::string>* resp_headers,
+                               std::string* resp_body,
+                               std::string* err_msg,
+                               RequestTiming* timing,
+                               bool is_decode_gzip) {
+    if (!req_body.empty() || !IsHedgeable(http_method)) {
+        RequestContext ctx;
+        ctx.SetDecodeGzip(is_decode_gzip);
+        int http_code = HttpSender::SendRequest(http_method, url_str, req_params, req_headers,
+                                                req_body, conn_timeout_in_ms,
+                                                recv_timeout_in_ms, resp_headers, resp_body,
+                                                err_msg, false, &ctx);
+        if (timing != NULL) {
+            *timing = ctx.GetTiming();
+        }
+        return http_code;
+    }
+
+    LatencyTracker* tracker = GetTracker(http_method);
+    Poco::SharedPtr<HedgeGroup> group(new HedgeGroup(http_method, url_str, req_params,
+                                                     req_headers, conn_timeout_in_ms,
+                                                     recv_timeout_in_ms, NULL, false, tracker));
+    group->SetDecodeGzip(is_decode_gzip);
+    const HedgeAttempt& attempt = RunHedgeGroup(group, tracker);
+    resp_headers->insert(attempt.m_resp_headers.begin(), attempt.m_resp_headers.end());
+    *resp_body = attempt.m_resp_body;
+    *err_msg = attempt.m_err_msg;
+    if (timing != NULL) {
+        *timing = attempt.GetTiming();
+    }
+    return attempt.m_http_code;
+}
+
+int HedgedRequest::SendRequest(const std::string& http_method,
+                               const std::string& url_str,
+                               const CanonicalRequest& req_params,
+                               const std::map<std::string, std::string>& req_headers,
+                               const std::string& req_body,
+                               uint64_t conn_timeout_in_ms,
+                               uint64_t recv_timeout_in_ms,
+                               std::map<std::string, std::string>* resp_headers,
+                               std::string* xml_err_str,
+                               std::ostream& resp_stream,
+                               std::string* err_msg,
+                               uint64_t* real_byte,
+                               bool is_check_md5,
+                               RequestTiming* timing) {
+    if (!req_body.empty() || !IsHedgeable(http_method)) {
+        RequestContext ctx;
+        int http_code = HttpSender::SendRequest(http_method, url_str, req_params, req_headers,
+                                                req_body, conn_timeout_in_ms,
+                                                recv_timeout_in_ms, resp_headers, xml_err_str,
+                                                resp_stream, err_msg, real_byte, is_check_md5,
+                                                &ctx);
+        if (timing != NULL) {
+            *timing = ctx.GetTiming();
+        }
+        return http_code;
+    }
+
+    LatencyTracker* tracker = GetTracker(http_method);
+    Poco::SharedPtr<HedgeGroup> group(new HedgeGroup(http_method, url_str, req_params,
+                                                     req_headers, conn_timeout_in_ms,
+                                                     recv_timeout_in_ms, &resp_stream,
+                                                     is_check_md5, tracker));
+    const HedgeAttempt& attempt = RunHedgeGroup(group, tracker);
+    resp_headers->insert(attempt.m_resp_headers.begin(), attempt.m_resp_headers.end());
+    *xml_err_str = attempt.m_resp_body;
+    *err_msg = attempt.m_err_msg;
+    *real_byte = attempt.m_real_byte;
+    if (timing != NULL) {
+        *timing = attempt.GetTiming();
+    }
+    return attempt.m_http_code;
+}
+
+bool HedgedRequest::IsHedgeable(const std::string& http_method) {
+    return CosSysConfig::IsHedgeEnable() && GetTracker(http_method) != NULL;
+}
+
+void HedgedRequest::GetStats(HedgeStats* stats) {
+    stats->m_request_num = __atomic_load_n(&s_request_num, __ATOMIC_RELAXED);
+    stats->m_hedge_num = __atomic_load_n(&s_hedge_num, __ATOMIC_RELAXED);
+    stats->m_hedge_win_num = __atomic_load_n(&s_hedge_win_num, __ATOMIC_RELAXED);
+    stats->m_get_delay_in_us = s_get_tracker.GetDelayInUs();
+    stats->m_head_delay_in_us = s_head_tracker.GetDelayInUs();
+}
+
+} // namespace qcloud_cos
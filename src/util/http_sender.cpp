@@ -7,33 +7,49 @@
 
 #include "util/http_sender.h"
 
+#include <sys/socket.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include <iostream>
 #include <sstream>
 
-#include "boost/scoped_ptr.hpp"
-#include "Poco/DigestStream.h"
-#include "Poco/MD5Engine.h"
-#include "Poco/Net/Context.h"
-#include "Poco/Net/HTTPClientSession.h"
-#include "Poco/Net/HTTPRequest.h"
-#include "Poco/Net/HTTPResponse.h"
-#include "Poco/Net/HTTPSClientSession.h"
-#include "Poco/Net/NetException.h"
-#include "Poco/StreamCopier.h"
-#include "Poco/URI.h"
-
-#include "cos_config.h"
-#include "cos_sys_config.h"
-#include "util/string_util.h"
-#include "util/codec_util.h"
+#include "util/body_source.h"
+#include "util/http_transport.h"
 
 namespace qcloud_cos {
 
+void RequestContext::Cancel() {
+    SimpleMutexLocker locker(&m_mutex);
+    m_cancelled = true;
+    if (m_fd >= 0) {
+        // 只关闭读写而不close, fd仍归HttpSender所有, 阻塞中的读写会立即出错返回
+        ::shutdown(m_fd, SHUT_RDWR);
+    }
+}
+
+bool RequestContext::IsCancelled() {
+    SimpleMutexLocker locker(&m_mutex);
+    return m_cancelled;
+}
+
+bool RequestContext::AttachSocket(int fd) {
+    SimpleMutexLocker locker(&m_mutex);
+    if (m_cancelled) {
+        return false;
+    }
+    m_fd = fd;
+    return true;
+}
+
+void RequestContext::DetachSocket() {
+    SimpleMutexLocker locker(&m_mutex);
+    m_fd = -1;
+}
+
 int HttpSender::SendRequest(const std::string& http_method,
                             const std::string& url_str,
-                            const std::map<std::string, std::string>& req_params,
+                            const CanonicalRequest& req_params,
                             const std::map<std::string, std::string>& req_headers,
                             const std::string& req_body,
                             uint64_t conn_timeout_in_ms,
@@ -41,27 +57,26 @@ int HttpSender::SendRequest(const std::string& http_method,
                             std::map<std::string, std::string>* resp_headers,
                             std::string* resp_body,
                             std::string* err_msg,
-                            bool is_check_md5) {
-    std::istringstream is(req_body);
-    std::ostringstream oss;
-    int ret = SendRequest(http_method,
-                          url_str,
-                          req_params,
-                          req_headers,
-                          is,
-                          conn_timeout_in_ms,
-                          recv_timeout_in_ms,
-                          resp_headers,
-                          oss,
-                          err_msg,
-                          is_check_md5);
-    *resp_body = oss.str();
-    return ret;
+                            bool is_check_md5,
+                            RequestContext* ctx) {
+    BufferBodySource body(req_body);
+    return SendRequest(http_method,
+                       url_str,
+                       req_params,
+                       req_headers,
+                       body,
+                       conn_timeout_in_ms,
+                       recv_timeout_in_ms,
+                       resp_headers,
+                       resp_body,
+                       err_msg,
+                       is_check_md5,
+                       ctx);
 }
 
 int HttpSender::SendRequest(const std::string& http_method,
                             const std::string& url_str,
-                            const std::map<std::string, std::string>& req_params,
+                            const CanonicalRequest& req_params,
                             const std::map<std::string, std::string>& req_headers,
                             const std::string& req_body,
                             uint64_t conn_timeout_in_ms,
@@ -70,24 +85,23 @@ int HttpSender::SendRequest(const std::string& http_method,
                             std::ostream& resp_stream,
                             std::string* err_msg,
                             bool is_check_md5) {
-    std::istringstream is(req_body);
-    int ret = SendRequest(http_method,
-                          url_str,
-                          req_params,
-                          req_headers,
-                          is,
-                          conn_timeout_in_ms,
-                          recv_timeout_in_ms,
-                          resp_headers,
-                          resp_stream,
-                          err_msg,
-                          is_check_md5);
-    return ret;
+    BufferBodySource body(req_body);
+    return SendRequest(http_method,
+                       url_str,
+                       req_params,
+                       req_headers,
+                       body,
+                       conn_timeout_in_ms,
+                       recv_timeout_in_ms,
+                       resp_headers,
+                       resp_stream,
+                       err_msg,
+                       is_check_md5);
 }
 
 int HttpSender::SendRequest(const std::string& http_method,
                             const std::string& url_str,
-                            const std::map<std::string, std::string>& req_params,
+                            const CanonicalRequest& req_params,
                             const std::map<std::string, std::string>& req_headers,
                             std::istream& is,
                             uint64_t conn_timeout_in_ms,
@@ -96,174 +110,103 @@ int HttpSender::SendRequest(const std::string& http_method,
                             std::string* resp_body,
                             std::string* err_msg,
                             bool is_check_md5) {
+    StreamBodySource body(is);
+    return SendRequest(http_method,
+                       url_str,
+                       req_params,
+                       req_headers,
+                       body,
+                       conn_timeout_in_ms,
+                       recv_timeout_in_ms,
+                       resp_headers,
+                       resp_body,
+                       err_msg,
+                       is_check_md5);
+}
+
+int HttpSender::SendRequest(const std::string& http_method,
+                            const std::string& url_str,
+                            const CanonicalRequest& req_params,
+                            const std::map<std::string, std::string>& req_headers,
+                            std::istream& is,
+                            uint64_t conn_timeout_in_ms,
+                            uint64_t recv_timeout_in_ms,
+                            std::map<std::string, std::string>* resp_headers,
+                            std::ostream& resp_stream,
+                            std::string* err_msg,
+                            bool is_check_md5) {
+    StreamBodySource body(is);
+    return SendRequest(http_method,
+                       url_str,
+                       req_params,
+                       req_headers,
+                       body,
+                       conn_timeout_in_ms,
+                       recv_timeout_in_ms,
+                       resp_headers,
+                       resp_stream,
+                       err_msg,
+                       is_check_md5);
+}
+
+int HttpSender::SendRequest(const std::string& http_method,
+                            const std::string& url_str,
+                            const CanonicalRequest& req_params,
+                            const std::map<std::string, std::string>& req_headers,
+                            BodySource& req_body,
+                            uint64_t conn_timeout_in_ms,
+                            uint64_t recv_timeout_in_ms,
+                            std::map<std::string, std::string>* resp_headers,
+                            std::string* resp_body,
+                            std::string* err_msg,
+                            bool is_check_md5,
+                            RequestContext* ctx) {
     std::ostringstream oss;
     int ret = SendRequest(http_method,
                           url_str,
                           req_params,
                           req_headers,
-                          is,
+                          req_body,
                           conn_timeout_in_ms,
                           recv_timeout_in_ms,
                           resp_headers,
                           oss,
                           err_msg,
-                          is_check_md5);
+                          is_check_md5,
+                          ctx);
     *resp_body = oss.str();
     return ret;
 }
 
 int HttpSender::SendRequest(const std::string& http_method,
                             const std::string& url_str,
-                            const std::map<std::string, std::string>& req_params,
+                            const CanonicalRequest& req_params,
                             const std::map<std::string, std::string>& req_headers,
-                            std::istream& is,
+                            BodySource& req_body,
                             uint64_t conn_timeout_in_ms,
                             uint64_t recv_timeout_in_ms,
                             std::map<std::string, std::string>* resp_headers,
                             std::ostream& resp_stream,
                             std::string* err_msg,
-                            bool is_check_md5) {
-    Poco::Net::HTTPResponse res;
-    try {
-        Poco::URI url(url_str);
-        boost::scoped_ptr<Poco::Net::HTTPClientSession> session;
-        if (StringUtil::StringStartsWithIgnoreCase(url_str, "https")) {
-            Poco::Net::Context::Ptr context = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE,
-                                                     "", "", "", Poco::Net::Context::VERIFY_RELAXED,
-                                                     9, true, "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
-            session.reset(new Poco::Net::HTTPSClientSession(url.getHost(), url.getPort(), context));
-        } else {
-            session.reset(new Poco::Net::HTTPClientSession(url.getHost(), url.getPort()));
-        }
-
-        session->setTimeout(Poco::Timespan(0, conn_timeout_in_ms * 1000));
-        // 1. 拼接path_query字符串
-        std::string path = url.getPath();
-        if (path.empty()) {
-            path += "/";
-        }
-
-        std::string query_str;
-        for (std::map<std::string, std::string>::const_iterator c_itr = req_params.begin();
-                c_itr != req_params.end(); ++c_itr) {
-            std::string part;
-            if (c_itr->second.empty()) {
-                part = CodecUtil::UrlEncode(c_itr->first) + "&";
-            } else {
-                part = CodecUtil::UrlEncode(c_itr->first) + "=" + CodecUtil::UrlEncode(c_itr->second) + "&";
-            }
-            query_str += part;
-        }
-
-        if (!query_str.empty()) {
-            query_str = "?" + query_str.substr(0, query_str.size() - 1);
-        }
-        std::string path_and_query_str = CodecUtil::EncodeKey(path) + query_str;
-        //std::string path_and_query_str = CodecUtil::EncodeKey(path) + CodecUtil::UrlEncode("?response-content-type") + "= " + CodecUtil::UrlEncode("abcd\r\rnef");
-
-        // 2. 创建http request, 并填充头部
-        Poco::Net::HTTPRequest req(http_method, path_and_query_str, Poco::Net::HTTPMessage::HTTP_1_1);
-        for (std::map<std::string, std::string>::const_iterator c_itr = req_headers.begin();
-                c_itr != req_headers.end(); ++c_itr) {
-            req.add(c_itr->first, (c_itr->second).c_str());
-        }
-
-        // 3. 计算长度
-        std::streampos pos = is.tellg();
-        is.seekg(0, std::ios::end);
-        req.setContentLength(is.tellg());
-        is.seekg(pos);
-
-#ifdef __COS_DEBUG__
-        std::ostringstream debug_os;
-        req.write(debug_os);
-        SDK_LOG_DBG("request=[%s]", debug_os.str().c_str());
-#endif
-
-        // 4. 发送请求
-        std::ostream& os = session->sendRequest(req);
-        Poco::StreamCopier::copyStream(is, os);
-
-        // 5. 接收返回
-        Poco::Net::StreamSocket& ss = session->socket();
-        ss.setReceiveTimeout(Poco::Timespan(0, recv_timeout_in_ms * 1000));
-        std::istream& recv_stream = session->receiveResponse(res);
-
-        // 6. 处理返回
-        int ret = res.getStatus();
-        resp_headers->insert(res.begin(), res.end());
-
-        std::string etag = "";
-        std::map<std::string, std::string>::const_iterator etag_itr
-            = resp_headers->find("ETag");
-        if (etag_itr != resp_headers->end()) {
-            etag = StringUtil::Trim(etag_itr->second, "\"");
-        }
-
-        if (is_check_md5 && !StringUtil::IsV4ETag(etag)
-            && !StringUtil::IsMultipartUploadETag(etag)) {
-            SDK_LOG_DBG("Check Response Md5");
-            Poco::MD5Engine md5;
-            Poco::DigestOutputStream dos(md5);
-
-            // explicit iostream (streambuf* sb);
-            std::stringbuf ibuf;
-            std::iostream io_tmp(&ibuf);
-
-            // The Poco session->receiveResponse return the streambuf which dose not overload the base_iostream seekpos which is the realization of the tellg and seekg.
-            // It casue the recv_stream can not relocation the begin postion, so can not reuse of the recv_stream.
-            // FIXME it might has property issue.
-            Poco::StreamCopier::copyStream(recv_stream, io_tmp);
-
-            std::streampos pos = io_tmp.tellg();
-            Poco::StreamCopier::copyStream(io_tmp, dos);
-            io_tmp.clear();
-            io_tmp.seekg(pos);
-            dos.close();
-
-            std::string md5_str = Poco::DigestEngine::digestToHex(md5.digest());
-
-            if (etag != md5_str) {
-                *err_msg = "Md5 of response body is not equal to the etag in the header."
-                    " Body Md5= " + md5_str + ", etag=" + etag;
-                SDK_LOG_ERR("Check Md5 fail, %s", err_msg->c_str());
-                ret = -1;
-            }
-            Poco::StreamCopier::copyStream(io_tmp, resp_stream);
-        }else {
-            Poco::StreamCopier::copyStream(recv_stream, resp_stream);
-        }
-
-#ifdef __COS_DEBUG__
-        SDK_LOG_DBG("response header :\n");
-        for (std::map<std::string, std::string>::const_iterator itr = resp_headers->begin();
-             itr != resp_headers->end(); ++itr) {
-            SDK_LOG_DBG("key=[%s], value=[%s]\n", itr->first.c_str(), itr->second.c_str());
-        }
-#endif
-        SDK_LOG_INFO("Send request over, status=%d, reason=%s",
-                res.getStatus(), res.getReason().c_str());
-        return ret;
-    } catch (Poco::Net::NetException& ex){
-        SDK_LOG_ERR("Net Exception:%s", ex.displayText().c_str());
-        *err_msg = "Net Exception:" + ex.displayText();
-        return -1;
-    } catch (Poco::TimeoutException& ex) {
-        SDK_LOG_ERR("TimeoutException:%s", ex.displayText().c_str());
-        *err_msg = "TimeoutException:" + ex.displayText();
-        return -1;
-    } catch (const std::exception &ex) {
-        SDK_LOG_ERR("Exception:%s, errno=%d", std::string(ex.what()).c_str(), errno);
-        *err_msg = "Exception:" + std::string(ex.what());
-        return -1;
-    }
-
-    return res.getStatus();
+                            bool is_check_md5,
+                            RequestContext* ctx) {
+    return HttpTransport::GetTransport()->SendRequest(http_method,
+                                                      url_str,
+                                                      req_params,
+                                                      req_headers,
+                                                      req_body,
+                                                      conn_timeout_in_ms,
+                                                      recv_timeout_in_ms,
+                                                      resp_headers,
+                                                      resp_stream,
+                                                      err_msg,
+                                                      is_check_md5,
+                                                      ctx);
 }
 
 int HttpSender::SendRequest(const std::string& http_method,
                             const std::string& url_str,
-                            const std::map<std::string, std::string>& req_params,
+                            const CanonicalRequest& req_params,
                             const std::map<std::string, std::string>& req_headers,
                             const std::string& req_body,
                             uint64_t conn_timeout_in_ms,
@@ -273,145 +216,24 @@ int HttpSender::SendRequest(const std::string& http_method,
                             std::ostream& resp_stream,
                             std::string* err_msg,
                             uint64_t* real_byte,
-                            bool is_check_md5) {
-    Poco::Net::HTTPResponse res;
-    try {
-        Poco::URI url(url_str);
-        boost::scoped_ptr<Poco::Net::HTTPClientSession> session;
-        if (StringUtil::StringStartsWithIgnoreCase(url_str, "https")) {
-            Poco::Net::Context::Ptr context = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE,
-                                                     "", "", "", Poco::Net::Context::VERIFY_RELAXED,
-                                                     9, true, "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
-            session.reset(new Poco::Net::HTTPSClientSession(url.getHost(), url.getPort(), context));
-        } else {
-            session.reset(new Poco::Net::HTTPClientSession(url.getHost(), url.getPort()));
-        }
-        session->setTimeout(Poco::Timespan(0, conn_timeout_in_ms * 1000));
-        // 1. 拼接path_query字符串
-        std::string path = url.getPath();
-        if (path.empty()) {
-            path += "/";
-        }
-
-        std::string query_str;
-        for (std::map<std::string, std::string>::const_iterator c_itr = req_params.begin();
-                c_itr != req_params.end(); ++c_itr) {
-            std::string part;
-            if (c_itr->second.empty()) {
-                part = CodecUtil::UrlEncode(c_itr->first) + "&";
-            } else {
-                part = CodecUtil::UrlEncode(c_itr->first) + "=" + CodecUtil::UrlEncode(c_itr->second) + "&";
-            }
-            query_str += part;
-        }
-
-        if (!query_str.empty()) {
-            query_str = "?" + query_str.substr(0, query_str.size() - 1);
-        }
-        // std::string path_and_query_str = CodecUtil::EncodeKey(path) + CodecUtil::UrlEncode(query_str);
-        std::string path_and_query_str = CodecUtil::EncodeKey(path) + query_str;
-        //std::string path_and_query_str = CodecUtil::EncodeKey(path) + "response-content-type=abcd%0A%0Def";
-
-        // 2. 创建http request, 并填充头部
-        Poco::Net::HTTPRequest req(http_method, path_and_query_str, Poco::Net::HTTPMessage::HTTP_1_1);
-        for (std::map<std::string, std::string>::const_iterator c_itr = req_headers.begin();
-                c_itr != req_headers.end(); ++c_itr) {
-            // 有用户这这里出了堆栈，(c_itr->second).c_str() -> c_itr->second
-            //req.add(c_itr->first, (c_itr->second).c_str());
-            req.add(c_itr->first, c_itr->second);
-        }
-        req.add("Content-Length", StringUtil::Uint64ToString(req_body.size()));
-
-#ifdef __COS_DEBUG__
-        std::ostringstream debug_os;
-        req.write(debug_os);
-        SDK_LOG_DBG("request=[%s]", debug_os.str().c_str());
-#endif
-
-        // 3. 发送请求
-        std::ostream& os = session->sendRequest(req);
-        if (!req_body.empty()) {
-            os << req_body;
-        }
-
-        // 4. 接收返回
-        Poco::Net::StreamSocket& ss = session->socket();
-        ss.setReceiveTimeout(Poco::Timespan(0, recv_timeout_in_ms * 1000));
-        std::istream& recv_stream = session->receiveResponse(res);
-
-        // 6. 处理返回
-        int ret = res.getStatus();
-        resp_headers->insert(res.begin(), res.end());
-        if (ret != 200 && ret != 206) {
-            *real_byte = Poco::StreamCopier::copyToString(recv_stream, *xml_err_str);
-        } else {
-            std::string etag = "";
-            std::map<std::string, std::string>::const_iterator etag_itr
-                = resp_headers->find("ETag");
-            if (etag_itr != resp_headers->end()) {
-                etag = StringUtil::Trim(etag_itr->second, "\"");
-            }
-
-            if (is_check_md5 && !StringUtil::IsV4ETag(etag)
-                && !StringUtil::IsMultipartUploadETag(etag)) {
-                SDK_LOG_DBG("Check Response Md5");
-                Poco::MD5Engine md5;
-                Poco::DigestOutputStream dos(md5);
-
-                // explicit iostream (streambuf* sb);
-                std::stringbuf ibuf;
-                std::iostream io_tmp(&ibuf);
-
-                // The Poco session->receiveResponse return the streambuf which dose not overload the base_iostream seekpos which is the realization of the tellg and seekg.
-                // It casue the recv_stream can not relocation the begin postion, so can not reuse of the recv_stream.
-                // FIXME it might has property issue.
-                *real_byte = Poco::StreamCopier::copyStream(recv_stream, io_tmp);
-
-                std::streampos pos = io_tmp.tellg();
-                Poco::StreamCopier::copyStream(io_tmp, dos);
-                io_tmp.clear();
-                io_tmp.seekg(pos);
-                dos.close();
-                std::string md5_str = Poco::DigestEngine::digestToHex(md5.digest());
-
-                if (etag != md5_str) {
-                    *err_msg = "Md5 of response body is not equal to the etag in the header."
-                        " Body Md5= " + md5_str + ", etag=" + etag;
-                    SDK_LOG_ERR("Check Md5 fail, %s", err_msg->c_str());
-                    ret = -1;
-                }
-                Poco::StreamCopier::copyStream(io_tmp, resp_stream);
-            }else { // other way direct use the recv_stream
-                *real_byte = Poco::StreamCopier::copyStream(recv_stream, resp_stream);
-            }
-
-        }
-
-#ifdef __COS_DEBUG__
-        SDK_LOG_DBG("response header :\n");
-        for (std::map<std::string, std::string>::const_iterator itr = resp_headers->begin();
-             itr != resp_headers->end(); ++itr) {
-            SDK_LOG_DBG("key=[%s], value=[%s]\n", itr->first.c_str(), itr->second.c_str());
-        }
-#endif
-        SDK_LOG_INFO("Send request over, status=%d, reason=%s", ret, res.getReason().c_str());
-        return ret;
-    } catch (Poco::Net::NetException& ex){
-        SDK_LOG_ERR("Net Exception:%s", ex.displayText().c_str());
-        *err_msg = "Net Exception:" + ex.displayText();
-        return -1;
-    } catch (Poco::TimeoutException& ex) {
-        SDK_LOG_ERR("TimeoutException:%s", ex.displayText().c_str());
-        *err_msg = "TimeoutException:" + ex.displayText();
-        return -1;
-    } catch (const std::exception &ex) {
-        SDK_LOG_ERR("Exception:%s, errno=%d", std::string(ex.what()).c_str(), errno);
-        *err_msg = "Exception:" + std::string(ex.what());
-        return -1;
-    }
-
-    return res.getStatus();
+                            bool is_check_md5,
+                            RequestContext* ctx) {
+    return HttpTransport::GetTransport()->SendRequest(http_method,
+                                                      url_str,
+                                                      req_params,
+                                                      req_headers,
+                                                      req_body,
+                                                      conn_timeout_in_ms,
+                                                      recv_timeout_in_ms,
+                                                      resp_headers,
+                                                      xml_err_str,
+                                                      resp_stream,
+                                                      err_msg,
+                                                      real_byte,
+                                                      is_check_md5,
+                                                      ctx);
 }
+
 // TODO(sevenyou) 挪走
 uint64_t HttpSender::GetTimeStampInUs() {
     // 构造时间
@@ -420,4 +242,10 @@ uint64_t HttpSender::GetTimeStampInUs() {
     return tv.tv_sec * 1000000 + tv.tv_usec;
 }
 
+uint64_t HttpSender::GetMonotonicTimeInUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
 } // namespace qcloud_cos
@@ -0,0 +1,405 @@
+#include "util/http_session_pool.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "Poco/Net/Context.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPSClientSession.h"
+#include "Poco/Net/IPAddress.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/Net/SecureStreamSocket.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/URI.h"
+
+#include "cos_sys_config.h"
+#include "util/dns_cache.h"
+#include "util/http_sender.h"
+#include "util/string_util.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 开启DNS缓存时, 新建连接最多依次尝试的地址数, 避免地址较多时等待过多个连接超时
+const size_t kMaxConnectAttempts = 3;
+} // namespace
+
+HttpSessionPool& HttpSessionPool::Instance() {
+    // DnsCache须先于连接池构造, 以便在连接池析构并关闭空闲连接之后才析构
+    DnsCache::Instance();
+    static HttpSessionPool pool;
+    return pool;
+}
+
+HttpSessionPool::~HttpSessionPool() {
+    Clear();
+}
+
+Poco::Net::Context::Ptr HttpSessionPool::CreateSslContext() {
+    Poco::Net::Context::Ptr context = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE,
+                                             "", "", "", Poco::Net::Context::VERIFY_RELAXED,
+                                             9, true, "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
+    // 开启客户端session缓存, 新建连接时可携带之前的session/ticket进行握手恢复
+    context->enableSessionCache(true);
+    return context;
+}
+
+void HttpSessionPool::InitSslContext() {
+    SimpleMutexLocker locker(&m_mutex);
+    if (m_ssl_context.isNull()) {
+        m_ssl_context = CreateSslContext();
+    }
+}
+
+void HttpSessionPool::ResetSslContext() {
+    SimpleMutexLocker locker(&m_mutex);
+    m_tls_sessions.clear();
+    m_ssl_context = NULL;
+}
+
+std::string HttpSessionPool::GetSessionKey(bool is_https, const std::string& host,
+                                           uint16_t port) {
+    std::string key = is_https ? "https://" : "http://";
+    key += host + ":" + StringUtil::IntToString(port);
+    return key;
+}
+
+Poco::Net::HTTPClientSession* HttpSessionPool::CreateSession(const Poco::URI& url,
+                                                             bool is_https) {
+    Poco::Net::HTTPClientSession* session = NULL;
+    if (is_https) {
+        Poco::Net::Context::Ptr context;
+        Poco::Net::Session::Ptr tls_session;
+        {
+            SimpleMutexLocker locker(&m_mutex);
+            // 未经CosInit直接使用HttpSender时, 在此处创建共享Context
+            if (m_ssl_context.isNull()) {
+                m_ssl_context = CreateSslContext();
+            }
+            context = m_ssl_context;
+
+            TlsSessionMap::const_iterator itr = m_tls_sessions.find(
+                GetSessionKey(is_https, url.getHost(), url.getPort()));
+            if (itr != m_tls_sessions.end()) {
+                tls_session = itr->second;
+            }
+        }
+        session = new Poco::Net::HTTPSClientSession(url.getHost(), url.getPort(),
+                                                    context, tls_session);
+    } else {
+        session = new Poco::Net::HTTPClientSession(url.getHost(), url.getPort());
+    }
+
+    // 连接由Connect预先建立, session须保持keep-alive, 否则Poco会在sendRequest时关闭并重连
+    // Connection头由HttpSender按KeepAlive配置设置, 未开启长连接时归还即关闭
+    // Poco从上次sendRequest起计算keep-alive超时, 超时后会在sendRequest内部静默重连,
+    // 绕过Connect的地址选择和耗时统计; 空闲超时由连接池的ReapStaleSessions负责, 这里设为无穷大
+    session->setKeepAlive(true);
+    session->setKeepAliveTimeout(
+        Poco::Timespan(std::numeric_limits<Poco::Timespan::TimeDiff>::max()));
+    return session;
+}
+
+Poco::Net::HTTPClientSession* HttpSessionPool::Acquire(const Poco::URI& url,
+                                                      bool* is_new_session) {
+    bool is_https = StringUtil::StringStartsWithIgnoreCase(url.getScheme(), "https");
+    if (is_new_session != NULL) {
+        *is_new_session = true;
+    }
+    if (!CosSysConfig::GetKeepAlive()) {
+        return CreateSession(url, is_https);
+    }
+
+    Poco::Net::HTTPClientSession* session = NULL;
+    std::deque<Poco::Net::HTTPClientSession*> stale_sessions;
+    {
+        SimpleMutexLocker locker(&m_mutex);
+        ReapStaleSessions(HttpSender::GetTimeStampInUs() / 1000, &stale_sessions);
+
+        SessionMap::iterator itr = m_idle_sessions.find(
+            GetSessionKey(is_https, url.getHost(), url.getPort()));
+        if (itr != m_idle_sessions.end() && !itr->second.empty()) {
+            // 优先复用最近归还的连接, 其TCP/TLS状态最新
+            session = itr->second.back().m_session;
+            itr->second.pop_back();
+            --m_idle_num;
+        }
+    }
+
+    for (std::deque<Poco::Net::HTTPClientSession*>::iterator itr = stale_sessions.begin();
+         itr != stale_sessions.end(); ++itr) {
+        DestroySession(*itr);
+    }
+
+    if (session != NULL) {
+        SDK_LOG_DBG("Reuse idle session, host=%s, port=%u",
+                    url.getHost().c_str(), url.getPort());
+        if (is_new_session != NULL) {
+            *is_new_session = false;
+        }
+        return session;
+    }
+
+    return CreateSession(url, is_https);
+}
+
+void HttpSessionPool::Connect(Poco::Net::HTTPClientSession* session, RequestTiming* timing) {
+    if (session->connected()) {
+        return;
+    }
+
+    ++timing->m_new_session_num;
+    uint64_t begin_in_us = HttpSender::GetMonotonicTimeInUs();
+    std::vector<std::string> addrs;
+    ResolveAddresses(session->getHost(), &addrs);
+    uint64_t resolved_in_us = HttpSender::GetMonotonicTimeInUs();
+    timing->m_dns_time_in_us = resolved_in_us - begin_in_us;
+
+    Poco::Timespan timeout = session->getTimeout();
+    if (!session->secure()) {
+        Poco::Net::StreamSocket& ss = session->socket();
+        ConnectSocket(session, ss, addrs, timeout);
+        ss.setSendTimeout(timeout);
+        ss.setNoDelay(true);
+        timing->m_connect_time_in_us = HttpSender::GetMonotonicTimeInUs() - resolved_in_us;
+        return;
+    }
+
+    // 与HTTPSClientSession::connect相同, 但推迟握手以便分别统计建连和握手的耗时
+    Poco::Net::HTTPSClientSession* https_session =
+        static_cast<Poco::Net::HTTPSClientSession*>(session);
+    Poco::Net::SecureStreamSocket secure_socket(session->socket());
+    secure_socket.setPeerHostName(session->getHost());
+    secure_socket.useSession(https_session->sslSession());
+    secure_socket.setLazyHandshake(true);
+    ConnectSocket(session, secure_socket, addrs, timeout);
+    secure_socket.setSendTimeout(timeout);
+    secure_socket.setNoDelay(true);
+    uint64_t connected_in_us = HttpSender::GetMonotonicTimeInUs();
+    timing->m_connect_time_in_us = connected_in_us - resolved_in_us;
+
+    secure_socket.setReceiveTimeout(timeout);
+    secure_socket.completeHandshake();
+    timing->m_tls_time_in_us = HttpSender::GetMonotonicTimeInUs() - connected_in_us;
+}
+
+void HttpSessionPool::ResolveAddresses(const std::string& host, std::vector<std::string>* addrs) {
+    Poco::Net::IPAddress ip;
+    if (!CosSysConfig::IsDnsCacheEnable() || Poco::Net::IPAddress::tryParse(host, ip)) {
+        // 未开启DNS缓存时由Poco::Net::SocketAddress在连接时解析
+        addrs->push_back(host);
+        return;
+    }
+
+    std::string err_msg;
+    if (!DnsCache::Instance().GetAddresses(host, addrs, &err_msg)) {
+        throw Poco::Net::HostNotFoundException(err_msg);
+    }
+}
+
+void HttpSessionPool::ConnectSocket(Poco::Net::HTTPClientSession* session,
+                                    Poco::Net::StreamSocket& ss,
+                                    const std::vector<std::string>& addrs,
+                                    const Poco::Timespan& timeout) {
+    bool is_dns_cache_enable = CosSysConfig::IsDnsCacheEnable();
+    size_t attempt_num = std::min(addrs.size(), kMaxConnectAttempts);
+    for (size_t i = 0; i < attempt_num; ++i) {
+        try {
+            ss.connect(Poco::Net::SocketAddress(addrs[i], session->getPort()), timeout);
+        } catch (const Poco::Exception& ex) {
+            if (!is_dns_cache_enable) {
+                throw;
+            }
+            DnsCache::Instance().MarkFailed(addrs[i]);
+            if (i + 1 == attempt_num) {
+                throw;
+            }
+            SDK_LOG_WARN("Connect %s(%s) fail, %s, try next address", session->getHost().c_str(),
+                         addrs[i].c_str(), ex.displayText().c_str());
+            // 连接失败的socket状态不确定, 关闭后下次connect重新创建
+            ss.close();
+            continue;
+        }
+
+        if (!is_dns_cache_enable) {
+            return;
+        }
+        DnsCache::Instance().AddConnection(addrs[i]);
+        std::string prev_addr;
+        {
+            SimpleMutexLocker locker(&m_mutex);
+            std::string& session_addr = m_session_addrs[session];
+            prev_addr.swap(session_addr);
+            session_addr = addrs[i];
+        }
+        // session重新建立连接时, 之前的连接已关闭
+        if (!prev_addr.empty()) {
+            DnsCache::Instance().RemoveConnection(prev_addr);
+        }
+        return;
+    }
+}
+
+void HttpSessionPool::DestroySession(Poco::Net::HTTPClientSession* session) {
+    std::string addr;
+    {
+        SimpleMutexLocker locker(&m_mutex);
+        std::map<Poco::Net::HTTPClientSession*, std::string>::iterator itr =
+            m_session_addrs.find(session);
+        if (itr != m_session_addrs.end()) {
+            addr = itr->second;
+            m_session_addrs.erase(itr);
+        }
+    }
+    if (!addr.empty()) {
+        DnsCache::Instance().RemoveConnection(addr);
+    }
+    delete session;
+}
+
+void HttpSessionPool::Release(Poco::Net::HTTPClientSession* session, bool reusable,
+                              bool is_new_session) {
+    if (session == NULL) {
+        return;
+    }
+
+    if (session->secure()) {
+        RecordTlsSession(session, is_new_session);
+    }
+
+    if (!reusable || !CosSysConfig::GetKeepAlive() || !session->connected()) {
+        DestroySession(session);
+        return;
+    }
+
+    ApplyKeepAliveOption(session);
+
+    std::deque<Poco::Net::HTTPClientSession*> stale_sessions;
+    bool is_pooled = false;
+    {
+        SimpleMutexLocker locker(&m_mutex);
+        uint64_t now_in_ms = HttpSender::GetTimeStampInUs() / 1000;
+        ReapStaleSessions(now_in_ms, &stale_sessions);
+
+        std::deque<IdleSession>& idle_sessions = m_idle_sessions[
+            GetSessionKey(session->secure(), session->getHost(), session->getPort())];
+        if (idle_sessions.size() < CosSysConfig::GetMaxIdleSessionsPerHost()) {
+            IdleSession idle_session;
+            idle_session.m_session = session;
+            idle_session.m_idle_since_in_ms = now_in_ms;
+            idle_sessions.push_back(idle_session);
+            ++m_idle_num;
+            is_pooled = true;
+        }
+    }
+
+    if (!is_pooled) {
+        stale_sessions.push_back(session);
+    }
+
+    for (std::deque<Poco::Net::HTTPClientSession*>::iterator itr = stale_sessions.begin();
+         itr != stale_sessions.end(); ++itr) {
+        DestroySession(*itr);
+    }
+}
+
+void HttpSessionPool::Clear() {
+    SessionMap idle_sessions;
+    {
+        SimpleMutexLocker locker(&m_mutex);
+        idle_sessions.swap(m_idle_sessions);
+        m_idle_num = 0;
+    }
+
+    for (SessionMap::iterator itr = idle_sessions.begin(); itr != idle_sessions.end(); ++itr) {
+        for (std::deque<IdleSession>::iterator s_itr = itr->second.begin();
+             s_itr != itr->second.end(); ++s_itr) {
+            DestroySession(s_itr->m_session);
+        }
+    }
+}
+
+size_t HttpSessionPool::GetIdleSessionNum() {
+    SimpleMutexLocker locker(&m_mutex);
+    return m_idle_num;
+}
+
+void HttpSessionPool::GetTlsHandshakeNum(uint64_t* full_handshake_num,
+                                         uint64_t* resumed_handshake_num) {
+    SimpleMutexLocker locker(&m_mutex);
+    if (full_handshake_num != NULL) {
+        *full_handshake_num = m_full_handshake_num;
+    }
+    if (resumed_handshake_num != NULL) {
+        *resumed_handshake_num = m_resumed_handshake_num;
+    }
+}
+
+void HttpSessionPool::RecordTlsSession(Poco::Net::HTTPClientSession* session,
+                                       bool is_new_session) {
+    // 连接未建立(如DNS或connect失败)时没有发生握手
+    if (!session->connected()) {
+        return;
+    }
+
+    // 连接由Connect建立, 握手得到的session只记录在socket上
+    bool is_resumed = false;
+    Poco::Net::Session::Ptr tls_session;
+    try {
+        Poco::Net::SecureStreamSocket secure_socket(session->socket());
+        is_resumed = secure_socket.sessionWasReused();
+        tls_session = secure_socket.currentSession();
+    } catch (const Poco::Exception& ex) {
+        SDK_LOG_WARN("Get tls session state fail, %s", ex.displayText().c_str());
+        return;
+    }
+
+    SimpleMutexLocker locker(&m_mutex);
+    if (is_new_session) {
+        if (is_resumed) {
+            ++m_resumed_handshake_num;
+        } else {
+            ++m_full_handshake_num;
+        }
+    }
+
+    if (!tls_session.isNull()) {
+        m_tls_sessions[GetSessionKey(true, session->getHost(), session->getPort())] = tls_session;
+    }
+}
+
+void HttpSessionPool::ApplyKeepAliveOption(Poco::Net::HTTPClientSession* session) {
+    try {
+        Poco::Net::StreamSocket& ss = session->socket();
+        ss.setKeepAlive(true);
+#ifdef TCP_KEEPIDLE
+        ss.setOption(IPPROTO_TCP, TCP_KEEPIDLE, static_cast<int>(CosSysConfig::GetKeepIdle()));
+#endif
+#ifdef TCP_KEEPINTVL
+        ss.setOption(IPPROTO_TCP, TCP_KEEPINTVL, static_cast<int>(CosSysConfig::GetKeepIntvl()));
+#endif
+    } catch (const Poco::Exception& ex) {
+        SDK_LOG_WARN("Set keepalive option fail, %s", ex.displayText().c_str());
+    }
+}
+
+void HttpSessionPool::ReapStaleSessions(uint64_t now_in_ms,
+                                        std::deque<Poco::Net::HTTPClientSession*>* stale_sessions) {
+    uint64_t idle_timeout_in_ms = CosSysConfig::GetIdleSessionTimeoutInms();
+    for (SessionMap::iterator itr = m_idle_sessions.begin(); itr != m_idle_sessions.end(); ++itr) {
+        // 队列按归还时间有序, 队首最旧; 系统时间回拨时也视为过期
+        std::deque<IdleSession>& idle_sessions = itr->second;
+        while (!idle_sessions.empty()
+               && (now_in_ms < idle_sessions.front().m_idle_since_in_ms
+                   || now_in_ms - idle_sessions.front().m_idle_since_in_ms >= idle_timeout_in_ms)) {
+            stale_sessions->push_back(idle_sessions.front().m_session);
+            idle_sessions.pop_front();
+            --m_idle_num;
+        }
+    }
+}
+
+} // namespace qcloud_cos
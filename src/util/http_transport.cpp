@@ -0,0 +1,64 @@
+#include "util/http_transport.h"
+
+#include "cos_sys_config.h"
+#include "util/body_source.h"
+#include "util/poco_http_transport.h"
+#include "util/simple_mutex.h"
+#ifdef ENABLE_CURL_TRANSPORT
+#include "util/curl_http_transport.h"
+#endif
+
+namespace qcloud_cos {
+
+namespace {
+SimpleMutex s_transport_mutex;
+// 通过SetTransport注入的传输层, 优先于按配置创建的传输层
+Poco::SharedPtr<HttpTransport> s_injected_transport;
+// 按CosSysConfig::GetHttpTransport创建的传输层, 配置变化时重新创建
+Poco::SharedPtr<HttpTransport> s_configured_transport;
+std::string s_configured_name;
+} // namespace
+
+const char HttpTransport::kCancelledErrMsg[] = "Cancelled:request is cancelled";
+
+Poco::SharedPtr<HttpTransport> HttpTransport::GetTransport() {
+    std::string name = CosSysConfig::GetHttpTransport();
+    SimpleMutexLocker locker(&s_transport_mutex);
+    if (!s_injected_transport.isNull()) {
+        return s_injected_transport;
+    }
+    if (s_configured_transport.isNull() || s_configured_name != name) {
+        HttpTransport* transport = Create(name);
+        if (transport == NULL) {
+            SDK_LOG_WARN("Unknown or unavailable http transport %s, use poco", name.c_str());
+            transport = new PocoHttpTransport();
+        }
+        s_configured_transport = transport;
+        s_configured_name = name;
+    }
+    return s_configured_transport;
+}
+
+void HttpTransport::SetTransport(const Poco::SharedPtr<HttpTransport>& transport) {
+    SimpleMutexLocker locker(&s_transport_mutex);
+    s_injected_transport = transport;
+}
+
+HttpTransport* HttpTransport::Create(const std::string& name) {
+    if (name == "poco") {
+        return new PocoHttpTransport();
+    }
+#ifdef ENABLE_CURL_TRANSPORT
+    if (name == "curl") {
+        return new CurlHttpTransport();
+    }
+#endif
+    return NULL;
+}
+
+bool HttpTransport::ShouldExpectContinue(BodySource& req_body) {
+    uint64_t threshold = CosSysConfig::GetExpectContinueThreshold();
+    return threshold > 0 && (req_body.IsChunked() || req_body.GetLength() >= threshold);
+}
+
+} // namespace qcloud_cos
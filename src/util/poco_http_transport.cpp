@@ -0,0 +1,412 @@
+#include "util/poco_http_transport.h"
+
+#include <strings.h>
+
+#include <sstream>
+#include <vector>
+
+#include "Poco/CountingStream.h"
+#include "Poco/InflatingStream.h"
+#include "Poco/MD5Engine.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/URI.h"
+
+#include "cos_sys_config.h"
+#include "util/body_source.h"
+#include "util/codec_util.h"
+#include "util/http_sender.h"
+#include "util/http_session_pool.h"
+#include "util/string_util.h"
+
+namespace qcloud_cos {
+
+// 响应体拷贝的缓冲区大小
+static const size_t kStreamCopyBufferSize = 64 * 1024;
+
+namespace {
+// 请求发出后把连接的socket登记到RequestContext, 离开作用域时注销
+// 须在PooledSession之后构造, 保证先于连接归还连接池析构
+class ContextSocketGuard {
+public:
+    explicit ContextSocketGuard(RequestContext* ctx) : m_ctx(ctx), m_attached(false) {}
+
+    ~ContextSocketGuard() {
+        if (m_attached) {
+            m_ctx->DetachSocket();
+        }
+    }
+
+    // 请求已被取消时返回false
+    bool Attach(Poco::Net::HTTPClientSession* session) {
+        if (m_ctx == NULL) {
+            return true;
+        }
+        m_attached = m_ctx->AttachSocket(session->socket().impl()->sockfd());
+        return m_attached;
+    }
+
+private:
+    RequestContext* m_ctx;
+    bool m_attached;
+};
+
+// 依次记录请求各阶段的耗时, 析构时记录总耗时
+class PhaseTimer {
+public:
+    explicit PhaseTimer(RequestTiming* timing)
+        : m_timing(timing), m_start_in_us(HttpSender::GetMonotonicTimeInUs()),
+          m_last_in_us(m_start_in_us) {
+        *m_timing = RequestTiming();
+        m_timing->m_request_num = 1;
+    }
+
+    ~PhaseTimer() {
+        m_timing->m_total_time_in_us = HttpSender::GetMonotonicTimeInUs() - m_start_in_us;
+    }
+
+    RequestTiming* Get() const { return m_timing; }
+
+    // 从此刻开始计算下一阶段, 用于跳过已由连接池记录的建连阶段
+    void Mark() { m_last_in_us = HttpSender::GetMonotonicTimeInUs(); }
+
+    // 结束当前阶段, 耗时记录到phase
+    void EndPhase(uint64_t RequestTiming::* phase) {
+        uint64_t now_in_us = HttpSender::GetMonotonicTimeInUs();
+        m_timing->*phase = now_in_us - m_last_in_us;
+        m_last_in_us = now_in_us;
+    }
+
+private:
+    RequestTiming* m_timing;
+    uint64_t m_start_in_us;
+    uint64_t m_last_in_us;
+};
+
+// 已发送Expect: 100-continue的请求头, 等待服务端的中间响应
+// 超时未收到任何响应时视为服务端不支持, 返回true继续发送请求体;
+// 服务端直接返回最终响应(如403/503)时返回false, 响应头已读入res, 不应再发送请求体
+bool WaitForContinue(Poco::Net::HTTPClientSession* session, Poco::Net::HTTPResponse* res) {
+    Poco::Timespan timeout(0, CosSysConfig::GetExpectContinueTimeoutInms() * 1000);
+    if (!session->socket().poll(timeout, Poco::Net::Socket::SELECT_READ)) {
+        SDK_LOG_DBG("No interim response in %lu ms, send body",
+                    CosSysConfig::GetExpectContinueTimeoutInms());
+        return true;
+    }
+    return session->peekResponse(*res);
+}
+
+// 服务端返回了gzip压缩的响应体
+bool IsGzipEncoded(const Poco::Net::HTTPResponse& res) {
+    return !strcasecmp(StringUtil::Trim(res.get("Content-Encoding", ""), " ").c_str(), "gzip");
+}
+} // namespace
+
+int PocoHttpTransport::SendRequest(const std::string& http_method,
+                                   const std::string& url_str,
+                                   const CanonicalRequest& req_params,
+                                   const std::map<std::string, std::string>& req_headers,
+                                   BodySource& req_body,
+                                   uint64_t conn_timeout_in_ms,
+                                   uint64_t recv_timeout_in_ms,
+                                   std::map<std::string, std::string>* resp_headers,
+                                   std::ostream& resp_stream,
+                                   std::string* err_msg,
+                                   bool is_check_md5,
+                                   RequestContext* ctx) {
+    Poco::Net::HTTPResponse res;
+    RequestTiming local_timing;
+    PhaseTimer timer(ctx != NULL ? ctx->MutableTiming() : &local_timing);
+    try {
+        Poco::URI url(url_str);
+        // 从连接池借出session, 开启KeepAlive时可复用已建立的TCP/TLS连接
+        PooledSession session(url);
+
+        session->setTimeout(Poco::Timespan(0, conn_timeout_in_ms * 1000));
+        session.Connect(timer.Get());
+        timer.Mark();
+        // 1. 拼接path_query字符串
+        std::string path = url.getPath();
+        if (path.empty()) {
+            path += "/";
+        }
+
+        std::string path_and_query_str = CodecUtil::EncodeKey(path) + req_params.GetQueryString();
+        //std::string path_and_query_str = CodecUtil::EncodeKey(path) + CodecUtil::UrlEncode("?response-content-type") + "= " + CodecUtil::UrlEncode("abcd\r\rnef");
+
+        // 2. 创建http request, 并填充头部
+        Poco::Net::HTTPRequest req(http_method, path_and_query_str, Poco::Net::HTTPMessage::HTTP_1_1);
+        for (std::map<std::string, std::string>::const_iterator c_itr = req_headers.begin();
+                c_itr != req_headers.end(); ++c_itr) {
+            req.add(c_itr->first, (c_itr->second).c_str());
+        }
+
+        // 3. 计算长度, 长度未知时以chunked编码边读边发送
+        if (req_body.IsChunked()) {
+            req.setChunkedTransferEncoding(true);
+        } else {
+            req.setContentLength64(req_body.GetLength());
+        }
+        req.setKeepAlive(CosSysConfig::GetKeepAlive());
+        if (ShouldExpectContinue(req_body)) {
+            req.setExpectContinue(true);
+        }
+
+#ifdef __COS_DEBUG__
+        std::ostringstream debug_os;
+        req.write(debug_os);
+        SDK_LOG_DBG("request=[%s]", debug_os.str().c_str());
+#endif
+
+        // 4. 发送请求
+        std::ostream& os = session->sendRequest(req);
+        ContextSocketGuard ctx_guard(ctx);
+        if (!ctx_guard.Attach(session.Get())) {
+            *err_msg = kCancelledErrMsg;
+            return -1;
+        }
+        // 请求被服务端提前拒绝时不发送请求体, 此时连接的状态不确定, 不再复用
+        bool is_body_sent = !req.getExpectContinue() || WaitForContinue(session.Get(), &res);
+        if (is_body_sent) {
+            timer.Get()->m_bytes_sent = req_body.WriteTo(os);
+        } else {
+            SDK_LOG_INFO("Request rejected before sending body, status=%d", res.getStatus());
+        }
+        timer.EndPhase(&RequestTiming::m_send_time_in_us);
+
+        // 5. 接收返回
+        Poco::Net::StreamSocket& ss = session->socket();
+        ss.setReceiveTimeout(Poco::Timespan(0, recv_timeout_in_ms * 1000));
+        std::istream& recv_stream = session->receiveResponse(res);
+        timer.EndPhase(&RequestTiming::m_first_byte_time_in_us);
+        if (ctx != NULL && !ctx->OnResponseHeader()) {
+            SDK_LOG_INFO("Request cancelled after response header, status=%d", res.getStatus());
+            *err_msg = kCancelledErrMsg;
+            return -1;
+        }
+
+        // 6. 处理返回
+        int ret = res.getStatus();
+        resp_headers->insert(res.begin(), res.end());
+
+        std::string etag = "";
+        std::map<std::string, std::string>::const_iterator etag_itr
+            = resp_headers->find("ETag");
+        if (etag_itr != resp_headers->end()) {
+            etag = StringUtil::Trim(etag_itr->second, "\"");
+        }
+
+        if (is_check_md5 && !StringUtil::IsV4ETag(etag)
+            && !StringUtil::IsMultipartUploadETag(etag)) {
+            SDK_LOG_DBG("Check Response Md5");
+            std::string md5_str;
+            timer.Get()->m_bytes_received = CopyStreamWithMd5(recv_stream, resp_stream, &md5_str);
+
+            if (etag != md5_str) {
+                *err_msg = "Md5 of response body is not equal to the etag in the header."
+                    " Body Md5= " + md5_str + ", etag=" + etag;
+                SDK_LOG_ERR("Check Md5 fail, %s", err_msg->c_str());
+                ret = -1;
+            }
+        } else if (ctx != NULL && ctx->IsDecodeGzip() && IsGzipEncoded(res)) {
+            // 边接收边解压, 接收字节数按压缩后的实际传输量统计
+            Poco::CountingInputStream counting_stream(recv_stream);
+            Poco::InflatingInputStream inflating_stream(counting_stream,
+                                                        Poco::InflatingStreamBuf::STREAM_GZIP);
+            Poco::StreamCopier::copyStream(inflating_stream, resp_stream);
+            timer.Get()->m_bytes_received = counting_stream.chars();
+        } else {
+            timer.Get()->m_bytes_received = Poco::StreamCopier::copyStream(recv_stream, resp_stream);
+        }
+        timer.EndPhase(&RequestTiming::m_recv_time_in_us);
+        // 响应已完整读取, 服务端允许时归还连接池复用
+        session.SetReusable(is_body_sent && res.getKeepAlive());
+
+#ifdef __COS_DEBUG__
+        SDK_LOG_DBG("response header :\n");
+        for (std::map<std::string, std::string>::const_iterator itr = resp_headers->begin();
+             itr != resp_headers->end(); ++itr) {
+            SDK_LOG_DBG("key=[%s], value=[%s]\n", itr->first.c_str(), itr->second.c_str());
+        }
+#endif
+        SDK_LOG_INFO("Send request over, status=%d, reason=%s",
+                res.getStatus(), res.getReason().c_str());
+        return ret;
+    } catch (Poco::Net::NetException& ex){
+        SDK_LOG_ERR("Net Exception:%s", ex.displayText().c_str());
+        *err_msg = "Net Exception:" + ex.displayText();
+        return -1;
+    } catch (Poco::TimeoutException& ex) {
+        SDK_LOG_ERR("TimeoutException:%s", ex.displayText().c_str());
+        *err_msg = "TimeoutException:" + ex.displayText();
+        return -1;
+    } catch (const std::exception &ex) {
+        SDK_LOG_ERR("Exception:%s, errno=%d", std::string(ex.what()).c_str(), errno);
+        *err_msg = "Exception:" + std::string(ex.what());
+        return -1;
+    }
+
+    return res.getStatus();
+}
+
+int PocoHttpTransport::SendRequest(const std::string& http_method,
+                                   const std::string& url_str,
+                                   const CanonicalRequest& req_params,
+                                   const std::map<std::string, std::string>& req_headers,
+                                   const std::string& req_body,
+                                   uint64_t conn_timeout_in_ms,
+                                   uint64_t recv_timeout_in_ms,
+                                   std::map<std::string, std::string>* resp_headers,
+                                   std::string* xml_err_str,
+                                   std::ostream& resp_stream,
+                                   std::string* err_msg,
+                                   uint64_t* real_byte,
+                                   bool is_check_md5,
+                                   RequestContext* ctx) {
+    Poco::Net::HTTPResponse res;
+    RequestTiming local_timing;
+    PhaseTimer timer(ctx != NULL ? ctx->MutableTiming() : &local_timing);
+    try {
+        Poco::URI url(url_str);
+        // 从连接池借出session, 开启KeepAlive时可复用已建立的TCP/TLS连接
+        PooledSession session(url);
+        session->setTimeout(Poco::Timespan(0, conn_timeout_in_ms * 1000));
+        session.Connect(timer.Get());
+        timer.Mark();
+        // 1. 拼接path_query字符串
+        std::string path = url.getPath();
+        if (path.empty()) {
+            path += "/";
+        }
+
+        std::string path_and_query_str = CodecUtil::EncodeKey(path) + req_params.GetQueryString();
+        //std::string path_and_query_str = CodecUtil::EncodeKey(path) + "response-content-type=abcd%0A%0Def";
+
+        // 2. 创建http request, 并填充头部
+        Poco::Net::HTTPRequest req(http_method, path_and_query_str, Poco::Net::HTTPMessage::HTTP_1_1);
+        for (std::map<std::string, std::string>::const_iterator c_itr = req_headers.begin();
+                c_itr != req_headers.end(); ++c_itr) {
+            // 有用户这这里出了堆栈，(c_itr->second).c_str() -> c_itr->second
+            //req.add(c_itr->first, (c_itr->second).c_str());
+            req.add(c_itr->first, c_itr->second);
+        }
+        req.add("Content-Length", StringUtil::Uint64ToString(req_body.size()));
+        req.setKeepAlive(CosSysConfig::GetKeepAlive());
+
+#ifdef __COS_DEBUG__
+        std::ostringstream debug_os;
+        req.write(debug_os);
+        SDK_LOG_DBG("request=[%s]", debug_os.str().c_str());
+#endif
+
+        // 3. 发送请求
+        std::ostream& os = session->sendRequest(req);
+        ContextSocketGuard ctx_guard(ctx);
+        if (!ctx_guard.Attach(session.Get())) {
+            *err_msg = kCancelledErrMsg;
+            return -1;
+        }
+        if (!req_body.empty()) {
+            os << req_body;
+        }
+        timer.Get()->m_bytes_sent = req_body.size();
+        timer.EndPhase(&RequestTiming::m_send_time_in_us);
+
+        // 4. 接收返回
+        Poco::Net::StreamSocket& ss = session->socket();
+        ss.setReceiveTimeout(Poco::Timespan(0, recv_timeout_in_ms * 1000));
+        std::istream& recv_stream = session->receiveResponse(res);
+        timer.EndPhase(&RequestTiming::m_first_byte_time_in_us);
+        if (ctx != NULL && !ctx->OnResponseHeader()) {
+            SDK_LOG_INFO("Request cancelled after response header, status=%d", res.getStatus());
+            *err_msg = kCancelledErrMsg;
+            return -1;
+        }
+
+        // 6. 处理返回
+        int ret = res.getStatus();
+        resp_headers->insert(res.begin(), res.end());
+        if (ret != 200 && ret != 206) {
+            *real_byte = Poco::StreamCopier::copyToString(recv_stream, *xml_err_str);
+        } else {
+            std::string etag = "";
+            std::map<std::string, std::string>::const_iterator etag_itr
+                = resp_headers->find("ETag");
+            if (etag_itr != resp_headers->end()) {
+                etag = StringUtil::Trim(etag_itr->second, "\"");
+            }
+
+            if (is_check_md5 && !StringUtil::IsV4ETag(etag)
+                && !StringUtil::IsMultipartUploadETag(etag)) {
+                SDK_LOG_DBG("Check Response Md5");
+                std::string md5_str;
+                *real_byte = CopyStreamWithMd5(recv_stream, resp_stream, &md5_str);
+
+                if (etag != md5_str) {
+                    *err_msg = "Md5 of response body is not equal to the etag in the header."
+                        " Body Md5= " + md5_str + ", etag=" + etag;
+                    SDK_LOG_ERR("Check Md5 fail, %s", err_msg->c_str());
+                    ret = -1;
+                }
+            }else { // other way direct use the recv_stream
+                *real_byte = Poco::StreamCopier::copyStream(recv_stream, resp_stream);
+            }
+
+        }
+        timer.Get()->m_bytes_received = *real_byte;
+        timer.EndPhase(&RequestTiming::m_recv_time_in_us);
+        // 响应已完整读取, 服务端允许时归还连接池复用
+        session.SetReusable(res.getKeepAlive());
+
+#ifdef __COS_DEBUG__
+        SDK_LOG_DBG("response header :\n");
+        for (std::map<std::string, std::string>::const_iterator itr = resp_headers->begin();
+             itr != resp_headers->end(); ++itr) {
+            SDK_LOG_DBG("key=[%s], value=[%s]\n", itr->first.c_str(), itr->second.c_str());
+        }
+#endif
+        SDK_LOG_INFO("Send request over, status=%d, reason=%s", ret, res.getReason().c_str());
+        return ret;
+    } catch (Poco::Net::NetException& ex){
+        SDK_LOG_ERR("Net Exception:%s", ex.displayText().c_str());
+        *err_msg = "Net Exception:" + ex.displayText();
+        return -1;
+    } catch (Poco::TimeoutException& ex) {
+        SDK_LOG_ERR("TimeoutException:%s", ex.displayText().c_str());
+        *err_msg = "TimeoutException:" + ex.displayText();
+        return -1;
+    } catch (const std::exception &ex) {
+        SDK_LOG_ERR("Exception:%s, errno=%d", std::string(ex.what()).c_str(), errno);
+        *err_msg = "Exception:" + std::string(ex.what());
+        return -1;
+    }
+
+    return res.getStatus();
+}
+
+uint64_t PocoHttpTransport::CopyStreamWithMd5(std::istream& is, std::ostream& os,
+                                              std::string* md5_str) {
+    // 边读边计算MD5并写入目标流, 只遍历一次数据, 无需在内存中缓存整个响应
+    // 下载线程来自线程池, 缓冲区放在堆上以免占用其栈空间
+    Poco::MD5Engine md5;
+    std::vector<char> buffer(kStreamCopyBufferSize);
+    char* buf = &buffer[0];
+    uint64_t total = 0;
+    while (is.good()) {
+        is.read(buf, buffer.size());
+        std::streamsize n = is.gcount();
+        if (n <= 0) {
+            break;
+        }
+        md5.update(buf, static_cast<size_t>(n));
+        os.write(buf, n);
+        total += n;
+    }
+    *md5_str = Poco::DigestEngine::digestToHex(md5.digest());
+    return total;
+}
+
+} // namespace qcloud_cos
@@ -0,0 +1,21 @@
+#include "util/request_timing.h"
+
+#include "util/string_util.h"
+
+namespace qcloud_cos {
+
+std::string RequestTiming::DebugString() const {
+    return "RequestNum=" + StringUtil::Uint64ToString(m_request_num)
+        + ", NewSessionNum=" + StringUtil::Uint64ToString(m_new_session_num)
+        + ", DnsTimeInUs=" + StringUtil::Uint64ToString(m_dns_time_in_us)
+        + ", ConnectTimeInUs=" + StringUtil::Uint64ToString(m_connect_time_in_us)
+        + ", TlsTimeInUs=" + StringUtil::Uint64ToString(m_tls_time_in_us)
+        + ", SendTimeInUs=" + StringUtil::Uint64ToString(m_send_time_in_us)
+        + ", FirstByteTimeInUs=" + StringUtil::Uint64ToString(m_first_byte_time_in_us)
+        + ", RecvTimeInUs=" + StringUtil::Uint64ToString(m_recv_time_in_us)
+        + ", TotalTimeInUs=" + StringUtil::Uint64ToString(m_total_time_in_us)
+        + ", BytesSent=" + StringUtil::Uint64ToString(m_bytes_sent)
+        + ", BytesReceived=" + StringUtil::Uint64ToString(m_bytes_received);
+}
+
+} // namespace qcloud_cos
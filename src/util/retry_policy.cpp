@@ -0,0 +1,149 @@
+#include "util/retry_policy.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "cos_sys_config.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 限流时的初始等待时间为普通失败的倍数
+const uint64_t kSlowDownDelayFactor = 10;
+
+// HttpSender::SendRequest返回-1时错误信息的前缀
+const char kNetExceptionPrefix[] = "Net Exception:";
+const char kTimeoutExceptionPrefix[] = "TimeoutException:";
+const char kMd5MismatchPrefix[] = "Md5 of response body";
+
+__thread unsigned s_jitter_seed = 0;
+
+bool StartsWith(const std::string& str, const char* prefix, size_t prefix_len) {
+    return str.compare(0, prefix_len, prefix) == 0;
+}
+
+uint64_t RandomInRange(uint64_t max_value) {
+    if (s_jitter_seed == 0) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        s_jitter_seed = tv.tv_usec ^ static_cast<unsigned>((uintptr_t)pthread_self()) ^ 1;
+    }
+    uint64_t rand_value = (static_cast<uint64_t>(rand_r(&s_jitter_seed)) << 31)
+        | static_cast<uint64_t>(rand_r(&s_jitter_seed));
+    return rand_value % (max_value + 1);
+}
+} // namespace
+
+RetryPolicy::RetryPolicy()
+    : m_max_retry_times(CosSysConfig::GetMaxRetryTimes()),
+      m_base_delay_in_ms(CosSysConfig::GetRetryBaseDelayInms()),
+      m_max_delay_in_ms(CosSysConfig::GetRetryMaxDelayInms()) {
+}
+
+RetryPolicy::RetryPolicy(unsigned max_retry_times, uint64_t base_delay_in_ms,
+                         uint64_t max_delay_in_ms)
+    : m_max_retry_times(max_retry_times), m_base_delay_in_ms(base_delay_in_ms),
+      m_max_delay_in_ms(max_delay_in_ms) {
+}
+
+RetryableError RetryPolicy::Classify(int http_code, const std::string& err_code,
+                                     const std::string& err_msg) {
+    if (http_code == -1) {
+        if (StartsWith(err_msg, kNetExceptionPrefix, sizeof(kNetExceptionPrefix) - 1)
+            || StartsWith(err_msg, kTimeoutExceptionPrefix,
+                          sizeof(kTimeoutExceptionPrefix) - 1)) {
+            return kRetryNetworkError;
+        }
+        if (StartsWith(err_msg, kMd5MismatchPrefix, sizeof(kMd5MismatchPrefix) - 1)) {
+            return kRetryChecksumMismatch;
+        }
+        // 读取本地文件失败等SDK内部错误, 重试无益
+        return kNotRetryable;
+    }
+
+    if (http_code == 503 && err_code == "SlowDown") {
+        return kRetrySlowDown;
+    }
+    if (http_code >= 500 && http_code <= 599) {
+        return kRetryServerError;
+    }
+    return kNotRetryable;
+}
+
+RetryableError RetryPolicy::ClassifyResponse(int http_code, const std::string& resp_body,
+                                             const std::string& err_msg) {
+    std::string err_code;
+    if (http_code == 503) {
+        // 只需区分是否为SlowDown, 不必完整解析xml
+        static const std::string kCodeBegin = "<Code>";
+        size_t begin = resp_body.find(kCodeBegin);
+        if (begin != std::string::npos) {
+            begin += kCodeBegin.size();
+            size_t end = resp_body.find('<', begin);
+            if (end != std::string::npos) {
+                err_code = resp_body.substr(begin, end - begin);
+            }
+        }
+    }
+    return Classify(http_code, err_code, err_msg);
+}
+
+bool RetryPolicy::IsIdempotent(const std::string& http_method) {
+    const char* method = http_method.c_str();
+    return !strcasecmp(method, "GET")
+        || !strcasecmp(method, "HEAD")
+        || !strcasecmp(method, "PUT")
+        || !strcasecmp(method, "DELETE")
+        || !strcasecmp(method, "OPTIONS");
+}
+
+bool RetryPolicy::ShouldRetry(const std::string& http_method, RetryableError error,
+                              unsigned attempt) const {
+    if (error == kNotRetryable || attempt > m_max_retry_times) {
+        return false;
+    }
+    // 限流时请求未被执行, 任何方法都可以重试; 其他失败下请求可能已生效
+    return error == kRetrySlowDown || IsIdempotent(http_method);
+}
+
+uint64_t RetryPolicy::GetDelayInms(RetryableError error, unsigned attempt) const {
+    uint64_t delay_in_ms = m_base_delay_in_ms;
+    if (error == kRetrySlowDown) {
+        delay_in_ms *= kSlowDownDelayFactor;
+    }
+    for (unsigned i = 1; i < attempt && delay_in_ms < m_max_delay_in_ms; ++i) {
+        delay_in_ms *= 2;
+    }
+    if (delay_in_ms > m_max_delay_in_ms) {
+        delay_in_ms = m_max_delay_in_ms;
+    }
+
+    // 限流时至少等待一半的退避时间, 其余情况在[0, 退避时间]内随机
+    if (error == kRetrySlowDown) {
+        return delay_in_ms / 2 + RandomInRange(delay_in_ms - delay_in_ms / 2);
+    }
+    return RandomInRange(delay_in_ms);
+}
+
+void RetryPolicy::Backoff(RetryableError error, unsigned attempt) const {
+    uint64_t delay_in_ms = GetDelayInms(error, attempt);
+    if (delay_in_ms > 0) {
+        usleep(delay_in_ms * 1000);
+    }
+}
+
+bool RetryPolicy::WaitForRetry(const std::string& http_method, RetryableError error,
+                               unsigned attempt) const {
+    if (!ShouldRetry(http_method, error, attempt)) {
+        return false;
+    }
+    SDK_LOG_WARN("Request fail, method=%s, error_type=%d, attempt=%u, retry later",
+                 http_method.c_str(), error, attempt);
+    Backoff(error, attempt);
+    return true;
+}
+
+} // namespace qcloud_cos
@@ -5,29 +5,125 @@
 #include <iostream>
 #include <sstream>
 
+#include <openssl/evp.h>
+
 #include "util/string_util.h"
 
+// OpenSSL 1.1.0之前EVP_MD_CTX的创建与释放接口名称不同
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+#define EVP_MD_CTX_new EVP_MD_CTX_create
+#define EVP_MD_CTX_free EVP_MD_CTX_destroy
+#endif
+
 namespace qcloud_cos {
 
-Sha1::Sha1() {
-    ShaInit(&m_sha);
+static std::string DigestToHex(const unsigned char digest[SHA_DIGESTSIZE]) {
+    static const char kHexChars[] = "0123456789abcdef";
+    std::string hex(SHA_DIGESTSIZE * 2, '\0');
+    for (int i = 0; i < SHA_DIGESTSIZE; ++i) {
+        hex[2 * i] = kHexChars[digest[i] >> 4];
+        hex[2 * i + 1] = kHexChars[digest[i] & 0x0f];
+    }
+    return hex;
+}
+
+static EVP_MD_CTX* ToMdCtx(void* ctx) {
+    return static_cast<EVP_MD_CTX*>(ctx);
+}
+
+Sha1::Sha1() : m_ctx(EVP_MD_CTX_new()) {
+    EVP_DigestInit_ex(ToMdCtx(m_ctx), EVP_sha1(), NULL);
 }
 
 Sha1::~Sha1() {
+    EVP_MD_CTX_free(ToMdCtx(m_ctx));
 }
 
 void Sha1::Append(const char* data, unsigned int size) {
-    ShaUpdate(&m_sha, (SHA_BYTE*)data, size);
+    EVP_DigestUpdate(ToMdCtx(m_ctx), data, size);
 }
 
 std::string Sha1::Final() {
-    char key[SHA_DIGESTSIZE] = {0};
-    ShaFinal((unsigned char *)key, &m_sha);
+    unsigned char digest[SHA_DIGESTSIZE];
+    EVP_DigestFinal_ex(ToMdCtx(m_ctx), digest, NULL);
+    return DigestToHex(digest);
+}
+
+HmacSha1Ctx::HmacSha1Ctx() : m_inner(EVP_MD_CTX_new()), m_outer(EVP_MD_CTX_new()) {
+    Init("");
+}
+
+HmacSha1Ctx::HmacSha1Ctx(const std::string& key)
+    : m_inner(EVP_MD_CTX_new()), m_outer(EVP_MD_CTX_new()) {
+    Init(key);
+}
+
+HmacSha1Ctx::HmacSha1Ctx(const HmacSha1Ctx& other)
+    : m_inner(EVP_MD_CTX_new()), m_outer(EVP_MD_CTX_new()) {
+    EVP_MD_CTX_copy_ex(ToMdCtx(m_inner), ToMdCtx(other.m_inner));
+    EVP_MD_CTX_copy_ex(ToMdCtx(m_outer), ToMdCtx(other.m_outer));
+}
 
-    char out[64] = {0};
-    ShaOutput((unsigned char *)key, (unsigned char*)out);
+HmacSha1Ctx& HmacSha1Ctx::operator=(const HmacSha1Ctx& other) {
+    if (this != &other) {
+        EVP_MD_CTX_copy_ex(ToMdCtx(m_inner), ToMdCtx(other.m_inner));
+        EVP_MD_CTX_copy_ex(ToMdCtx(m_outer), ToMdCtx(other.m_outer));
+    }
+    return *this;
+}
+
+HmacSha1Ctx::~HmacSha1Ctx() {
+    EVP_MD_CTX_free(ToMdCtx(m_inner));
+    EVP_MD_CTX_free(ToMdCtx(m_outer));
+}
+
+void HmacSha1Ctx::Init(const std::string& key) {
+    SHA_BYTE key_block[SHA_BLOCKSIZE] = {0};
+    if (key.size() > SHA_BLOCKSIZE) {
+        EVP_Digest(key.data(), key.size(), key_block, NULL, EVP_sha1(), NULL);
+    } else {
+        memcpy(key_block, key.data(), key.size());
+    }
+
+    SHA_BYTE pad[SHA_BLOCKSIZE];
+    for (int i = 0; i < SHA_BLOCKSIZE; ++i) {
+        pad[i] = key_block[i] ^ 0x36;
+    }
+    EVP_DigestInit_ex(ToMdCtx(m_inner), EVP_sha1(), NULL);
+    EVP_DigestUpdate(ToMdCtx(m_inner), pad, SHA_BLOCKSIZE);
+
+    for (int i = 0; i < SHA_BLOCKSIZE; ++i) {
+        pad[i] = key_block[i] ^ 0x5c;
+    }
+    EVP_DigestInit_ex(ToMdCtx(m_outer), EVP_sha1(), NULL);
+    EVP_DigestUpdate(ToMdCtx(m_outer), pad, SHA_BLOCKSIZE);
+}
+
+void HmacSha1Ctx::Compute(const std::string& plain_text,
+                          unsigned char digest[SHA_DIGESTSIZE]) const {
+    // 从预计算状态拷贝出临时上下文, 预计算状态本身只读
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    EVP_MD_CTX_copy_ex(ctx, ToMdCtx(m_inner));
+    EVP_DigestUpdate(ctx, plain_text.data(), plain_text.size());
+    unsigned char inner_digest[SHA_DIGESTSIZE];
+    EVP_DigestFinal_ex(ctx, inner_digest, NULL);
+
+    EVP_MD_CTX_copy_ex(ctx, ToMdCtx(m_outer));
+    EVP_DigestUpdate(ctx, inner_digest, SHA_DIGESTSIZE);
+    EVP_DigestFinal_ex(ctx, digest, NULL);
+    EVP_MD_CTX_free(ctx);
+}
+
+std::string HmacSha1Ctx::Digest(const std::string& plain_text) const {
+    unsigned char digest[SHA_DIGESTSIZE];
+    Compute(plain_text, digest);
+    return std::string((const char*)digest, SHA_DIGESTSIZE);
+}
 
-    return out;
+std::string HmacSha1Ctx::HexDigest(const std::string& plain_text) const {
+    unsigned char digest[SHA_DIGESTSIZE];
+    Compute(plain_text, digest);
+    return DigestToHex(digest);
 }
 
 /* UNRAVEL should be fastest & biggest */
@@ -0,0 +1,227 @@
+#include "util/task_executor.h"
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <exception>
+
+#include <boost/bind.hpp>
+
+#include "cos_sys_config.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 任务以网络IO为主, 线程数按CPU核数的倍数确定, 并保证不少于kMinDefaultThreadNum
+const unsigned kDefaultThreadNumPerCpu = 4;
+const unsigned kMinDefaultThreadNum = 16;
+
+uint64_t GetTimeStampInUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+} // namespace
+
+TaskExecutor& TaskExecutor::Instance() {
+    static TaskExecutor executor;
+    return executor;
+}
+
+TaskExecutor::TaskExecutor()
+    : m_started(false), m_stopping(false), m_busy_thread_num(0), m_completed_task_num(0),
+      m_busy_time_in_us(0), m_start_time_in_us(0) {
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+}
+
+TaskExecutor::~TaskExecutor() {
+    pthread_mutex_lock(&m_mutex);
+    m_stopping = true;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (std::vector<pthread_t>::iterator itr = m_threads.begin();
+         itr != m_threads.end(); ++itr) {
+        pthread_join(*itr, NULL);
+    }
+    m_threads.clear();
+
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+unsigned TaskExecutor::GetDefaultThreadNum() {
+    long cpu_num = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned thread_num = cpu_num > 0 ? cpu_num * kDefaultThreadNumPerCpu : 0;
+    return thread_num < kMinDefaultThreadNum ? kMinDefaultThreadNum : thread_num;
+}
+
+void TaskExecutor::Start() {
+    unsigned thread_num = CosSysConfig::GetExecutorThreadNum();
+    if (thread_num == 0) {
+        thread_num = GetDefaultThreadNum();
+    }
+
+    for (unsigned i = 0; i < thread_num; ++i) {
+        pthread_t tid;
+        int ret = pthread_create(&tid, NULL, WorkerEntry, this);
+        if (ret != 0) {
+            SDK_LOG_ERR("Create executor thread fail, index=%u, ret=%d", i, ret);
+            break;
+        }
+        m_threads.push_back(tid);
+    }
+
+    SDK_LOG_INFO("Task executor started, thread_num=%lu", m_threads.size());
+    m_start_time_in_us = GetTimeStampInUs();
+    m_started = true;
+}
+
+void TaskExecutor::Submit(const ExecutorTask& task) {
+    pthread_mutex_lock(&m_mutex);
+    if (!m_started) {
+        Start();
+    }
+
+    if (m_threads.empty()) {
+        // 无法创建任何工作线程时退化为在调用线程中执行
+        pthread_mutex_unlock(&m_mutex);
+        SDK_LOG_WARN("No executor thread available, run task in caller thread");
+        task();
+        return;
+    }
+
+    m_tasks.push_back(task);
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void TaskExecutor::GetStats(TaskExecutorStats* stats) {
+    if (stats == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    stats->m_thread_num = m_threads.size();
+    stats->m_busy_thread_num = m_busy_thread_num;
+    stats->m_queued_task_num = m_tasks.size();
+    stats->m_completed_task_num = m_completed_task_num;
+    stats->m_utilization = 0;
+    if (m_started && !m_threads.empty()) {
+        uint64_t now_in_us = GetTimeStampInUs();
+        if (now_in_us > m_start_time_in_us) {
+            double total_time_in_us =
+                static_cast<double>(now_in_us - m_start_time_in_us) * m_threads.size();
+            stats->m_utilization = m_busy_time_in_us / total_time_in_us;
+            if (stats->m_utilization > 1) {
+                stats->m_utilization = 1;
+            }
+        }
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void* TaskExecutor::WorkerEntry(void* arg) {
+    static_cast<TaskExecutor*>(arg)->WorkerLoop();
+    return NULL;
+}
+
+void TaskExecutor::WorkerLoop() {
+    while (true) {
+        pthread_mutex_lock(&m_mutex);
+        while (m_tasks.empty() && !m_stopping) {
+            pthread_cond_wait(&m_cond, &m_mutex);
+        }
+        // 退出前先执行完队列中剩余的任务
+        if (m_tasks.empty()) {
+            pthread_mutex_unlock(&m_mutex);
+            return;
+        }
+        ExecutorTask task;
+        task.swap(m_tasks.front());
+        m_tasks.pop_front();
+        ++m_busy_thread_num;
+        pthread_mutex_unlock(&m_mutex);
+
+        uint64_t begin_in_us = GetTimeStampInUs();
+        try {
+            task();
+        } catch (const std::exception& ex) {
+            SDK_LOG_ERR("Executor task throw exception, %s", ex.what());
+        } catch (...) {
+            SDK_LOG_ERR("Executor task throw unknown exception");
+        }
+        uint64_t end_in_us = GetTimeStampInUs();
+
+        pthread_mutex_lock(&m_mutex);
+        --m_busy_thread_num;
+        ++m_completed_task_num;
+        if (end_in_us > begin_in_us) {
+            m_busy_time_in_us += end_in_us - begin_in_us;
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+}
+
+TaskGroup::TaskGroup(unsigned max_concurrency)
+    : m_max_concurrency(max_concurrency > 0 ? max_concurrency : 1), m_running_num(0) {
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+}
+
+TaskGroup::~TaskGroup() {
+    Wait();
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+void TaskGroup::Schedule(const ExecutorTask& task) {
+    pthread_mutex_lock(&m_mutex);
+    if (m_running_num >= m_max_concurrency) {
+        m_pending_tasks.push_back(task);
+        pthread_mutex_unlock(&m_mutex);
+        return;
+    }
+    ++m_running_num;
+    pthread_mutex_unlock(&m_mutex);
+
+    TaskExecutor::Instance().Submit(boost::bind(&TaskGroup::RunTask, this, task));
+}
+
+void TaskGroup::Wait() {
+    pthread_mutex_lock(&m_mutex);
+    while (m_running_num > 0) {
+        pthread_cond_wait(&m_cond, &m_mutex);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void TaskGroup::RunTask(const ExecutorTask& task) {
+    try {
+        task();
+    } catch (const std::exception& ex) {
+        SDK_LOG_ERR("Task group task throw exception, %s", ex.what());
+    } catch (...) {
+        SDK_LOG_ERR("Task group task throw unknown exception");
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    if (!m_pending_tasks.empty()) {
+        // 名额直接交给组内排队的下一个任务
+        ExecutorTask next_task;
+        next_task.swap(m_pending_tasks.front());
+        m_pending_tasks.pop_front();
+        pthread_mutex_unlock(&m_mutex);
+        TaskExecutor::Instance().Submit(boost::bind(&TaskGroup::RunTask, this, next_task));
+        return;
+    }
+
+    // 解锁后本对象可能随即被Wait返回的调用方析构, 之后不能再访问成员
+    if (--m_running_num == 0) {
+        pthread_cond_broadcast(&m_cond);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+} // namespace qcloud_cos
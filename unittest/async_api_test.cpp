@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+#include <string>
+
+#include <boost/bind.hpp>
+
+#include "cos_api.h"
+#include "cos_sys_config.h"
+#include "mock_server.h"
+#include "util/simple_mutex.h"
+
+namespace qcloud_cos {
+
+// HEAD exist_object返回200, 其余返回404
+class HeadRequestHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    virtual void handleRequest(Poco::Net::HTTPServerRequest& req,
+                               Poco::Net::HTTPServerResponse& resp) {
+        if (req.getMethod() == "HEAD" && req.getURI() == "/exist_object") {
+            resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            resp.add("ETag", "\"head_etag\"");
+        } else {
+            resp.setStatus(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+        }
+        resp.setContentLength(0);
+        resp.send().flush();
+    }
+};
+
+class AsyncApiTest : public testing::Test {
+protected:
+    AsyncApiTest() : m_callback_num(0), m_callback_succ_num(0) {}
+
+    virtual void SetUp() {
+        m_server = new LocalHttpServer(new LocalHandlerFactory<HeadRequestHandler>());
+        m_sys_config.UseLocalServer(m_server->GetAddr());
+        CosSysConfig::SetMaxRetryTimes(0);
+        m_config = new CosConfig(7777, "access_key", "secret_key", "cn-north");
+    }
+
+    virtual void TearDown() {
+        delete m_config;
+        delete m_server;
+    }
+
+public:
+    // 通过boost::bind作为回调, 需为public
+    void OnHeadDone(const CosResult& result, const HeadObjectResp& resp) {
+        SimpleMutexLocker locker(&m_mutex);
+        ++m_callback_num;
+        if (result.IsSucc() && resp.GetEtag() == "head_etag") {
+            ++m_callback_succ_num;
+        }
+    }
+
+    void OnHeadDoneThrow(const CosResult& result, const HeadObjectResp& resp) {
+        OnHeadDone(result, resp);
+        throw std::runtime_error("callback exception");
+    }
+
+protected:
+    ScopedSysConfig m_sys_config;
+    LocalHttpServer* m_server;
+    CosConfig* m_config;
+    SimpleMutex m_mutex;
+    int m_callback_num;
+    int m_callback_succ_num;
+};
+
+TEST_F(AsyncApiTest, ResultTest) {
+    {
+        CosAPI client(*m_config);
+        HeadObjectReq exist_req("buckettest-7777", "exist_object");
+        HeadObjectAsyncResultPtr exist_result = client.AsyncHeadObject(exist_req,
+            boost::bind(&AsyncApiTest::OnHeadDone, this, _1, _2));
+        HeadObjectReq missing_req("buckettest-7777", "missing_object");
+        HeadObjectAsyncResultPtr missing_result = client.AsyncHeadObject(missing_req,
+            boost::bind(&AsyncApiTest::OnHeadDone, this, _1, _2));
+
+        ASSERT_TRUE(exist_result->WaitFor(10000));
+        EXPECT_TRUE(exist_result->GetResult().IsSucc())
+            << exist_result->GetResult().GetErrorInfo();
+        EXPECT_EQ("head_etag", exist_result->GetResp().GetEtag());
+
+        ASSERT_TRUE(missing_result->WaitFor(10000));
+        EXPECT_FALSE(missing_result->GetResult().IsSucc());
+        EXPECT_EQ(404, missing_result->GetResult().GetHttpStatus());
+    }
+
+    // 回调在Done中标记完成之后执行, 析构CosAPI时会等待所有任务结束
+    EXPECT_EQ(2, m_callback_num);
+    EXPECT_EQ(1, m_callback_succ_num);
+}
+
+TEST_F(AsyncApiTest, CallbackExceptionTest) {
+    // 回调抛出异常不影响结果, 也不会使CosAPI析构时一直等待
+    {
+        CosAPI client(*m_config);
+        for (int i = 0; i < 4; ++i) {
+            HeadObjectReq req("buckettest-7777", "exist_object");
+            HeadObjectAsyncResultPtr result = client.AsyncHeadObject(req,
+                boost::bind(&AsyncApiTest::OnHeadDoneThrow, this, _1, _2));
+            ASSERT_TRUE(result->WaitFor(10000));
+            EXPECT_TRUE(result->GetResult().IsSucc()) << result->GetResult().GetErrorInfo();
+        }
+    }
+    EXPECT_EQ(4, m_callback_num);
+    EXPECT_EQ(4, m_callback_succ_num);
+}
+
+} // namespace qcloud_cos
@@ -8,6 +8,9 @@
 #include "gtest/gtest.h"
 
 #include "util/auth_tool.h"
+#include "util/canonical_request.h"
+#include "util/codec_util.h"
+#include "util/sha1.h"
 #include <iostream>
 
 namespace qcloud_cos {
@@ -85,4 +88,101 @@ TEST(AuthToolTest, NormalTest) {
     EXPECT_EQ("", sign_result);
 }
 
+TEST(AuthToolTest, SignKeyCacheTest) {
+    std::map<std::string, std::string> headers;
+    headers["host"] = "hostname_test";
+    std::map<std::string, std::string> params;
+
+    std::string expected = "q-sign-algorithm=sha1&q-ak=access_key_test&q-sign-t"
+                           "ime=1502493430;1502573430&q-key-time=1502493430;150"
+                           "2573430&q-header-list=&q-url-param-list=&q-signatur"
+                           "e=122c75ad3f7c230b8cc88f4f38410b9d3d347997";
+
+    // 1. 同一窗口重复签名命中缓存, 结果不变
+    std::map<std::string, std::string> empty_headers;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(expected, AuthTool::Sign("access_key_test", "secret_key_test", "GET", "xxxx",
+                                           empty_headers, params, 1502493430, 1502573430));
+    }
+
+    // 2. 同一窗口不同secret_key不能共用缓存
+    std::string sign_a = AuthTool::Sign("access_key_test", "secret_key_a", "GET", "xxxx",
+                                        headers, params, 1502493430, 1502573430);
+    std::string sign_b = AuthTool::Sign("access_key_test", "secret_key_b", "GET", "xxxx",
+                                        headers, params, 1502493430, 1502573430);
+    EXPECT_NE(sign_a, sign_b);
+
+    // 3. 同一secret_key不同窗口不能共用缓存
+    std::string sign_c = AuthTool::Sign("access_key_test", "secret_key_a", "GET", "xxxx",
+                                        headers, params, 1502493431, 1502573431);
+    EXPECT_NE(sign_a.substr(sign_a.find("q-signature=")),
+              sign_c.substr(sign_c.find("q-signature=")));
+}
+
+TEST(AuthToolTest, CanonicalRequestTest) {
+    std::map<std::string, std::string> params;
+    params["uploadId"] = "a b";
+    params["partNumber"] = "1";
+    params["acl"] = "";
+    std::map<std::string, std::string> headers;
+    headers["Host"] = "hostname_test";
+    headers["x-cos-meta-xx"] = "meta/test";
+    headers["User-Agent"] = "unsigned";
+
+    CanonicalRequest canonical_req(params, headers);
+    // 请求行按原始key排序, 签名列表按小写key排序
+    EXPECT_EQ("?acl&partNumber=1&uploadId=a%20b", canonical_req.GetQueryString());
+    EXPECT_EQ("acl;partnumber;uploadid", canonical_req.GetParamList());
+    EXPECT_EQ("acl=&partnumber=1&uploadid=a%20b", canonical_req.GetParamValueList());
+    EXPECT_EQ("host;x-cos-meta-xx", canonical_req.GetHeaderList());
+    EXPECT_EQ("host=hostname_test&x-cos-meta-xx=meta%2Ftest",
+              canonical_req.GetHeaderValueList());
+
+    // 只由params构造时仅生成query串
+    CanonicalRequest query_only(params);
+    EXPECT_EQ(canonical_req.GetQueryString(), query_only.GetQueryString());
+    EXPECT_EQ("", query_only.GetParamList());
+
+    // 与直接传入params/headers的签名结果一致
+    EXPECT_EQ(AuthTool::Sign("access_key_test", "secret_key_test", "GET", "xxxx",
+                             headers, params, 1502493430, 1502573430),
+              AuthTool::Sign("access_key_test", "secret_key_test", "GET", "xxxx",
+                             canonical_req, 1502493430, 1502573430));
+}
+
+TEST(AuthToolTest, HmacSha1CtxTest) {
+    // RFC 2202 test case 2
+    EXPECT_EQ("effcdf6ae5eb2fa2d27416d5f184df9c259a7c79",
+              HmacSha1Ctx("Jefe").HexDigest("what do ya want for nothing?"));
+
+    // 超过分组长度的key先做哈希, 与OpenSSL的实现结果一致
+    std::string long_key(100, 'k');
+    const char* texts[] = {"", "a", "sha1\n1502493430;1502573430\nxxxx\n",
+                           "0123456789012345678901234567890123456789012345678901234567890123"};
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i) {
+        EXPECT_EQ(CodecUtil::HmacSha1(texts[i], long_key),
+                  HmacSha1Ctx(long_key).Digest(texts[i]));
+        EXPECT_EQ(CodecUtil::HmacSha1(texts[i], "secret_key_test"),
+                  HmacSha1Ctx("secret_key_test").Digest(texts[i]));
+    }
+}
+
+TEST(AuthToolTest, BatchSignerTest) {
+    std::map<std::string, std::string> empty;
+    BatchSigner signer("access_key_test", "secret_key_test", "GET", 1502493430, 1502573430);
+    ASSERT_TRUE(signer.IsValid());
+
+    // 与逐个调用AuthTool::Sign的结果一致
+    const char* uris[] = {"/", "/test.txt", "/dir/中文 key+1", ""};
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); ++i) {
+        EXPECT_EQ(AuthTool::Sign("access_key_test", "secret_key_test", "GET", uris[i],
+                                 empty, empty, 1502493430, 1502573430),
+                  signer.GetSignPrefix() + signer.GetSignature(uris[i]));
+    }
+
+    BatchSigner invalid_signer("", "secret_key_test", "GET", 1502493430, 1502573430);
+    EXPECT_FALSE(invalid_signer.IsValid());
+    EXPECT_EQ("", invalid_signer.GetSignature("/test.txt"));
+}
+
 } // namespace qcloud_cos
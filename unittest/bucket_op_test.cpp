@@ -9,6 +9,7 @@
 
 #include "common.h"
 #include "cos_api.h"
+#include "cos_sys_config.h"
 #include "util/string_util.h"
 
 namespace qcloud_cos {
@@ -296,6 +297,22 @@ TEST_F(BucketOpTest, GetBucketTest) {
         EXPECT_EQ("9", cnt_01.m_size);
         EXPECT_EQ("STANDARD_IA", cnt_01.m_storage_class);
     }
+
+    // GetBucket, 接受gzip压缩的响应, 解压后的结果应与不压缩时一致
+    {
+        CosSysConfig::SetListGzipEnable(true);
+        GetBucketReq req(m_bucket_name);
+        GetBucketResp resp;
+        req.SetPrefix("prefix");
+        CosResult result = m_client->GetBucket(req, &resp);
+        CosSysConfig::SetListGzipEnable(false);
+        EXPECT_TRUE(result.IsSucc());
+        EXPECT_EQ("prefix", resp.GetPrefix());
+        const std::vector<Content>& contents = resp.GetContents();
+        EXPECT_EQ(10, contents.size());
+        EXPECT_EQ("prefixA_0", contents[0].m_key);
+        EXPECT_EQ("3be03ea31c1d6ce899f419c04cbf1ea9", contents[0].m_etag);
+    }
     sleep(1);
 }
 
@@ -0,0 +1,205 @@
+#include "gtest/gtest.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <iostream>
+#include <string>
+
+#include "util/codec_util.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 以下为改为查表实现之前的逐字节版本, 作为对比的基准
+unsigned char RefToHex(unsigned char x) {
+    return x > 9 ? (x - 10 + 'A') : x + '0';
+}
+
+std::string RefEncode(const std::string& str, bool keep_slash) {
+    std::string encoded = "";
+    for (size_t i = 0; i < str.length(); ++i) {
+        if (isalnum((unsigned char)str[i]) || str[i] == '-' || str[i] == '_'
+            || str[i] == '.' || str[i] == '~' || (keep_slash && str[i] == '/')) {
+            encoded += str[i];
+        } else {
+            encoded += '%';
+            encoded += RefToHex((unsigned char)str[i] >> 4);
+            encoded += RefToHex((unsigned char)str[i] % 16);
+        }
+    }
+    return encoded;
+}
+
+std::string RefBase64Encode(const std::string& plain_text) {
+    static const char b64_table[65] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string retval((((plain_text.size() + 2) / 3) * 4), '=');
+    std::size_t outpos = 0;
+    int bits_collected = 0;
+    unsigned int accumulator = 0;
+    for (std::string::const_iterator i = plain_text.begin(); i != plain_text.end(); ++i) {
+        accumulator = (accumulator << 8) | (*i & 0xffu);
+        bits_collected += 8;
+        while (bits_collected >= 6) {
+            bits_collected -= 6;
+            retval[outpos++] = b64_table[(accumulator >> bits_collected) & 0x3fu];
+        }
+    }
+    if (bits_collected > 0) {
+        accumulator <<= 6 - bits_collected;
+        retval[outpos++] = b64_table[accumulator & 0x3fu];
+    }
+    return retval;
+}
+
+std::string RefBinToHex(const std::string& bin) {
+    std::string hex;
+    for (size_t i = 0; i < bin.size(); ++i) {
+        hex += RefToHex((unsigned char)bin[i] >> 4);
+        hex += RefToHex((unsigned char)bin[i] & 15);
+    }
+    return hex;
+}
+
+std::string RefHexToBin(const std::string& str_hex) {
+    if (str_hex.size() % 2 != 0) {
+        return "";
+    }
+    std::string str_bin;
+    str_bin.resize(str_hex.size() / 2);
+    for (size_t i = 0; i < str_bin.size(); i++) {
+        uint8_t tmp = 0;
+        for (size_t j = 0; j < 2; j++) {
+            char cur = str_hex[2 * i + j];
+            if (cur >= '0' && cur <= '9') {
+                tmp = (tmp << 4) + (cur - '0');
+            } else if (cur >= 'a' && cur <= 'f') {
+                tmp = (tmp << 4) + (cur - 'a' + 10);
+            } else if (cur >= 'A' && cur <= 'F') {
+                tmp = (tmp << 4) + (cur - 'A' + 10);
+            } else {
+                return "";
+            }
+        }
+        str_bin[i] = tmp;
+    }
+    return str_bin;
+}
+
+std::string BinToHex(const std::string& bin) {
+    std::string hex(bin.size() * 2, '\0');
+    if (!bin.empty()) {
+        CodecUtil::BinToHex((const unsigned char*)bin.data(), bin.size(), &hex[0]);
+    }
+    return hex;
+}
+
+std::string RandomString(size_t len, const std::string& charset) {
+    std::string str;
+    for (size_t i = 0; i < len; ++i) {
+        str.push_back(charset.empty() ? static_cast<char>(rand() % 256)
+                                      : charset[rand() % charset.size()]);
+    }
+    return str;
+}
+
+uint64_t NowInUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+} // namespace
+
+TEST(CodecUtilTest, EncodeTest) {
+    EXPECT_EQ("a%20b%2Fc~-_.", CodecUtil::UrlEncode("a b/c~-_."));
+    EXPECT_EQ("a%20b/c~-_.", CodecUtil::EncodeKey("a b/c~-_."));
+    EXPECT_EQ("%E4%B8%AD%E6%96%87", CodecUtil::EncodeKey("中文"));
+
+    // 追加形式不覆盖已有内容
+    std::string out = "?key=";
+    CodecUtil::UrlEncode("v+1", &out);
+    EXPECT_EQ("?key=v%2B1", out);
+
+    // 随机字节及常见对象名字符, 与逐字节实现的结果一致
+    srand(20171023);
+    std::string key_charset = "abcXYZ019-_.~/ +=&%中文キー";
+    for (int i = 0; i < 2000; ++i) {
+        std::string str = RandomString(rand() % 300, i % 2 ? "" : key_charset);
+        EXPECT_EQ(RefEncode(str, false), CodecUtil::UrlEncode(str));
+        EXPECT_EQ(RefEncode(str, true), CodecUtil::EncodeKey(str));
+    }
+}
+
+TEST(CodecUtilTest, Base64Test) {
+    EXPECT_EQ("", CodecUtil::Base64Encode(""));
+    EXPECT_EQ("Zg==", CodecUtil::Base64Encode("f"));
+    EXPECT_EQ("Zm8=", CodecUtil::Base64Encode("fo"));
+    EXPECT_EQ("Zm9vYmFy", CodecUtil::Base64Encode("foobar"));
+    EXPECT_EQ("foobar", CodecUtil::Base64Decode("Zm9vYmFy"));
+    EXPECT_EQ("fo", CodecUtil::Base64Decode("Zm8="));
+    EXPECT_EQ("f", CodecUtil::Base64Decode("Zg=="));
+
+    // 非法输入返回空串
+    EXPECT_EQ("", CodecUtil::Base64Decode("Zm8"));
+    EXPECT_EQ("", CodecUtil::Base64Decode("Zm=v"));
+    EXPECT_EQ("", CodecUtil::Base64Decode("Zm9v\nmFy"));
+    EXPECT_EQ("", CodecUtil::Base64Decode("===="));
+
+    srand(20171024);
+    for (int i = 0; i < 2000; ++i) {
+        std::string str = RandomString(rand() % 100, "");
+        std::string encoded = CodecUtil::Base64Encode(str);
+        EXPECT_EQ(RefBase64Encode(str), encoded);
+        if (!str.empty()) {
+            EXPECT_EQ(str, CodecUtil::Base64Decode(encoded));
+        }
+    }
+}
+
+TEST(CodecUtilTest, HexTest) {
+    EXPECT_EQ("00FF10AB", BinToHex(std::string("\x00\xff\x10\xab", 4)));
+    EXPECT_EQ(std::string("\x00\xff\x10\xab", 4), CodecUtil::HexToBin("00ff10AB"));
+    EXPECT_EQ("", CodecUtil::HexToBin("0"));
+    EXPECT_EQ("", CodecUtil::HexToBin("0g"));
+
+    srand(20171025);
+    for (int i = 0; i < 2000; ++i) {
+        std::string bin = RandomString(rand() % 64, "");
+        EXPECT_EQ(RefBinToHex(bin), BinToHex(bin));
+        std::string hex = RandomString((rand() % 64) * 2, "0123456789abcdefABCDEFxG");
+        EXPECT_EQ(RefHexToBin(hex), CodecUtil::HexToBin(hex));
+    }
+}
+
+// 对比逐字节实现与查表实现处理长的非ASCII对象名时的耗时
+// 默认不运行, 需要时加--gtest_also_run_disabled_tests
+TEST(CodecUtilTest, DISABLED_Benchmark) {
+    std::string key;
+    for (int i = 0; i < 64; ++i) {
+        key += "目录/文件名_file-";
+    }
+    const int rounds = 20000;
+
+    std::string ref_ret, ret;
+    uint64_t begin = NowInUs();
+    for (int r = 0; r < rounds; ++r) {
+        ref_ret = RefEncode(key, true);
+    }
+    uint64_t ref_cost = NowInUs() - begin;
+
+    begin = NowInUs();
+    for (int r = 0; r < rounds; ++r) {
+        ret = CodecUtil::EncodeKey(key);
+    }
+    uint64_t cost = NowInUs() - begin;
+
+    EXPECT_EQ(ref_ret, ret);
+    std::cout << "EncodeKey " << key.size() << " bytes: byte-by-byte "
+              << ref_cost * 1000 / rounds << " ns/op, table "
+              << cost * 1000 / rounds << " ns/op" << std::endl;
+}
+
+} // namespace qcloud_cos
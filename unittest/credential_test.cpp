@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "util/credential.h"
+#include "util/string_util.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 每次返回一组新的临时密钥, 有效期为m_ttl_in_s秒; m_fail为true时获取失败
+class MockCredentialProvider : public CredentialProvider {
+public:
+    explicit MockCredentialProvider(uint64_t ttl_in_s)
+        : m_ttl_in_s(ttl_in_s), m_fetch_num(0), m_fail(false) {}
+
+    virtual bool FetchCredential(Credential* credential) {
+        if (m_fail) {
+            return false;
+        }
+        ++m_fetch_num;
+        std::string no = StringUtil::Uint64ToString(m_fetch_num);
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        *credential = Credential("ak_" + no, "sk_" + no, "token_" + no, tv.tv_sec + m_ttl_in_s);
+        return true;
+    }
+
+    uint64_t m_ttl_in_s;
+    volatile uint64_t m_fetch_num;
+    volatile bool m_fail;
+};
+} // namespace
+
+TEST(CredentialTest, AtomicCredentialTest) {
+    AtomicCredential credential;
+    EXPECT_EQ("", credential.Get()->GetAccessKey());
+
+    credential.Set(Credential("ak", "sk", "token"));
+    const Credential* snapshot = credential.Get();
+    EXPECT_EQ("ak", snapshot->GetAccessKey());
+    EXPECT_EQ("sk", snapshot->GetSecretKey());
+    EXPECT_EQ("token", snapshot->GetTmpToken());
+    EXPECT_EQ(0u, snapshot->GetExpiredTimeInSec());
+
+    // 替换后旧快照仍然可读
+    credential.Set(Credential("ak2", "sk2", ""));
+    EXPECT_EQ("ak2", credential.Get()->GetAccessKey());
+    EXPECT_EQ("ak", snapshot->GetAccessKey());
+}
+
+TEST(CredentialTest, RefresherTest) {
+    MockCredentialProvider* mock = new MockCredentialProvider(2);
+    Poco::SharedPtr<CredentialProvider> provider(mock);
+    AtomicCredential credential;
+
+    {
+        CredentialRefresher refresher(provider, &credential, 1);
+        ASSERT_TRUE(refresher.Start());
+        EXPECT_EQ("ak_1", credential.Get()->GetAccessKey());
+        EXPECT_EQ("token_1", credential.Get()->GetTmpToken());
+
+        // 有效期2秒, 剩余有效期过半时刷新
+        sleep(3);
+        EXPECT_GE(mock->m_fetch_num, 2u);
+        EXPECT_EQ("ak_" + StringUtil::Uint64ToString(mock->m_fetch_num),
+                  credential.Get()->GetAccessKey());
+    }
+
+    // 首次获取失败时不启动
+    mock->m_fail = true;
+    CredentialRefresher refresher(provider, &credential, 1);
+    EXPECT_FALSE(refresher.Start());
+}
+
+} // namespace qcloud_cos
@@ -0,0 +1,291 @@
+#include "gtest/gtest.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+#include "Poco/MD5Engine.h"
+
+#include "cos_sys_config.h"
+#include "mock_server.h"
+#include "util/body_source.h"
+#include "util/canonical_request.h"
+#include "util/curl_http_transport.h"
+#include "util/http_sender.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 大于传输层的缓冲区, 需多次补充/取走
+const size_t kLargeBodyLen = 1024 * 1024;
+// 慢速请求体/响应流每次读写的耗时
+const unsigned kSlowIoDelayInms = 300;
+// 慢速读写进行期间, 其他请求的最长耗时
+const uint64_t kFastRequestMaxInms = 200;
+
+std::string GetMd5(const std::string& data) {
+    Poco::MD5Engine md5;
+    md5.update(data);
+    return Poco::DigestEngine::digestToHex(md5.digest());
+}
+
+const std::string& GetLargeBody() {
+    static std::string s_body(kLargeBodyLen, 'l');
+    return s_body;
+}
+} // namespace
+
+// PUT返回请求体的MD5作为ETag; GET /large返回带ETag的大响应体, /small返回"small", 其余返回404
+class CurlRequestHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    virtual void handleRequest(Poco::Net::HTTPServerRequest& req,
+                               Poco::Net::HTTPServerResponse& resp) {
+        std::ostringstream body;
+        Poco::StreamCopier::copyStream(req.stream(), body);
+        if (req.getMethod() == "PUT") {
+            resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            resp.add("ETag", "\"" + GetMd5(body.str()) + "\"");
+            resp.setContentLength(0);
+            resp.send().flush();
+        } else if (req.getURI() == "/large") {
+            resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            resp.add("ETag", "\"" + GetMd5(GetLargeBody()) + "\"");
+            resp.setContentLength(GetLargeBody().size());
+            resp.send() << GetLargeBody();
+        } else if (req.getURI() == "/small") {
+            resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            resp.setContentLength(5);
+            resp.send() << "small";
+        } else {
+            std::string err = "<Error><Code>NoSuchKey</Code></Error>";
+            resp.setStatus(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+            resp.setContentLength(err.size());
+            resp.send() << err;
+        }
+    }
+};
+
+// 每次Read前等待kSlowIoDelayInms, 每次最多返回64K
+class SlowBodySource : public BodySource {
+public:
+    explicit SlowBodySource(uint64_t len) : m_len(len), m_offset(0) {}
+
+    virtual ~SlowBodySource() {}
+
+    virtual uint64_t GetLength() { return m_len; }
+
+    virtual uint64_t WriteTo(std::ostream& os) {
+        char buf[4096];
+        uint64_t total = 0;
+        size_t n = 0;
+        while ((n = Read(buf, sizeof(buf))) > 0) {
+            os.write(buf, n);
+            total += n;
+        }
+        return total;
+    }
+
+    virtual size_t Read(char* buf, size_t len) {
+        usleep(kSlowIoDelayInms * 1000);
+        size_t n = static_cast<size_t>(std::min<uint64_t>(m_len - m_offset, len));
+        n = std::min<size_t>(n, 64 * 1024);
+        memset(buf, 's', n);
+        m_offset += n;
+        return n;
+    }
+
+    virtual bool Rewind() {
+        m_offset = 0;
+        return true;
+    }
+
+private:
+    uint64_t m_len;
+    uint64_t m_offset;
+};
+
+// 每次写入前等待kSlowIoDelayInms
+class SlowStreamBuf : public std::streambuf {
+public:
+    SlowStreamBuf() : m_size(0) {}
+
+    size_t GetSize() const { return m_size; }
+
+protected:
+    virtual std::streamsize xsputn(const char* /*s*/, std::streamsize n) {
+        usleep(kSlowIoDelayInms * 1000);
+        m_size += n;
+        return n;
+    }
+
+    virtual int_type overflow(int_type c) {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            ++m_size;
+        }
+        return traits_type::not_eof(c);
+    }
+
+private:
+    size_t m_size;
+};
+
+class CurlTransportTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        m_server = new LocalHttpServer(new LocalHandlerFactory<CurlRequestHandler>());
+        CosSysConfig::SetLogOutType(COS_LOG_NULL);
+        m_transport = new CurlHttpTransport();
+    }
+
+    virtual void TearDown() {
+        delete m_transport;
+        delete m_server;
+    }
+
+public:
+    // 慢速读写在单独的线程中发起, 需为public
+    std::string GetUrl(const std::string& path) const {
+        return "http://" + m_server->GetAddr() + path;
+    }
+
+    int Put(BodySource& body, std::map<std::string, std::string>* resp_headers) {
+        std::map<std::string, std::string> params;
+        std::map<std::string, std::string> headers;
+        std::ostringstream os;
+        std::string err_msg;
+        return m_transport->SendRequest("PUT", GetUrl("/put_object"), CanonicalRequest(params),
+                                        headers, body, 3000, 3000, resp_headers, os,
+                                        &err_msg, false, NULL);
+    }
+
+    int Get(const std::string& path, std::ostream& os, std::string* xml_err_str,
+            uint64_t* real_byte) {
+        std::map<std::string, std::string> params;
+        std::map<std::string, std::string> headers;
+        std::map<std::string, std::string> resp_headers;
+        std::string err_msg;
+        return m_transport->SendRequest("GET", GetUrl(path), CanonicalRequest(params), headers,
+                                        "", 3000, 3000, &resp_headers, xml_err_str, os,
+                                        &err_msg, real_byte, true, NULL);
+    }
+
+    // 返回GET /small的耗时
+    uint64_t GetSmallCostInms() {
+        std::ostringstream os;
+        std::string xml_err_str;
+        uint64_t real_byte = 0;
+        uint64_t start_in_us = HttpSender::GetMonotonicTimeInUs();
+        EXPECT_EQ(200, Get("/small", os, &xml_err_str, &real_byte));
+        EXPECT_EQ("small", os.str());
+        return (HttpSender::GetMonotonicTimeInUs() - start_in_us) / 1000;
+    }
+
+protected:
+    ScopedSysConfig m_sys_config;
+    LocalHttpServer* m_server;
+    CurlHttpTransport* m_transport;
+};
+
+namespace {
+struct SlowUploadContext {
+    CurlTransportTest* m_test;
+    uint64_t m_len;
+    int m_http_code;
+    std::map<std::string, std::string> m_resp_headers;
+};
+
+struct SlowDownloadContext {
+    CurlTransportTest* m_test;
+    SlowStreamBuf m_buf;
+    int m_http_code;
+};
+
+void* SlowUpload(void* arg) {
+    SlowUploadContext* ctx = static_cast<SlowUploadContext*>(arg);
+    SlowBodySource body(ctx->m_len);
+    ctx->m_http_code = ctx->m_test->Put(body, &ctx->m_resp_headers);
+    return NULL;
+}
+
+void* SlowDownload(void* arg) {
+    SlowDownloadContext* ctx = static_cast<SlowDownloadContext*>(arg);
+    std::ostream os(&ctx->m_buf);
+    std::string xml_err_str;
+    uint64_t real_byte = 0;
+    ctx->m_http_code = ctx->m_test->Get("/large", os, &xml_err_str, &real_byte);
+    return NULL;
+}
+} // namespace
+
+TEST_F(CurlTransportTest, UploadDownloadTest) {
+    BufferBodySource body(GetLargeBody());
+    std::map<std::string, std::string> resp_headers;
+    EXPECT_EQ(200, Put(body, &resp_headers));
+    EXPECT_EQ("\"" + GetMd5(GetLargeBody()) + "\"", resp_headers["ETag"]);
+
+    // 校验响应体MD5与ETag一致
+    std::ostringstream os;
+    std::string xml_err_str;
+    uint64_t real_byte = 0;
+    EXPECT_EQ(200, Get("/large", os, &xml_err_str, &real_byte));
+    EXPECT_EQ(kLargeBodyLen, real_byte);
+    EXPECT_TRUE(os.str() == GetLargeBody());
+    EXPECT_TRUE(xml_err_str.empty());
+}
+
+TEST_F(CurlTransportTest, ErrorResponseTest) {
+    // 错误响应写入xml_err_str, 不写入流
+    std::ostringstream os;
+    std::string xml_err_str;
+    uint64_t real_byte = 0;
+    EXPECT_EQ(404, Get("/missing", os, &xml_err_str, &real_byte));
+    EXPECT_TRUE(os.str().empty());
+    EXPECT_EQ("<Error><Code>NoSuchKey</Code></Error>", xml_err_str);
+}
+
+TEST_F(CurlTransportTest, StreamFailTest) {
+    std::ostringstream os;
+    os.setstate(std::ios::badbit);
+    std::string xml_err_str;
+    uint64_t real_byte = 0;
+    EXPECT_EQ(-1, Get("/large", os, &xml_err_str, &real_byte));
+}
+
+TEST_F(CurlTransportTest, SlowBodySourceTest) {
+    // 请求体的读取在调用线程中进行, 不阻塞事件循环中的其他请求
+    SlowUploadContext ctx;
+    ctx.m_test = this;
+    ctx.m_len = 128 * 1024;
+    ctx.m_http_code = 0;
+    pthread_t tid;
+    pthread_create(&tid, NULL, SlowUpload, &ctx);
+    usleep(kSlowIoDelayInms / 3 * 1000);
+    EXPECT_LT(GetSmallCostInms(), kFastRequestMaxInms);
+    pthread_join(tid, NULL);
+
+    EXPECT_EQ(200, ctx.m_http_code);
+    EXPECT_EQ("\"" + GetMd5(std::string(ctx.m_len, 's')) + "\"", ctx.m_resp_headers["ETag"]);
+}
+
+TEST_F(CurlTransportTest, SlowStreamTest) {
+    // 响应体的写入在调用线程中进行, 不阻塞事件循环中的其他请求
+    SlowDownloadContext ctx;
+    ctx.m_test = this;
+    ctx.m_http_code = 0;
+    pthread_t tid;
+    pthread_create(&tid, NULL, SlowDownload, &ctx);
+    usleep(kSlowIoDelayInms / 3 * 1000);
+    EXPECT_LT(GetSmallCostInms(), kFastRequestMaxInms);
+    pthread_join(tid, NULL);
+
+    EXPECT_EQ(200, ctx.m_http_code);
+    EXPECT_EQ(kLargeBodyLen, ctx.m_buf.GetSize());
+}
+
+} // namespace qcloud_cos
@@ -0,0 +1,187 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/URI.h"
+
+#include "cos_sys_config.h"
+#include "util/dns_cache.h"
+#include "util/http_session_pool.h"
+#include "util/string_util.h"
+
+namespace qcloud_cos {
+
+// 按预设结果解析, 并记录解析次数
+class FakeDnsResolver : public DnsResolver {
+public:
+    FakeDnsResolver() : m_resolve_num(0) {}
+
+    virtual bool Resolve(const std::string& host, std::vector<std::string>* addrs,
+                         std::string* err_msg) {
+        ++m_resolve_num;
+        std::map<std::string, std::vector<std::string> >::const_iterator itr =
+            m_results.find(host);
+        if (itr == m_results.end()) {
+            *err_msg = "Host not found";
+            return false;
+        }
+        *addrs = itr->second;
+        return true;
+    }
+
+    std::map<std::string, std::vector<std::string> > m_results;
+    int m_resolve_num;
+};
+
+class DnsCacheTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        m_resolver = new FakeDnsResolver();
+        std::vector<std::string>& addrs = m_resolver->m_results["bucket.test.host"];
+        addrs.push_back("10.0.0.1");
+        addrs.push_back("10.0.0.2");
+        addrs.push_back("10.0.0.3");
+        DnsCache::Instance().SetResolver(Poco::SharedPtr<DnsResolver>(m_resolver));
+        DnsCache::Instance().Clear();
+        CosSysConfig::SetDnsCacheEnable(true);
+        CosSysConfig::SetDnsCacheTtlInms(60000);
+        CosSysConfig::SetDnsNegativeTtlInms(5000);
+        CosSysConfig::SetDnsRotatePolicy(DNS_ROTATE_ROUND_ROBIN);
+    }
+
+    virtual void TearDown() {
+        DnsCache::Instance().SetResolver(Poco::SharedPtr<DnsResolver>());
+        CosSysConfig::SetDnsCacheEnable(false);
+        CosSysConfig::SetDnsRotatePolicy(DNS_ROTATE_ROUND_ROBIN);
+    }
+
+    std::vector<std::string> GetAddresses(const std::string& host) {
+        std::vector<std::string> addrs;
+        std::string err_msg;
+        EXPECT_TRUE(DnsCache::Instance().GetAddresses(host, &addrs, &err_msg)) << err_msg;
+        return addrs;
+    }
+
+    // 由DnsCache持有, TearDown中随SetResolver释放
+    FakeDnsResolver* m_resolver;
+};
+
+TEST_F(DnsCacheTest, TtlTest) {
+    EXPECT_EQ(3u, GetAddresses("bucket.test.host").size());
+    EXPECT_EQ(3u, GetAddresses("bucket.test.host").size());
+    EXPECT_EQ(1, m_resolver->m_resolve_num);
+
+    uint64_t hit_num = 0;
+    uint64_t resolve_num = 0;
+    DnsCache::Instance().GetStats(&hit_num, &resolve_num);
+    EXPECT_EQ(1u, hit_num);
+    EXPECT_EQ(1u, resolve_num);
+
+    // 过期后重新解析, 解析失败时继续使用过期的地址
+    CosSysConfig::SetDnsCacheTtlInms(50);
+    DnsCache::Instance().Clear();
+    GetAddresses("bucket.test.host");
+    usleep(100 * 1000);
+    m_resolver->m_results.clear();
+    EXPECT_EQ(3u, GetAddresses("bucket.test.host").size());
+    EXPECT_EQ(3, m_resolver->m_resolve_num);
+}
+
+TEST_F(DnsCacheTest, NegativeCacheTest) {
+    std::vector<std::string> addrs;
+    std::string err_msg;
+    EXPECT_FALSE(DnsCache::Instance().GetAddresses("unknown.test.host", &addrs, &err_msg));
+    EXPECT_FALSE(err_msg.empty());
+    EXPECT_FALSE(DnsCache::Instance().GetAddresses("unknown.test.host", &addrs, &err_msg));
+    EXPECT_EQ(1, m_resolver->m_resolve_num);
+
+    CosSysConfig::SetDnsNegativeTtlInms(50);
+    DnsCache::Instance().Clear();
+    EXPECT_FALSE(DnsCache::Instance().GetAddresses("unknown.test.host", &addrs, &err_msg));
+    usleep(100 * 1000);
+    m_resolver->m_results["unknown.test.host"].push_back("10.0.1.1");
+    EXPECT_EQ(1u, GetAddresses("unknown.test.host").size());
+}
+
+TEST_F(DnsCacheTest, RoundRobinTest) {
+    std::map<std::string, int> first_addr_num;
+    for (int i = 0; i < 30; ++i) {
+        std::vector<std::string> addrs = GetAddresses("bucket.test.host");
+        ASSERT_EQ(3u, addrs.size());
+        ++first_addr_num[addrs[0]];
+    }
+    EXPECT_EQ(10, first_addr_num["10.0.0.1"]);
+    EXPECT_EQ(10, first_addr_num["10.0.0.2"]);
+    EXPECT_EQ(10, first_addr_num["10.0.0.3"]);
+}
+
+TEST_F(DnsCacheTest, LeastLoadedTest) {
+    CosSysConfig::SetDnsRotatePolicy(DNS_ROTATE_LEAST_LOADED);
+    DnsCache::Instance().AddConnection("10.0.0.1");
+    DnsCache::Instance().AddConnection("10.0.0.1");
+    DnsCache::Instance().AddConnection("10.0.0.3");
+    for (int i = 0; i < 3; ++i) {
+        std::vector<std::string> addrs = GetAddresses("bucket.test.host");
+        ASSERT_EQ(3u, addrs.size());
+        EXPECT_EQ("10.0.0.2", addrs[0]);
+        EXPECT_EQ("10.0.0.3", addrs[1]);
+        EXPECT_EQ("10.0.0.1", addrs[2]);
+    }
+
+    DnsCache::Instance().RemoveConnection("10.0.0.1");
+    DnsCache::Instance().RemoveConnection("10.0.0.1");
+    DnsCache::Instance().AddConnection("10.0.0.2");
+    DnsCache::Instance().AddConnection("10.0.0.2");
+    EXPECT_EQ("10.0.0.1", GetAddresses("bucket.test.host")[0]);
+}
+
+TEST_F(DnsCacheTest, MarkFailedTest) {
+    DnsCache::Instance().MarkFailed("10.0.0.2");
+    for (int i = 0; i < 3; ++i) {
+        std::vector<std::string> addrs = GetAddresses("bucket.test.host");
+        ASSERT_EQ(3u, addrs.size());
+        EXPECT_EQ("10.0.0.2", addrs[2]);
+    }
+
+    // 冷却时间过后恢复参与轮询
+    CosSysConfig::SetDnsNegativeTtlInms(50);
+    DnsCache::Instance().MarkFailed("10.0.0.2");
+    usleep(100 * 1000);
+    bool is_first = false;
+    for (int i = 0; i < 3; ++i) {
+        is_first = is_first || GetAddresses("bucket.test.host")[0] == "10.0.0.2";
+    }
+    EXPECT_TRUE(is_first);
+}
+
+TEST_F(DnsCacheTest, ConnectFailoverTest) {
+    // 只监听127.0.0.1, 连接127.0.0.2的同一端口会被拒绝
+    Poco::Net::ServerSocket server_socket(Poco::Net::SocketAddress("127.0.0.1", 0));
+    std::vector<std::string>& addrs = m_resolver->m_results["failover.test.host"];
+    addrs.push_back("127.0.0.2");
+    addrs.push_back("127.0.0.1");
+    Poco::URI url("http://failover.test.host:"
+                  + StringUtil::IntToString(server_socket.address().port()) + "/");
+
+    // 轮询使两次连接中至少有一次先尝试127.0.0.2
+    for (int i = 0; i < 2; ++i) {
+        Poco::Net::HTTPClientSession* session = HttpSessionPool::Instance().Acquire(url);
+        RequestTiming timing;
+        EXPECT_NO_THROW(HttpSessionPool::Instance().Connect(session, &timing));
+        EXPECT_TRUE(session->connected());
+        HttpSessionPool::Instance().Release(session, false);
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_EQ("127.0.0.1", GetAddresses("failover.test.host")[0]);
+    }
+}
+
+} // namespace qcloud_cos
@@ -0,0 +1,308 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cos_api.h"
+#include "cos_sys_config.h"
+#include "mock_server.h"
+#include "op/download_checkpoint.h"
+#include "util/simple_mutex.h"
+#include "util/string_util.h"
+
+namespace qcloud_cos {
+
+namespace {
+const char kCheckpointFile[] = "./download_checkpoint_test.cp";
+const char kLocalFile[] = "./download_checkpoint_test.dat";
+const char kTempFile[] = "./download_checkpoint_test.dat.download";
+const uint64_t kSliceSize = 64 * 1024;
+const uint64_t kSliceNum = 4;
+
+bool IsFileExist(const std::string& path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+std::string GetFileContent(const std::string& path) {
+    std::ifstream ifs(path.c_str(), std::ios::in | std::ios::binary);
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return oss.str();
+}
+
+// 每个分片的内容各不相同, 便于确认数据写在了正确的位置
+std::string GetObjectContent() {
+    std::string content;
+    for (uint64_t i = 0; i < kSliceNum; ++i) {
+        content += std::string(kSliceSize, static_cast<char>('a' + i));
+    }
+    return content;
+}
+} // namespace
+
+TEST(DownloadCheckpointTest, LoadTest) {
+    {
+        DownloadCheckpoint checkpoint(kCheckpointFile);
+        ASSERT_TRUE(checkpoint.Create("etag_1", 300, 100));
+        EXPECT_TRUE(checkpoint.AppendSlice(0));
+        EXPECT_TRUE(checkpoint.AppendSlice(2));
+    }
+
+    // 模拟进程中断时只写了一半的行, 以及越界的分片序号
+    {
+        std::ofstream ofs(kCheckpointFile, std::ios::out | std::ios::app);
+        ofs << "slice=5\nslice";
+    }
+
+    DownloadCheckpoint checkpoint(kCheckpointFile);
+    ASSERT_TRUE(checkpoint.Load());
+    EXPECT_TRUE(checkpoint.IsMatch("etag_1", 300, 100));
+    ASSERT_EQ(3u, checkpoint.GetSliceBitmap().size());
+    EXPECT_TRUE(checkpoint.GetSliceBitmap()[0]);
+    EXPECT_FALSE(checkpoint.GetSliceBitmap()[1]);
+    EXPECT_TRUE(checkpoint.GetSliceBitmap()[2]);
+    EXPECT_EQ(2u, checkpoint.GetFinishedSliceNum());
+
+    EXPECT_FALSE(checkpoint.IsMatch("etag_2", 300, 100));
+    EXPECT_FALSE(checkpoint.IsMatch("etag_1", 301, 100));
+    EXPECT_FALSE(checkpoint.IsMatch("etag_1", 300, 200));
+
+    checkpoint.Remove();
+    EXPECT_FALSE(IsFileExist(kCheckpointFile));
+    EXPECT_FALSE(checkpoint.Load());
+
+    // 缺少etag或slice_size的断点文件无效
+    {
+        std::ofstream ofs(kCheckpointFile, std::ios::out | std::ios::trunc);
+        ofs << "file_size=300\nslice=1\n";
+    }
+    EXPECT_FALSE(DownloadCheckpoint(kCheckpointFile).Load());
+    remove(kCheckpointFile);
+}
+
+// 支持HEAD和Range GET的桩, 按If-Match校验etag, 可指定失败的分片
+struct RangeServerState {
+    RangeServerState()
+        : m_content(GetObjectContent()), m_etag("etag_v1"), m_change_after_head(false),
+          m_fail_offset(-1) {}
+
+    std::vector<uint64_t> GetOffsets() {
+        SimpleMutexLocker locker(&m_mutex);
+        return m_offsets;
+    }
+
+    SimpleMutex m_mutex;
+    std::string m_content;
+    std::string m_etag;
+    bool m_change_after_head;       // 响应HEAD后修改etag, 模拟下载期间object被覆盖
+    int64_t m_fail_offset;          // 该偏移的分片返回500, -1表示不失败
+    std::vector<uint64_t> m_offsets;
+};
+
+class RangeRequestHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    explicit RangeRequestHandler(RangeServerState* state) : m_state(state) {}
+
+    virtual void handleRequest(Poco::Net::HTTPServerRequest& req,
+                               Poco::Net::HTTPServerResponse& resp) {
+        SimpleMutexLocker locker(&m_state->m_mutex);
+        if (req.getMethod() == "HEAD") {
+            resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            resp.add("ETag", "\"" + m_state->m_etag + "\"");
+            resp.setContentLength(m_state->m_content.size());
+            resp.send().flush();
+            if (m_state->m_change_after_head) {
+                m_state->m_etag = "etag_v2";
+            }
+            return;
+        }
+
+        std::string if_match = req.get("If-Match", "");
+        if (!if_match.empty() && if_match != "\"" + m_state->m_etag + "\"") {
+            SendError(resp, 412, "PreconditionFailed");
+            return;
+        }
+
+        // Range: bytes=<begin>-<end>
+        std::string range = req.get("Range", "");
+        size_t eq_pos = range.find('=');
+        size_t dash_pos = range.find('-');
+        uint64_t begin = StringUtil::StringToUint64(
+            range.substr(eq_pos + 1, dash_pos - eq_pos - 1));
+        uint64_t end = StringUtil::StringToUint64(range.substr(dash_pos + 1));
+        m_state->m_offsets.push_back(begin);
+        if (static_cast<int64_t>(begin) == m_state->m_fail_offset) {
+            SendError(resp, 500, "InternalError");
+            return;
+        }
+
+        std::string body = m_state->m_content.substr(begin, end - begin + 1);
+        resp.setStatus(Poco::Net::HTTPResponse::HTTP_PARTIAL_CONTENT);
+        resp.add("ETag", "\"" + m_state->m_etag + "\"");
+        resp.add("Content-Range", "bytes " + range.substr(eq_pos + 1) + "/"
+                 + StringUtil::Uint64ToString(m_state->m_content.size()));
+        resp.setContentLength(body.size());
+        resp.send() << body;
+    }
+
+private:
+    static void SendError(Poco::Net::HTTPServerResponse& resp, int status,
+                          const std::string& error_code) {
+        std::string body = "<Error><Code>" + error_code + "</Code>"
+            "<Message>mock error</Message></Error>";
+        resp.setStatus(static_cast<Poco::Net::HTTPResponse::HTTPStatus>(status));
+        resp.setContentLength(body.size());
+        resp.send() << body;
+    }
+
+    RangeServerState* m_state;
+};
+
+// 通过本地桩服务验证断点续传下载
+class DownloadResumeTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        m_server = new LocalHttpServer(
+            new LocalHandlerFactory<RangeRequestHandler, RangeServerState>(&m_state));
+        m_sys_config.UseLocalServer(m_server->GetAddr());
+        CosSysConfig::SetMaxRetryTimes(0);
+
+        m_config = new CosConfig(7777, "access_key", "secret_key", "cn-north");
+        m_client = new CosAPI(*m_config);
+    }
+
+    virtual void TearDown() {
+        delete m_client;
+        delete m_config;
+        delete m_server;
+        remove(kLocalFile);
+        remove(kTempFile);
+        remove(kCheckpointFile);
+    }
+
+    // 写入上次下载留下的断点文件和临时文件, 临时文件中只有已完成分片的数据是正确的
+    void CreateCheckpoint(const std::string& etag, const std::vector<uint64_t>& slices) {
+        DownloadCheckpoint checkpoint(kCheckpointFile);
+        ASSERT_TRUE(checkpoint.Create(etag, m_state.m_content.size(), kSliceSize));
+        std::string data(m_state.m_content.size(), '\0');
+        for (std::vector<uint64_t>::const_iterator itr = slices.begin();
+             itr != slices.end(); ++itr) {
+            ASSERT_TRUE(checkpoint.AppendSlice(*itr));
+            data.replace(*itr * kSliceSize, kSliceSize,
+                         m_state.m_content.substr(*itr * kSliceSize, kSliceSize));
+        }
+        std::ofstream ofs(kTempFile, std::ios::out | std::ios::trunc | std::ios::binary);
+        ofs << data;
+    }
+
+    CosResult Download() {
+        MultiGetObjectReq req("buckettest-7777", "object_test", kLocalFile);
+        req.SetSliceSize(kSliceSize);
+        // 单线程下载, 分片请求的顺序确定
+        req.SetThreadPoolSize(1);
+        req.SetCheckpointFile(kCheckpointFile);
+        MultiGetObjectResp resp;
+        return m_client->GetObject(req, &resp);
+    }
+
+    ScopedSysConfig m_sys_config;
+    RangeServerState m_state;
+    LocalHttpServer* m_server;
+    CosConfig* m_config;
+    CosAPI* m_client;
+};
+
+TEST_F(DownloadResumeTest, ResumeTest) {
+    std::vector<uint64_t> slices;
+    slices.push_back(0);
+    slices.push_back(2);
+    CreateCheckpoint(m_state.m_etag, slices);
+
+    // 只下载未完成的分片, 临时文件不被截断, 已完成分片的数据保留
+    CosResult result = Download();
+    EXPECT_TRUE(result.IsSucc()) << result.GetErrorInfo();
+    std::vector<uint64_t> offsets = m_state.GetOffsets();
+    ASSERT_EQ(2u, offsets.size());
+    EXPECT_EQ(kSliceSize, offsets[0]);
+    EXPECT_EQ(3 * kSliceSize, offsets[1]);
+
+    // 完成后临时文件重命名为目标文件, 并删除断点文件
+    EXPECT_TRUE(GetFileContent(kLocalFile) == m_state.m_content);
+    EXPECT_FALSE(IsFileExist(kTempFile));
+    EXPECT_FALSE(IsFileExist(kCheckpointFile));
+}
+
+TEST_F(DownloadResumeTest, EtagMismatchTest) {
+    // 断点记录的etag与object不一致, 重新下载全部分片并截断临时文件
+    std::vector<uint64_t> slices;
+    slices.push_back(0);
+    CreateCheckpoint("etag_old", slices);
+    {
+        std::ofstream ofs(kTempFile, std::ios::out | std::ios::app | std::ios::binary);
+        ofs << std::string(kSliceSize, 'z');
+    }
+
+    CosResult result = Download();
+    EXPECT_TRUE(result.IsSucc()) << result.GetErrorInfo();
+    EXPECT_EQ(kSliceNum, m_state.GetOffsets().size());
+    EXPECT_TRUE(GetFileContent(kLocalFile) == m_state.m_content);
+    EXPECT_FALSE(IsFileExist(kTempFile));
+    EXPECT_FALSE(IsFileExist(kCheckpointFile));
+}
+
+TEST_F(DownloadResumeTest, InterruptTest) {
+    // 中途失败时保留断点文件和临时文件, 不生成目标文件
+    m_state.m_fail_offset = 2 * kSliceSize;
+    CosResult result = Download();
+    EXPECT_FALSE(result.IsSucc());
+    EXPECT_EQ(500, result.GetHttpStatus());
+    EXPECT_FALSE(IsFileExist(kLocalFile));
+    EXPECT_TRUE(IsFileExist(kTempFile));
+
+    DownloadCheckpoint checkpoint(kCheckpointFile);
+    ASSERT_TRUE(checkpoint.Load());
+    EXPECT_EQ(2u, checkpoint.GetFinishedSliceNum());
+
+    // 再次下载从失败的分片继续
+    m_state.m_fail_offset = -1;
+    m_state.m_offsets.clear();
+    result = Download();
+    EXPECT_TRUE(result.IsSucc()) << result.GetErrorInfo();
+    std::vector<uint64_t> offsets = m_state.GetOffsets();
+    ASSERT_EQ(2u, offsets.size());
+    EXPECT_EQ(2 * kSliceSize, offsets[0]);
+    EXPECT_EQ(3 * kSliceSize, offsets[1]);
+    EXPECT_TRUE(GetFileContent(kLocalFile) == m_state.m_content);
+    EXPECT_FALSE(IsFileExist(kTempFile));
+    EXPECT_FALSE(IsFileExist(kCheckpointFile));
+}
+
+TEST_F(DownloadResumeTest, PreconditionFailTest) {
+    std::vector<uint64_t> slices;
+    slices.push_back(0);
+    CreateCheckpoint(m_state.m_etag, slices);
+
+    // 续传期间object被修改, 分片请求返回412, 断点文件和临时文件均作废
+    m_state.m_change_after_head = true;
+    CosResult result = Download();
+    EXPECT_FALSE(result.IsSucc());
+    EXPECT_EQ(412, result.GetHttpStatus());
+    EXPECT_FALSE(IsFileExist(kCheckpointFile));
+    EXPECT_FALSE(IsFileExist(kTempFile));
+    EXPECT_FALSE(IsFileExist(kLocalFile));
+
+    // 下次调用重新下载全部分片
+    m_state.m_change_after_head = false;
+    m_state.m_offsets.clear();
+    result = Download();
+    EXPECT_TRUE(result.IsSucc()) << result.GetErrorInfo();
+    EXPECT_EQ(kSliceNum, m_state.GetOffsets().size());
+    EXPECT_TRUE(GetFileContent(kLocalFile) == m_state.m_content);
+}
+
+} // namespace qcloud_cos
@@ -0,0 +1,312 @@
+#include "gtest/gtest.h"
+
+#include <pthread.h>
+#include <strings.h>
+
+#include <map>
+#include <string>
+
+#include "Poco/Exception.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Net/StreamSocket.h"
+
+#include "cos_sys_config.h"
+#include "mock_server.h"
+#include "util/body_source.h"
+#include "util/canonical_request.h"
+#include "util/http_sender.h"
+#include "util/http_session_pool.h"
+#include "util/simple_mutex.h"
+#include "util/string_util.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 请求体大小, 大于Expect: 100-continue的阈值
+const size_t kBodyLen = 256 * 1024;
+// 等待100 Continue的超时时间
+const uint64_t kContinueTimeoutInms = 200;
+} // namespace
+
+// Poco::Net::HTTPServer在调用handler之前会自动回复100 Continue,
+// 无法模拟提前拒绝和不支持100-continue的服务端, 这里直接基于socket实现
+class ExpectContinueServer {
+public:
+    enum Mode {
+        MODE_CONTINUE,  // 回复100 Continue后读取请求体, 返回200
+        MODE_REJECT,    // 不读取请求体, 直接返回403
+        MODE_SILENT     // 不回复100 Continue, 直接读取请求体, 返回200
+    };
+
+    ExpectContinueServer()
+        : m_socket(Poco::Net::SocketAddress("127.0.0.1", 0)), m_stopped(false),
+          m_mode(MODE_CONTINUE), m_conn_num(0), m_request_num(0), m_expect_num(0),
+          m_body_bytes(0), m_rejected_body_bytes(0) {
+        pthread_create(&m_tid, NULL, Run, this);
+    }
+
+    ~ExpectContinueServer() {
+        {
+            SimpleMutexLocker locker(&m_mutex);
+            m_stopped = true;
+        }
+        pthread_join(m_tid, NULL);
+    }
+
+    std::string GetUrl() const {
+        return "http://127.0.0.1:" + StringUtil::IntToString(m_socket.address().port())
+            + "/expect_object";
+    }
+
+    void SetMode(Mode mode) {
+        SimpleMutexLocker locker(&m_mutex);
+        m_mode = mode;
+    }
+
+    void GetStats(int* conn_num, int* request_num, int* expect_num,
+                  uint64_t* body_bytes, uint64_t* rejected_body_bytes) {
+        SimpleMutexLocker locker(&m_mutex);
+        *conn_num = m_conn_num;
+        *request_num = m_request_num;
+        *expect_num = m_expect_num;
+        *body_bytes = m_body_bytes;
+        *rejected_body_bytes = m_rejected_body_bytes;
+    }
+
+private:
+    static void* Run(void* arg) {
+        ExpectContinueServer* server = static_cast<ExpectContinueServer*>(arg);
+        while (!server->IsStopped()) {
+            if (!server->m_socket.poll(Poco::Timespan(0, 50 * 1000),
+                                       Poco::Net::Socket::SELECT_READ)) {
+                continue;
+            }
+            Poco::Net::StreamSocket ss = server->m_socket.acceptConnection();
+            ss.setReceiveTimeout(Poco::Timespan(0, 50 * 1000));
+            server->HandleConnection(ss);
+            ss.close();
+        }
+        return NULL;
+    }
+
+    bool IsStopped() {
+        SimpleMutexLocker locker(&m_mutex);
+        return m_stopped;
+    }
+
+    // 读取1个字节, 对端关闭或服务端退出时返回false
+    bool ReadByte(Poco::Net::StreamSocket& ss, char* c) {
+        while (!IsStopped()) {
+            try {
+                return ss.receiveBytes(c, 1) == 1;
+            } catch (const Poco::TimeoutException&) {
+                continue;
+            } catch (const Poco::Exception&) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // 只处理单个连接上的串行请求, 连接关闭后再接受下一个连接
+    void HandleConnection(Poco::Net::StreamSocket& ss) {
+        {
+            SimpleMutexLocker locker(&m_mutex);
+            ++m_conn_num;
+        }
+        for (;;) {
+            std::string header;
+            char c = 0;
+            while (header.size() < 4 || header.compare(header.size() - 4, 4, "\r\n\r\n") != 0) {
+                if (!ReadByte(ss, &c)) {
+                    return;
+                }
+                header += c;
+            }
+
+            uint64_t content_len = 0;
+            bool is_expect = false;
+            ParseHeader(header, &content_len, &is_expect);
+
+            Mode mode = MODE_CONTINUE;
+            {
+                SimpleMutexLocker locker(&m_mutex);
+                ++m_request_num;
+                m_expect_num += is_expect ? 1 : 0;
+                mode = m_mode;
+            }
+
+            if (mode == MODE_REJECT) {
+                SendResponse(ss, "403 Forbidden");
+                // 客户端不应再发送请求体, 统计连接关闭前收到的字节数
+                while (ReadByte(ss, &c)) {
+                    SimpleMutexLocker locker(&m_mutex);
+                    ++m_rejected_body_bytes;
+                }
+                return;
+            }
+
+            if (is_expect && mode == MODE_CONTINUE) {
+                std::string interim = "HTTP/1.1 100 Continue\r\n\r\n";
+                ss.sendBytes(interim.data(), static_cast<int>(interim.size()));
+            }
+            for (uint64_t i = 0; i < content_len; ++i) {
+                if (!ReadByte(ss, &c)) {
+                    return;
+                }
+            }
+            {
+                SimpleMutexLocker locker(&m_mutex);
+                m_body_bytes += content_len;
+            }
+            SendResponse(ss, "200 OK");
+        }
+    }
+
+    static void ParseHeader(const std::string& header, uint64_t* content_len, bool* is_expect) {
+        size_t begin = header.find("\r\n") + 2;
+        while (begin < header.size()) {
+            size_t end = header.find("\r\n", begin);
+            std::string line = header.substr(begin, end - begin);
+            begin = end + 2;
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            std::string name = line.substr(0, colon);
+            std::string value = StringUtil::Trim(line.substr(colon + 1), " ");
+            if (!strcasecmp(name.c_str(), "Content-Length")) {
+                *content_len = StringUtil::StringToUint64(value);
+            } else if (!strcasecmp(name.c_str(), "Expect")) {
+                *is_expect = !strcasecmp(value.c_str(), "100-continue");
+            }
+        }
+    }
+
+    static void SendResponse(Poco::Net::StreamSocket& ss, const std::string& status) {
+        std::string resp = "HTTP/1.1 " + status + "\r\nContent-Length: 0\r\n"
+            "Connection: Keep-Alive\r\n\r\n";
+        ss.sendBytes(resp.data(), static_cast<int>(resp.size()));
+    }
+
+    Poco::Net::ServerSocket m_socket;
+    pthread_t m_tid;
+    SimpleMutex m_mutex;
+    bool m_stopped;
+    Mode m_mode;
+    int m_conn_num;
+    int m_request_num;
+    int m_expect_num;
+    uint64_t m_body_bytes;
+    uint64_t m_rejected_body_bytes;
+};
+
+class ExpectContinueTest : public testing::Test {
+protected:
+    ExpectContinueTest() : m_body(kBodyLen, 'e') {}
+
+    virtual void SetUp() {
+        CosSysConfig::SetExpectContinueThreshold(1024);
+        CosSysConfig::SetExpectContinueTimeoutInms(kContinueTimeoutInms);
+        CosSysConfig::SetKeepAlive(true);
+        CosSysConfig::SetLogOutType(COS_LOG_NULL);
+        HttpSessionPool::Instance().Clear();
+        m_server = new ExpectContinueServer();
+    }
+
+    virtual void TearDown() {
+        // 先关闭客户端连接, 服务端线程才能退出
+        HttpSessionPool::Instance().Clear();
+        delete m_server;
+    }
+
+    int Put(RequestContext* ctx) {
+        std::map<std::string, std::string> params;
+        std::map<std::string, std::string> headers;
+        std::map<std::string, std::string> resp_headers;
+        std::string resp_body;
+        std::string err_msg;
+        BufferBodySource body(m_body);
+        return HttpSender::SendRequest("PUT", m_server->GetUrl(), CanonicalRequest(params),
+                                       headers, body, 3000, 3000, &resp_headers, &resp_body,
+                                       &err_msg, false, ctx);
+    }
+
+    ScopedSysConfig m_sys_config;
+    std::string m_body;
+    ExpectContinueServer* m_server;
+};
+
+TEST_F(ExpectContinueTest, ContinueTest) {
+    RequestContext ctx;
+    uint64_t start_in_us = HttpSender::GetMonotonicTimeInUs();
+    EXPECT_EQ(200, Put(&ctx));
+    // 收到100 Continue后立即发送请求体, 无需等到超时
+    EXPECT_LT((HttpSender::GetMonotonicTimeInUs() - start_in_us) / 1000, kContinueTimeoutInms);
+    EXPECT_EQ(kBodyLen, ctx.GetTiming().m_bytes_sent);
+    EXPECT_EQ(1u, HttpSessionPool::Instance().GetIdleSessionNum());
+
+    int conn_num = 0;
+    int request_num = 0;
+    int expect_num = 0;
+    uint64_t body_bytes = 0;
+    uint64_t rejected_body_bytes = 0;
+    m_server->GetStats(&conn_num, &request_num, &expect_num, &body_bytes, &rejected_body_bytes);
+    EXPECT_EQ(1, expect_num);
+    EXPECT_EQ(kBodyLen, body_bytes);
+
+    // 小于阈值的请求不携带Expect头
+    CosSysConfig::SetExpectContinueThreshold(kBodyLen + 1);
+    EXPECT_EQ(200, Put(NULL));
+    m_server->GetStats(&conn_num, &request_num, &expect_num, &body_bytes, &rejected_body_bytes);
+    EXPECT_EQ(1, conn_num);
+    EXPECT_EQ(2, request_num);
+    EXPECT_EQ(1, expect_num);
+}
+
+TEST_F(ExpectContinueTest, EarlyRejectTest) {
+    m_server->SetMode(ExpectContinueServer::MODE_REJECT);
+    RequestContext ctx;
+    EXPECT_EQ(403, Put(&ctx));
+    // 请求体未发送, 连接状态不确定, 不归还连接池
+    EXPECT_EQ(0u, ctx.GetTiming().m_bytes_sent);
+    EXPECT_EQ(0u, HttpSessionPool::Instance().GetIdleSessionNum());
+
+    // 下一个请求使用新建的连接, 服务端在被拒绝的连接上未收到任何请求体
+    m_server->SetMode(ExpectContinueServer::MODE_CONTINUE);
+    EXPECT_EQ(200, Put(NULL));
+    int conn_num = 0;
+    int request_num = 0;
+    int expect_num = 0;
+    uint64_t body_bytes = 0;
+    uint64_t rejected_body_bytes = 0;
+    m_server->GetStats(&conn_num, &request_num, &expect_num, &body_bytes, &rejected_body_bytes);
+    EXPECT_EQ(2, conn_num);
+    EXPECT_EQ(2, request_num);
+    EXPECT_EQ(0u, rejected_body_bytes);
+    EXPECT_EQ(kBodyLen, body_bytes);
+}
+
+TEST_F(ExpectContinueTest, TimeoutFallbackTest) {
+    // 服务端不支持100-continue, 超时后照常发送请求体
+    m_server->SetMode(ExpectContinueServer::MODE_SILENT);
+    RequestContext ctx;
+    uint64_t start_in_us = HttpSender::GetMonotonicTimeInUs();
+    EXPECT_EQ(200, Put(&ctx));
+    EXPECT_GE((HttpSender::GetMonotonicTimeInUs() - start_in_us) / 1000, kContinueTimeoutInms);
+    EXPECT_EQ(kBodyLen, ctx.GetTiming().m_bytes_sent);
+    // 请求完整结束, 连接可以复用
+    EXPECT_EQ(1u, HttpSessionPool::Instance().GetIdleSessionNum());
+
+    int conn_num = 0;
+    int request_num = 0;
+    int expect_num = 0;
+    uint64_t body_bytes = 0;
+    uint64_t rejected_body_bytes = 0;
+    m_server->GetStats(&conn_num, &request_num, &expect_num, &body_bytes, &rejected_body_bytes);
+    EXPECT_EQ(1, expect_num);
+    EXPECT_EQ(kBodyLen, body_bytes);
+}
+
+} // namespace qcloud_cos
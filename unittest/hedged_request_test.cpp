@@ -0,0 +1,259 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <deque>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cos_sys_config.h"
+#include "mock_server.h"
+#include "util/canonical_request.h"
+#include "util/hedged_request.h"
+#include "util/http_sender.h"
+#include "util/http_session_pool.h"
+#include "util/simple_mutex.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 对冲等待时间, 预热后样本均小于该值, 分位数取该值
+const uint64_t kHedgeDelayInms = 100;
+// 慢请求的响应延时, 远大于对冲等待时间
+const unsigned kSlowDelayInms = 600;
+} // namespace
+
+// 按请求到达的顺序依次取出预设的响应延时和响应体, 未预设时立即返回"default"
+struct HedgeServerState {
+    struct Plan {
+        unsigned m_delay_in_ms;
+        std::string m_body;
+    };
+
+    void AddPlan(unsigned delay_in_ms, const std::string& body) {
+        SimpleMutexLocker locker(&m_mutex);
+        Plan plan;
+        plan.m_delay_in_ms = delay_in_ms;
+        plan.m_body = body;
+        m_plans.push_back(plan);
+    }
+
+    void Reset() {
+        SimpleMutexLocker locker(&m_mutex);
+        m_plans.clear();
+        m_arrivals_in_us.clear();
+    }
+
+    std::vector<uint64_t> GetArrivals() {
+        SimpleMutexLocker locker(&m_mutex);
+        return m_arrivals_in_us;
+    }
+
+    SimpleMutex m_mutex;
+    std::deque<Plan> m_plans;
+    std::vector<uint64_t> m_arrivals_in_us;
+};
+
+class HedgeRequestHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    explicit HedgeRequestHandler(HedgeServerState* state) : m_state(state) {}
+
+    virtual void handleRequest(Poco::Net::HTTPServerRequest& /*req*/,
+                               Poco::Net::HTTPServerResponse& resp) {
+        HedgeServerState::Plan plan;
+        plan.m_delay_in_ms = 0;
+        plan.m_body = "default";
+        {
+            SimpleMutexLocker locker(&m_state->m_mutex);
+            m_state->m_arrivals_in_us.push_back(HttpSender::GetMonotonicTimeInUs());
+            if (!m_state->m_plans.empty()) {
+                plan = m_state->m_plans.front();
+                m_state->m_plans.pop_front();
+            }
+        }
+
+        usleep(plan.m_delay_in_ms * 1000);
+        resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+        resp.setContentLength(plan.m_body.size());
+        resp.send() << plan.m_body;
+    }
+
+private:
+    HedgeServerState* m_state;
+};
+
+class HedgedRequestTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        m_server = new LocalHttpServer(
+            new LocalHandlerFactory<HedgeRequestHandler, HedgeServerState>(&m_state));
+        m_url = "http://" + m_server->GetAddr() + "/hedge_object";
+        CosSysConfig::SetLogOutType(COS_LOG_NULL);
+        CosSysConfig::SetKeepAlive(true);
+        CosSysConfig::SetHedgeEnable(true);
+        CosSysConfig::SetHedgeDelayPercentile(50);
+        CosSysConfig::SetHedgeMinDelayInms(kHedgeDelayInms);
+
+        // 收集足够的快速样本, 使对冲等待时间为kHedgeDelayInms
+        for (int i = 0; i < 64; ++i) {
+            std::string body;
+            EXPECT_EQ(200, Get(&body));
+        }
+        HedgeStats stats;
+        HedgedRequest::GetStats(&stats);
+        EXPECT_EQ(kHedgeDelayInms * 1000, stats.m_get_delay_in_us);
+
+        m_state.Reset();
+        HttpSessionPool::Instance().Clear();
+        HedgedRequest::GetStats(&m_stats);
+    }
+
+    virtual void TearDown() {
+        HttpSessionPool::Instance().Clear();
+        delete m_server;
+    }
+
+    int Get(std::string* body) {
+        std::map<std::string, std::string> params;
+        std::map<std::string, std::string> headers;
+        std::map<std::string, std::string> resp_headers;
+        std::string err_msg;
+        return HedgedRequest::SendRequest("GET", m_url, CanonicalRequest(params), headers, "",
+                                          3000, 3000, &resp_headers, body, &err_msg);
+    }
+
+    int GetToStream(std::ostream& os) {
+        std::map<std::string, std::string> params;
+        std::map<std::string, std::string> headers;
+        std::map<std::string, std::string> resp_headers;
+        std::string xml_err_str;
+        std::string err_msg;
+        uint64_t real_byte = 0;
+        return HedgedRequest::SendRequest("GET", m_url, CanonicalRequest(params), headers, "",
+                                          3000, 3000, &resp_headers, &xml_err_str, os,
+                                          &err_msg, &real_byte);
+    }
+
+    // 返回SetUp之后新增的对冲次数与对冲胜出次数
+    void GetHedgeNum(uint64_t* hedge_num, uint64_t* hedge_win_num) {
+        HedgeStats stats;
+        HedgedRequest::GetStats(&stats);
+        *hedge_num = stats.m_hedge_num - m_stats.m_hedge_num;
+        *hedge_win_num = stats.m_hedge_win_num - m_stats.m_hedge_win_num;
+    }
+
+    ScopedSysConfig m_sys_config;
+    HedgeServerState m_state;
+    LocalHttpServer* m_server;
+    std::string m_url;
+    HedgeStats m_stats;
+};
+
+TEST_F(HedgedRequestTest, HedgeAfterDelayTest) {
+    m_state.AddPlan(kSlowDelayInms, "original");
+    m_state.AddPlan(0, "hedge");
+
+    std::string body;
+    uint64_t start_in_us = HttpSender::GetMonotonicTimeInUs();
+    EXPECT_EQ(200, Get(&body));
+    uint64_t cost_in_ms = (HttpSender::GetMonotonicTimeInUs() - start_in_us) / 1000;
+    EXPECT_EQ("hedge", body);
+    EXPECT_LT(cost_in_ms, kSlowDelayInms);
+
+    // 对冲请求在等待时间之后才发出
+    std::vector<uint64_t> arrivals = m_state.GetArrivals();
+    ASSERT_EQ(2u, arrivals.size());
+    uint64_t hedge_delay_in_ms = (arrivals[1] - arrivals[0]) / 1000;
+    EXPECT_GE(hedge_delay_in_ms, kHedgeDelayInms - 10);
+    EXPECT_LT(hedge_delay_in_ms, kSlowDelayInms);
+
+    uint64_t hedge_num = 0;
+    uint64_t hedge_win_num = 0;
+    GetHedgeNum(&hedge_num, &hedge_win_num);
+    EXPECT_EQ(1u, hedge_num);
+    EXPECT_EQ(1u, hedge_win_num);
+}
+
+TEST_F(HedgedRequestTest, FirstHeaderWinsTest) {
+    // 对冲已发出, 但原请求先返回响应头
+    m_state.AddPlan(kHedgeDelayInms + 50, "original");
+    m_state.AddPlan(kSlowDelayInms, "hedge");
+
+    std::string body;
+    EXPECT_EQ(200, Get(&body));
+    EXPECT_EQ("original", body);
+    EXPECT_EQ(2u, m_state.GetArrivals().size());
+
+    uint64_t hedge_num = 0;
+    uint64_t hedge_win_num = 0;
+    GetHedgeNum(&hedge_num, &hedge_win_num);
+    EXPECT_EQ(1u, hedge_num);
+    EXPECT_EQ(0u, hedge_win_num);
+}
+
+TEST_F(HedgedRequestTest, LoserCancelledTest) {
+    // 落败的原请求被立即取消, 调用方无需等待其响应
+    m_state.AddPlan(kSlowDelayInms, "original");
+    m_state.AddPlan(0, "hedge");
+    std::string body;
+    uint64_t start_in_us = HttpSender::GetMonotonicTimeInUs();
+    EXPECT_EQ(200, Get(&body));
+    EXPECT_LT((HttpSender::GetMonotonicTimeInUs() - start_in_us) / 1000, kSlowDelayInms);
+    // 只有胜出的连接归还连接池
+    EXPECT_EQ(1u, HttpSessionPool::Instance().GetIdleSessionNum());
+
+    // 落败的对冲请求同样被取消, 其连接不归还连接池
+    HttpSessionPool::Instance().Clear();
+    m_state.AddPlan(kHedgeDelayInms + 50, "original");
+    m_state.AddPlan(kSlowDelayInms, "hedge");
+    EXPECT_EQ(200, Get(&body));
+    EXPECT_EQ("original", body);
+    usleep(kSlowDelayInms * 1000 + 200 * 1000);
+    EXPECT_EQ(1u, HttpSessionPool::Instance().GetIdleSessionNum());
+}
+
+TEST_F(HedgedRequestTest, OnlyWinnerWritesStreamTest) {
+    std::string original_body(64 * 1024, 'o');
+    std::string hedge_body(64 * 1024, 'h');
+
+    // 对冲胜出
+    {
+        m_state.AddPlan(kSlowDelayInms, original_body);
+        m_state.AddPlan(0, hedge_body);
+        std::ostringstream os;
+        EXPECT_EQ(200, GetToStream(os));
+        EXPECT_TRUE(os.str() == hedge_body);
+        usleep(kSlowDelayInms * 1000);
+        EXPECT_TRUE(os.str() == hedge_body);
+    }
+
+    // 原请求胜出, 对冲请求之后收到的响应也不写入流
+    {
+        m_state.AddPlan(kHedgeDelayInms + 50, original_body);
+        m_state.AddPlan(kHedgeDelayInms + 150, hedge_body);
+        std::ostringstream os;
+        EXPECT_EQ(200, GetToStream(os));
+        EXPECT_TRUE(os.str() == original_body);
+        usleep(kSlowDelayInms * 1000);
+        EXPECT_TRUE(os.str() == original_body);
+    }
+}
+
+TEST_F(HedgedRequestTest, NoHedgeAfterCompleteTest) {
+    m_state.AddPlan(kHedgeDelayInms / 5, "original");
+    std::string body;
+    EXPECT_EQ(200, Get(&body));
+    EXPECT_EQ("original", body);
+
+    // 原请求已结束, 到达对冲等待时间后也不再发出对冲请求
+    usleep(kHedgeDelayInms * 3 * 1000);
+    EXPECT_EQ(1u, m_state.GetArrivals().size());
+    uint64_t hedge_num = 0;
+    uint64_t hedge_win_num = 0;
+    GetHedgeNum(&hedge_num, &hedge_win_num);
+    EXPECT_EQ(0u, hedge_num);
+}
+
+} // namespace qcloud_cos
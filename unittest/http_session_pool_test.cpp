@@ -0,0 +1,122 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cos_sys_config.h"
+#include "mock_server.h"
+#include "util/canonical_request.h"
+#include "util/http_sender.h"
+#include "util/http_session_pool.h"
+#include "util/simple_mutex.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 空闲连接的最长保留时间
+const uint64_t kIdleSessionTimeoutInms = 200;
+// 慢请求的响应延时, 大于空闲连接的最长保留时间
+const unsigned kSlowDelayInms = 400;
+} // namespace
+
+// 记录每个请求的客户端端口, 用于判断请求是否在同一连接上发送
+struct SessionPoolServerState {
+    std::vector<uint16_t> GetClientPorts() {
+        SimpleMutexLocker locker(&m_mutex);
+        return m_client_ports;
+    }
+
+    SimpleMutex m_mutex;
+    std::vector<uint16_t> m_client_ports;
+};
+
+// /slow延时kSlowDelayInms后返回, 其余立即返回
+class SessionPoolRequestHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    explicit SessionPoolRequestHandler(SessionPoolServerState* state) : m_state(state) {}
+
+    virtual void handleRequest(Poco::Net::HTTPServerRequest& req,
+                               Poco::Net::HTTPServerResponse& resp) {
+        {
+            SimpleMutexLocker locker(&m_state->m_mutex);
+            m_state->m_client_ports.push_back(req.clientAddress().port());
+        }
+        if (req.getURI() == "/slow") {
+            usleep(kSlowDelayInms * 1000);
+        }
+        resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+        resp.setContentLength(2);
+        resp.send() << "ok";
+    }
+
+private:
+    SessionPoolServerState* m_state;
+};
+
+class HttpSessionPoolTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        m_server = new LocalHttpServer(
+            new LocalHandlerFactory<SessionPoolRequestHandler, SessionPoolServerState>(&m_state));
+        CosSysConfig::SetLogOutType(COS_LOG_NULL);
+        CosSysConfig::SetKeepAlive(true);
+        CosSysConfig::SetIdleSessionTimeoutInms(kIdleSessionTimeoutInms);
+        HttpSessionPool::Instance().Clear();
+    }
+
+    virtual void TearDown() {
+        HttpSessionPool::Instance().Clear();
+        delete m_server;
+    }
+
+    int Get(const std::string& path, RequestContext* ctx) {
+        std::map<std::string, std::string> params;
+        std::map<std::string, std::string> headers;
+        std::map<std::string, std::string> resp_headers;
+        std::string resp_body;
+        std::string err_msg;
+        return HttpSender::SendRequest("GET", "http://" + m_server->GetAddr() + path,
+                                       CanonicalRequest(params), headers, "", 3000, 3000,
+                                       &resp_headers, &resp_body, &err_msg, false, ctx);
+    }
+
+    ScopedSysConfig m_sys_config;
+    SessionPoolServerState m_state;
+    LocalHttpServer* m_server;
+};
+
+TEST_F(HttpSessionPoolTest, ReuseAfterSlowRequestTest) {
+    RequestContext slow_ctx;
+    EXPECT_EQ(200, Get("/slow", &slow_ctx));
+    EXPECT_EQ(1u, slow_ctx.GetTiming().m_new_session_num);
+    EXPECT_EQ(1u, HttpSessionPool::Instance().GetIdleSessionNum());
+
+    // 请求耗时超过空闲超时, 但连接归还后空闲时间未超时, 应在同一连接上复用
+    RequestContext ctx;
+    EXPECT_EQ(200, Get("/fast", &ctx));
+    EXPECT_EQ(0u, ctx.GetTiming().m_new_session_num);
+
+    std::vector<uint16_t> client_ports = m_state.GetClientPorts();
+    ASSERT_EQ(2u, client_ports.size());
+    EXPECT_EQ(client_ports[0], client_ports[1]);
+}
+
+TEST_F(HttpSessionPoolTest, IdleTimeoutTest) {
+    EXPECT_EQ(200, Get("/fast", NULL));
+    EXPECT_EQ(1u, HttpSessionPool::Instance().GetIdleSessionNum());
+
+    // 空闲超过超时时间的连接由连接池关闭, 下一个请求新建连接
+    usleep((kIdleSessionTimeoutInms + 100) * 1000);
+    RequestContext ctx;
+    EXPECT_EQ(200, Get("/fast", &ctx));
+    EXPECT_EQ(1u, ctx.GetTiming().m_new_session_num);
+
+    std::vector<uint16_t> client_ports = m_state.GetClientPorts();
+    ASSERT_EQ(2u, client_ports.size());
+    EXPECT_NE(client_ports[0], client_ports[1]);
+}
+
+} // namespace qcloud_cos
@@ -9,6 +9,9 @@
 #define MOCK_SERVER_H
 #pragma once
 
+#include <stdint.h>
+
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -17,13 +20,17 @@
 #include "Poco/Net/HTTPRequestHandlerFactory.h"
 #include "Poco/Net/HTTPResponse.h"
 #include "Poco/Net/HTTPServer.h"
+#include "Poco/Net/HTTPServerParams.h"
 #include "Poco/Net/HTTPServerRequest.h"
 #include "Poco/Net/HTTPServerResponse.h"
 #include "Poco/Net/ServerSocket.h"
+#include "Poco/Net/SocketAddress.h"
 #include "Poco/StreamCopier.h"
 #include "Poco/Util/ServerApplication.h"
 
 #include "cos_params.h"
+#include "cos_sys_config.h"
+#include "util/noncopyable.h"
 #include "util/string_util.h"
 
 namespace qcloud_cos {
@@ -394,5 +401,131 @@ public:
     }
 };
 
+/// \brief 为每个请求创建一个Handler, Handler以共享的State*构造, 用于记录请求或控制返回
+///        State为void时Handler以默认构造函数创建
+template <typename Handler, typename State = void>
+class LocalHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+public:
+    explicit LocalHandlerFactory(State* state) : m_state(state) {}
+
+    virtual Poco::Net::HTTPRequestHandler* createRequestHandler(
+            const Poco::Net::HTTPServerRequest&) {
+        return new Handler(m_state);
+    }
+
+private:
+    State* m_state;
+};
+
+template <typename Handler>
+class LocalHandlerFactory<Handler, void> : public Poco::Net::HTTPRequestHandlerFactory {
+public:
+    virtual Poco::Net::HTTPRequestHandler* createRequestHandler(
+            const Poco::Net::HTTPServerRequest&) {
+        return new Handler();
+    }
+};
+
+/// \brief 构造时保存用例常改动的CosSysConfig全局配置, 析构时恢复, 作为fixture的成员使用
+class ScopedSysConfig : private NonCopyable {
+public:
+    ScopedSysConfig()
+        : m_is_use_intranet(CosSysConfig::IsUseIntranet()),
+          m_intranet_addr(CosSysConfig::GetIntranetAddr()),
+          m_log_out_type(static_cast<LOG_OUT_TYPE>(CosSysConfig::GetLogOutType())),
+          m_keep_alive(CosSysConfig::GetKeepAlive()),
+          m_idle_session_timeout_in_ms(CosSysConfig::GetIdleSessionTimeoutInms()),
+          m_max_retry_times(CosSysConfig::GetMaxRetryTimes()),
+          m_retry_base_delay_in_ms(CosSysConfig::GetRetryBaseDelayInms()),
+          m_hedge_enable(CosSysConfig::IsHedgeEnable()),
+          m_hedge_delay_percentile(CosSysConfig::GetHedgeDelayPercentile()),
+          m_hedge_min_delay_in_ms(CosSysConfig::GetHedgeMinDelayInms()),
+          m_expect_continue_threshold(CosSysConfig::GetExpectContinueThreshold()),
+          m_expect_continue_timeout_in_ms(CosSysConfig::GetExpectContinueTimeoutInms()),
+          m_list_gzip_enable(CosSysConfig::IsListGzipEnable()),
+          m_down_slice_size(CosSysConfig::GetDownSliceSize()),
+          m_down_thread_pool_size(CosSysConfig::GetDownThreadPoolSize()),
+          m_is_check_md5(CosSysConfig::IsCheckMd5()) {}
+
+    ~ScopedSysConfig() {
+        CosSysConfig::SetIsUseIntranet(m_is_use_intranet);
+        CosSysConfig::SetIntranetAddr(m_intranet_addr);
+        CosSysConfig::SetLogOutType(m_log_out_type);
+        CosSysConfig::SetKeepAlive(m_keep_alive);
+        CosSysConfig::SetIdleSessionTimeoutInms(m_idle_session_timeout_in_ms);
+        CosSysConfig::SetMaxRetryTimes(m_max_retry_times);
+        CosSysConfig::SetRetryBaseDelayInms(m_retry_base_delay_in_ms);
+        CosSysConfig::SetHedgeEnable(m_hedge_enable);
+        CosSysConfig::SetHedgeDelayPercentile(m_hedge_delay_percentile);
+        CosSysConfig::SetHedgeMinDelayInms(m_hedge_min_delay_in_ms);
+        CosSysConfig::SetExpectContinueThreshold(m_expect_continue_threshold);
+        CosSysConfig::SetExpectContinueTimeoutInms(m_expect_continue_timeout_in_ms);
+        CosSysConfig::SetListGzipEnable(m_list_gzip_enable);
+        CosSysConfig::SetDownSliceSize(m_down_slice_size);
+        CosSysConfig::SetDownThreadPoolSize(m_down_thread_pool_size);
+        CosSysConfig::SetCheckMd5(m_is_check_md5);
+    }
+
+    /// \brief 请求发往本地服务, 并关闭日志输出, 用例中最常见的设置
+    void UseLocalServer(const std::string& addr) {
+        CosSysConfig::SetIsUseIntranet(true);
+        CosSysConfig::SetIntranetAddr(addr);
+        CosSysConfig::SetLogOutType(COS_LOG_NULL);
+    }
+
+private:
+    bool m_is_use_intranet;
+    std::string m_intranet_addr;
+    LOG_OUT_TYPE m_log_out_type;
+    bool m_keep_alive;
+    uint64_t m_idle_session_timeout_in_ms;
+    unsigned m_max_retry_times;
+    uint64_t m_retry_base_delay_in_ms;
+    bool m_hedge_enable;
+    unsigned m_hedge_delay_percentile;
+    uint64_t m_hedge_min_delay_in_ms;
+    uint64_t m_expect_continue_threshold;
+    uint64_t m_expect_continue_timeout_in_ms;
+    bool m_list_gzip_enable;
+    unsigned m_down_slice_size;
+    unsigned m_down_thread_pool_size;
+    bool m_is_check_md5;
+};
+
+/// \brief 监听127.0.0.1上任意可用端口的HTTP服务, 构造时启动, 析构时停止
+///        配合CosSysConfig::SetIsUseIntranet/SetIntranetAddr(GetAddr())使用,
+///        请求的Host仍为<bucket>-<appid>.<region>.myqcloud.com
+class LocalHttpServer {
+public:
+    explicit LocalHttpServer(Poco::Net::HTTPRequestHandlerFactory* factory, int max_threads = 16)
+        : m_socket(Poco::Net::SocketAddress("127.0.0.1", 0)),
+          m_server(factory, m_socket, CreateParams(max_threads)) {
+        m_server.start();
+    }
+
+    ~LocalHttpServer() {
+        m_server.stop();
+    }
+
+    uint16_t GetPort() const { return m_socket.address().port(); }
+
+    /// \brief 返回"127.0.0.1:<port>"
+    std::string GetAddr() const {
+        return "127.0.0.1:" + StringUtil::IntToString(GetPort());
+    }
+
+private:
+    static Poco::Net::HTTPServerParams* CreateParams(int max_threads) {
+        Poco::Net::HTTPServerParams* params = new Poco::Net::HTTPServerParams();
+        params->setMaxThreads(max_threads);
+        params->setMaxQueued(max_threads * 4);
+        params->setKeepAlive(true);
+        return params;
+    }
+
+    Poco::Net::ServerSocket m_socket;
+    Poco::Net::HTTPServer m_server;
+};
+
 } // namespace qcloud_cos
 #endif
@@ -7,6 +7,10 @@
 
 #include "gtest/gtest.h"
 
+#include <unistd.h>
+
+#include <ext/stdio_filebuf.h>
+
 #include "common.h"
 #include "cos_api.h"
 #include <sstream>
@@ -267,6 +271,32 @@ TEST_F(ObjectOpTest, PutObjectByStreamTest) {
         CosResult result = m_client->PutObject(req, &resp);
         ASSERT_TRUE(result.IsSucc());
     }
+
+    // 5. 从不可定位的管道chunked上传
+    {
+        int fds[2];
+        ASSERT_EQ(0, pipe(fds));
+        std::string content = "put_obj_by_stream_chunked_from_pipe";
+        ASSERT_EQ(static_cast<ssize_t>(content.size()),
+                  write(fds[1], content.data(), content.size()));
+        close(fds[1]);
+
+        __gnu_cxx::stdio_filebuf<char> pipe_buf(fds[0], std::ios::in);
+        std::istream is(&pipe_buf);
+        PutObjectByStreamReq req(m_bucket_name, "object_test_chunked", is);
+        req.TurnOnChunkedTransfer();
+        PutObjectByStreamResp resp;
+        CosResult result = m_client->PutObject(req, &resp);
+        ASSERT_TRUE(result.IsSucc());
+        EXPECT_EQ(content.size(), result.GetTiming().m_bytes_sent);
+
+        std::ostringstream os;
+        GetObjectByStreamReq get_req(m_bucket_name, "object_test_chunked", os);
+        GetObjectByStreamResp get_resp;
+        result = m_client->GetObject(get_req, &get_resp);
+        ASSERT_TRUE(result.IsSucc());
+        EXPECT_EQ(content, os.str());
+    }
 }
 
 TEST_F(ObjectOpTest, IsObjectExistTest) {
@@ -280,6 +310,10 @@ TEST_F(ObjectOpTest, HeadObjectTest) {
         HeadObjectResp resp;
         CosResult result = m_client->HeadObject(req, &resp);
         ASSERT_TRUE(result.IsSucc());
+        EXPECT_EQ(1u, result.GetTiming().m_request_num);
+        EXPECT_GT(result.GetTiming().m_first_byte_time_in_us, 0u);
+        EXPECT_GE(result.GetTiming().m_total_time_in_us,
+                  result.GetTiming().m_first_byte_time_in_us);
     }
 
     {
@@ -470,6 +504,9 @@ TEST_F(ObjectOpTest, MultiUploadObjectTest_OneStep) {
 
         CosResult result = m_client->MultiUploadObject(req, &resp);
         EXPECT_TRUE(result.IsSucc());
+        // 耗时包括Init、各分块和Complete请求
+        EXPECT_GE(result.GetTiming().m_request_num, 3u);
+        EXPECT_GE(result.GetTiming().m_bytes_sent, 100u * 1000 * 1000);
 
         // 3. 删除临时文件
         if (-1 == remove(filename.c_str())) {
@@ -0,0 +1,63 @@
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "util/retry_policy.h"
+
+namespace qcloud_cos {
+
+TEST(RetryPolicyTest, ClassifyTest) {
+    EXPECT_EQ(kRetryNetworkError,
+              RetryPolicy::Classify(-1, "", "Net Exception:Connection reset by peer"));
+    EXPECT_EQ(kRetryNetworkError, RetryPolicy::Classify(-1, "", "TimeoutException:Timeout"));
+    EXPECT_EQ(kRetryChecksumMismatch,
+              RetryPolicy::Classify(-1, "", "Md5 of response body is not equal to the etag"));
+    EXPECT_EQ(kNotRetryable, RetryPolicy::Classify(-1, "", "Open file fail"));
+
+    EXPECT_EQ(kRetrySlowDown, RetryPolicy::Classify(503, "SlowDown", ""));
+    EXPECT_EQ(kRetryServerError, RetryPolicy::Classify(503, "ServiceUnavailable", ""));
+    EXPECT_EQ(kRetryServerError, RetryPolicy::Classify(500, "InternalError", ""));
+    EXPECT_EQ(kNotRetryable, RetryPolicy::Classify(404, "NoSuchKey", ""));
+    EXPECT_EQ(kNotRetryable, RetryPolicy::Classify(403, "AccessDenied", ""));
+
+    std::string slow_down = "<?xml version='1.0' encoding='utf-8' ?>"
+        "<Error><Code>SlowDown</Code><Message>Please reduce your request rate.</Message></Error>";
+    EXPECT_EQ(kRetrySlowDown, RetryPolicy::ClassifyResponse(503, slow_down, ""));
+    EXPECT_EQ(kRetryServerError, RetryPolicy::ClassifyResponse(503, "", ""));
+}
+
+TEST(RetryPolicyTest, ShouldRetryTest) {
+    RetryPolicy policy(2, 10, 100);
+    EXPECT_TRUE(policy.ShouldRetry("GET", kRetryNetworkError, 1));
+    EXPECT_TRUE(policy.ShouldRetry("PUT", kRetryServerError, 2));
+    EXPECT_FALSE(policy.ShouldRetry("GET", kRetryNetworkError, 3));
+    EXPECT_FALSE(policy.ShouldRetry("GET", kNotRetryable, 1));
+
+    // 非幂等方法只在限流时重试
+    EXPECT_FALSE(policy.ShouldRetry("POST", kRetryNetworkError, 1));
+    EXPECT_FALSE(policy.ShouldRetry("POST", kRetryServerError, 1));
+    EXPECT_TRUE(policy.ShouldRetry("POST", kRetrySlowDown, 1));
+}
+
+TEST(RetryPolicyTest, DelayTest) {
+    RetryPolicy policy(5, 10, 100);
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_LE(policy.GetDelayInms(kRetryNetworkError, 1), 10u);
+        EXPECT_LE(policy.GetDelayInms(kRetryServerError, 3), 40u);
+        EXPECT_LE(policy.GetDelayInms(kRetryServerError, 5), 100u);
+
+        uint64_t slow_down_delay = policy.GetDelayInms(kRetrySlowDown, 1);
+        EXPECT_GE(slow_down_delay, 50u);
+        EXPECT_LE(slow_down_delay, 100u);
+    }
+
+    // 抖动应使等待时间分散
+    bool has_diff = false;
+    uint64_t first = policy.GetDelayInms(kRetryServerError, 5);
+    for (int i = 0; i < 100 && !has_diff; ++i) {
+        has_diff = policy.GetDelayInms(kRetryServerError, 5) != first;
+    }
+    EXPECT_TRUE(has_diff);
+}
+
+} // namespace qcloud_cos
@@ -0,0 +1,155 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Poco/MD5Engine.h"
+
+#include "cos_api.h"
+#include "cos_sys_config.h"
+#include "mock_server.h"
+#include "util/simple_mutex.h"
+
+namespace qcloud_cos {
+
+namespace {
+const char kLocalFile[] = "./retry_sign_test.dat";
+
+std::string GetAccessKey(const std::string& auth) {
+    size_t begin = auth.find("q-ak=");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    begin += 5;
+    return auth.substr(begin, auth.find('&', begin) - begin);
+}
+} // namespace
+
+// 记录命中m_fail_method/m_fail_uri的请求所用的密钥,
+// 首次命中时替换客户端的密钥并返回503, 使请求在重试时使用新密钥
+struct RetrySignServerState {
+    RetrySignServerState() : m_client(NULL), m_failed(false) {}
+
+    SimpleMutex m_mutex;
+    CosAPI* m_client;
+    std::string m_fail_method;
+    std::string m_fail_uri;
+    bool m_failed;
+    std::vector<std::string> m_access_keys;
+    std::vector<std::string> m_tokens;
+};
+
+class RetrySignRequestHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    explicit RetrySignRequestHandler(RetrySignServerState* state) : m_state(state) {}
+
+    virtual void handleRequest(Poco::Net::HTTPServerRequest& req,
+                               Poco::Net::HTTPServerResponse& resp) {
+        std::string method = req.getMethod();
+        std::string uri = req.getURI();
+        std::ostringstream body;
+        Poco::StreamCopier::copyStream(req.stream(), body);
+
+        SimpleMutexLocker locker(&m_state->m_mutex);
+        if (method == m_state->m_fail_method && uri.find(m_state->m_fail_uri) != std::string::npos) {
+            m_state->m_access_keys.push_back(GetAccessKey(req.get("Authorization", "")));
+            m_state->m_tokens.push_back(req.get("x-cos-security-token", ""));
+            if (!m_state->m_failed) {
+                m_state->m_failed = true;
+                m_state->m_client->SetCredentail("new_access_key", "new_secret_key", "new_token");
+                resp.setStatus(Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+                resp.send() << "<Error><Code>ServiceUnavailable</Code>"
+                            << "<Message>mock error</Message></Error>";
+                return;
+            }
+        }
+
+        resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+        if (method == "POST" && uri.find("uploads") != std::string::npos) {
+            resp.send() << "<InitiateMultipartUploadResult><Bucket>bucket_test</Bucket>"
+                        << "<Key>object_test</Key><UploadId>upload_id</UploadId>"
+                        << "</InitiateMultipartUploadResult>";
+        } else if (method == "POST") {
+            resp.send() << "<CompleteMultipartUploadResult><Bucket>bucket_test</Bucket>"
+                        << "<Key>object_test</Key><ETag>\"complete_etag\"</ETag>"
+                        << "</CompleteMultipartUploadResult>";
+        } else {
+            // 分块上传会校验ETag与分块的md5一致
+            Poco::MD5Engine md5;
+            md5.update(body.str());
+            resp.add("ETag", "\"" + Poco::DigestEngine::digestToHex(md5.digest()) + "\"");
+            resp.setContentLength(0);
+            resp.send().flush();
+        }
+    }
+
+private:
+    RetrySignServerState* m_state;
+};
+
+// 验证重试时使用最新的密钥重新签名
+class RetrySignTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        m_server = new LocalHttpServer(
+            new LocalHandlerFactory<RetrySignRequestHandler, RetrySignServerState>(&m_state));
+        m_sys_config.UseLocalServer(m_server->GetAddr());
+        CosSysConfig::SetMaxRetryTimes(2);
+        CosSysConfig::SetRetryBaseDelayInms(1);
+
+        CosConfig config(7777, "access_key", "secret_key", "cn-north");
+        m_client = new CosAPI(config);
+        m_state.m_client = m_client;
+    }
+
+    virtual void TearDown() {
+        delete m_client;
+        delete m_server;
+    }
+
+    void ExpectResigned() {
+        ASSERT_EQ(2u, m_state.m_access_keys.size());
+        EXPECT_EQ("access_key", m_state.m_access_keys[0]);
+        EXPECT_EQ("", m_state.m_tokens[0]);
+        EXPECT_EQ("new_access_key", m_state.m_access_keys[1]);
+        EXPECT_EQ("new_token", m_state.m_tokens[1]);
+    }
+
+    ScopedSysConfig m_sys_config;
+    RetrySignServerState m_state;
+    LocalHttpServer* m_server;
+    CosAPI* m_client;
+};
+
+TEST_F(RetrySignTest, NormalActionTest) {
+    m_state.m_fail_method = "HEAD";
+    m_state.m_fail_uri = "/object_test";
+    HeadObjectReq req("buckettest-7777", "object_test");
+    HeadObjectResp resp;
+    CosResult result = m_client->HeadObject(req, &resp);
+    EXPECT_TRUE(result.IsSucc()) << result.GetErrorInfo();
+    EXPECT_EQ(2u, result.GetAttemptNum());
+    ExpectResigned();
+}
+
+TEST_F(RetrySignTest, UploadTaskTest) {
+    {
+        std::ofstream ofs(kLocalFile, std::ios::out | std::ios::trunc);
+        ofs << std::string(100 * 1024, 'x');
+    }
+    m_state.m_fail_method = "PUT";
+    m_state.m_fail_uri = "partNumber";
+    MultiUploadObjectReq req("buckettest-7777", "object_test", kLocalFile);
+    req.SetPartSize(1048576);
+    MultiUploadObjectResp resp;
+    CosResult result = m_client->MultiUploadObject(req, &resp);
+    EXPECT_TRUE(result.IsSucc()) << result.GetErrorInfo();
+    ExpectResigned();
+    remove(kLocalFile);
+}
+
+} // namespace qcloud_cos
@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+
+#include <sys/time.h>
+
+#include <iostream>
+#include <string>
+
+#include "util/sha1.h"
+
+namespace qcloud_cos {
+
+namespace {
+std::string PortableSha1Hex(const std::string& data) {
+    SHA_INFO sha;
+    ShaInit(&sha);
+    ShaUpdate(&sha, (SHA_BYTE*)data.data(), data.size());
+    unsigned char digest[SHA_DIGESTSIZE];
+    ShaFinal(digest, &sha);
+    unsigned char out[SHA_DIGESTSIZE * 2 + 1] = {0};
+    ShaOutput(digest, out);
+    return std::string((const char*)out, SHA_DIGESTSIZE * 2);
+}
+
+std::string Sha1Hex(const std::string& data) {
+    Sha1 sha1;
+    sha1.Append(data.data(), data.size());
+    return sha1.Final();
+}
+
+uint64_t NowInUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+} // namespace
+
+TEST(Sha1Test, NormalTest) {
+    EXPECT_EQ("da39a3ee5e6b4b0d3255bfef95601890afd80709", Sha1Hex(""));
+    EXPECT_EQ("a9993e364706816aba3e25717850c26c9cd0d89d", Sha1Hex("abc"));
+    EXPECT_EQ("84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+              Sha1Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+
+    // 分多次追加与一次追加结果一致, 且与可移植实现一致
+    std::string data;
+    for (int i = 0; i < 1000; ++i) {
+        data.push_back(static_cast<char>(i * 31 + 7));
+    }
+    for (size_t len = 0; len <= data.size(); len += 37) {
+        std::string part = data.substr(0, len);
+        Sha1 sha1;
+        sha1.Append(part.data(), part.size() / 2);
+        sha1.Append(part.data() + part.size() / 2, part.size() - part.size() / 2);
+        EXPECT_EQ(PortableSha1Hex(part), sha1.Final());
+    }
+}
+
+// 对比OpenSSL实现与原可移植实现在签名串常见长度下的耗时
+// 默认不运行, 需要时加--gtest_also_run_disabled_tests
+TEST(Sha1Test, DISABLED_Benchmark) {
+    const size_t sizes[] = {128, 512, 4096};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        std::string data(sizes[i], 'x');
+        const int rounds = 20000;
+        std::string portable_ret, openssl_ret;
+
+        uint64_t begin = NowInUs();
+        for (int r = 0; r < rounds; ++r) {
+            portable_ret = PortableSha1Hex(data);
+        }
+        uint64_t portable_cost = NowInUs() - begin;
+
+        begin = NowInUs();
+        for (int r = 0; r < rounds; ++r) {
+            openssl_ret = Sha1Hex(data);
+        }
+        uint64_t openssl_cost = NowInUs() - begin;
+
+        EXPECT_EQ(portable_ret, openssl_ret);
+        std::cout << "sha1 " << sizes[i] << " bytes: portable "
+                  << portable_cost * 1000 / rounds << " ns/op, openssl "
+                  << openssl_cost * 1000 / rounds << " ns/op" << std::endl;
+    }
+}
+
+} // namespace qcloud_cos
@@ -0,0 +1,247 @@
+#include "gtest/gtest.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include <boost/bind.hpp>
+
+#include "cos_sys_config.h"
+#include "mock_server.h"
+#include "util/task_executor.h"
+
+namespace qcloud_cos {
+
+namespace {
+// 组内任务的执行时长, 使同组任务有机会并发
+const unsigned kTaskDelayInms = 50;
+} // namespace
+
+// 记录任务的执行情况, 并可阻塞任务直至Open
+class TaskRecorder {
+public:
+    TaskRecorder() : m_is_open(true), m_running_num(0), m_max_running_num(0) {
+        pthread_mutex_init(&m_mutex, NULL);
+        pthread_cond_init(&m_cond, NULL);
+    }
+
+    ~TaskRecorder() {
+        pthread_cond_destroy(&m_cond);
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    void Close() {
+        pthread_mutex_lock(&m_mutex);
+        m_is_open = false;
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    void Open() {
+        pthread_mutex_lock(&m_mutex);
+        m_is_open = true;
+        pthread_cond_broadcast(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    void Run(int id, unsigned delay_in_ms) {
+        pthread_mutex_lock(&m_mutex);
+        m_started_ids.push_back(id);
+        ++m_running_num;
+        if (m_running_num > m_max_running_num) {
+            m_max_running_num = m_running_num;
+        }
+        pthread_cond_broadcast(&m_cond);
+        while (!m_is_open) {
+            pthread_cond_wait(&m_cond, &m_mutex);
+        }
+        pthread_mutex_unlock(&m_mutex);
+
+        usleep(delay_in_ms * 1000);
+
+        pthread_mutex_lock(&m_mutex);
+        --m_running_num;
+        m_finished_ids.push_back(id);
+        pthread_cond_broadcast(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    void WaitStarted(size_t num) {
+        pthread_mutex_lock(&m_mutex);
+        while (m_started_ids.size() < num) {
+            pthread_cond_wait(&m_cond, &m_mutex);
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    void WaitFinished(size_t num) {
+        pthread_mutex_lock(&m_mutex);
+        while (m_finished_ids.size() < num) {
+            pthread_cond_wait(&m_cond, &m_mutex);
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    std::vector<int> GetStartedIds() {
+        pthread_mutex_lock(&m_mutex);
+        std::vector<int> ids = m_started_ids;
+        pthread_mutex_unlock(&m_mutex);
+        return ids;
+    }
+
+    size_t GetFinishedNum() {
+        pthread_mutex_lock(&m_mutex);
+        size_t num = m_finished_ids.size();
+        pthread_mutex_unlock(&m_mutex);
+        return num;
+    }
+
+    unsigned GetMaxRunningNum() {
+        pthread_mutex_lock(&m_mutex);
+        unsigned num = m_max_running_num;
+        pthread_mutex_unlock(&m_mutex);
+        return num;
+    }
+
+private:
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    bool m_is_open;
+    unsigned m_running_num;
+    unsigned m_max_running_num;
+    std::vector<int> m_started_ids;
+    std::vector<int> m_finished_ids;
+};
+
+namespace {
+void ThrowTask() {
+    throw std::runtime_error("task fail");
+}
+} // namespace
+
+class TaskExecutorTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        CosSysConfig::SetLogOutType(COS_LOG_NULL);
+    }
+
+    ScopedSysConfig m_sys_config;
+    TaskRecorder m_recorder;
+};
+
+TEST_F(TaskExecutorTest, SubmitTest) {
+    TaskExecutorStats before;
+    TaskExecutor::Instance().GetStats(&before);
+
+    const int task_num = 64;
+    for (int i = 0; i < task_num; ++i) {
+        TaskExecutor::Instance().Submit(boost::bind(&TaskRecorder::Run, &m_recorder, i, 0));
+    }
+    m_recorder.WaitFinished(task_num);
+
+    TaskExecutorStats after;
+    TaskExecutor::Instance().GetStats(&after);
+    EXPECT_GT(after.m_thread_num, 0u);
+    EXPECT_EQ(0u, after.m_queued_task_num);
+    // 任务完成的计数在任务函数返回后更新, 等待其追上
+    while (after.m_completed_task_num < before.m_completed_task_num + task_num) {
+        usleep(1000);
+        TaskExecutor::Instance().GetStats(&after);
+    }
+    EXPECT_EQ(before.m_completed_task_num + task_num, after.m_completed_task_num);
+}
+
+TEST_F(TaskExecutorTest, QueueTest) {
+    // 执行器在首次提交任务时启动
+    TaskRecorder warmup;
+    TaskExecutor::Instance().Submit(boost::bind(&TaskRecorder::Run, &warmup, 0, 0));
+    warmup.WaitFinished(1);
+    TaskExecutorStats stats;
+    TaskExecutor::Instance().GetStats(&stats);
+    unsigned thread_num = stats.m_thread_num;
+    ASSERT_GT(thread_num, 0u);
+
+    // 阻塞所有工作线程, 之后提交的任务在共享队列中排队, 线程空闲后即被取走
+    m_recorder.Close();
+    for (unsigned i = 0; i < thread_num; ++i) {
+        TaskExecutor::Instance().Submit(boost::bind(&TaskRecorder::Run, &m_recorder, -1, 0));
+    }
+    m_recorder.WaitStarted(thread_num);
+    TaskExecutor::Instance().GetStats(&stats);
+    EXPECT_EQ(stats.m_thread_num, stats.m_busy_thread_num);
+
+    const int task_num = 8;
+    for (int i = 0; i < task_num; ++i) {
+        TaskExecutor::Instance().Submit(boost::bind(&TaskRecorder::Run, &m_recorder, i, 0));
+    }
+    TaskExecutor::Instance().GetStats(&stats);
+    EXPECT_EQ(static_cast<uint64_t>(task_num), stats.m_queued_task_num);
+
+    m_recorder.Open();
+    m_recorder.WaitFinished(thread_num + task_num);
+    TaskExecutor::Instance().GetStats(&stats);
+    EXPECT_EQ(0u, stats.m_queued_task_num);
+}
+
+TEST_F(TaskExecutorTest, ExceptionTest) {
+    // 任务抛出的异常被忽略, 工作线程继续执行后续任务
+    TaskExecutorStats stats;
+    TaskExecutor::Instance().GetStats(&stats);
+    for (unsigned i = 0; i < stats.m_thread_num + 1; ++i) {
+        TaskExecutor::Instance().Submit(ThrowTask);
+    }
+    TaskExecutor::Instance().Submit(boost::bind(&TaskRecorder::Run, &m_recorder, 0, 0));
+    m_recorder.WaitFinished(1);
+}
+
+TEST_F(TaskExecutorTest, GroupConcurrencyTest) {
+    const int task_num = 16;
+    {
+        TaskGroup group(3);
+        for (int i = 0; i < task_num; ++i) {
+            group.Schedule(boost::bind(&TaskRecorder::Run, &m_recorder, i, kTaskDelayInms));
+        }
+        group.Wait();
+        EXPECT_EQ(static_cast<size_t>(task_num), m_recorder.GetFinishedNum());
+    }
+    EXPECT_EQ(3u, m_recorder.GetMaxRunningNum());
+
+    // 0视为1
+    TaskRecorder recorder;
+    TaskGroup group(0);
+    for (int i = 0; i < 4; ++i) {
+        group.Schedule(boost::bind(&TaskRecorder::Run, &recorder, i, kTaskDelayInms));
+    }
+    group.Wait();
+    EXPECT_EQ(1u, recorder.GetMaxRunningNum());
+}
+
+TEST_F(TaskExecutorTest, GroupPendingTest) {
+    m_recorder.Close();
+    TaskGroup group(1);
+    const int task_num = 6;
+    for (int i = 0; i < task_num; ++i) {
+        group.Schedule(boost::bind(&TaskRecorder::Run, &m_recorder, i, 0));
+    }
+    m_recorder.WaitStarted(1);
+
+    // 超出配额的任务在组内排队, 不进入执行器的队列
+    TaskExecutorStats stats;
+    TaskExecutor::Instance().GetStats(&stats);
+    EXPECT_EQ(0u, stats.m_queued_task_num);
+    EXPECT_EQ(1u, m_recorder.GetStartedIds().size());
+
+    // 组内任务完成后, 名额按提交顺序交给排队的任务
+    m_recorder.Open();
+    group.Wait();
+    EXPECT_EQ(static_cast<size_t>(task_num), m_recorder.GetFinishedNum());
+    std::vector<int> started_ids = m_recorder.GetStartedIds();
+    ASSERT_EQ(static_cast<size_t>(task_num), started_ids.size());
+    for (int i = 0; i < task_num; ++i) {
+        EXPECT_EQ(i, started_ids[i]);
+    }
+    EXPECT_EQ(1u, m_recorder.GetMaxRunningNum());
+}
+
+} // namespace qcloud_cos
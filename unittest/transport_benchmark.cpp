@@ -0,0 +1,159 @@
+// 对比各HTTP传输层的吞吐与延时, 请求发往进程内启动的mock server
+// 用法: transport_benchmark [并发线程数, 默认16] [每个线程的请求数, 默认50]
+// curl传输层需在编译时开启ENABLE_CURL_TRANSPORT, 否则跳过
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Poco/Net/HTTPServer.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/ServerSocket.h"
+
+#include "cos_sys_config.h"
+#include "mock_server.h"
+#include "util/body_source.h"
+#include "util/canonical_request.h"
+#include "util/http_sender.h"
+#include "util/http_transport.h"
+#include "util/string_util.h"
+
+using namespace qcloud_cos;
+
+namespace {
+// mock server按host解析bucket和appid
+const char kMockHost[] = "bucket_test-7777.cn-north.myqcloud.com";
+// PUT请求体大小, GET的响应体固定为mock server返回的1M
+const size_t kPutBodySize = 256 * 1024;
+
+struct BenchThreadContext {
+    std::string m_url;
+    std::string m_method;
+    unsigned m_request_num;
+    const std::string* m_put_body;
+    std::vector<uint64_t> m_latencies_in_us;
+    unsigned m_fail_num;
+    RequestTiming m_timing;
+};
+
+void* BenchThread(void* arg) {
+    BenchThreadContext* ctx = static_cast<BenchThreadContext*>(arg);
+    std::map<std::string, std::string> req_headers;
+    req_headers["Host"] = kMockHost;
+    std::map<std::string, std::string> params;
+    CanonicalRequest req_params(params);
+    size_t body_len = ctx->m_method == "PUT" ? ctx->m_put_body->size() : 0;
+
+    for (unsigned i = 0; i < ctx->m_request_num; ++i) {
+        BufferBodySource body(ctx->m_put_body->data(), body_len);
+        std::map<std::string, std::string> resp_headers;
+        std::string resp_body;
+        std::string err_msg;
+        RequestContext req_ctx;
+        uint64_t start_in_us = HttpSender::GetMonotonicTimeInUs();
+        int http_code = HttpSender::SendRequest(ctx->m_method, ctx->m_url, req_params,
+                                                req_headers, body, 3000, 10000,
+                                                &resp_headers, &resp_body, &err_msg,
+                                                false, &req_ctx);
+        ctx->m_latencies_in_us.push_back(HttpSender::GetMonotonicTimeInUs() - start_in_us);
+        if (http_code != 200) {
+            ++ctx->m_fail_num;
+        }
+        ctx->m_timing.Add(req_ctx.GetTiming());
+    }
+    return NULL;
+}
+
+void RunBenchmark(const std::string& transport, const std::string& url,
+                  const std::string& method, unsigned thread_num, unsigned request_num) {
+    CosSysConfig::SetHttpTransport(transport);
+    if (HttpTransport::GetTransport()->GetName() != transport) {
+        std::cout << transport << " transport is unavailable, skip" << std::endl;
+        return;
+    }
+
+    std::string put_body(kPutBodySize, 'x');
+    std::vector<BenchThreadContext> contexts(thread_num);
+    std::vector<pthread_t> tids(thread_num);
+    uint64_t start_in_us = HttpSender::GetMonotonicTimeInUs();
+    for (unsigned i = 0; i < thread_num; ++i) {
+        contexts[i].m_url = url;
+        contexts[i].m_method = method;
+        contexts[i].m_request_num = request_num;
+        contexts[i].m_put_body = &put_body;
+        contexts[i].m_fail_num = 0;
+        pthread_create(&tids[i], NULL, BenchThread, &contexts[i]);
+    }
+    for (unsigned i = 0; i < thread_num; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    uint64_t elapsed_in_us = HttpSender::GetMonotonicTimeInUs() - start_in_us;
+
+    std::vector<uint64_t> latencies;
+    unsigned fail_num = 0;
+    RequestTiming timing;
+    for (unsigned i = 0; i < thread_num; ++i) {
+        latencies.insert(latencies.end(), contexts[i].m_latencies_in_us.begin(),
+                         contexts[i].m_latencies_in_us.end());
+        fail_num += contexts[i].m_fail_num;
+        timing.Add(contexts[i].m_timing);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    if (latencies.empty() || elapsed_in_us == 0) {
+        return;
+    }
+
+    double qps = latencies.size() * 1000000.0 / elapsed_in_us;
+    double mb_per_s = (timing.m_bytes_sent + timing.m_bytes_received) / 1048576.0
+        * 1000000.0 / elapsed_in_us;
+    std::cout << std::left << std::setw(6) << transport << std::setw(5) << method
+              << " requests=" << latencies.size()
+              << " fail=" << fail_num
+              << " qps=" << std::fixed << std::setprecision(1) << qps
+              << " MB/s=" << mb_per_s
+              << " p50_us=" << latencies[latencies.size() / 2]
+              << " p99_us=" << latencies[latencies.size() * 99 / 100]
+              << " new_sessions=" << timing.m_new_session_num << std::endl;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned thread_num = argc > 1 ? atoi(argv[1]) : 16;
+    unsigned request_num = argc > 2 ? atoi(argv[2]) : 50;
+    if (thread_num == 0 || request_num == 0) {
+        std::cerr << "usage: " << argv[0] << " [thread_num] [request_num_per_thread]" << std::endl;
+        return -1;
+    }
+
+    CosSysConfig::SetLogOutType(COS_LOG_NULL);
+    CosSysConfig::SetKeepAlive(true);
+    CosSysConfig::SetMaxIdleSessionsPerHost(thread_num);
+
+    // 监听任意可用端口, 服务线程数与并发数一致, 避免服务端成为瓶颈
+    Poco::Net::ServerSocket server_socket(0);
+    Poco::Net::HTTPServerParams* server_params = new Poco::Net::HTTPServerParams();
+    server_params->setMaxThreads(thread_num);
+    server_params->setMaxQueued(thread_num * 4);
+    server_params->setKeepAlive(true);
+    Poco::Net::HTTPServer server(new MockRequestHandlerFactory(), server_socket, server_params);
+    server.start();
+
+    std::string url = "http://127.0.0.1:"
+        + StringUtil::IntToString(server_socket.address().port()) + "/bench_object";
+    std::cout << "threads=" << thread_num << " requests_per_thread=" << request_num << std::endl;
+    const char* transports[] = {"poco", "curl"};
+    for (size_t i = 0; i < sizeof(transports) / sizeof(transports[0]); ++i) {
+        RunBenchmark(transports[i], url, "GET", thread_num, request_num);
+        RunBenchmark(transports[i], url, "PUT", thread_num, request_num);
+    }
+
+    server.stop();
+    return 0;
+}
@@ -0,0 +1,270 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cos_api.h"
+#include "cos_sys_config.h"
+#include "mock_server.h"
+#include "op/upload_checkpoint.h"
+#include "util/file_util.h"
+#include "util/simple_mutex.h"
+
+namespace qcloud_cos {
+
+namespace {
+const char kCheckpointFile[] = "./upload_checkpoint_test.cp";
+const char kLocalFile[] = "./upload_checkpoint_test.dat";
+
+bool IsFileExist(const std::string& path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+} // namespace
+
+TEST(UploadCheckpointTest, LoadTest) {
+    {
+        UploadCheckpoint checkpoint(kCheckpointFile);
+        ASSERT_TRUE(checkpoint.Create("upload_id_1", 100, 200, 1048576));
+        EXPECT_TRUE(checkpoint.AppendPart(1, "\"etag_1\""));
+        EXPECT_TRUE(checkpoint.AppendPart(3, "\"etag_3\""));
+    }
+
+    // 模拟进程中断时只写了一半的行
+    {
+        std::ofstream ofs(kCheckpointFile, std::ios::out | std::ios::app);
+        ofs << "part=4";
+    }
+
+    UploadCheckpoint checkpoint(kCheckpointFile);
+    ASSERT_TRUE(checkpoint.Load());
+    EXPECT_EQ("upload_id_1", checkpoint.GetUploadId());
+    EXPECT_TRUE(checkpoint.IsMatch(100, 200, 1048576));
+    ASSERT_EQ(2u, checkpoint.GetParts().size());
+    EXPECT_EQ("\"etag_1\"", checkpoint.GetParts().find(1)->second);
+    EXPECT_EQ("\"etag_3\"", checkpoint.GetParts().find(3)->second);
+
+    checkpoint.Remove();
+    EXPECT_FALSE(IsFileExist(kCheckpointFile));
+    EXPECT_FALSE(checkpoint.Load());
+
+    // 缺少upload_id或part_size的断点文件无效
+    {
+        std::ofstream ofs(kCheckpointFile, std::ios::out | std::ios::trunc);
+        ofs << "file_size=100\npart=1 etag_1\n";
+    }
+    EXPECT_FALSE(UploadCheckpoint(kCheckpointFile).Load());
+    remove(kCheckpointFile);
+}
+
+TEST(UploadCheckpointTest, MismatchTest) {
+    UploadCheckpoint checkpoint(kCheckpointFile);
+    ASSERT_TRUE(checkpoint.Create("upload_id_1", 100, 200, 1048576));
+    EXPECT_FALSE(checkpoint.IsMatch(101, 200, 1048576));
+    EXPECT_FALSE(checkpoint.IsMatch(100, 201, 1048576));
+    EXPECT_FALSE(checkpoint.IsMatch(100, 200, 2097152));
+
+    EXPECT_TRUE(checkpoint.AppendPart(1, "\"etag_1\""));
+    EXPECT_TRUE(checkpoint.AppendPart(2, "\"etag_2\""));
+    EXPECT_TRUE(checkpoint.AppendPart(3, "\"etag_3\""));
+
+    // 服务端ETag不带引号时也视为一致; ETag不一致或服务端不存在的分块需要重传
+    std::vector<Part> server_parts(4);
+    server_parts[0].m_part_num = 1;
+    server_parts[0].m_etag = "etag_1";
+    server_parts[1].m_part_num = 2;
+    server_parts[1].m_etag = "\"etag_2_new\"";
+    server_parts[2].m_part_num = 4;
+    server_parts[2].m_etag = "\"etag_4\"";
+    server_parts[3].m_part_num = 5;
+    server_parts[3].m_etag = "\"etag_5\"";
+
+    std::map<uint64_t, std::string> uploaded_parts;
+    checkpoint.MatchUploadedParts(server_parts, &uploaded_parts);
+    ASSERT_EQ(1u, uploaded_parts.size());
+    EXPECT_EQ("\"etag_1\"", uploaded_parts[1]);
+    checkpoint.Remove();
+}
+
+// 分块上传相关请求的桩, 可指定ListParts和Abort返回的状态码
+struct MultiUploadServerState {
+    MultiUploadServerState() : m_list_status(200), m_abort_status(204),
+                               m_init_num(0), m_list_num(0), m_part_num(0),
+                               m_complete_num(0), m_abort_num(0) {}
+
+    SimpleMutex m_mutex;
+    int m_list_status;
+    std::string m_list_error_code;
+    int m_abort_status;
+    int m_init_num;
+    int m_list_num;
+    int m_part_num;
+    int m_complete_num;
+    int m_abort_num;
+};
+
+class MultiUploadRequestHandler : public Poco::Net::HTTPRequestHandler {
+public:
+    explicit MultiUploadRequestHandler(MultiUploadServerState* state) : m_state(state) {}
+
+    virtual void handleRequest(Poco::Net::HTTPServerRequest& req,
+                               Poco::Net::HTTPServerResponse& resp) {
+        std::string method = req.getMethod();
+        std::string uri = req.getURI();
+        std::ofstream null_stream("/dev/null");
+        Poco::StreamCopier::copyStream(req.stream(), null_stream);
+
+        SimpleMutexLocker locker(&m_state->m_mutex);
+        if (method == "POST" && uri.find("uploads") != std::string::npos) {
+            ++m_state->m_init_num;
+            resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            resp.send() << "<InitiateMultipartUploadResult><Bucket>bucket_test</Bucket>"
+                        << "<Key>object_test</Key><UploadId>new_upload_id</UploadId>"
+                        << "</InitiateMultipartUploadResult>";
+        } else if (method == "GET" && uri.find("uploadId") != std::string::npos) {
+            ++m_state->m_list_num;
+            SendStatus(resp, m_state->m_list_status, m_state->m_list_error_code);
+        } else if (method == "PUT" && uri.find("partNumber") != std::string::npos) {
+            ++m_state->m_part_num;
+            resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            resp.add("ETag", "\"part_etag\"");
+            resp.send().flush();
+        } else if (method == "POST" && uri.find("uploadId") != std::string::npos) {
+            ++m_state->m_complete_num;
+            resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            resp.send() << "<CompleteMultipartUploadResult><Bucket>bucket_test</Bucket>"
+                        << "<Key>object_test</Key><ETag>\"complete_etag\"</ETag>"
+                        << "</CompleteMultipartUploadResult>";
+        } else if (method == "DELETE") {
+            ++m_state->m_abort_num;
+            SendStatus(resp, m_state->m_abort_status, "InternalError");
+        } else {
+            SendStatus(resp, 400, "InvalidRequest");
+        }
+    }
+
+private:
+    static void SendStatus(Poco::Net::HTTPServerResponse& resp, int status,
+                           const std::string& error_code) {
+        resp.setStatus(static_cast<Poco::Net::HTTPResponse::HTTPStatus>(status));
+        if (status < 300) {
+            resp.setContentLength(0);
+            resp.send().flush();
+            return;
+        }
+        resp.send() << "<Error><Code>" << error_code << "</Code>"
+                    << "<Message>mock error</Message></Error>";
+    }
+
+    MultiUploadServerState* m_state;
+};
+
+// 通过本地桩服务验证断点续传时对已有upload_id的处理
+class UploadResumeTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        m_server = new LocalHttpServer(
+            new LocalHandlerFactory<MultiUploadRequestHandler, MultiUploadServerState>(&m_state));
+        m_sys_config.UseLocalServer(m_server->GetAddr());
+        CosSysConfig::SetMaxRetryTimes(0);
+
+        std::ofstream ofs(kLocalFile, std::ios::out | std::ios::trunc);
+        ofs << std::string(2 * 1024 * 1024, 'x');
+        ofs.close();
+        m_file_size = FileUtil::GetFileLen(kLocalFile);
+        m_file_mtime = FileUtil::GetFileMtime(kLocalFile);
+
+        m_config = new CosConfig(7777, "access_key", "secret_key", "cn-north");
+        m_client = new CosAPI(*m_config);
+    }
+
+    virtual void TearDown() {
+        delete m_client;
+        delete m_config;
+        delete m_server;
+        remove(kLocalFile);
+        remove(kCheckpointFile);
+    }
+
+    // 写入上次上传留下的断点文件, 记录的文件大小可与本地文件不一致
+    void CreateCheckpoint(uint64_t file_size) {
+        UploadCheckpoint checkpoint(kCheckpointFile);
+        ASSERT_TRUE(checkpoint.Create("old_upload_id", file_size, m_file_mtime, 1048576));
+        ASSERT_TRUE(checkpoint.AppendPart(1, "\"part_etag\""));
+    }
+
+    CosResult Upload() {
+        MultiUploadObjectReq req("buckettest-7777", "object_test", kLocalFile);
+        req.SetPartSize(1048576);
+        req.SetCheckpointFile(kCheckpointFile);
+        MultiUploadObjectResp resp;
+        return m_client->MultiUploadObject(req, &resp);
+    }
+
+    ScopedSysConfig m_sys_config;
+    MultiUploadServerState m_state;
+    LocalHttpServer* m_server;
+    CosConfig* m_config;
+    CosAPI* m_client;
+    uint64_t m_file_size;
+    uint64_t m_file_mtime;
+};
+
+TEST_F(UploadResumeTest, NoSuchUploadTest) {
+    CreateCheckpoint(m_file_size);
+    m_state.m_list_status = 404;
+    m_state.m_list_error_code = "NoSuchUpload";
+
+    CosResult result = Upload();
+    EXPECT_TRUE(result.IsSucc()) << result.GetErrorInfo();
+    EXPECT_EQ(1, m_state.m_list_num);
+    EXPECT_EQ(1, m_state.m_init_num);
+    EXPECT_EQ(2, m_state.m_part_num);
+    EXPECT_EQ(1, m_state.m_complete_num);
+    EXPECT_FALSE(IsFileExist(kCheckpointFile));
+}
+
+TEST_F(UploadResumeTest, ListPartsFailTest) {
+    // 无法确认upload_id是否有效时不新建上传, 保留断点文件供下次续传
+    const int statuses[] = {403, 404, 503};
+    const char* error_codes[] = {"AccessDenied", "NoSuchBucket", "ServiceUnavailable"};
+    for (int i = 0; i < 3; ++i) {
+        CreateCheckpoint(m_file_size);
+        m_state.m_list_status = statuses[i];
+        m_state.m_list_error_code = error_codes[i];
+
+        CosResult result = Upload();
+        EXPECT_FALSE(result.IsSucc());
+        EXPECT_EQ(statuses[i], result.GetHttpStatus());
+        EXPECT_EQ(0, m_state.m_init_num);
+        EXPECT_EQ(0, m_state.m_part_num);
+        EXPECT_TRUE(IsFileExist(kCheckpointFile));
+    }
+}
+
+TEST_F(UploadResumeTest, FileChangedTest) {
+    // 本地文件已变化, 旧上传Abort失败时不新建上传
+    CreateCheckpoint(m_file_size + 1);
+    m_state.m_abort_status = 500;
+    CosResult result = Upload();
+    EXPECT_FALSE(result.IsSucc());
+    EXPECT_EQ(1, m_state.m_abort_num);
+    EXPECT_EQ(0, m_state.m_init_num);
+    EXPECT_TRUE(IsFileExist(kCheckpointFile));
+
+    // Abort成功后重新上传
+    m_state.m_abort_status = 204;
+    result = Upload();
+    EXPECT_TRUE(result.IsSucc()) << result.GetErrorInfo();
+    EXPECT_EQ(2, m_state.m_abort_num);
+    EXPECT_EQ(0, m_state.m_list_num);
+    EXPECT_EQ(1, m_state.m_init_num);
+    EXPECT_EQ(2, m_state.m_part_num);
+    EXPECT_FALSE(IsFileExist(kCheckpointFile));
+}
+
+} // namespace qcloud_cos